@@ -14,6 +14,15 @@ set (WAMR_BUILD_REF_TYPES 1)
 set (WASM_ENABLE_LOG 1)
 set (WAMR_BUILD_SHARED_HEAP 1)
 
+# Guest profiling: WAMR prints its profiling data, Ocre captures it through WAMR_BH_VPRINTF
+if (OCRE_WAMR_PROFILING)
+    set (WAMR_BUILD_PERF_PROFILING 1)
+    set (WAMR_BUILD_MEMORY_PROFILING 1)
+    set (WAMR_BUILD_CUSTOM_NAME_SECTION 1)
+    set (WAMR_BUILD_COPY_CALL_STACK 1)
+    set (WAMR_BH_VPRINTF wamr_profile_vprintf)
+endif ()
+
 if (NOT DEFINED WAMR_BUILD_PLATFORM)
     set (WAMR_BUILD_PLATFORM "linux")
 endif()
@@ -0,0 +1,216 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_METRICS_H
+#define OCRE_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Counters and gauges of the Ocre Library
+ * @headerfile ocre.h <ocre/ocre.h>
+ *
+ * Counters only go up and are reset only when the process restarts. Gauges are set to the current value of what they
+ * measure.
+ */
+enum ocre_metric {
+	OCRE_METRIC_CONTAINERS = 0,		    /**< Gauge: containers that were created and not removed */
+	OCRE_METRIC_CONTAINER_CREATED_TOTAL,	    /**< Counter: transitions to CREATED */
+	OCRE_METRIC_CONTAINER_RUNNING_TOTAL,	    /**< Counter: transitions to RUNNING */
+	OCRE_METRIC_CONTAINER_PAUSED_TOTAL,	    /**< Counter: transitions to PAUSED */
+	OCRE_METRIC_CONTAINER_EXITED_TOTAL,	    /**< Counter: transitions to EXITED */
+	OCRE_METRIC_CONTAINER_STOPPED_TOTAL,	    /**< Counter: transitions to STOPPED */
+	OCRE_METRIC_CONTAINER_ERROR_TOTAL,	    /**< Counter: transitions to ERROR */
+	OCRE_METRIC_CONTAINER_RESTARTS_TOTAL,	    /**< Counter: restarts by a restart policy */
+	OCRE_METRIC_EVENTS_ENQUEUED_TOTAL,	    /**< Counter: events posted to an event queue */
+	OCRE_METRIC_EVENTS_DROPPED_TOTAL,	    /**< Counter: events lost because a queue was full or purged */
+	OCRE_METRIC_EVENTS_DELIVERED_TOTAL,	    /**< Counter: events handed to a container */
+	OCRE_METRIC_MESSAGES_PUBLISHED_TOTAL,	    /**< Counter: messages published */
+	OCRE_METRIC_MESSAGES_MATCHED_TOTAL,	    /**< Counter: subscriptions matching a published message */
+	OCRE_METRIC_MESSAGES_DROPPED_TOTAL,	    /**< Counter: matches that could not be delivered */
+	OCRE_METRIC_TIMER_FIRES_TOTAL,		    /**< Counter: timer expirations */
+	OCRE_METRIC_TIMER_OVERRUNS_TOTAL,	    /**< Counter: periodic timer expirations that were missed */
+	OCRE_METRIC_IMAGES,			    /**< Gauge: images in the image stores */
+	OCRE_METRIC_IMAGE_STORE_BYTES,		    /**< Gauge: size of the images in the image stores */
+	OCRE_METRIC_MEMORY_RESERVED_BYTES,	    /**< Gauge: memory reserved by containers against memory budgets */
+	OCRE_METRIC_CONTAINER_REJECTED_TOTAL,	    /**< Counter: containers rejected by memory budgets */
+	OCRE_METRIC_CONTAINER_THROTTLED_TOTAL,	    /**< Counter: containers suspended for using up their CPU quota */
+	OCRE_METRIC_COUNT,			    /**< Number of metrics, not a metric */
+};
+
+/**
+ * @brief Histograms of the Ocre Library
+ * @headerfile ocre.h <ocre/ocre.h>
+ *
+ * Histograms measure durations. They all share the same buckets, from one microsecond to ten seconds.
+ */
+enum ocre_histogram {
+	OCRE_HISTOGRAM_CONTAINER_CREATE = 0, /**< Time to create a container */
+	OCRE_HISTOGRAM_CONTAINER_START,	     /**< Time for a container to start running */
+	OCRE_HISTOGRAM_CONTAINER_STOP,	     /**< Time from a stop or kill request to the container exit */
+	OCRE_HISTOGRAM_MODULE_LOAD,	     /**< Time to read and load a WebAssembly module */
+	OCRE_HISTOGRAM_COUNT,		     /**< Number of histograms, not a histogram */
+};
+
+/**
+ * @brief Adds to a counter
+ *
+ * Lock-free and safe to call from any thread.
+ *
+ * @param metric The counter to add to
+ * @param value The value to add
+ */
+void ocre_metric_add(enum ocre_metric metric, uint64_t value);
+
+/**
+ * @brief Increments a counter
+ *
+ * @param metric The counter to increment
+ */
+static inline void ocre_metric_inc(enum ocre_metric metric)
+{
+	ocre_metric_add(metric, 1);
+}
+
+/**
+ * @brief Sets a gauge
+ *
+ * @param metric The gauge to set
+ * @param value The new value
+ */
+void ocre_metric_set(enum ocre_metric metric, int64_t value);
+
+/**
+ * @brief Adds to a gauge
+ *
+ * @param metric The gauge to update
+ * @param delta The value to add, can be negative
+ */
+void ocre_metric_gauge_add(enum ocre_metric metric, int64_t delta);
+
+/**
+ * @brief Records a duration in a histogram
+ *
+ * Lock-free and safe to call from any thread.
+ *
+ * @param histogram The histogram to update
+ * @param duration_ns The duration in nanoseconds
+ */
+void ocre_metric_observe(enum ocre_histogram histogram, uint64_t duration_ns);
+
+/**
+ * @brief Monotonic time to measure durations
+ *
+ * @return The current time in nanoseconds
+ */
+uint64_t ocre_metrics_now_ns(void);
+
+/**
+ * @brief Registers a function called before every dump
+ *
+ * Collectors update the gauges that are too expensive to keep up to date all the time, like the image store size.
+ *
+ * @param collect The function to call
+ * @param arg The argument passed to the function
+ *
+ * @return 0 on success, negative error number on failure
+ */
+int ocre_metrics_register_collector(void (*collect)(void *arg), void *arg);
+
+/**
+ * @brief Unregisters a collector
+ *
+ * @param collect The function registered with ocre_metrics_register_collector()
+ * @param arg The argument registered with ocre_metrics_register_collector()
+ */
+void ocre_metrics_unregister_collector(void (*collect)(void *arg), void *arg);
+
+/**
+ * @brief Dumps all the metrics in Prometheus text format
+ *
+ * Works like snprintf(): the output is truncated to fit in the buffer, and the length of the full output is returned.
+ *
+ * @param buf The buffer to write to. Can be NULL if size is zero
+ * @param size The size of the buffer
+ *
+ * @return The length of the full output, without the terminating null character
+ */
+size_t ocre_metrics_dump(char *buf, size_t size);
+
+/**
+ * @brief Destination of the periodic metrics dumps
+ * @headerfile ocre.h <ocre/ocre.h>
+ */
+struct ocre_metrics_sink {
+	/**
+	 * @brief Writes a dump
+	 *
+	 * @param arg The sink argument
+	 * @param data The metrics in Prometheus text format
+	 * @param len The length of the data
+	 *
+	 * @return 0 on success, negative error number on failure
+	 */
+	int (*write)(void *arg, const char *data, size_t len);
+
+	/**
+	 * @brief Releases the sink when it is stopped. Can be NULL
+	 *
+	 * @param arg The sink argument
+	 */
+	void (*close)(void *arg);
+
+	void *arg; /**< Argument passed to the sink functions */
+};
+
+/**
+ * @brief Initializes a sink that replaces a file with every dump
+ *
+ * The dump is written to a temporary file which is then renamed, so readers always see a complete dump. This works with
+ * the textfile collector of the Prometheus node exporter.
+ *
+ * @param sink The sink to initialize
+ * @param path The path of the file
+ *
+ * @return 0 on success, negative error number on failure
+ */
+int ocre_metrics_sink_file(struct ocre_metrics_sink *sink, const char *path);
+
+/**
+ * @brief Initializes a sink that sends every dump to a Unix socket
+ *
+ * A new stream connection is opened for every dump, so the listener can be restarted at any time. Dumps are skipped
+ * while nothing listens on the socket.
+ *
+ * @param sink The sink to initialize
+ * @param path The path of the socket
+ *
+ * @return 0 on success, -ENOTSUP if Unix sockets are not available, negative error number on failure
+ */
+int ocre_metrics_sink_unix(struct ocre_metrics_sink *sink, const char *path);
+
+/**
+ * @brief Starts writing the metrics to a sink periodically
+ *
+ * Only one sink can be active at a time. The sink is copied and owned by the metrics until ocre_metrics_stop_sink().
+ *
+ * @param sink The sink to write to
+ * @param interval_ms The time between dumps, in milliseconds
+ *
+ * @return 0 on success, -EBUSY if a sink is already active, negative error number on failure
+ */
+int ocre_metrics_start_sink(const struct ocre_metrics_sink *sink, unsigned int interval_ms);
+
+/**
+ * @brief Writes a last dump to the active sink, stops and closes it
+ *
+ * Does nothing if no sink is active.
+ */
+void ocre_metrics_stop_sink(void);
+
+#endif /* OCRE_METRICS_H */
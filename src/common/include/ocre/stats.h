@@ -0,0 +1,63 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_STATS_H
+#define OCRE_STATS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Call statistics of a native function
+ * @headerfile ocre.h <ocre/ocre.h>
+ *
+ * Filled by ocre_container_get_native_stats().
+ */
+struct ocre_native_stats {
+	const char *name;  /**< Name of the native function, as imported by the container */
+	uint64_t calls;	   /**< Number of calls */
+	uint64_t total_ns; /**< Total time spent in the native function, in nanoseconds */
+};
+
+/**
+ * @brief Memory usage of a container
+ * @headerfile ocre.h <ocre/ocre.h>
+ *
+ * Filled by ocre_container_get_memory_stats(). Covers the memory the runtime engine allocates from the host heap on
+ * behalf of the container.
+ */
+struct ocre_memory_stats {
+	uint64_t used;	   /**< Bytes allocated and not freed */
+	uint64_t reserved; /**< Bytes taken from the host heap, which the memory limit applies to */
+	uint64_t peak;	   /**< Highest number of reserved bytes */
+	uint64_t limit;	   /**< Memory limit, in bytes. Zero if unlimited */
+	uint64_t failed;   /**< Allocations that failed because of the memory limit */
+};
+
+/**
+ * @brief Memory budget of a context
+ * @headerfile ocre.h <ocre/ocre.h>
+ *
+ * Filled by ocre_context_get_memory_budget().
+ */
+struct ocre_budget_stats {
+	uint64_t budget;   /**< Memory the containers can reserve, in bytes. Zero if unlimited */
+	uint64_t reserved; /**< Bytes reserved by the containers of the context */
+	uint64_t rejected; /**< Containers not created because their footprint did not fit in the budget */
+};
+
+/**
+ * @brief Receives the call stacks sampled by ocre_container_sample()
+ *
+ * Each call is a line of the folded stack format used by flame graph tools.
+ *
+ * @param arg The argument given to ocre_container_sample()
+ * @param stack The function names of the call stack, outermost first, separated by semicolons
+ * @param count The number of samples taken with this call stack
+ */
+typedef void (*ocre_stack_callback_t)(void *arg, const char *stack, unsigned int count);
+
+#endif /* OCRE_STATS_H */
@@ -0,0 +1,112 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_TRACE_H
+#define OCRE_TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @brief A span being recorded
+ * @headerfile ocre.h <ocre/ocre.h>
+ *
+ * Use OCRE_TRACE_BEGIN() and OCRE_TRACE_END() instead of filling it directly.
+ */
+struct ocre_trace_span {
+	const char *category; /**< Category of the span, must be a string literal */
+	const char *name;     /**< Name of the span, must be a string literal */
+	uint64_t start_ns;    /**< Start time of the span */
+};
+
+#ifdef CONFIG_OCRE_TRACE
+
+/**
+ * @brief Starts a span
+ *
+ * Declares a local variable, so it must be in the same scope as the matching OCRE_TRACE_END(). Spans are removed at
+ * compile time when CONFIG_OCRE_TRACE is not set.
+ *
+ * @param span The name of the span variable
+ * @param category The category of the span, must be a string literal
+ * @param name The name of the span, must be a string literal
+ */
+#define OCRE_TRACE_BEGIN(span, category, name) struct ocre_trace_span span = {(category), (name), ocre_trace_now_ns()}
+
+/**
+ * @brief Ends a span and records it in the buffer of the calling thread
+ *
+ * @param span The name of the span variable
+ */
+#define OCRE_TRACE_END(span) ocre_trace_end(&(span))
+
+/**
+ * @brief Names the calling thread in the trace
+ *
+ * @param name The name of the thread
+ */
+#define OCRE_TRACE_THREAD_NAME(name) ocre_trace_thread_name(name)
+
+#else
+
+#define OCRE_TRACE_BEGIN(span, category, name)                                                                         \
+	do {                                                                                                           \
+	} while (0)
+
+#define OCRE_TRACE_END(span)                                                                                           \
+	do {                                                                                                           \
+	} while (0)
+
+#define OCRE_TRACE_THREAD_NAME(name)                                                                                   \
+	do {                                                                                                           \
+	} while (0)
+
+#endif
+
+/**
+ * @brief Monotonic time of the trace events
+ *
+ * @return The current time in nanoseconds
+ */
+uint64_t ocre_trace_now_ns(void);
+
+/**
+ * @brief Records a span that ended now
+ *
+ * Each thread records into its own buffer, so recording threads never wait for each other. When the buffer is full,
+ * the oldest spans are overwritten. Does nothing when tracing is disabled.
+ *
+ * @param span The span to record
+ */
+void ocre_trace_end(const struct ocre_trace_span *span);
+
+/**
+ * @brief Names the calling thread in the trace
+ *
+ * Threads are named "thread-N" unless they set a name. The name is copied.
+ *
+ * @param name The name of the thread
+ */
+void ocre_trace_thread_name(const char *name);
+
+/**
+ * @brief Drops all the recorded spans
+ */
+void ocre_trace_clear(void);
+
+/**
+ * @brief Writes the recorded spans in Chrome trace event JSON format
+ *
+ * The file can be opened with Perfetto (https://ui.perfetto.dev) or chrome://tracing. Recording goes on while the
+ * file is written.
+ *
+ * @param path The path of the file to write
+ *
+ * @return 0 on success, -ENOTSUP if tracing is disabled, negative error number on failure
+ */
+int ocre_trace_export(const char *path);
+
+#endif /* OCRE_TRACE_H */
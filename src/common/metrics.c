@@ -0,0 +1,393 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ocre/metrics.h>
+#include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
+
+LOG_MODULE_REGISTER(metrics, CONFIG_OCRE_LOG_LEVEL);
+
+#ifndef CONFIG_OCRE_METRICS_SHARDS
+#define CONFIG_OCRE_METRICS_SHARDS 1
+#endif
+
+#ifndef CONFIG_OCRE_METRICS_MAX_COLLECTORS
+#define CONFIG_OCRE_METRICS_MAX_COLLECTORS 4
+#endif
+
+enum metric_type {
+	METRIC_COUNTER,
+	METRIC_GAUGE,
+	METRIC_HISTOGRAM,
+};
+
+static const char *const metric_types[] = {"counter", "gauge", "histogram"};
+
+struct metric_info {
+	const char *name;
+	const char *labels;
+	const char *help;
+	enum metric_type type;
+};
+
+/* Metrics sharing a name must be next to each other, and only the first one has the help that goes in the HELP and TYPE
+ * lines
+ */
+
+static const struct metric_info metrics[OCRE_METRIC_COUNT] = {
+	[OCRE_METRIC_CONTAINERS] = {"ocre_containers", NULL, "Containers that were created and not removed",
+				    METRIC_GAUGE},
+	[OCRE_METRIC_CONTAINER_CREATED_TOTAL] = {"ocre_container_transitions_total", "state=\"created\"",
+						 "Container status transitions", METRIC_COUNTER},
+	[OCRE_METRIC_CONTAINER_RUNNING_TOTAL] = {"ocre_container_transitions_total", "state=\"running\"", NULL,
+						 METRIC_COUNTER},
+	[OCRE_METRIC_CONTAINER_PAUSED_TOTAL] = {"ocre_container_transitions_total", "state=\"paused\"", NULL,
+						METRIC_COUNTER},
+	[OCRE_METRIC_CONTAINER_EXITED_TOTAL] = {"ocre_container_transitions_total", "state=\"exited\"", NULL,
+						METRIC_COUNTER},
+	[OCRE_METRIC_CONTAINER_STOPPED_TOTAL] = {"ocre_container_transitions_total", "state=\"stopped\"", NULL,
+						 METRIC_COUNTER},
+	[OCRE_METRIC_CONTAINER_ERROR_TOTAL] = {"ocre_container_transitions_total", "state=\"error\"", NULL,
+					       METRIC_COUNTER},
+	[OCRE_METRIC_CONTAINER_RESTARTS_TOTAL] = {"ocre_container_restarts_total", NULL,
+						  "Containers restarted by their restart policy", METRIC_COUNTER},
+	[OCRE_METRIC_EVENTS_ENQUEUED_TOTAL] = {"ocre_events_enqueued_total", NULL, "Events posted to an event queue",
+					       METRIC_COUNTER},
+	[OCRE_METRIC_EVENTS_DROPPED_TOTAL] = {"ocre_events_dropped_total", NULL,
+					      "Events lost because a queue was full or purged", METRIC_COUNTER},
+	[OCRE_METRIC_EVENTS_DELIVERED_TOTAL] = {"ocre_events_delivered_total", NULL, "Events handed to a container",
+						METRIC_COUNTER},
+	[OCRE_METRIC_MESSAGES_PUBLISHED_TOTAL] = {"ocre_messages_published_total", NULL, "Messages published",
+						  METRIC_COUNTER},
+	[OCRE_METRIC_MESSAGES_MATCHED_TOTAL] = {"ocre_messages_matched_total", NULL,
+						"Subscriptions matching a published message", METRIC_COUNTER},
+	[OCRE_METRIC_MESSAGES_DROPPED_TOTAL] = {"ocre_messages_dropped_total", NULL,
+						"Matching messages that could not be delivered", METRIC_COUNTER},
+	[OCRE_METRIC_TIMER_FIRES_TOTAL] = {"ocre_timer_fires_total", NULL, "Timer expirations", METRIC_COUNTER},
+	[OCRE_METRIC_TIMER_OVERRUNS_TOTAL] = {"ocre_timer_overruns_total", NULL,
+					      "Periodic timer expirations that were missed", METRIC_COUNTER},
+	[OCRE_METRIC_IMAGES] = {"ocre_images", NULL, "Images in the image stores", METRIC_GAUGE},
+	[OCRE_METRIC_IMAGE_STORE_BYTES] = {"ocre_image_store_bytes", NULL, "Size of the images in the image stores",
+					   METRIC_GAUGE},
+	[OCRE_METRIC_MEMORY_RESERVED_BYTES] = {"ocre_memory_reserved_bytes", NULL,
+					       "Memory reserved by containers against the memory budgets",
+					       METRIC_GAUGE},
+	[OCRE_METRIC_CONTAINER_REJECTED_TOTAL] = {"ocre_container_rejected_total", NULL,
+						  "Containers rejected because the memory budget was exhausted",
+						  METRIC_COUNTER},
+	[OCRE_METRIC_CONTAINER_THROTTLED_TOTAL] = {"ocre_container_throttled_total", NULL,
+						   "Containers suspended until the next period of their CPU quota",
+						   METRIC_COUNTER},
+};
+
+static const struct metric_info histograms[OCRE_HISTOGRAM_COUNT] = {
+	[OCRE_HISTOGRAM_CONTAINER_CREATE] = {"ocre_container_create_duration_seconds", NULL,
+					     "Time to create a container", METRIC_HISTOGRAM},
+	[OCRE_HISTOGRAM_CONTAINER_START] = {"ocre_container_start_duration_seconds", NULL,
+					    "Time for a container to start running", METRIC_HISTOGRAM},
+	[OCRE_HISTOGRAM_CONTAINER_STOP] = {"ocre_container_stop_duration_seconds", NULL,
+					   "Time from a stop or kill request to the container exit", METRIC_HISTOGRAM},
+	[OCRE_HISTOGRAM_MODULE_LOAD] = {"ocre_module_load_duration_seconds", NULL,
+					"Time to read and load a WebAssembly module", METRIC_HISTOGRAM},
+};
+
+/* Upper bounds of the histogram buckets, in nanoseconds. There is an extra +Inf bucket */
+
+static const uint64_t bucket_bounds[] = {
+	1000ULL,       2500ULL,       5000ULL,       // 1 us
+	10000ULL,      25000ULL,      50000ULL,      //
+	100000ULL,     250000ULL,     500000ULL,     //
+	1000000ULL,    2500000ULL,    5000000ULL,    // 1 ms
+	10000000ULL,   25000000ULL,   50000000ULL,   //
+	100000000ULL,  250000000ULL,  500000000ULL,  //
+	1000000000ULL, 2500000000ULL, 5000000000ULL, // 1 s
+	10000000000ULL,
+};
+
+#define NR_BUCKETS (sizeof(bucket_bounds) / sizeof(bucket_bounds[0]) + 1)
+
+/* Counters and histograms are spread over shards, so the CPUs do not fight over the same cache lines. Readers add up
+ * all the shards.
+ */
+
+struct shard {
+	atomic_uint_least64_t counters[OCRE_METRIC_COUNT];
+	atomic_uint_least64_t buckets[OCRE_HISTOGRAM_COUNT][NR_BUCKETS];
+	atomic_uint_least64_t sums[OCRE_HISTOGRAM_COUNT];
+} __attribute__((aligned(64)));
+
+static struct shard shards[CONFIG_OCRE_METRICS_SHARDS];
+static atomic_int_least64_t gauges[OCRE_METRIC_COUNT];
+
+struct collector {
+	void (*collect)(void *arg);
+	void *arg;
+};
+
+static pthread_mutex_t collectors_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct collector collectors[CONFIG_OCRE_METRICS_MAX_COLLECTORS];
+
+static struct shard *current_shard(void)
+{
+#if CONFIG_OCRE_METRICS_SHARDS > 1
+#ifdef __linux__
+	int cpu = sched_getcpu();
+	if (cpu >= 0) {
+		return &shards[(unsigned int)cpu % CONFIG_OCRE_METRICS_SHARDS];
+	}
+#endif
+	/* No way to know the CPU, give each thread its own shard instead */
+
+	static atomic_uint next_shard;
+	static __thread int thread_shard = -1;
+
+	if (thread_shard < 0) {
+		thread_shard = (int)(atomic_fetch_add_explicit(&next_shard, 1, memory_order_relaxed) %
+				     CONFIG_OCRE_METRICS_SHARDS);
+	}
+
+	return &shards[thread_shard];
+#else
+	return &shards[0];
+#endif
+}
+
+void ocre_metric_add(enum ocre_metric metric, uint64_t value)
+{
+	if ((unsigned int)metric >= OCRE_METRIC_COUNT) {
+		return;
+	}
+
+	atomic_fetch_add_explicit(&current_shard()->counters[metric], value, memory_order_relaxed);
+}
+
+void ocre_metric_set(enum ocre_metric metric, int64_t value)
+{
+	if ((unsigned int)metric >= OCRE_METRIC_COUNT) {
+		return;
+	}
+
+	atomic_store_explicit(&gauges[metric], value, memory_order_relaxed);
+}
+
+void ocre_metric_gauge_add(enum ocre_metric metric, int64_t delta)
+{
+	if ((unsigned int)metric >= OCRE_METRIC_COUNT) {
+		return;
+	}
+
+	atomic_fetch_add_explicit(&gauges[metric], delta, memory_order_relaxed);
+}
+
+void ocre_metric_observe(enum ocre_histogram histogram, uint64_t duration_ns)
+{
+	size_t bucket = 0;
+
+	if ((unsigned int)histogram >= OCRE_HISTOGRAM_COUNT) {
+		return;
+	}
+
+	while (bucket < NR_BUCKETS - 1 && duration_ns > bucket_bounds[bucket]) {
+		bucket++;
+	}
+
+	struct shard *shard = current_shard();
+
+	atomic_fetch_add_explicit(&shard->buckets[histogram][bucket], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&shard->sums[histogram], duration_ns, memory_order_relaxed);
+}
+
+uint64_t ocre_metrics_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int ocre_metrics_register_collector(void (*collect)(void *arg), void *arg)
+{
+	int ret = -ENOMEM;
+
+	if (!collect) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&collectors_mutex);
+
+	for (int i = 0; i < CONFIG_OCRE_METRICS_MAX_COLLECTORS; i++) {
+		if (!collectors[i].collect) {
+			collectors[i].collect = collect;
+			collectors[i].arg = arg;
+			ret = 0;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&collectors_mutex);
+
+	if (ret) {
+		LOG_ERR("No free collector slot (max: %d)", CONFIG_OCRE_METRICS_MAX_COLLECTORS);
+	}
+
+	return ret;
+}
+
+void ocre_metrics_unregister_collector(void (*collect)(void *arg), void *arg)
+{
+	pthread_mutex_lock(&collectors_mutex);
+
+	for (int i = 0; i < CONFIG_OCRE_METRICS_MAX_COLLECTORS; i++) {
+		if (collectors[i].collect == collect && collectors[i].arg == arg) {
+			collectors[i].collect = NULL;
+			collectors[i].arg = NULL;
+		}
+	}
+
+	pthread_mutex_unlock(&collectors_mutex);
+}
+
+/* Output of a dump, truncated to the buffer size */
+
+struct writer {
+	char *buf;
+	size_t size;
+	size_t len;
+};
+
+static void append(struct writer *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(struct writer *w, const char *fmt, ...)
+{
+	va_list args;
+
+	char *dst = w->len < w->size ? w->buf + w->len : NULL;
+	size_t avail = w->len < w->size ? w->size - w->len : 0;
+
+	va_start(args, fmt);
+	int n = vsnprintf(dst, avail, fmt, args);
+	va_end(args);
+
+	if (n > 0) {
+		w->len += (size_t)n;
+	}
+}
+
+static void append_header(struct writer *w, const struct metric_info *info)
+{
+	if (info->help) {
+		append(w, "# HELP %s %s\n", info->name, info->help);
+		append(w, "# TYPE %s %s\n", info->name, metric_types[info->type]);
+	}
+}
+
+static uint64_t sum_shards(const atomic_uint_least64_t *first)
+{
+	/* Same offset in every shard */
+
+	size_t offset = (const char *)first - (const char *)&shards[0];
+	uint64_t total = 0;
+
+	for (int i = 0; i < CONFIG_OCRE_METRICS_SHARDS; i++) {
+		total += atomic_load_explicit((const atomic_uint_least64_t *)((const char *)&shards[i] + offset),
+					      memory_order_relaxed);
+	}
+
+	return total;
+}
+
+static void dump_metric(struct writer *w, enum ocre_metric metric)
+{
+	const struct metric_info *info = &metrics[metric];
+
+	append_header(w, info);
+
+	append(w, "%s", info->name);
+
+	if (info->labels) {
+		append(w, "{%s}", info->labels);
+	}
+
+	if (info->type == METRIC_GAUGE) {
+		append(w, " %lld\n", (long long)atomic_load_explicit(&gauges[metric], memory_order_relaxed));
+	} else {
+		append(w, " %llu\n", (unsigned long long)sum_shards(&shards[0].counters[metric]));
+	}
+}
+
+static void dump_histogram(struct writer *w, enum ocre_histogram histogram)
+{
+	const struct metric_info *info = &histograms[histogram];
+	uint64_t count = 0;
+
+	append_header(w, info);
+
+	for (size_t bucket = 0; bucket < NR_BUCKETS; bucket++) {
+		count += sum_shards(&shards[0].buckets[histogram][bucket]);
+
+		if (bucket < NR_BUCKETS - 1) {
+			append(w, "%s_bucket{le=\"%g\"} %llu\n", info->name, (double)bucket_bounds[bucket] / 1e9,
+			       (unsigned long long)count);
+		} else {
+			append(w, "%s_bucket{le=\"+Inf\"} %llu\n", info->name, (unsigned long long)count);
+		}
+	}
+
+	append(w, "%s_sum %.9f\n", info->name, (double)sum_shards(&shards[0].sums[histogram]) / 1e9);
+	append(w, "%s_count %llu\n", info->name, (unsigned long long)count);
+}
+
+size_t ocre_metrics_dump(char *buf, size_t size)
+{
+	struct writer w = {
+		.buf = buf,
+		.size = buf ? size : 0,
+		.len = 0,
+	};
+
+	/* Let the collectors refresh their gauges first */
+
+	pthread_mutex_lock(&collectors_mutex);
+
+	for (int i = 0; i < CONFIG_OCRE_METRICS_MAX_COLLECTORS; i++) {
+		if (collectors[i].collect) {
+			collectors[i].collect(collectors[i].arg);
+		}
+	}
+
+	pthread_mutex_unlock(&collectors_mutex);
+
+	for (int metric = 0; metric < OCRE_METRIC_COUNT; metric++) {
+		dump_metric(&w, (enum ocre_metric)metric);
+	}
+
+	for (int histogram = 0; histogram < OCRE_HISTOGRAM_COUNT; histogram++) {
+		dump_histogram(&w, (enum ocre_histogram)histogram);
+	}
+
+	if (w.size && w.len >= w.size) {
+		w.buf[w.size - 1] = '\0';
+	}
+
+	return w.len;
+}
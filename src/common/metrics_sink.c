@@ -0,0 +1,327 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef __ZEPHYR__
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include <ocre/metrics.h>
+#include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
+
+LOG_MODULE_REGISTER(metrics_sink, CONFIG_OCRE_LOG_LEVEL);
+
+static pthread_mutex_t sink_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sink_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t sink_thread;
+static struct ocre_metrics_sink sink;
+static unsigned int sink_interval_ms;
+static bool sink_active;
+static bool sink_stop_requested;
+
+/* File sink */
+
+static int file_write(void *arg, const char *data, size_t len)
+{
+	const char *path = arg;
+	int ret = -1;
+
+	char *tmp_path = malloc(strlen(path) + strlen(".tmp") + 1);
+	if (!tmp_path) {
+		return -ENOMEM;
+	}
+
+	sprintf(tmp_path, "%s.tmp", path);
+
+	FILE *f = fopen(tmp_path, "w");
+	if (!f) {
+		ret = -errno;
+		LOG_ERR("Failed to open '%s': errno=%d", tmp_path, errno);
+		goto finish;
+	}
+
+	if (fwrite(data, 1, len, f) != len) {
+		ret = -EIO;
+		LOG_ERR("Failed to write '%s'", tmp_path);
+		fclose(f);
+		goto finish;
+	}
+
+	if (fclose(f)) {
+		ret = -errno;
+		LOG_ERR("Failed to close '%s': errno=%d", tmp_path, errno);
+		goto finish;
+	}
+
+	if (rename(tmp_path, path)) {
+		ret = -errno;
+		LOG_ERR("Failed to rename '%s' to '%s': errno=%d", tmp_path, path, errno);
+		goto finish;
+	}
+
+	ret = 0;
+
+finish:
+	free(tmp_path);
+
+	return ret;
+}
+
+static void path_close(void *arg)
+{
+	free(arg);
+}
+
+int ocre_metrics_sink_file(struct ocre_metrics_sink *sink, const char *path)
+{
+	if (!sink || !path || !*path) {
+		return -EINVAL;
+	}
+
+	sink->arg = strdup(path);
+	if (!sink->arg) {
+		return -ENOMEM;
+	}
+
+	sink->write = file_write;
+	sink->close = path_close;
+
+	return 0;
+}
+
+/* Unix socket sink */
+
+#ifndef __ZEPHYR__
+static int unix_write(void *arg, const char *data, size_t len)
+{
+	const char *path = arg;
+	struct sockaddr_un addr;
+	int ret = -1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		LOG_ERR("Failed to create socket: errno=%d", errno);
+		return -errno;
+	}
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		/* Nobody is listening, try again next time */
+
+		LOG_DBG("Failed to connect to '%s': errno=%d", path, errno);
+		ret = 0;
+		goto finish;
+	}
+
+	while (len) {
+#ifdef MSG_NOSIGNAL
+		ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+#else
+		ssize_t n = send(fd, data, len, 0);
+#endif
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n <= 0) {
+			LOG_WRN("Failed to send metrics to '%s': errno=%d", path, errno);
+			ret = -EIO;
+			goto finish;
+		}
+
+		data += n;
+		len -= (size_t)n;
+	}
+
+	ret = 0;
+
+finish:
+	close(fd);
+
+	return ret;
+}
+#endif
+
+int ocre_metrics_sink_unix(struct ocre_metrics_sink *sink, const char *path)
+{
+#ifdef __ZEPHYR__
+	return -ENOTSUP;
+#else
+	if (!sink || !path || !*path) {
+		return -EINVAL;
+	}
+
+	if (strlen(path) >= sizeof(((struct sockaddr_un *)0)->sun_path)) {
+		LOG_ERR("Socket path '%s' is too long", path);
+		return -ENAMETOOLONG;
+	}
+
+	sink->arg = strdup(path);
+	if (!sink->arg) {
+		return -ENOMEM;
+	}
+
+	sink->write = unix_write;
+	sink->close = path_close;
+
+	return 0;
+#endif
+}
+
+/* Periodic writer */
+
+static void write_dump(char **buf, size_t *size)
+{
+	size_t len = ocre_metrics_dump(*buf, *size);
+
+	if (len >= *size) {
+		/* Leave some room for the next dumps to grow */
+
+		size_t new_size = len + len / 2 + 1;
+
+		char *new_buf = realloc(*buf, new_size);
+		if (!new_buf) {
+			LOG_ERR("Failed to allocate %zu bytes for the metrics", new_size);
+			return;
+		}
+
+		*buf = new_buf;
+		*size = new_size;
+
+		len = ocre_metrics_dump(*buf, *size);
+		if (len >= *size) {
+			len = *size - 1;
+		}
+	}
+
+	int rc = sink.write(sink.arg, *buf, len);
+	if (rc) {
+		LOG_WRN("Failed to write metrics: rc=%d", rc);
+	}
+}
+
+static void *sink_thread_fn(void *arg)
+{
+	char *buf = NULL;
+	size_t size = 0;
+
+	(void)arg;
+
+	pthread_mutex_lock(&sink_mutex);
+
+	while (!sink_stop_requested) {
+		struct timespec deadline;
+
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += sink_interval_ms / 1000;
+		deadline.tv_nsec += (long)(sink_interval_ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+
+		while (!sink_stop_requested) {
+			if (pthread_cond_timedwait(&sink_cond, &sink_mutex, &deadline) == ETIMEDOUT) {
+				break;
+			}
+		}
+
+		/* Do not hold the lock while writing, the sink may be slow */
+
+		pthread_mutex_unlock(&sink_mutex);
+
+		write_dump(&buf, &size);
+
+		pthread_mutex_lock(&sink_mutex);
+	}
+
+	pthread_mutex_unlock(&sink_mutex);
+
+	free(buf);
+
+	return NULL;
+}
+
+int ocre_metrics_start_sink(const struct ocre_metrics_sink *new_sink, unsigned int interval_ms)
+{
+	int ret = 0;
+
+	if (!new_sink || !new_sink->write || !interval_ms) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&sink_mutex);
+
+	if (sink_active) {
+		LOG_ERR("A metrics sink is already active");
+		ret = -EBUSY;
+		goto finish;
+	}
+
+	sink = *new_sink;
+	sink_interval_ms = interval_ms;
+	sink_stop_requested = false;
+
+	int rc = pthread_create(&sink_thread, NULL, sink_thread_fn, NULL);
+	if (rc) {
+		LOG_ERR("Failed to create metrics sink thread: rc=%d", rc);
+		ret = -rc;
+		goto finish;
+	}
+
+	sink_active = true;
+
+	LOG_INF("Writing metrics every %u ms", interval_ms);
+
+finish:
+	pthread_mutex_unlock(&sink_mutex);
+
+	return ret;
+}
+
+void ocre_metrics_stop_sink(void)
+{
+	pthread_mutex_lock(&sink_mutex);
+
+	if (!sink_active) {
+		pthread_mutex_unlock(&sink_mutex);
+		return;
+	}
+
+	sink_stop_requested = true;
+	pthread_cond_signal(&sink_cond);
+
+	pthread_mutex_unlock(&sink_mutex);
+
+	/* The thread writes a last dump before leaving */
+
+	pthread_join(sink_thread, NULL);
+
+	if (sink.close) {
+		sink.close(sink.arg);
+	}
+
+	pthread_mutex_lock(&sink_mutex);
+
+	memset(&sink, 0, sizeof(sink));
+	sink_active = false;
+
+	pthread_mutex_unlock(&sink_mutex);
+}
@@ -0,0 +1,339 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ocre/trace.h>
+#include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
+
+LOG_MODULE_REGISTER(trace, CONFIG_OCRE_LOG_LEVEL);
+
+uint64_t ocre_trace_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#ifdef CONFIG_OCRE_TRACE
+
+#ifndef CONFIG_OCRE_TRACE_BUFFER_EVENTS
+#define CONFIG_OCRE_TRACE_BUFFER_EVENTS 4096
+#endif
+
+#ifndef CONFIG_OCRE_TRACE_MAX_THREADS
+#define CONFIG_OCRE_TRACE_MAX_THREADS 64
+#endif
+
+struct trace_event {
+	const char *category;
+	const char *name;
+	uint64_t start_ns;
+	uint64_t duration_ns;
+};
+
+/* Each thread records into its own buffer. The buffer mutex is only contended while exporting, the oldest events are
+ * overwritten when the buffer is full. Buffers are never freed: when a thread exits, its buffer is kept for the export
+ * and is reused by a new thread once the maximum number of buffers is reached.
+ */
+
+struct trace_buffer {
+	struct trace_buffer *next;
+	pthread_mutex_t mutex;
+	uint64_t count;
+	unsigned int tid;
+	bool in_use;
+	uint64_t released;
+	char thread_name[32];
+	struct trace_event events[CONFIG_OCRE_TRACE_BUFFER_EVENTS];
+};
+
+static pthread_mutex_t buffers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+static struct trace_buffer *_Atomic buffers;
+static unsigned int nr_buffers;
+static unsigned int next_tid;
+static uint64_t nr_released;
+static atomic_bool out_of_buffers_logged;
+
+/* Marks the threads that found no buffer, so they do not look for one on every span */
+
+static char no_buffer;
+
+static void release_buffer(void *arg)
+{
+	struct trace_buffer *buffer = arg;
+
+	if (arg == &no_buffer) {
+		return;
+	}
+
+	pthread_mutex_lock(&buffers_mutex);
+
+	buffer->in_use = false;
+	buffer->released = ++nr_released;
+
+	pthread_mutex_unlock(&buffers_mutex);
+}
+
+static void create_key(void)
+{
+	int rc = pthread_key_create(&buffer_key, release_buffer);
+	if (rc) {
+		LOG_ERR("Failed to create trace buffer key: rc=%d", rc);
+	}
+}
+
+static struct trace_buffer *new_buffer(void)
+{
+	struct trace_buffer *buffer = NULL;
+
+	if (nr_buffers < CONFIG_OCRE_TRACE_MAX_THREADS) {
+		buffer = calloc(1, sizeof(struct trace_buffer));
+		if (buffer) {
+			pthread_mutex_init(&buffer->mutex, NULL);
+			buffer->next = atomic_load(&buffers);
+			atomic_store(&buffers, buffer);
+			nr_buffers++;
+			return buffer;
+		}
+	}
+
+	/* Take over the buffer of the thread that exited first */
+
+	for (struct trace_buffer *b = atomic_load(&buffers); b; b = b->next) {
+		if (!b->in_use && (!buffer || b->released < buffer->released)) {
+			buffer = b;
+		}
+	}
+
+	return buffer;
+}
+
+static struct trace_buffer *get_buffer(void)
+{
+	pthread_once(&key_once, create_key);
+
+	void *value = pthread_getspecific(buffer_key);
+	if (value) {
+		return value == &no_buffer ? NULL : value;
+	}
+
+	pthread_mutex_lock(&buffers_mutex);
+
+	struct trace_buffer *buffer = new_buffer();
+	if (buffer) {
+		pthread_mutex_lock(&buffer->mutex);
+
+		buffer->count = 0;
+		buffer->in_use = true;
+		buffer->tid = ++next_tid;
+		snprintf(buffer->thread_name, sizeof(buffer->thread_name), "thread-%u", buffer->tid);
+
+		pthread_mutex_unlock(&buffer->mutex);
+	}
+
+	pthread_mutex_unlock(&buffers_mutex);
+
+	if (!buffer && !atomic_exchange(&out_of_buffers_logged, true)) {
+		LOG_WRN("All %d trace buffers are in use, some threads are not traced", CONFIG_OCRE_TRACE_MAX_THREADS);
+	}
+
+	pthread_setspecific(buffer_key, buffer ? (void *)buffer : (void *)&no_buffer);
+
+	return buffer;
+}
+
+void ocre_trace_end(const struct ocre_trace_span *span)
+{
+	uint64_t end_ns = ocre_trace_now_ns();
+
+	struct trace_buffer *buffer = get_buffer();
+	if (!buffer) {
+		return;
+	}
+
+	pthread_mutex_lock(&buffer->mutex);
+
+	struct trace_event *event = &buffer->events[buffer->count % CONFIG_OCRE_TRACE_BUFFER_EVENTS];
+
+	event->category = span->category;
+	event->name = span->name;
+	event->start_ns = span->start_ns;
+	event->duration_ns = end_ns - span->start_ns;
+
+	buffer->count++;
+
+	pthread_mutex_unlock(&buffer->mutex);
+}
+
+void ocre_trace_thread_name(const char *name)
+{
+	struct trace_buffer *buffer = get_buffer();
+	if (!buffer || !name) {
+		return;
+	}
+
+	pthread_mutex_lock(&buffer->mutex);
+
+	snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%s", name);
+
+	pthread_mutex_unlock(&buffer->mutex);
+}
+
+void ocre_trace_clear(void)
+{
+	for (struct trace_buffer *b = atomic_load(&buffers); b; b = b->next) {
+		pthread_mutex_lock(&b->mutex);
+		b->count = 0;
+		pthread_mutex_unlock(&b->mutex);
+	}
+}
+
+static void write_json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(f, "\\%c", *s);
+		} else if ((unsigned char)*s < 0x20) {
+			fprintf(f, "\\u%04x", (unsigned int)(unsigned char)*s);
+		} else {
+			fputc(*s, f);
+		}
+	}
+
+	fputc('"', f);
+}
+
+/* Chrome trace timestamps are in microseconds */
+
+static void write_us(FILE *f, uint64_t ns)
+{
+	fprintf(f, "%" PRIu64 ".%03u", ns / 1000, (unsigned int)(ns % 1000));
+}
+
+static void write_buffer(FILE *f, const struct trace_buffer *buffer, uint64_t count)
+{
+	uint64_t first = count > CONFIG_OCRE_TRACE_BUFFER_EVENTS ? count - CONFIG_OCRE_TRACE_BUFFER_EVENTS : 0;
+
+	fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", buffer->tid);
+	write_json_string(f, buffer->thread_name);
+	fprintf(f, "}}");
+
+	for (uint64_t i = first; i < count; i++) {
+		const struct trace_event *event = &buffer->events[i % CONFIG_OCRE_TRACE_BUFFER_EVENTS];
+
+		fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":", event->name,
+			event->category, buffer->tid);
+		write_us(f, event->start_ns);
+		fprintf(f, ",\"dur\":");
+		write_us(f, event->duration_ns);
+		fprintf(f, "}");
+	}
+}
+
+int ocre_trace_export(const char *path)
+{
+	int ret = 0;
+
+	if (!path || !*path) {
+		return -EINVAL;
+	}
+
+	/* Copy each buffer before writing it, so the thread is not blocked by the file I/O */
+
+	struct trace_buffer *copy = malloc(sizeof(struct trace_buffer));
+	if (!copy) {
+		return -ENOMEM;
+	}
+
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		ret = -errno;
+		LOG_ERR("Failed to open '%s': errno=%d", path, errno);
+		goto finish;
+	}
+
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ocre\"}}");
+
+	for (struct trace_buffer *b = atomic_load(&buffers); b; b = b->next) {
+		pthread_mutex_lock(&b->mutex);
+
+		uint64_t count = b->count;
+		size_t nr_events = CONFIG_OCRE_TRACE_BUFFER_EVENTS;
+		if (count < CONFIG_OCRE_TRACE_BUFFER_EVENTS) {
+			nr_events = (size_t)count;
+		}
+
+		copy->tid = b->tid;
+		memcpy(copy->thread_name, b->thread_name, sizeof(copy->thread_name));
+		memcpy(copy->events, b->events, nr_events * sizeof(struct trace_event));
+
+		pthread_mutex_unlock(&b->mutex);
+
+		if (count) {
+			write_buffer(f, copy, count);
+		}
+	}
+
+	fprintf(f, "\n]}\n");
+
+	if (ferror(f)) {
+		ret = -EIO;
+		LOG_ERR("Failed to write '%s'", path);
+	}
+
+	if (fclose(f) && !ret) {
+		ret = -errno;
+		LOG_ERR("Failed to close '%s': errno=%d", path, errno);
+	}
+
+finish:
+	free(copy);
+
+	return ret;
+}
+
+#else
+
+void ocre_trace_end(const struct ocre_trace_span *span)
+{
+	(void)span;
+}
+
+void ocre_trace_thread_name(const char *name)
+{
+	(void)name;
+}
+
+void ocre_trace_clear(void)
+{
+}
+
+int ocre_trace_export(const char *path)
+{
+	(void)path;
+
+	return -ENOTSUP;
+}
+
+#endif
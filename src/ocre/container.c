@@ -12,13 +12,18 @@
 #include <string.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
+#include <time.h>
 #include <ocre/ocre.h>
+#include <ocre/platform/config.h>
 #include <ocre/platform/log.h>
+#include <ocre/platform/thread.h>
 #include <ocre/runtime/vtable.h>
 
 #include "ocre.h"
 #include "container.h"
+#include "logs.h"
 #include "util/string_array.h"
 
 LOG_MODULE_REGISTER(container, CONFIG_OCRE_LOG_LEVEL);
@@ -39,38 +44,154 @@ struct ocre_container {
 	char **argv;
 	char **envp;
 	int exit_code;
+	unsigned int stop_timeout_ms;
+	bool reactor;
+	size_t stack_size;
+	char *cpuset;
+	enum ocre_sched_policy sched_policy;
+	int sched_priority;
+	uint64_t stop_requested_ns;
+	uint64_t start_ns;
+	bool started;
+	int start_result;
+	ocre_container_callback_t start_callback;
+	void *start_arg;
+	struct container_waiter *waiters;
+	ocre_container_status_hook_t status_hook;
+	void *status_hook_arg;
+	enum ocre_restart_policy restart_policy;
+	unsigned int restart_max_retries;
+	unsigned int restart_backoff_ms;
+	unsigned int restart_backoff_max_ms;
+	unsigned int restart_attempts;
+	unsigned int restart_count;
+	uint32_t restart_jitter;
+	struct container_log *log;
+	size_t footprint;
 };
 
 struct container_thread_params {
-	int (*func)(void *, sem_t *);
+	int (*func)(void *, void (*)(void *), void *);
 	struct ocre_container *container;
-	sem_t *sem;
 };
 
-static void *container_thread(void *arg)
+/* Callers of ocre_container_wait_async(), notified when the container exits */
+
+struct container_waiter {
+	struct container_waiter *next;
+	ocre_container_callback_t callback;
+	void *arg;
+};
+
+/* Every status change goes through here, so the transitions are counted */
+
+static void container_set_status(struct ocre_container *container, ocre_container_status_t status)
 {
-	int rc;
-	struct container_thread_params *params = arg;
-	struct ocre_container *container = params->container;
+	static const enum ocre_metric transitions[] = {
+		[OCRE_CONTAINER_STATUS_CREATED] = OCRE_METRIC_CONTAINER_CREATED_TOTAL,
+		[OCRE_CONTAINER_STATUS_RUNNING] = OCRE_METRIC_CONTAINER_RUNNING_TOTAL,
+		[OCRE_CONTAINER_STATUS_PAUSED] = OCRE_METRIC_CONTAINER_PAUSED_TOTAL,
+		[OCRE_CONTAINER_STATUS_EXITED] = OCRE_METRIC_CONTAINER_EXITED_TOTAL,
+		[OCRE_CONTAINER_STATUS_STOPPED] = OCRE_METRIC_CONTAINER_STOPPED_TOTAL,
+		[OCRE_CONTAINER_STATUS_ERROR] = OCRE_METRIC_CONTAINER_ERROR_TOTAL,
+	};
 
-	/* Run the container */
+	if (container->status == status) {
+		return;
+	}
 
-	int result = params->func(container->runtime_context, params->sem);
+	ocre_container_status_t old_status = container->status;
 
-	/* Exited */
+	container->status = status;
 
-	free(params);
+	if (status > OCRE_CONTAINER_STATUS_UNKNOWN && status <= OCRE_CONTAINER_STATUS_ERROR) {
+		ocre_metric_inc(transitions[status]);
+	}
+
+	if (container->status_hook) {
+		container->status_hook(container->status_hook_arg, container, old_status, status);
+	}
+}
+
+/* Completes the start, once the runtime signals the container is running, or when it exits without having started.
+ * Synchronous starts wait on the semaphore, asynchronous ones get the callback.
+ */
+
+static void container_start_done(struct ocre_container *container, int result)
+{
+	int rc = pthread_mutex_lock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to lock mutex: rc=%d", rc);
+		return;
+	}
+
+	if (container->started) {
+		pthread_mutex_unlock(&container->mutex);
+		return;
+	}
+
+	container->started = true;
+	container->start_result = result;
+
+	ocre_container_callback_t callback = container->start_callback;
+	void *callback_arg = container->start_arg;
+
+	container->start_callback = NULL;
+	container->start_arg = NULL;
+
+	pthread_mutex_unlock(&container->mutex);
+
+	if (!callback) {
+		rc = sem_post(&container->sem_start);
+		if (rc) {
+			LOG_WRN("Failed to signal start semaphore: rc=%d", rc);
+		}
+
+		return;
+	}
+
+	if (!result) {
+		LOG_INF("Started container '%s' on runtime '%s'", container->id, container->runtime->runtime_name);
+
+		ocre_metric_observe(OCRE_HISTOGRAM_CONTAINER_START, ocre_metrics_now_ns() - container->start_ns);
+	} else {
+		LOG_ERR("Container '%s' exited before starting", container->id);
+	}
+
+	callback(container, result, callback_arg);
+}
+
+static void container_started(void *arg)
+{
+	container_start_done(arg, 0);
+}
+
+static void container_exited(void *arg, int result)
+{
+	int rc;
+	struct ocre_container *container = arg;
+
+	/* The runtime does not signal the start when the container fails to start */
+
+	container_start_done(container, -1);
 
 	rc = pthread_mutex_lock(&container->mutex);
 	if (rc) {
 		LOG_ERR("Failed to lock mutex: rc=%d", rc);
-		return NULL;
+		return;
 	}
 
 	/* Here is the **only** place where we should set the status to EXITED */
 
-	container->status = OCRE_CONTAINER_STATUS_EXITED;
 	container->exit_code = result;
+	container_set_status(container, OCRE_CONTAINER_STATUS_EXITED);
+
+	if (container->stop_requested_ns) {
+		uint64_t elapsed_ns = ocre_metrics_now_ns() - container->stop_requested_ns;
+
+		ocre_metric_observe(OCRE_HISTOGRAM_CONTAINER_STOP, elapsed_ns);
+		container->stop_requested_ns = 0;
+	}
 
 	LOG_INF("Container '%s' exited. Result is = %d", container->id, result);
 
@@ -81,17 +202,244 @@ static void *container_thread(void *arg)
 		LOG_WRN("Failed to broadcast conditional variable: rc=%d", rc);
 	}
 
+	struct container_waiter *waiters = container->waiters;
+	container->waiters = NULL;
+
 	rc = pthread_mutex_unlock(&container->mutex);
 	if (rc) {
 		LOG_ERR("Failed to unlock mutex: rc=%d", rc);
-		return NULL;
 	}
 
+	/* The callbacks may use the container, so they are called without holding its lock */
+
+	while (waiters) {
+		struct container_waiter *next = waiters->next;
+
+		waiters->callback(container, result, waiters->arg);
+		free(waiters);
+
+		waiters = next;
+	}
+}
+
+/* Delay before the next restart: exponential backoff, minus a random jitter of up to half of it */
+
+static unsigned int container_restart_delay(struct ocre_container *container)
+{
+	uint64_t delay_ms = container->restart_backoff_ms;
+
+	for (unsigned int i = 0; i < container->restart_attempts && delay_ms < container->restart_backoff_max_ms; i++) {
+		delay_ms *= 2;
+	}
+
+	if (delay_ms > container->restart_backoff_max_ms) {
+		delay_ms = container->restart_backoff_max_ms;
+	}
+
+	/* xorshift32, good enough to spread containers failing together */
+
+	uint32_t x = container->restart_jitter;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	container->restart_jitter = x;
+
+	return (unsigned int)(delay_ms - x % (delay_ms / 2 + 1));
+}
+
+/* Called by the container thread when the container exits. Applies the restart policy, waiting for the backoff delay
+ * unless the container is stopped or killed meanwhile. Returns true if the container must run again.
+ */
+
+static bool container_restart(struct ocre_container *container, int result, uint64_t run_ns)
+{
+	bool restart = false;
+	int rc;
+
+	if (container->restart_policy == OCRE_RESTART_NO ||
+	    (container->restart_policy == OCRE_RESTART_ON_FAILURE && !result)) {
+		return false;
+	}
+
+	rc = pthread_mutex_lock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to lock mutex: rc=%d", rc);
+		return false;
+	}
+
+	/* A container that ran for longer than the maximum delay was healthy, the backoff starts over */
+
+	if (run_ns >= (uint64_t)container->restart_backoff_max_ms * 1000000ULL) {
+		container->restart_attempts = 0;
+	}
+
+	if (container->stop_requested_ns) {
+		goto unlock;
+	}
+
+	if (container->restart_max_retries && container->restart_attempts >= container->restart_max_retries) {
+		LOG_WRN("Container '%s' exited with %d after %u restarts, giving up", container->id, result,
+			container->restart_attempts);
+		goto unlock;
+	}
+
+	unsigned int delay_ms = container_restart_delay(container);
+
+	LOG_INF("Container '%s' exited with %d, restarting in %u ms", container->id, result, delay_ms);
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += delay_ms / 1000;
+	deadline.tv_nsec += (long)(delay_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	/* Stop and kill wake us up */
+
+	while (!container->stop_requested_ns) {
+		rc = pthread_cond_timedwait(&container->cond_stop, &container->mutex, &deadline);
+		if (rc == ETIMEDOUT) {
+			break;
+		} else if (rc) {
+			LOG_ERR("Failed to wait on stop conditional variable: rc=%d", rc);
+			goto unlock;
+		}
+	}
+
+	if (container->stop_requested_ns) {
+		goto unlock;
+	}
+
+	container->restart_attempts++;
+	container->restart_count++;
+	container->exit_code = result;
+
+	ocre_metric_inc(OCRE_METRIC_CONTAINER_RESTARTS_TOTAL);
+
+	/* The status does not change, but supervisors want to know */
+
+	if (container->status_hook) {
+		container->status_hook(container->status_hook_arg, container, OCRE_CONTAINER_STATUS_RUNNING,
+				       OCRE_CONTAINER_STATUS_RUNNING);
+	}
+
+	restart = true;
+
+unlock:
+	rc = pthread_mutex_unlock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to unlock mutex: rc=%d", rc);
+	}
+
+	return restart;
+}
+
+static void *container_thread(void *arg)
+{
+	struct container_thread_params *params = arg;
+	struct ocre_container *container = params->container;
+
+	OCRE_TRACE_THREAD_NAME(container->id);
+
+	/* The nice value is not part of the thread attributes, it can only be set from the thread itself */
+
+	if (container->sched_policy == OCRE_SCHED_OTHER && container->sched_priority) {
+		int rc = ocre_thread_set_nice(container->sched_priority);
+		if (rc) {
+			LOG_WRN("Failed to set nice value %d of container '%s': rc=%d", container->sched_priority,
+				container->id, rc);
+		}
+	}
+
+	/* Run the container, again and again as long as its restart policy says so */
+
+	int result;
+	uint64_t run_ns;
+
+	do {
+		run_ns = ocre_metrics_now_ns();
+
+		OCRE_TRACE_BEGIN(run_span, "container", "run");
+
+		result = params->func(container->runtime_context, container_started, container);
+
+		OCRE_TRACE_END(run_span);
+
+		run_ns = ocre_metrics_now_ns() - run_ns;
+	} while (container_restart(container, result, run_ns));
+
+	/* Exited */
+
+	free(params);
+
+	container_exited(container, result);
+
 	/* Cast result int to void pointer so we can return it from the thread */
 
 	return (void *)(intptr_t)result;
 }
 
+static int container_attr_init(const struct ocre_container *container, pthread_attr_t *attr)
+{
+	int rc = pthread_attr_init(attr);
+	if (rc) {
+		LOG_ERR("Failed to initialize pthread attribute: rc=%d", rc);
+		return rc;
+	}
+
+	if (container->stack_size) {
+		rc = pthread_attr_setstacksize(attr, container->stack_size);
+		if (rc) {
+			LOG_ERR("Invalid stack size %zu for container '%s': rc=%d", container->stack_size,
+				container->id, rc);
+			goto error_attr;
+		}
+	}
+
+	if (container->cpuset) {
+		rc = ocre_thread_attr_set_affinity(attr, container->cpuset);
+		if (rc) {
+			LOG_ERR("Invalid CPU set '%s' for container '%s': rc=%d", container->cpuset, container->id, rc);
+			goto error_attr;
+		}
+	}
+
+	if (container->sched_policy != OCRE_SCHED_DEFAULT) {
+		struct sched_param param = {0};
+		int policy = SCHED_OTHER;
+
+		if (container->sched_policy == OCRE_SCHED_FIFO) {
+			policy = SCHED_FIFO;
+			param.sched_priority = container->sched_priority;
+		} else if (container->sched_policy == OCRE_SCHED_RR) {
+			policy = SCHED_RR;
+			param.sched_priority = container->sched_priority;
+		}
+
+		rc = pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+		if (!rc) {
+			rc = pthread_attr_setschedpolicy(attr, policy);
+		}
+		if (!rc) {
+			rc = pthread_attr_setschedparam(attr, &param);
+		}
+		if (rc) {
+			LOG_ERR("Invalid scheduling policy %d or priority %d for container '%s': rc=%d",
+				container->sched_policy, container->sched_priority, container->id, rc);
+			goto error_attr;
+		}
+	}
+
+	return 0;
+
+error_attr:
+	pthread_attr_destroy(attr);
+
+	return rc;
+}
+
 static ocre_container_status_t ocre_container_status_locked(struct ocre_container *container)
 {
 	if (!container) {
@@ -99,7 +447,11 @@ static ocre_container_status_t ocre_container_status_locked(struct ocre_containe
 		return OCRE_CONTAINER_STATUS_UNKNOWN;
 	}
 
-	if (container->status == OCRE_CONTAINER_STATUS_EXITED) {
+	if (container->status == OCRE_CONTAINER_STATUS_EXITED && container->reactor) {
+		/* Reactors do not have a thread of their own */
+
+		container_set_status(container, OCRE_CONTAINER_STATUS_STOPPED);
+	} else if (container->status == OCRE_CONTAINER_STATUS_EXITED) {
 		/* Need to join the thread to clean up resources and get exit status.
 		 * pthread_join should not block here because the thread already exited.
 		 * Here is the only place where we should call pthread_join.
@@ -122,7 +474,7 @@ static ocre_container_status_t ocre_container_status_locked(struct ocre_containe
 
 		/* Now the container is really stopped */
 
-		container->status = OCRE_CONTAINER_STATUS_STOPPED;
+		container_set_status(container, OCRE_CONTAINER_STATUS_STOPPED);
 	}
 
 	return container->status;
@@ -152,6 +504,9 @@ struct ocre_container *ocre_container_create(const char *img_path, const char *w
 	int rc;
 	const char **capabilities = NULL;
 	const char **mounts = NULL;
+	uint64_t start_ns = ocre_metrics_now_ns();
+
+	OCRE_TRACE_BEGIN(create_span, "container", "create");
 
 	if (stdin_fd < 0) {
 		stdin_fd = STDIN_FILENO;
@@ -278,23 +633,181 @@ struct ocre_container *ocre_container_create(const char *img_path, const char *w
 		goto error_mutex;
 	}
 
+	if (arguments && arguments->capture_logs) {
+		container->log = container_log_create(workdir, arguments->log_size, arguments->log_file_size);
+		if (!container->log) {
+			LOG_ERR("Failed to create log of container '%s'", container->id);
+			goto error_cond;
+		}
+
+		stdout_fd = container_log_get_fd(container->log);
+		stderr_fd = stdout_fd;
+	}
+
+	OCRE_TRACE_BEGIN(runtime_create_span, "container", "runtime_create");
+
 	container->runtime_context = container->runtime->create(
 		container_id, img_path, workdir, capabilities, (const char **)container->argv,
 		(const char **)container->envp, mounts, stdin_fd, stdout_fd, stderr_fd);
+
+	OCRE_TRACE_END(runtime_create_span);
+
 	if (!container->runtime_context) {
 		LOG_ERR("Failed to create container");
 		goto error_cond;
 	}
 
-	container->status = OCRE_CONTAINER_STATUS_CREATED;
+	if (arguments && arguments->reactor) {
+		if (!container->runtime->spawn) {
+			LOG_ERR("Runtime '%s' does not support reactor containers", runtime);
+			goto error_runtime;
+		}
+
+		/* Reactors share the worker threads, they cannot be throttled on their own */
+
+		if (arguments->cpu_quota_us) {
+			LOG_ERR("CPU quotas are not supported for reactor containers");
+			goto error_runtime;
+		}
+
+		/* Neither can their threads be configured */
+
+		if (arguments->stack_size || arguments->cpuset || arguments->sched_policy != OCRE_SCHED_DEFAULT) {
+			LOG_ERR("Thread attributes are not supported for reactor containers");
+			goto error_runtime;
+		}
+
+		/* Nor restarted by their thread */
+
+		if (arguments->restart_policy != OCRE_RESTART_NO) {
+			LOG_ERR("Restart policies are not supported for reactor containers");
+			goto error_runtime;
+		}
+
+		container->reactor = true;
+	}
+
+	if (arguments) {
+		if (arguments->sched_policy > OCRE_SCHED_RR ||
+		    (arguments->sched_policy == OCRE_SCHED_DEFAULT && arguments->sched_priority) ||
+		    (arguments->sched_policy == OCRE_SCHED_OTHER &&
+		     (arguments->sched_priority < -20 || arguments->sched_priority > 19))) {
+			LOG_ERR("Invalid scheduling policy %d or priority %d", arguments->sched_policy,
+				arguments->sched_priority);
+			goto error_runtime;
+		}
+
+		if (arguments->restart_policy > OCRE_RESTART_ALWAYS) {
+			LOG_ERR("Invalid restart policy %d", arguments->restart_policy);
+			goto error_runtime;
+		}
+
+		container->stack_size = arguments->stack_size;
+		container->sched_policy = arguments->sched_policy;
+		container->sched_priority = arguments->sched_priority;
+
+		if (arguments->cpuset) {
+			container->cpuset = strdup(arguments->cpuset);
+			if (!container->cpuset) {
+				LOG_ERR("Failed to allocate memory for CPU set: errno=%d", errno);
+				goto error_runtime;
+			}
+		}
+
+		/* Check the thread attributes now, rather than failing when starting */
+
+		if (!container->reactor) {
+			pthread_attr_t attr;
+
+			rc = container_attr_init(container, &attr);
+			if (rc) {
+				goto error_runtime;
+			}
+
+			pthread_attr_destroy(&attr);
+		}
+	}
+
+	if (arguments && arguments->memory_limit) {
+		if (!container->runtime->set_memory_limit) {
+			LOG_ERR("Runtime '%s' does not support memory limits", runtime);
+			goto error_runtime;
+		}
+
+		rc = container->runtime->set_memory_limit(container->runtime_context, arguments->memory_limit);
+		if (rc) {
+			LOG_ERR("Failed to set memory limit of container '%s': rc=%d", container->id, rc);
+			goto error_runtime;
+		}
+	}
+
+	/* A memory limit caps what the runtime takes, otherwise it is up to the runtime to tell */
+
+	if (arguments && arguments->memory_limit) {
+		container->footprint = arguments->memory_limit;
+	} else if (container->runtime->get_footprint &&
+		   container->runtime->get_footprint(container->runtime_context, &container->footprint)) {
+		LOG_WRN("Failed to estimate the footprint of container '%s'", container->id);
+		container->footprint = 0;
+	}
+
+	container->footprint += container->stack_size;
+
+	if (arguments && arguments->cpu_quota_us) {
+		if (!container->runtime->set_cpu_quota) {
+			LOG_ERR("Runtime '%s' does not support CPU quotas", runtime);
+			goto error_runtime;
+		}
+
+		rc = container->runtime->set_cpu_quota(container->runtime_context, arguments->cpu_quota_us,
+						       arguments->cpu_period_us);
+		if (rc) {
+			LOG_ERR("Failed to set CPU quota of container '%s': rc=%d", container->id, rc);
+			goto error_runtime;
+		}
+	}
+
+	container_set_status(container, OCRE_CONTAINER_STATUS_CREATED);
 
 	container->detached = detached;
 
+	container->stop_timeout_ms = CONFIG_OCRE_CONTAINER_STOP_TIMEOUT_MS;
+	if (arguments && arguments->stop_timeout_ms) {
+		container->stop_timeout_ms = arguments->stop_timeout_ms;
+	}
+
+	container->restart_backoff_ms = CONFIG_OCRE_RESTART_BACKOFF_MS;
+	container->restart_backoff_max_ms = CONFIG_OCRE_RESTART_BACKOFF_MAX_MS;
+	container->restart_jitter = (uint32_t)ocre_metrics_now_ns() | 1;
+
+	if (arguments) {
+		container->restart_policy = arguments->restart_policy;
+		container->restart_max_retries = arguments->restart_max_retries;
+
+		if (arguments->restart_backoff_ms) {
+			container->restart_backoff_ms = arguments->restart_backoff_ms;
+		}
+
+		if (arguments->restart_backoff_max_ms) {
+			container->restart_backoff_max_ms = arguments->restart_backoff_max_ms;
+		}
+	}
+
 	LOG_INF("Created container '%s' with runtime '%s' (path '%s')", container->id, runtime, img_path);
 
+	ocre_metric_gauge_add(OCRE_METRIC_CONTAINERS, 1);
+	ocre_metric_observe(OCRE_HISTOGRAM_CONTAINER_CREATE, ocre_metrics_now_ns() - start_ns);
+
+	OCRE_TRACE_END(create_span);
+
 	return container;
 
+error_runtime:
+	container->runtime->destroy(container->runtime_context);
+
 error_cond:
+	container_log_destroy(container->log);
+
 	rc = sem_destroy(&container->sem_start);
 	if (rc) {
 		LOG_ERR("Failed to deinitialize start semaphore: rc=%d", rc);
@@ -315,6 +828,7 @@ error_free:
 	string_array_free(container->argv);
 	string_array_free(container->envp);
 
+	free(container->cpuset);
 	free(container->image);
 	free(container->id);
 	free(container);
@@ -338,6 +852,8 @@ int ocre_container_destroy(struct ocre_container *container)
 
 	container->runtime->destroy(container->runtime_context);
 
+	container_log_destroy(container->log);
+
 	int rc;
 	rc = pthread_mutex_destroy(&container->mutex);
 	if (rc) {
@@ -359,6 +875,9 @@ int ocre_container_destroy(struct ocre_container *container)
 
 	LOG_INF("Removed container '%s'", container->id);
 
+	ocre_metric_gauge_add(OCRE_METRIC_CONTAINERS, -1);
+
+	free(container->cpuset);
 	free(container->id);
 	free(container->image);
 	free(container);
@@ -366,13 +885,12 @@ int ocre_container_destroy(struct ocre_container *container)
 	return 0;
 }
 
-int ocre_container_start(struct ocre_container *container)
-{
-	if (!container) {
-		LOG_ERR("Invalid arguments");
-		return -1;
-	}
+/* Launches the container thread, or submits a reactor. Returns once the container is launched, the start is
+ * completed by container_start_done().
+ */
 
+static int container_launch(struct ocre_container *container, ocre_container_callback_t callback, void *arg)
+{
 	int rc;
 	rc = pthread_mutex_lock(&container->mutex);
 	if (rc) {
@@ -386,55 +904,66 @@ int ocre_container_start(struct ocre_container *container)
 		goto error_mutex;
 	}
 
-	rc = pthread_attr_init(&container->attr);
-	if (rc) {
-		LOG_ERR("Failed to initialize pthread attribute: rc=%d", rc);
-		goto error_mutex;
-	}
+	container->start_ns = ocre_metrics_now_ns();
+	container->started = false;
+	container->restart_attempts = 0;
+	container->start_result = 0;
+	container->start_callback = callback;
+	container->start_arg = arg;
 
-	struct container_thread_params *params;
-	params = malloc(sizeof(struct container_thread_params));
-	if (!params) {
-		LOG_ERR("Failed to allocate memory (size=%zu) for thread parameters: errno=%d",
-			sizeof(struct container_thread_params), errno);
+	if (container->reactor) {
+		container_set_status(container, OCRE_CONTAINER_STATUS_RUNNING);
+
+		OCRE_TRACE_BEGIN(spawn_span, "container", "spawn");
+
+		rc = container->runtime->spawn(container->runtime_context, container_started, container_exited,
+					       container);
+
+		OCRE_TRACE_END(spawn_span);
+
+		if (rc) {
+			LOG_ERR("Failed to spawn container '%s': rc=%d", container->id, rc);
+			goto error_callback;
+		}
+
+		goto started;
+	}
+
+	rc = container_attr_init(container, &container->attr);
+	if (rc) {
+		goto error_callback;
+	}
+
+	struct container_thread_params *params;
+	params = malloc(sizeof(struct container_thread_params));
+	if (!params) {
+		LOG_ERR("Failed to allocate memory (size=%zu) for thread parameters: errno=%d",
+			sizeof(struct container_thread_params), errno);
 		goto error_attr;
 	}
 
 	memset(params, 0, sizeof(struct container_thread_params));
 	params->container = container;
 	params->func = container->runtime->thread_execute;
-	params->sem = &container->sem_start;
-	container->status = OCRE_CONTAINER_STATUS_RUNNING;
+	container_set_status(container, OCRE_CONTAINER_STATUS_RUNNING);
+
+	OCRE_TRACE_BEGIN(thread_create_span, "container", "thread_create");
 
 	rc = pthread_create(&container->thread, &container->attr, container_thread, params);
+
+	OCRE_TRACE_END(thread_create_span);
+
 	if (rc) {
 		LOG_ERR("Failed to create thread: rc=%d", rc);
 		goto error_params;
 	}
 
+started:
 	LOG_INF("Waiting for container '%s' to start", container->id);
 
 	rc = pthread_mutex_unlock(&container->mutex);
 	if (rc) {
 		LOG_ERR("Failed to unlock mutex: rc=%d", rc);
-		goto error_status;
-	}
-
-	rc = sem_wait(&container->sem_start);
-	if (rc) {
-		LOG_ERR("Failed to wait on start semaphore: rc=%d", rc);
-		goto error_status;
-	}
-
-	LOG_INF("Started container '%s' on runtime '%s'", container->id, container->runtime->runtime_name);
-
-	if (!container->detached) {
-		/* This will block until the container thread exits */
-
-		if (ocre_container_wait(container, NULL)) {
-			LOG_ERR("Failed to wait for container '%s'", container->id);
-			return -1;
-		}
 	}
 
 	return 0;
@@ -448,6 +977,10 @@ error_attr:
 		LOG_ERR("Failed to destroy thread attributes: rc=%d", rc);
 	}
 
+error_callback:
+	container->start_callback = NULL;
+	container->start_arg = NULL;
+
 error_mutex:
 	rc = pthread_mutex_unlock(&container->mutex);
 	if (rc) {
@@ -456,11 +989,72 @@ error_mutex:
 
 error_status:
 	LOG_INF("Setting container '%s' status to ERROR", container->id);
-	container->status = OCRE_CONTAINER_STATUS_ERROR;
+	container_set_status(container, OCRE_CONTAINER_STATUS_ERROR);
 
 	return -1;
 }
 
+int ocre_container_start(struct ocre_container *container)
+{
+	if (!container) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	OCRE_TRACE_BEGIN(start_span, "container", "start");
+
+	if (container_launch(container, NULL, NULL)) {
+		return -1;
+	}
+
+	OCRE_TRACE_BEGIN(handshake_span, "container", "start_handshake");
+
+	int rc;
+	while ((rc = sem_wait(&container->sem_start)) && errno == EINTR) {
+	}
+
+	OCRE_TRACE_END(handshake_span);
+
+	if (rc) {
+		LOG_ERR("Failed to wait on start semaphore: errno=%d", errno);
+		return -1;
+	}
+
+	/* Set before the semaphore was posted, it does not change until the next start */
+
+	if (container->start_result) {
+		LOG_ERR("Container '%s' exited before starting", container->id);
+		return -1;
+	}
+
+	LOG_INF("Started container '%s' on runtime '%s'", container->id, container->runtime->runtime_name);
+
+	ocre_metric_observe(OCRE_HISTOGRAM_CONTAINER_START, ocre_metrics_now_ns() - container->start_ns);
+
+	OCRE_TRACE_END(start_span);
+
+	if (!container->detached) {
+		/* This will block until the container thread exits */
+
+		if (ocre_container_wait(container, NULL)) {
+			LOG_ERR("Failed to wait for container '%s'", container->id);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int ocre_container_start_async(struct ocre_container *container, ocre_container_callback_t callback, void *arg)
+{
+	if (!container || !callback) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	return container_launch(container, callback, arg);
+}
+
 ocre_container_status_t ocre_container_get_status(struct ocre_container *container)
 {
 	if (!container) {
@@ -486,6 +1080,11 @@ ocre_container_status_t ocre_container_get_status(struct ocre_container *contain
 	return status;
 }
 
+static bool ocre_container_is_active_locked(const struct ocre_container *container)
+{
+	return container->status == OCRE_CONTAINER_STATUS_RUNNING || container->status == OCRE_CONTAINER_STATUS_PAUSED;
+}
+
 int ocre_container_stop(struct ocre_container *container)
 {
 	int ret = -1;
@@ -501,19 +1100,76 @@ int ocre_container_stop(struct ocre_container *container)
 		return -1;
 	}
 
-	if (container->status != OCRE_CONTAINER_STATUS_RUNNING) {
+	if (!ocre_container_is_active_locked(container)) {
 		LOG_ERR("Container '%s' is not running", container->id);
 		goto unlock_mutex;
 	}
 
-	if (!container->runtime->stop) {
-		LOG_ERR("Container '%s' does not support stop", container->id);
-		goto unlock_mutex;
+	/* A paused container would not be able to handle the stop request, so it is resumed first. If that is not
+	 * possible, we go straight to kill.
+	 */
+
+	if (container->status == OCRE_CONTAINER_STATUS_PAUSED && container->runtime->unpause &&
+	    !container->runtime->unpause(container->runtime_context)) {
+		container_set_status(container, OCRE_CONTAINER_STATUS_RUNNING);
+	}
+
+	container->stop_requested_ns = ocre_metrics_now_ns();
+
+	/* Wake up the container thread if it is waiting to restart the container */
+
+	pthread_cond_broadcast(&container->cond_stop);
+
+	if (container->status == OCRE_CONTAINER_STATUS_RUNNING && container->runtime->stop) {
+		LOG_INF("Sending stop signal to container '%s'", container->id);
+
+		if (!container->runtime->stop(container->runtime_context)) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_sec += container->stop_timeout_ms / 1000;
+			deadline.tv_nsec += (long)(container->stop_timeout_ms % 1000) * 1000000L;
+			if (deadline.tv_nsec >= 1000000000L) {
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000L;
+			}
+
+			while (ocre_container_is_active_locked(container)) {
+				rc = pthread_cond_timedwait(&container->cond_stop, &container->mutex, &deadline);
+				if (rc == ETIMEDOUT) {
+					break;
+				} else if (rc) {
+					LOG_ERR("Failed to wait on stop conditional variable: rc=%d", rc);
+					break;
+				}
+			}
+		}
+	}
+
+	if (ocre_container_is_active_locked(container)) {
+		LOG_WRN("Container '%s' did not stop within %u ms, killing it", container->id,
+			container->stop_timeout_ms);
+
+		ret = container->runtime->kill(container->runtime_context);
+		if (ret) {
+			LOG_ERR("Failed to kill container '%s': rc=%d", container->id, ret);
+			goto unlock_mutex;
+		}
+
+		container_set_status(container, OCRE_CONTAINER_STATUS_RUNNING);
+
+		while (ocre_container_is_active_locked(container)) {
+			rc = pthread_cond_wait(&container->cond_stop, &container->mutex);
+			if (rc) {
+				LOG_ERR("Failed to wait on stop conditional variable: rc=%d", rc);
+				ret = -1;
+				goto unlock_mutex;
+			}
+		}
 	}
 
-	LOG_INF("Sending stop signal to container '%s'", container->id);
+	LOG_INF("Container '%s' stopped", container->id);
 
-	ret = container->runtime->stop(container->runtime_context);
+	ret = 0;
 
 unlock_mutex:
 	rc = pthread_mutex_unlock(&container->mutex);
@@ -539,12 +1195,26 @@ int ocre_container_kill(struct ocre_container *container)
 		return -1;
 	}
 
-	if (container->status != OCRE_CONTAINER_STATUS_RUNNING) {
+	if (!ocre_container_is_active_locked(container)) {
 		LOG_ERR("Container '%s' is not running", container->id);
 		goto unlock_mutex;
 	}
 
 	ret = container->runtime->kill(container->runtime_context);
+	if (ret) {
+		LOG_ERR("Failed to kill container '%s': rc=%d", container->id, ret);
+		goto unlock_mutex;
+	}
+
+	/* Killing also resumes a paused container, so it can exit */
+
+	container_set_status(container, OCRE_CONTAINER_STATUS_RUNNING);
+
+	if (!container->stop_requested_ns) {
+		container->stop_requested_ns = ocre_metrics_now_ns();
+	}
+
+	pthread_cond_broadcast(&container->cond_stop);
 
 	LOG_INF("Sent kill signal to container '%s'", container->id);
 
@@ -591,7 +1261,7 @@ int ocre_container_pause(struct ocre_container *container)
 		goto unlock_mutex;
 	}
 
-	container->status = OCRE_CONTAINER_STATUS_PAUSED;
+	container_set_status(container, OCRE_CONTAINER_STATUS_PAUSED);
 
 unlock_mutex:
 	rc = pthread_mutex_unlock(&container->mutex);
@@ -636,7 +1306,7 @@ int ocre_container_unpause(struct ocre_container *container)
 		goto unlock_mutex;
 	}
 
-	container->status = OCRE_CONTAINER_STATUS_RUNNING;
+	container_set_status(container, OCRE_CONTAINER_STATUS_RUNNING);
 
 unlock_mutex:
 	rc = pthread_mutex_unlock(&container->mutex);
@@ -647,7 +1317,116 @@ unlock_mutex:
 	return ret;
 }
 
-int ocre_container_wait(struct ocre_container *container, int *status)
+int ocre_container_checkpoint(struct ocre_container *container, const char *path)
+{
+	int ret = -1;
+
+	if (!container || !path) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	int rc = pthread_mutex_lock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to lock mutex: rc=%d", rc);
+		return -1;
+	}
+
+	if (!container->reactor) {
+		LOG_ERR("Container '%s' is not a reactor, only reactor containers can be checkpointed", container->id);
+		goto unlock_mutex;
+	}
+
+	if (container->status != OCRE_CONTAINER_STATUS_PAUSED) {
+		LOG_ERR("Container '%s' is not paused", container->id);
+		goto unlock_mutex;
+	}
+
+	if (!container->runtime->checkpoint) {
+		LOG_ERR("Container '%s' does not support checkpoints", container->id);
+		goto unlock_mutex;
+	}
+
+	ret = container->runtime->checkpoint(container->runtime_context, path);
+	if (ret) {
+		LOG_ERR("Failed to checkpoint container '%s' to '%s': rc=%d", container->id, path, ret);
+		goto unlock_mutex;
+	}
+
+	LOG_INF("Checkpointed container '%s' to '%s'", container->id, path);
+
+unlock_mutex:
+	rc = pthread_mutex_unlock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to unlock mutex: rc=%d", rc);
+	}
+
+	return ret;
+}
+
+int ocre_container_restore(struct ocre_container *container, const char *path)
+{
+	int ret = -1;
+
+	if (!container || !path) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	int rc = pthread_mutex_lock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to lock mutex: rc=%d", rc);
+		return -1;
+	}
+
+	if (!container->reactor) {
+		LOG_ERR("Container '%s' is not a reactor, only reactor containers can be restored", container->id);
+		goto unlock_mutex;
+	}
+
+	ocre_container_status_t status = ocre_container_status_locked(container);
+
+	if (status != OCRE_CONTAINER_STATUS_CREATED && status != OCRE_CONTAINER_STATUS_STOPPED) {
+		LOG_ERR("Container '%s' is not created or stopped", container->id);
+		goto unlock_mutex;
+	}
+
+	if (!container->runtime->restore) {
+		LOG_ERR("Container '%s' does not support checkpoints", container->id);
+		goto unlock_mutex;
+	}
+
+	ret = container->runtime->restore(container->runtime_context, path);
+	if (ret) {
+		LOG_ERR("Failed to restore container '%s' from '%s': rc=%d", container->id, path, ret);
+	}
+
+unlock_mutex:
+	rc = pthread_mutex_unlock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to unlock mutex: rc=%d", rc);
+	}
+
+	return ret;
+}
+
+int ocre_container_read_logs(struct ocre_container *container, uint64_t *cursor, char *buf, size_t size,
+			     int timeout_ms)
+{
+	if (!container || !cursor || !buf || !size) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	if (!container->log) {
+		LOG_ERR("Output of container '%s' is not captured", container->id);
+		return -1;
+	}
+
+	return container_log_read(container->log, cursor, buf, size, timeout_ms);
+}
+
+static int container_wait(struct ocre_container *container, int *status, const struct timespec *deadline)
 {
 	int ret = -1;
 
@@ -668,9 +1447,21 @@ int ocre_container_wait(struct ocre_container *container, int *status)
 		goto unlock_mutex;
 	}
 
-	if (container->status == OCRE_CONTAINER_STATUS_RUNNING) {
+	if (ocre_container_is_active_locked(container)) {
 		LOG_INF("Container '%s' is running", container->id);
-		rc = pthread_cond_wait(&container->cond_stop, &container->mutex);
+	}
+
+	while (ocre_container_is_active_locked(container)) {
+		if (deadline) {
+			rc = pthread_cond_timedwait(&container->cond_stop, &container->mutex, deadline);
+			if (rc == ETIMEDOUT) {
+				ret = -ETIMEDOUT;
+				goto unlock_mutex;
+			}
+		} else {
+			rc = pthread_cond_wait(&container->cond_stop, &container->mutex);
+		}
+
 		if (rc) {
 			LOG_ERR("Failed to wait on stop conditional variable: rc=%d", rc);
 			goto unlock_mutex;
@@ -703,6 +1494,110 @@ unlock_mutex:
 	return ret;
 }
 
+int ocre_container_wait(struct ocre_container *container, int *status)
+{
+	return container_wait(container, status, NULL);
+}
+
+int ocre_container_wait_timeout(struct ocre_container *container, int *status, int timeout_ms)
+{
+	struct timespec deadline;
+
+	if (timeout_ms < 0) {
+		return container_wait(container, status, NULL);
+	}
+
+	/* The stop condition variable uses the default clock */
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	return container_wait(container, status, &deadline);
+}
+
+int ocre_container_wait_async(struct ocre_container *container, ocre_container_callback_t callback, void *arg)
+{
+	int ret = -1;
+
+	if (!container || !callback) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	struct container_waiter *waiter = malloc(sizeof(struct container_waiter));
+	if (!waiter) {
+		LOG_ERR("Failed to allocate memory (size=%zu) for waiter: errno=%d", sizeof(struct container_waiter),
+			errno);
+		return -1;
+	}
+
+	waiter->next = NULL;
+	waiter->callback = callback;
+	waiter->arg = arg;
+
+	int rc;
+	rc = pthread_mutex_lock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to lock mutex: rc=%d", rc);
+		free(waiter);
+		return -1;
+	}
+
+	if (container->status == OCRE_CONTAINER_STATUS_UNKNOWN || container->status == OCRE_CONTAINER_STATUS_CREATED) {
+		goto unlock_mutex;
+	}
+
+	if (ocre_container_is_active_locked(container)) {
+		/* Notified in the order of the calls */
+
+		struct container_waiter **p = &container->waiters;
+		while (*p) {
+			p = &(*p)->next;
+		}
+
+		*p = waiter;
+		waiter = NULL;
+
+		ret = 0;
+		goto unlock_mutex;
+	}
+
+	/* Already exited, notify right away. A container that failed to start has no exit code */
+
+	ocre_container_status_t status = ocre_container_status_locked(container);
+	if (status == OCRE_CONTAINER_STATUS_UNKNOWN) {
+		goto unlock_mutex;
+	}
+
+	int exit_code = status == OCRE_CONTAINER_STATUS_STOPPED ? container->exit_code : -1;
+
+	rc = pthread_mutex_unlock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to unlock mutex: rc=%d", rc);
+	}
+
+	free(waiter);
+
+	callback(container, exit_code, arg);
+
+	return 0;
+
+unlock_mutex:
+	rc = pthread_mutex_unlock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to unlock mutex: rc=%d", rc);
+	}
+
+	free(waiter);
+
+	return ret;
+}
+
 const char *ocre_container_get_id(const struct ocre_container *container)
 {
 	if (!container) {
@@ -732,3 +1627,111 @@ bool ocre_container_is_detached(struct ocre_container *container)
 
 	return container->detached;
 }
+
+int ocre_container_get_restart_count(struct ocre_container *container)
+{
+	if (!container) {
+		LOG_ERR("Invalid container");
+		return -1;
+	}
+
+	int rc = pthread_mutex_lock(&container->mutex);
+	if (rc) {
+		LOG_ERR("Failed to lock mutex: rc=%d", rc);
+		return -1;
+	}
+
+	int count = (int)container->restart_count;
+
+	pthread_mutex_unlock(&container->mutex);
+
+	return count;
+}
+
+int ocre_container_get_native_stats(struct ocre_container *container, struct ocre_native_stats *stats, size_t max)
+{
+	if (!container || (!stats && max)) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	if (!container->runtime->get_native_stats) {
+		LOG_ERR("Container '%s' does not support native profiling", container->id);
+		return -1;
+	}
+
+	return container->runtime->get_native_stats(container->runtime_context, stats, max);
+}
+
+int ocre_container_get_memory_stats(struct ocre_container *container, struct ocre_memory_stats *stats)
+{
+	if (!container || !stats) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	if (!container->runtime->get_memory_stats) {
+		LOG_ERR("Container '%s' does not support memory accounting", container->id);
+		return -1;
+	}
+
+	return container->runtime->get_memory_stats(container->runtime_context, stats);
+}
+
+int ocre_container_get_profile(struct ocre_container *container, char *buf, size_t size)
+{
+	if (!container || (!buf && size)) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	if (!container->runtime->get_profile) {
+		LOG_ERR("Container '%s' does not support profiling", container->id);
+		return -1;
+	}
+
+	return container->runtime->get_profile(container->runtime_context, buf, size);
+}
+
+int ocre_container_sample(struct ocre_container *container, unsigned int duration_ms, unsigned int period_ms,
+			  ocre_stack_callback_t callback, void *arg)
+{
+	if (!container || !period_ms || !callback) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	if (!container->runtime->sample) {
+		LOG_ERR("Container '%s' does not support sampling", container->id);
+		return -1;
+	}
+
+	/* Do not hold the container lock while sampling, it would block the container lifecycle */
+
+	if (ocre_container_get_status(container) != OCRE_CONTAINER_STATUS_RUNNING) {
+		LOG_ERR("Container '%s' is not running", container->id);
+		return -1;
+	}
+
+	return container->runtime->sample(container->runtime_context, duration_ms, period_ms, callback, arg);
+}
+
+void ocre_container_set_status_hook(struct ocre_container *container, ocre_container_status_hook_t hook, void *arg)
+{
+	pthread_mutex_lock(&container->mutex);
+
+	container->status_hook = hook;
+	container->status_hook_arg = arg;
+
+	pthread_mutex_unlock(&container->mutex);
+}
+
+int ocre_container_get_exit_code(const struct ocre_container *container)
+{
+	return container->exit_code;
+}
+
+size_t ocre_container_get_footprint(const struct ocre_container *container)
+{
+	return container->footprint;
+}
@@ -6,6 +6,7 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include <ocre/ocre.h>
 
@@ -16,3 +17,20 @@ struct ocre_container *ocre_container_create(const char *img_path, const char *w
 					     const struct ocre_container_args *arguments, int stdin_fd, int stdout_fd,
 					     int stderr_fd);
 int ocre_container_destroy(struct ocre_container *container);
+
+/* Called on every status change, usually with the container lock held. It must not call the container API, except
+ * ocre_container_get_id() and ocre_container_get_exit_code()
+ */
+
+typedef void (*ocre_container_status_hook_t)(void *arg, struct ocre_container *container,
+					     ocre_container_status_t old_status, ocre_container_status_t new_status);
+
+void ocre_container_set_status_hook(struct ocre_container *container, ocre_container_status_hook_t hook, void *arg);
+
+/* Memory reserved for the container against the budget of its context, fixed at creation */
+
+size_t ocre_container_get_footprint(const struct ocre_container *container);
+
+/* Exit code of the last run, without locking */
+
+int ocre_container_get_exit_code(const struct ocre_container *container);
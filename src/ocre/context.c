@@ -7,10 +7,12 @@
 
 #include <errno.h>
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <dirent.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sys/stat.h>
 
 #include <uthash/utlist.h>
@@ -20,6 +22,8 @@
 #include <ocre/platform/log.h>
 
 #include "container.h"
+#include "watch.h"
+#include "util/image_ref.h"
 #include "util/rm_rf.h"
 #include "util/string_array.h"
 #include "util/unique_random_id.h"
@@ -32,14 +36,117 @@ struct ocre_context {
 	pthread_mutex_t mutex;
 	char *working_directory;
 	struct container_node *containers;
+
+	/* Containers that exited and were not reported by ocre_context_wait_any() yet, oldest first. The exit lock is
+	 * taken last, after the context or container locks.
+	 */
+	pthread_mutex_t exit_mutex;
+	pthread_cond_t exit_cond;
+	struct container_node *exits;
+	struct container_node **exits_tail;
+
+	struct watch_list watches;
+
+	/* Memory budget of the containers, under the context lock */
+
+	size_t memory_budget;
+	size_t memory_reserved;
+	uint64_t rejected;
 };
 
 struct container_node {
 	struct ocre_container *container;
 	char *working_directory;
 	struct container_node *next; /* needed for singly- or doubly-linked lists */
+	struct ocre_context *context;
+	struct container_node *exit_next;
+	bool exit_queued;
+	size_t footprint;
 };
 
+static void exit_queue_push(struct ocre_context *context, struct container_node *node)
+{
+	pthread_mutex_lock(&context->exit_mutex);
+
+	if (!node->exit_queued) {
+		node->exit_queued = true;
+		node->exit_next = NULL;
+		*context->exits_tail = node;
+		context->exits_tail = &node->exit_next;
+	}
+
+	pthread_cond_broadcast(&context->exit_cond);
+
+	pthread_mutex_unlock(&context->exit_mutex);
+}
+
+/* Called by the containers on every status change */
+
+static void container_status_hook(void *arg, struct ocre_container *container, ocre_container_status_t old_status,
+				  ocre_container_status_t new_status)
+{
+	struct container_node *node = arg;
+	struct ocre_context *context = node->context;
+	int exit_code = 0;
+
+	/* Restarts by the restart policy keep the status, they report the exit code of the run that ended */
+
+	if (new_status == OCRE_CONTAINER_STATUS_EXITED || new_status == OCRE_CONTAINER_STATUS_STOPPED ||
+	    new_status == old_status) {
+		exit_code = ocre_container_get_exit_code(container);
+	}
+
+	watch_list_emit(&context->watches, ocre_container_get_id(container), old_status, new_status, exit_code);
+
+	if (new_status == OCRE_CONTAINER_STATUS_EXITED) {
+		exit_queue_push(context, node);
+	}
+}
+
+static void exit_queue_remove_locked(struct ocre_context *context, struct container_node **prev)
+{
+	struct container_node *node = *prev;
+
+	*prev = node->exit_next;
+	if (context->exits_tail == &node->exit_next) {
+		context->exits_tail = prev;
+	}
+
+	node->exit_next = NULL;
+	node->exit_queued = false;
+}
+
+static void exit_queue_remove(struct ocre_context *context, struct container_node *node)
+{
+	pthread_mutex_lock(&context->exit_mutex);
+
+	for (struct container_node **prev = &context->exits; *prev; prev = &(*prev)->exit_next) {
+		if (*prev == node) {
+			exit_queue_remove_locked(context, prev);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&context->exit_mutex);
+}
+
+/* Called with the context lock held */
+
+static bool budget_admit(struct ocre_context *context, const char *id, size_t footprint)
+{
+	if (!context->memory_budget || footprint <= context->memory_budget - context->memory_reserved) {
+		return true;
+	}
+
+	LOG_ERR("Container '%s' needs %zu bytes, only %zu are left in the memory budget", id, footprint,
+		context->memory_budget - context->memory_reserved);
+
+	context->rejected++;
+	ocre_metric_inc(OCRE_METRIC_CONTAINER_REJECTED_TOTAL);
+
+	return false;
+}
+
 static int ocre_context_remove_container_locked(struct ocre_context *context, struct ocre_container *container)
 {
 	int rc;
@@ -49,6 +156,11 @@ static int ocre_context_remove_container_locked(struct ocre_context *context, st
 	LL_FOREACH_SAFE(context->containers, node, elt)
 	{
 		if (node->container == container) {
+			char id[OCRE_CONTAINER_EVENT_ID_SIZE];
+			ocre_container_status_t status = ocre_container_get_status(container);
+
+			snprintf(id, sizeof(id), "%s", ocre_container_get_id(container));
+
 			rc = ocre_container_destroy(container);
 			if (rc) {
 				LOG_ERR("Failed to destroy container: rc=%d", rc);
@@ -66,8 +178,15 @@ static int ocre_context_remove_container_locked(struct ocre_context *context, st
 			}
 #endif
 
+			exit_queue_remove(context, node);
+
 			LL_DELETE(context->containers, node);
 
+			context->memory_reserved -= node->footprint;
+			ocre_metric_gauge_add(OCRE_METRIC_MEMORY_RESERVED_BYTES, -(int64_t)node->footprint);
+
+			watch_list_emit(&context->watches, id, status, OCRE_CONTAINER_STATUS_UNKNOWN, 0);
+
 			free(node->working_directory);
 			free(node);
 
@@ -96,19 +215,53 @@ struct ocre_context *ocre_context_create(const char *workdir)
 		goto error;
 	}
 
+	rc = pthread_mutex_init(&context->exit_mutex, NULL);
+	if (rc) {
+		LOG_ERR("Failed to initialize context exit mutex: rc=%d", rc);
+		goto error_mutex;
+	}
+
+	rc = pthread_cond_init(&context->exit_cond, NULL);
+	if (rc) {
+		LOG_ERR("Failed to initialize context exit conditional variable: rc=%d", rc);
+		goto error_exit_mutex;
+	}
+
+	context->exits_tail = &context->exits;
+
+	rc = watch_list_init(&context->watches);
+	if (rc) {
+		LOG_ERR("Failed to initialize context watches: rc=%d", rc);
+		goto error_exit_cond;
+	}
+
 	/* Set working directory */
 
 	context->working_directory = strdup(workdir);
 	if (!context->working_directory) {
-		goto error;
+		goto error_watches;
 	}
 
 	/* Initialize containers list */
 
 	context->containers = NULL;
 
+	context->memory_budget = CONFIG_OCRE_MEMORY_BUDGET;
+
 	return context;
 
+error_watches:
+	watch_list_destroy(&context->watches);
+
+error_exit_cond:
+	pthread_cond_destroy(&context->exit_cond);
+
+error_exit_mutex:
+	pthread_mutex_destroy(&context->exit_mutex);
+
+error_mutex:
+	pthread_mutex_destroy(&context->mutex);
+
 error:
 	if (context) {
 		free(context->working_directory);
@@ -163,7 +316,19 @@ int ocre_context_destroy(struct ocre_context *context)
 		ocre_context_remove_container_locked(context, node->container);
 	}
 
-	int rc = pthread_mutex_destroy(&context->mutex);
+	watch_list_destroy(&context->watches);
+
+	int rc = pthread_cond_destroy(&context->exit_cond);
+	if (rc) {
+		LOG_ERR("Failed to destroy context exit conditional variable: rc=%d", rc);
+	}
+
+	rc = pthread_mutex_destroy(&context->exit_mutex);
+	if (rc) {
+		LOG_ERR("Failed to destroy context exit mutex: rc=%d", rc);
+	}
+
+	rc = pthread_mutex_destroy(&context->mutex);
 	if (rc) {
 		LOG_ERR("Failed to destroy context mutex: rc=%d", rc);
 		return -1;
@@ -235,6 +400,13 @@ struct ocre_container *ocre_context_create_container(struct ocre_context *contex
 		computed_container_id = container_id;
 	}
 
+	/* A declared memory limit is known before loading anything */
+
+	if (arguments && arguments->memory_limit &&
+	    !budget_admit(context, computed_container_id, arguments->memory_limit + arguments->stack_size)) {
+		goto error;
+	}
+
 	/* Allocate the node */
 
 	node = malloc(sizeof(struct container_node));
@@ -245,18 +417,14 @@ struct ocre_container *ocre_context_create_container(struct ocre_context *contex
 
 	memset(node, 0, sizeof(struct container_node));
 
-	/* Build the full path to the image */
+	/* Build the full path to the image, or to its blob if it is a reference */
 
-	image_path = malloc(strlen(context->working_directory) + strlen("/images/") + strlen(image) + 1);
+	image_path = image_ref_resolve(context->working_directory, image);
 	if (!image_path) {
 		LOG_ERR("Failed to allocate memory for image path");
 		goto error;
 	}
 
-	strcpy(image_path, context->working_directory);
-	strcat(image_path, "/images/");
-	strcat(image_path, image);
-
 	// TODO: check if image exists
 
 	/* Build the path to the working dir and create it */
@@ -292,13 +460,37 @@ struct ocre_container *ocre_context_create_container(struct ocre_context *contex
 		goto error;
 	}
 
+	/* Reserve its memory */
+
+	size_t footprint = ocre_container_get_footprint(container);
+
+	if (!budget_admit(context, computed_container_id, footprint)) {
+		rc = ocre_container_destroy(container);
+		if (rc) {
+			LOG_ERR("Failed to destroy container: rc=%d", rc);
+		}
+
+		container = NULL;
+		goto error;
+	}
+
+	context->memory_reserved += footprint;
+	ocre_metric_gauge_add(OCRE_METRIC_MEMORY_RESERVED_BYTES, (int64_t)footprint);
+
 	/* Add the container to the context */
 
 	node->container = container;
+	node->footprint = footprint;
 	node->working_directory = container_workdir;
+	node->context = context;
+
+	ocre_container_set_status_hook(container, container_status_hook, node);
 
 	LL_APPEND(context->containers, node);
 
+	watch_list_emit(&context->watches, computed_container_id, OCRE_CONTAINER_STATUS_UNKNOWN,
+			OCRE_CONTAINER_STATUS_CREATED, 0);
+
 	goto success;
 
 error:
@@ -455,3 +647,135 @@ struct ocre_container *ocre_context_get_container_by_id(struct ocre_context *con
 
 	return ret;
 }
+
+static bool container_in(struct ocre_container *const *containers, size_t count, const struct ocre_container *container)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (containers[i] == container) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+struct ocre_container *ocre_context_wait_any(struct ocre_context *context, struct ocre_container *const *containers,
+					     size_t count, int timeout_ms)
+{
+	struct ocre_container *container = NULL;
+	struct timespec deadline;
+
+	if (!context || (!containers && count)) {
+		LOG_ERR("Invalid arguments");
+		return NULL;
+	}
+
+	if (timeout_ms > 0) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&context->exit_mutex);
+
+	for (;;) {
+		for (struct container_node **prev = &context->exits; *prev; prev = &(*prev)->exit_next) {
+			if (!containers || container_in(containers, count, (*prev)->container)) {
+				container = (*prev)->container;
+				exit_queue_remove_locked(context, prev);
+				goto unlock;
+			}
+		}
+
+		if (!timeout_ms) {
+			break;
+		}
+
+		int rc;
+		if (timeout_ms > 0) {
+			rc = pthread_cond_timedwait(&context->exit_cond, &context->exit_mutex, &deadline);
+		} else {
+			rc = pthread_cond_wait(&context->exit_cond, &context->exit_mutex);
+		}
+
+		if (rc == ETIMEDOUT) {
+			break;
+		}
+
+		if (rc) {
+			LOG_ERR("Failed to wait on context exit conditional variable: rc=%d", rc);
+			break;
+		}
+	}
+
+unlock:
+	pthread_mutex_unlock(&context->exit_mutex);
+
+	return container;
+}
+
+int ocre_context_set_memory_budget(struct ocre_context *context, size_t budget)
+{
+	int ret = 0;
+
+	if (!context) {
+		LOG_ERR("Invalid context");
+		return -1;
+	}
+
+	pthread_mutex_lock(&context->mutex);
+
+	if (budget && budget < context->memory_reserved) {
+		LOG_ERR("Containers already reserved %zu bytes, more than the budget of %zu bytes",
+			context->memory_reserved, budget);
+		ret = -1;
+	} else {
+		context->memory_budget = budget;
+	}
+
+	pthread_mutex_unlock(&context->mutex);
+
+	return ret;
+}
+
+int ocre_context_get_memory_budget(struct ocre_context *context, struct ocre_budget_stats *stats)
+{
+	if (!context || !stats) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	pthread_mutex_lock(&context->mutex);
+
+	stats->budget = context->memory_budget;
+	stats->reserved = context->memory_reserved;
+	stats->rejected = context->rejected;
+
+	pthread_mutex_unlock(&context->mutex);
+
+	return 0;
+}
+
+struct ocre_watch *ocre_context_watch(struct ocre_context *context, size_t capacity, ocre_watch_callback_t callback,
+				      void *arg)
+{
+	if (!context || (!capacity && !callback)) {
+		LOG_ERR("Invalid arguments");
+		return NULL;
+	}
+
+	return watch_list_add(&context->watches, capacity, callback, arg);
+}
+
+void ocre_context_unwatch(struct ocre_context *context, struct ocre_watch *watch)
+{
+	if (!context || !watch) {
+		return;
+	}
+
+	watch_list_remove(&context->watches, watch);
+}
@@ -9,8 +9,12 @@
 #define OCRE_CONTAINER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <unistd.h>
 
+#include <ocre/stats.h>
+
 /* Hack until Zephyr define those */
 #ifndef STDIN_FILENO
 #define STDIN_FILENO 0
@@ -56,6 +60,18 @@ typedef enum {
  */
 struct ocre_container;
 
+/**
+ * @brief Completion callback of the asynchronous container operations
+ *
+ * Called from a thread of Ocre, usually the container thread, so it must not block nor call the Ocre API on the same
+ * container. A supervisor can write to an eventfd or a pipe from it, and handle the completion in its event loop.
+ *
+ * @param container The container of the operation
+ * @param result The result of the operation
+ * @param arg The argument given with the callback
+ */
+typedef void (*ocre_container_callback_t)(struct ocre_container *container, int result, void *arg);
+
 /**
  * @brief Start a container
  * @memberof ocre_container
@@ -69,6 +85,22 @@ struct ocre_container;
  */
 int ocre_container_start(struct ocre_container *container);
 
+/**
+ * @brief Start a container without waiting for it
+ * @memberof ocre_container
+ *
+ * Same as ocre_container_start(), but returns once the container is launched. The callback is called once the container
+ * is running, with a result of zero, or when it failed to start, with a non-zero result. Attached containers are not
+ * waited for, use ocre_container_wait_async() to be notified of their exit.
+ *
+ * @param container A pointer to the container to start
+ * @param callback The function to call when the start completes
+ * @param arg The argument to pass to the callback
+ *
+ * @return Zero if the container was launched, non-zero on failure, in which case the callback is not called
+ */
+int ocre_container_start_async(struct ocre_container *container, ocre_container_callback_t callback, void *arg);
+
 /**
  * @brief Get the status of a container
  * @memberof ocre_container
@@ -113,7 +145,9 @@ const char *ocre_container_get_image(const struct ocre_container *container);
  *
  * Pauses a container in the context. The container must be in the RUNNING state, otherwise it will fail.
  *
- * Note: This is currently not supported in WAMR containers.
+ * A paused container keeps its state but does not use any CPU time. The call returns once the container is suspended.
+ *
+ * Note: In WAMR containers, this is supported only on POSIX.
  *
  * @param container A pointer to the container to pause
  *
@@ -127,7 +161,7 @@ int ocre_container_pause(struct ocre_container *container);
  *
  * Unpauses a container in the context. The container must be in the PAUSED state, otherwise it will fail.
  *
- * Note: This is currently not supported in WAMR containers.
+ * Note: In WAMR containers, this is supported only on POSIX.
  *
  * @param container A pointer to the container to unpause
  *
@@ -139,12 +173,14 @@ int ocre_container_unpause(struct ocre_container *container);
  * @brief Gracefully stop a container
  * @memberof ocre_container
  *
- * Stops a container in the context. The container must be in the RUNNING state, otherwise it will fail.
+ * Stops a container in the context. The container must be in the RUNNING or PAUSED state, otherwise it will fail.
  *
  * The operation will signal the container to stop, and after a grace period, it will be forcefully terminated if not
+ * exited. The grace period is set by the stop_timeout_ms container argument. This call blocks until the container
  * exited.
  *
- * Note: This is currently not supported in WAMR containers.
+ * Note: WAMR containers are notified with a lifecycle event, so they need the "ocre:api" capability to handle it.
+ * Other containers are terminated right away.
  *
  * @param container A pointer to the container to stop
  *
@@ -156,7 +192,10 @@ int ocre_container_stop(struct ocre_container *container);
  * @brief Forcefully terminate a container
  * @memberof ocre_container
  *
- * Terminates a container in the context. The container must be in the RUNNING state, otherwise it will fail.
+ * Terminates a container in the context. The container must be in the RUNNING or PAUSED state, otherwise it will fail.
+ *
+ * Note: blocking calls of WAMR containers into the Ocre API, like ocre_sleep(), are interrupted. Blocking WASI calls
+ * are not, so the container only exits when they return.
  *
  * @param container A pointer to the container to terminate
  *
@@ -181,6 +220,40 @@ int ocre_container_kill(struct ocre_container *container);
  */
 int ocre_container_wait(struct ocre_container *container, int *status);
 
+/**
+ * @brief Wait for a container to exit, for a limited time
+ * @memberof ocre_container
+ *
+ * Same as ocre_container_wait(), but gives up after the timeout. To wait for several containers at once, use
+ * ocre_context_wait_any().
+ *
+ * @param container A pointer to the container to wait for
+ * @param[out] status A pointer to store the exit status of the container. Can be NULL
+ * @param timeout_ms The maximum time to wait, in milliseconds. Zero does not wait, negative waits forever
+ *
+ * @return Zero if the container exited, -ETIMEDOUT if it is still running after the timeout, other non-zero value on
+ * failure
+ */
+int ocre_container_wait_timeout(struct ocre_container *container, int *status, int timeout_ms);
+
+/**
+ * @brief Get notified when a container exits
+ * @memberof ocre_container
+ *
+ * Same as ocre_container_wait(), but returns right away. The callback is called once the container exited, with its
+ * exit status. When the container is not running anymore, the callback is called before returning.
+ *
+ * The container is EXITED while the callback runs from the container thread. It becomes STOPPED once the status is
+ * queried, e.g. with ocre_container_get_status() from the event loop.
+ *
+ * @param container A pointer to the container to wait for
+ * @param callback The function to call when the container exits
+ * @param arg The argument to pass to the callback
+ *
+ * @return Zero on success, non-zero on failure, in which case the callback is not called
+ */
+int ocre_container_wait_async(struct ocre_container *container, ocre_container_callback_t callback, void *arg);
+
 /**
  * @brief Get detached mode
  * @memberof ocre_container
@@ -193,4 +266,142 @@ int ocre_container_wait(struct ocre_container *container, int *status);
  */
 bool ocre_container_is_detached(struct ocre_container *container);
 
+/**
+ * @brief Get the number of times a container was restarted by its restart policy
+ * @memberof ocre_container
+ *
+ * Restarts are counted over the whole life of the container, including the restarts of its previous runs.
+ *
+ * @param container A pointer to the container
+ *
+ * @return The number of restarts, or negative on failure
+ */
+int ocre_container_get_restart_count(struct ocre_container *container);
+
+/**
+ * @brief Get the call statistics of the native functions of a container
+ * @memberof ocre_container
+ *
+ * Counts the calls to each native function of the runtime engine and the time spent in them, since the container was
+ * created. Only available when Ocre is built with native profiling (OCRE_API_PROFILING).
+ *
+ * Works like snprintf(): at most max entries are written, and the number of native functions is returned.
+ *
+ * @param container A pointer to the container
+ * @param[out] stats An array to fill. Can be NULL if max is zero
+ * @param max The number of entries of the array
+ *
+ * @return The number of native functions on success, negative on failure or if profiling is not available
+ */
+int ocre_container_get_native_stats(struct ocre_container *container, struct ocre_native_stats *stats, size_t max);
+
+/**
+ * @brief Get the memory usage of a container
+ * @memberof ocre_container
+ *
+ * Reports the memory the runtime engine allocated on behalf of the container, since it was created, and its memory
+ * limit. Only available on platforms with memory arenas, such as Linux.
+ *
+ * @param container A pointer to the container
+ * @param[out] stats The structure to fill
+ *
+ * @return Zero on success, non-zero on failure or if memory accounting is not available
+ */
+int ocre_container_get_memory_stats(struct ocre_container *container, struct ocre_memory_stats *stats);
+
+/**
+ * @brief Get the execution profile of the guest functions of a container
+ * @memberof ocre_container
+ *
+ * The profile is a text report of the number of calls, the total time and the self time of each called function,
+ * followed by the memory consumption of the container. While the container runs, it covers the execution so far.
+ * Once the container exited, it covers its last run. Only available when Ocre is built with guest profiling
+ * (OCRE_WAMR_PROFILING).
+ *
+ * Works like snprintf(): at most size bytes are written, and the length of the profile is returned.
+ *
+ * @param container A pointer to the container
+ * @param[out] buf A buffer to write the profile to. Can be NULL if size is zero
+ * @param size The size of the buffer
+ *
+ * @return The length of the profile on success, negative on failure or if profiling is not available
+ */
+int ocre_container_get_profile(struct ocre_container *container, char *buf, size_t size);
+
+/**
+ * @brief Sample the call stack of a running container
+ * @memberof ocre_container
+ *
+ * Takes a sample of the guest call stack every period_ms, for duration_ms or until the container exits. Then the
+ * callback is called once for each distinct call stack, with its number of samples, in the folded stack format of
+ * flame graph tools. Blocks while sampling. The container must not be removed while it is sampled.
+ *
+ * Only available when Ocre is built with guest profiling (OCRE_WAMR_PROFILING), for containers that are not reactors.
+ *
+ * @param container A pointer to the container
+ * @param duration_ms How long to sample, in milliseconds
+ * @param period_ms The time between samples, in milliseconds
+ * @param callback Called with each distinct call stack
+ * @param arg Argument of the callback
+ *
+ * @return The number of samples on success, negative on failure or if sampling is not available
+ */
+int ocre_container_sample(struct ocre_container *container, unsigned int duration_ms, unsigned int period_ms,
+			  ocre_stack_callback_t callback, void *arg);
+
+/**
+ * @brief Save the state of a paused container to a file
+ * @memberof ocre_container
+ *
+ * The checkpoint holds the linear memory of the container, its mutable exported globals, its event dispatchers, timers
+ * and messaging subscriptions. Pages of memory that are all zeroes are left as holes of the file. The file is written
+ * atomically: it either holds the whole checkpoint or is left untouched.
+ *
+ * Only reactor containers can be checkpointed: between two events, they have no call stack to save.
+ *
+ * @param container A pointer to the container, which must be paused
+ * @param path The path of the checkpoint file
+ *
+ * @return Zero on success, non-zero on failure
+ */
+int ocre_container_checkpoint(struct ocre_container *container, const char *path);
+
+/**
+ * @brief Restore the state of a container from a checkpoint on its next start
+ * @memberof ocre_container
+ *
+ * The next ocre_container_start() loads the checkpoint instead of running the entry point of the container. The
+ * checkpoint must have been taken from a container of the same image. Only reactor containers can be restored.
+ *
+ * @param container A pointer to the container, which must be created or stopped
+ * @param path The path of the checkpoint file
+ *
+ * @return Zero on success, non-zero on failure
+ */
+int ocre_container_restore(struct ocre_container *container, const char *path);
+
+/**
+ * @brief Read the captured output of a container
+ * @memberof ocre_container
+ *
+ * The output is only captured for containers created with ocre_container_args::capture_logs. Their stdout and stderr
+ * are kept together in a ring buffer, which holds the last bytes they wrote.
+ *
+ * The cursor tells where to read from, as the number of bytes written by the container since it was created. Start
+ * with zero, and pass the same cursor to the next call to get what was written since. When the bytes at the cursor
+ * were overwritten, the read starts at the oldest bytes still in the buffer.
+ *
+ * The container must not be removed while it is read.
+ *
+ * @param container A pointer to the container
+ * @param cursor Where to read from, updated to where to read next
+ * @param buf The buffer to read into
+ * @param size The size of the buffer
+ * @param timeout_ms How long to wait for output when there is none to read, 0 to not wait, negative to wait forever
+ *
+ * @return The number of bytes read, zero on timeout, negative if the output of the container is not captured
+ */
+int ocre_container_read_logs(struct ocre_container *container, uint64_t *cursor, char *buf, size_t size,
+			     int timeout_ms);
+
 #endif /* OCRE_CONTAINER_H */
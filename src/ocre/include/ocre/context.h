@@ -9,8 +9,10 @@
 #define OCRE_CONTEXT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 struct ocre_container;
+struct ocre_budget_stats;
 
 /**
  * @class ocre_context
@@ -24,6 +26,37 @@ struct ocre_container;
  */
 struct ocre_context;
 
+/**
+ * @brief Size of the hexadecimal SHA-256 digest of an image, including the terminating NUL
+ */
+#define OCRE_IMAGE_DIGEST_SIZE 65
+
+/**
+ * @brief Start of an image reference, followed by the digest of the blob and a newline
+ */
+#define OCRE_IMAGE_REF_PREFIX "sha256:"
+
+/**
+ * @brief Scheduling policy of a container thread
+ * @headerfile ocre.h <ocre/ocre.h>
+ */
+enum ocre_sched_policy {
+	OCRE_SCHED_DEFAULT = 0, ///< Inherited from the thread starting the container
+	OCRE_SCHED_OTHER,	///< Time-sharing, with sched_priority as nice value
+	OCRE_SCHED_FIFO,	///< Real-time first-in first-out, with sched_priority as real-time priority
+	OCRE_SCHED_RR,		///< Real-time round-robin, with sched_priority as real-time priority
+};
+
+/**
+ * @brief Restart policy of a container
+ * @headerfile ocre.h <ocre/ocre.h>
+ */
+enum ocre_restart_policy {
+	OCRE_RESTART_NO = 0,	 ///< Never restarted
+	OCRE_RESTART_ON_FAILURE, ///< Restarted when it exits with a non-zero exit code
+	OCRE_RESTART_ALWAYS,	 ///< Restarted whenever it exits
+};
+
 /**
  * @brief Container arguments
  * @headerfile ocre.h <ocre/ocre.h>
@@ -113,6 +146,145 @@ struct ocre_container_args {
 	 * @endcode
 	 */
 	const char **mounts;
+
+	/** @brief CPU time quota of the container, in microseconds per period
+	 *
+	 * The container is allowed to use at most this much CPU time in each period of cpu_period_us. When it uses up
+	 * its quota, the container is throttled (suspended, not terminated) until the next period starts.
+	 *
+	 * For example, a quota of 25000 with a period of 100000 caps the container to a quarter of a core.
+	 *
+	 * Zero means no limit. Requires a runtime engine supporting CPU quotas.
+	 */
+	unsigned int cpu_quota_us;
+
+	/** @brief Length of the CPU quota period, in microseconds
+	 *
+	 * Only used if cpu_quota_us is set. Zero means the runtime default (usually 100000, i.e. 100 ms).
+	 */
+	unsigned int cpu_period_us;
+
+	/** @brief Memory limit of the container, in bytes
+	 *
+	 * Limits the memory the runtime engine takes from the host heap on behalf of the container. Once reached, its
+	 * allocations fail: the container may fail to start, or trap, while the host and the other containers carry on.
+	 * The usage is reported by ocre_container_get_memory_stats().
+	 *
+	 * Zero means no limit. Requires a runtime engine supporting memory limits.
+	 */
+	size_t memory_limit;
+
+	/** @brief Time given to the container to exit after a stop request, in milliseconds
+	 *
+	 * When the container is stopped, it is notified and given this much time to exit on its own. When the time
+	 * expires, it is killed.
+	 *
+	 * Zero means the default (CONFIG_OCRE_CONTAINER_STOP_TIMEOUT_MS).
+	 */
+	unsigned int stop_timeout_ms;
+
+	/** @brief Run the container as a reactor on the shared worker pool
+	 *
+	 * For event-driven containers. Their entry point runs once and registers event dispatchers, then the
+	 * container stays running without a thread of its own: its dispatchers are called on one of a fixed pool of
+	 * worker threads when events arrive. When all the workers are busy, the containers wait in line.
+	 *
+	 * A container without any dispatcher once its entry point returns simply exits. Long-running containers
+	 * should not be reactors, as they would hold a worker for as long as they run.
+	 *
+	 * Requires a runtime engine supporting reactors. Not compatible with CPU quotas.
+	 */
+	bool reactor;
+
+	/** @brief Size of the native stack of the container thread, in bytes
+	 *
+	 * This is the stack of the host thread running the container, not the stack of the WebAssembly application.
+	 * Small containers can use a smaller stack to reduce their memory reservation.
+	 *
+	 * Zero means the platform default. Not compatible with reactors.
+	 */
+	size_t stack_size;
+
+	/** @brief CPUs the container thread is allowed to run on
+	 *
+	 * A list of CPU numbers and ranges, like "0-3,6". Can be used to pin latency-critical containers to isolated
+	 * cores.
+	 *
+	 * NULL means any CPU. Not supported on all platforms. Not compatible with reactors.
+	 */
+	const char *cpuset;
+
+	/** @brief Scheduling policy of the container thread
+	 *
+	 * Real-time policies usually require elevated privileges, otherwise the container fails to start.
+	 *
+	 * Not compatible with reactors.
+	 */
+	enum ocre_sched_policy sched_policy;
+
+	/** @brief Priority of the container thread, depending on sched_policy
+	 *
+	 * For OCRE_SCHED_OTHER, the nice value, from -20 (highest priority) to 19. Lowering it usually requires
+	 * elevated privileges; if it cannot be applied, a warning is logged and the container runs anyway.
+	 *
+	 * For OCRE_SCHED_FIFO and OCRE_SCHED_RR, the real-time priority, in the range allowed by the platform.
+	 *
+	 * Must be zero for OCRE_SCHED_DEFAULT.
+	 */
+	int sched_priority;
+
+	/** @brief Restart policy of the container
+	 *
+	 * A container exiting according to its policy is restarted in place, by its own thread: the module stays
+	 * loaded and only a new instance is created, so the container stays RUNNING across restarts. A container is
+	 * never restarted after it was stopped or killed.
+	 *
+	 * Not compatible with reactors.
+	 */
+	enum ocre_restart_policy restart_policy;
+
+	/** @brief Maximum number of consecutive restarts
+	 *
+	 * Once reached, the container is left to exit. The count starts over when the container ran for longer than
+	 * restart_backoff_max_ms, or when it is started again. Zero means no limit.
+	 */
+	unsigned int restart_max_retries;
+
+	/** @brief Delay before the first restart, in milliseconds
+	 *
+	 * The delay doubles after each consecutive restart, up to restart_backoff_max_ms. A random jitter of up to
+	 * half the delay is taken off, so containers failing together do not restart together.
+	 *
+	 * Zero means the default (CONFIG_OCRE_RESTART_BACKOFF_MS).
+	 */
+	unsigned int restart_backoff_ms;
+
+	/** @brief Maximum delay before a restart, in milliseconds
+	 *
+	 * Zero means the default (CONFIG_OCRE_RESTART_BACKOFF_MAX_MS).
+	 */
+	unsigned int restart_backoff_max_ms;
+
+	/** @brief Capture the output of the container
+	 *
+	 * Its stdout and stderr are kept in a ring buffer, read with ocre_container_read_logs(), instead of going to
+	 * the file descriptors given at creation. Writes of the container never block: when the host falls behind,
+	 * they fail with EAGAIN. Requires CONFIG_OCRE_CONTAINER_LOGS.
+	 */
+	bool capture_logs;
+
+	/** @brief Size of the ring buffer of the captured output, in bytes
+	 *
+	 * Zero means the default (CONFIG_OCRE_CONTAINER_LOG_SIZE).
+	 */
+	size_t log_size;
+
+	/** @brief Maximum size of the log file of the captured output, in bytes
+	 *
+	 * The captured output is also appended to container.log, in the working directory of the container. When it
+	 * grows past this size, it is renamed to container.log.1, replacing the previous one. Zero means no log file.
+	 */
+	size_t log_file_size;
 };
 
 /**
@@ -186,6 +358,57 @@ int ocre_context_get_container_count(struct ocre_context *context);
  */
 int ocre_context_get_containers(struct ocre_context *context, struct ocre_container **containers, int max_size);
 
+/**
+ * @brief Wait for any of several containers to exit
+ * @memberof ocre_context
+ *
+ * The context queues the exits of its containers, oldest first. Returns the first container of the queue among the
+ * given ones and removes it from the queue, or waits for one of them to exit. Each exit is reported once, by a single
+ * call. Use ocre_container_wait() on the returned container to get its exit status, it does not block.
+ *
+ * Exits are queued even when nobody waits, until they are reported or the container is removed, so exits that happen
+ * between two calls are not missed. A container is queued once, even if it exited several times before being
+ * reported.
+ *
+ * @param context A pointer to the context of the containers
+ * @param containers The containers to wait for. Can be NULL to wait for any container of the context
+ * @param count The number of containers. Must be zero if containers is NULL
+ * @param timeout_ms The maximum time to wait, in milliseconds. Zero does not wait, negative waits forever
+ *
+ * @return The container that exited, or NULL if none exited before the timeout, or on failure
+ */
+struct ocre_container *ocre_context_wait_any(struct ocre_context *context, struct ocre_container *const *containers,
+					     size_t count, int timeout_ms);
+
+/**
+ * @brief Set the memory budget of the context
+ * @memberof ocre_context
+ *
+ * Each container reserves its footprint against the budget when it is created, and gives it back when it is removed.
+ * The footprint is the memory limit of the container if it has one, or else the estimate of its runtime engine (the
+ * module, its linear memory up to the declared maximum, stacks and heap), plus its native stack size if set. A
+ * container whose footprint does not fit in what is left of the budget is not created.
+ *
+ * The budget starts at CONFIG_OCRE_MEMORY_BUDGET. It cannot be set below the memory already reserved.
+ *
+ * @param context A pointer to the context
+ * @param budget The memory the containers can reserve, in bytes. Zero means unlimited
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int ocre_context_set_memory_budget(struct ocre_context *context, size_t budget);
+
+/**
+ * @brief Get the memory budget of the context and the memory reserved by its containers
+ * @memberof ocre_context
+ *
+ * @param context A pointer to the context
+ * @param[out] stats The structure to fill
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int ocre_context_get_memory_budget(struct ocre_context *context, struct ocre_budget_stats *stats);
+
 /**
  * @brief Get the working directory of the context
  * @memberof ocre_context
@@ -199,4 +422,21 @@ int ocre_context_get_containers(struct ocre_context *context, struct ocre_contai
  */
 const char *ocre_context_get_working_directory(const struct ocre_context *context);
 
+/**
+ * @brief Read an image reference
+ * @memberof ocre_context
+ *
+ * Images in the images directory of a context are either plain files, or references to a blob of the
+ * content-addressed store, holding OCRE_IMAGE_REF_PREFIX, the digest of the blob and a newline. The content of a
+ * referenced image is in blobs/sha256/<digest>. Tools managing the images directory should use this, so they agree
+ * with the library on what a reference is.
+ *
+ * @param path The path of the image file
+ * @param[out] digest Filled with the digest of the blob, if the image is a reference. At least OCRE_IMAGE_DIGEST_SIZE
+ * bytes
+ *
+ * @return 0 if the image is a reference, 1 if it is a plain file, negative if it could not be read
+ */
+int ocre_image_ref_read(const char *path, char *digest);
+
 #endif /* OCRE_CONTEXT_H */
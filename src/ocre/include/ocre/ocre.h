@@ -44,6 +44,14 @@
  *
  * See ocre_container class for documentation.
  *
+ * ## Ocre Metrics: used to monitor Ocre.
+ *
+ * See metrics.h file documentation.
+ *
+ * ## Ocre Tracing: used to see where the time goes.
+ *
+ * See trace.h file documentation.
+ *
  * # Runtime Engine Virtual Table
  *
  * Used to add custom runtime engines to the Ocre Runtime Library.
@@ -52,8 +60,11 @@
  */
 
 #include <ocre/common.h>
+#include <ocre/metrics.h>
+#include <ocre/trace.h>
 #include <ocre/library.h>
 #include <ocre/context.h>
 #include <ocre/container.h>
+#include <ocre/watch.h>
 
 #endif /* OCRE_H */
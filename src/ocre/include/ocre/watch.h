@@ -0,0 +1,112 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_WATCH_H
+#define OCRE_WATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ocre/container.h>
+
+struct ocre_context;
+
+/**
+ * @brief Size of the container ID in the events, including the terminating NUL
+ */
+#define OCRE_CONTAINER_EVENT_ID_SIZE 64
+
+/**
+ * @brief A status change of a container
+ * @headerfile ocre.h <ocre/ocre.h>
+ */
+struct ocre_container_event {
+	uint64_t sequence;		       /**< Number of the event in the context, starting at 1 */
+	uint64_t timestamp_ns;		       /**< Time of the change, from the clock of ocre_metrics_now_ns() */
+	char id[OCRE_CONTAINER_EVENT_ID_SIZE]; /**< ID of the container, truncated if longer */
+	ocre_container_status_t old_status;    /**< Status before the change, UNKNOWN when the container was created */
+	ocre_container_status_t new_status;    /**< Status after the change, UNKNOWN when the container was removed */
+	int exit_code;			       /**< Exit code, for EXITED, STOPPED and restarts */
+};
+
+/**
+ * @brief Callback of a watch
+ *
+ * Called for each event, in order, from the thread changing the status, while the status change is in progress. It
+ * must not block nor call the Ocre API.
+ *
+ * @param event The event, only valid during the call
+ * @param arg The argument given with the callback
+ */
+typedef void (*ocre_watch_callback_t)(const struct ocre_container_event *event, void *arg);
+
+/**
+ * @class ocre_watch
+ * @headerfile ocre.h <ocre/ocre.h>
+ * @brief A subscription to the status changes of the containers of a context
+ */
+struct ocre_watch;
+
+/**
+ * @brief Subscribe to the status changes of the containers of a context
+ * @memberof ocre_context
+ *
+ * Every status change of the containers of the context is recorded in the ring of the watch, and passed to its
+ * callback. When the ring is full, the oldest events are dropped, which shows as a gap in their sequence numbers.
+ *
+ * A container restarted by its restart policy stays RUNNING, the restart is reported as a change from RUNNING to
+ * RUNNING, with the exit code of the run that ended.
+ *
+ * @param context A pointer to the context to watch
+ * @param capacity The number of events the ring holds. Can be zero to only use the callback
+ * @param callback The function to call for each event. Can be NULL to only use the ring
+ * @param arg The argument to pass to the callback
+ *
+ * @return The watch, or NULL on failure
+ */
+struct ocre_watch *ocre_context_watch(struct ocre_context *context, size_t capacity, ocre_watch_callback_t callback,
+				      void *arg);
+
+/**
+ * @brief Unsubscribe and free a watch
+ * @memberof ocre_context
+ *
+ * No callback of the watch runs once this returns.
+ *
+ * @param context A pointer to the watched context
+ * @param watch The watch to free
+ */
+void ocre_context_unwatch(struct ocre_context *context, struct ocre_watch *watch);
+
+/**
+ * @brief Take the oldest events out of the ring of a watch
+ * @memberof ocre_watch
+ *
+ * @param watch The watch
+ * @param[out] events The array to fill
+ * @param max The size of the array
+ * @param timeout_ms The maximum time to wait for an event when the ring is empty, in milliseconds. Zero does not
+ * wait, negative waits forever
+ *
+ * @return The number of events, zero if none came before the timeout, negative on failure
+ */
+int ocre_watch_read(struct ocre_watch *watch, struct ocre_container_event *events, size_t max, int timeout_ms);
+
+/**
+ * @brief Get a file descriptor for poll() or epoll
+ * @memberof ocre_watch
+ *
+ * The file descriptor is readable while the ring of the watch has events. It is owned by the watch, only poll it and
+ * take the events with ocre_watch_read().
+ *
+ * @param watch The watch
+ *
+ * @return The file descriptor, or -ENOTSUP if the platform has no eventfd
+ */
+int ocre_watch_get_fd(struct ocre_watch *watch);
+
+#endif /* OCRE_WATCH_H */
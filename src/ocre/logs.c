@@ -0,0 +1,663 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
+
+#include "logs.h"
+
+LOG_MODULE_REGISTER(logs, CONFIG_OCRE_LOG_LEVEL);
+
+#ifdef CONFIG_OCRE_CONTAINER_LOGS
+
+#define LOG_FILE_NAME "container.log"
+
+/* Bytes read from a pipe at once, and at most per pipe in each round, so a chatty container does not starve others */
+
+#define DRAIN_CHUNK_SIZE  4096
+#define DRAIN_MAX_CHUNKS  16
+
+/* Pipes the drainer has room to poll at first, the array grows with the number of logs */
+
+#define DRAIN_MIN_LOGS 8
+
+/* Send buffer asked for the write end, so bursts are absorbed before guest writes fail */
+
+#define CHANNEL_CAPACITY 65536
+
+struct container_log {
+	struct container_log *next;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int read_fd;
+	int write_fd;
+
+	/* Ring buffer. head is the total number of bytes ever written, the ring keeps the last size of them */
+
+	char *buf;
+	size_t size;
+	uint64_t head;
+
+	/* Optional log file. Only touched by the drainer, and by container_log_destroy() once the drainer let go */
+
+	char *file_path;
+	int file_fd;
+	size_t file_size;
+	size_t file_written;
+};
+
+/* The drainer thread polls the pipes of all the logs. Adding or removing a log bumps the generation and wakes it up
+ * through the wake pipe, so it never touches a log that was removed while it was polling.
+ *
+ * The pipes are drained and the log files written without logs_mutex, so a slow disk does not hold up creating and
+ * destroying other logs. While the drainer does that, draining is set, and container_log_destroy() waits for it to be
+ * cleared before freeing a log.
+ */
+
+static pthread_mutex_t logs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drained_cond = PTHREAD_COND_INITIALIZER;
+static struct container_log *logs;
+static unsigned int logs_generation;
+static bool draining;
+static pthread_t drainer_thread;
+static bool drainer_running;
+static bool drainer_shutdown;
+static int wake_fds[2] = {-1, -1};
+
+static int set_nonblock(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* A connected pair of sockets is used as a pipe, as it is available on Zephyr too */
+
+static int open_channel(int fds[2])
+{
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+		LOG_ERR("Failed to create socket pair: errno=%d", errno);
+		return -1;
+	}
+
+	if (set_nonblock(fds[0]) || set_nonblock(fds[1])) {
+		LOG_ERR("Failed to configure socket pair: errno=%d", errno);
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void wake_drainer(void)
+{
+	char c = 0;
+
+	if (write(wake_fds[1], &c, 1) < 0 && errno != EAGAIN) {
+		LOG_WRN("Failed to wake up log drainer: errno=%d", errno);
+	}
+}
+
+/* Only called by the drainer */
+
+static int file_open(struct container_log *log)
+{
+	struct stat st;
+
+	log->file_fd = open(log->file_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (log->file_fd < 0) {
+		LOG_ERR("Failed to open log file '%s': errno=%d", log->file_path, errno);
+		return -1;
+	}
+
+	log->file_written = fstat(log->file_fd, &st) ? 0 : (size_t)st.st_size;
+
+	return 0;
+}
+
+static void file_rotate(struct container_log *log)
+{
+	size_t len = strlen(log->file_path) + sizeof(".1");
+	char *rotated = malloc(len);
+
+	close(log->file_fd);
+	log->file_fd = -1;
+
+	if (!rotated) {
+		LOG_ERR("Failed to allocate memory for log file path");
+		return;
+	}
+
+	snprintf(rotated, len, "%s.1", log->file_path);
+
+	if (rename(log->file_path, rotated)) {
+		LOG_ERR("Failed to rotate log file '%s': errno=%d", log->file_path, errno);
+	}
+
+	free(rotated);
+
+	file_open(log);
+}
+
+static void file_write(struct container_log *log, const char *data, size_t len)
+{
+	if (log->file_fd < 0 && file_open(log)) {
+		return;
+	}
+
+	if (log->file_written && log->file_written + len > log->file_size) {
+		file_rotate(log);
+
+		if (log->file_fd < 0) {
+			return;
+		}
+	}
+
+	while (len) {
+		ssize_t n = write(log->file_fd, data, len);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			LOG_ERR("Failed to write log file '%s': errno=%d", log->file_path, errno);
+			return;
+		}
+
+		data += n;
+		len -= n;
+		log->file_written += n;
+	}
+}
+
+static void ring_append(struct container_log *log, const char *data, size_t len)
+{
+	pthread_mutex_lock(&log->mutex);
+
+	if (len > log->size) {
+		log->head += len - log->size;
+		data += len - log->size;
+		len = log->size;
+	}
+
+	size_t pos = log->head % log->size;
+	size_t first = len < log->size - pos ? len : log->size - pos;
+
+	memcpy(log->buf + pos, data, first);
+	memcpy(log->buf, data + first, len - first);
+
+	log->head += len;
+
+	pthread_cond_broadcast(&log->cond);
+	pthread_mutex_unlock(&log->mutex);
+}
+
+/* Called by the drainer with draining set, without logs_mutex */
+
+static void drain(struct container_log *log)
+{
+	char chunk[DRAIN_CHUNK_SIZE];
+
+	for (int i = 0; i < DRAIN_MAX_CHUNKS; i++) {
+		ssize_t n = read(log->read_fd, chunk, sizeof(chunk));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n <= 0) {
+			return;
+		}
+
+		ring_append(log, chunk, n);
+
+		if (log->file_path) {
+			file_write(log, chunk, n);
+		}
+	}
+}
+
+static void *drainer(void *arg)
+{
+	size_t capacity = DRAIN_MIN_LOGS;
+	struct pollfd *fds = malloc(capacity * sizeof(*fds));
+	struct container_log **polled = malloc(capacity * sizeof(*polled));
+
+	(void)arg;
+
+	if (!fds || !polled) {
+		LOG_ERR("Failed to allocate memory for log pipes");
+		free(polled);
+		free(fds);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&logs_mutex);
+
+	while (!drainer_shutdown) {
+		size_t count = 1;
+
+		for (struct container_log *log = logs; log; log = log->next) {
+			count++;
+		}
+
+		if (count > capacity) {
+			struct pollfd *new_fds = realloc(fds, count * sizeof(*fds));
+			if (new_fds) {
+				fds = new_fds;
+			}
+
+			struct container_log **new_polled = realloc(polled, count * sizeof(*polled));
+			if (new_polled) {
+				polled = new_polled;
+			}
+
+			if (!new_fds || !new_polled) {
+				LOG_ERR("Failed to allocate memory for %zu log pipes, polling %zu", count, capacity);
+				count = capacity;
+			} else {
+				capacity = count;
+			}
+		}
+
+		fds[0].fd = wake_fds[0];
+		fds[0].events = POLLIN;
+
+		size_t i = 1;
+		for (struct container_log *log = logs; log && i < count; log = log->next, i++) {
+			fds[i].fd = log->read_fd;
+			fds[i].events = POLLIN;
+			polled[i] = log;
+		}
+
+		unsigned int generation = logs_generation;
+
+		pthread_mutex_unlock(&logs_mutex);
+
+		int rc = poll(fds, count, -1);
+		if (rc < 0 && errno != EINTR) {
+			LOG_ERR("Failed to poll log pipes: errno=%d", errno);
+		}
+
+		if (rc > 0 && fds[0].revents) {
+			char discard[64];
+
+			while (read(wake_fds[0], discard, sizeof(discard)) > 0) {
+			}
+		}
+
+		pthread_mutex_lock(&logs_mutex);
+
+		/* The logs polled are only still there if the generation did not change. If it did, whatever is left in
+		 * their pipes is picked up at the next round
+		 */
+
+		if (rc > 0 && generation == logs_generation) {
+			draining = true;
+
+			pthread_mutex_unlock(&logs_mutex);
+
+			for (i = 1; i < count; i++) {
+				if (fds[i].revents & (POLLIN | POLLHUP)) {
+					drain(polled[i]);
+				}
+			}
+
+			pthread_mutex_lock(&logs_mutex);
+
+			draining = false;
+			pthread_cond_broadcast(&drained_cond);
+		}
+	}
+
+	pthread_mutex_unlock(&logs_mutex);
+
+	free(polled);
+	free(fds);
+
+	return NULL;
+}
+
+/* Called with logs_mutex held */
+
+static int drainer_start(void)
+{
+	int rc;
+
+	if (drainer_running) {
+		return 0;
+	}
+
+	if (open_channel(wake_fds)) {
+		return -1;
+	}
+
+	drainer_shutdown = false;
+
+	rc = pthread_create(&drainer_thread, NULL, drainer, NULL);
+	if (rc) {
+		LOG_ERR("Failed to create log drainer thread: rc=%d", rc);
+		close(wake_fds[0]);
+		close(wake_fds[1]);
+		return -1;
+	}
+
+	drainer_running = true;
+
+	LOG_INF("Started container log drainer");
+
+	return 0;
+}
+
+struct container_log *container_log_create(const char *workdir, size_t size, size_t file_size)
+{
+	struct container_log *log;
+	int fds[2];
+	int rc;
+
+	if (!size) {
+		size = CONFIG_OCRE_CONTAINER_LOG_SIZE;
+	}
+
+	if (file_size && !workdir) {
+		LOG_ERR("A working directory is required to write the log file");
+		return NULL;
+	}
+
+	log = calloc(1, sizeof(*log));
+	if (!log) {
+		LOG_ERR("Failed to allocate memory for container log");
+		return NULL;
+	}
+
+	log->file_fd = -1;
+	log->file_size = file_size;
+	log->size = size;
+
+	log->buf = malloc(size);
+	if (!log->buf) {
+		LOG_ERR("Failed to allocate %zu bytes for container log", size);
+		goto error_free;
+	}
+
+	if (file_size) {
+		size_t len = strlen(workdir) + sizeof("/" LOG_FILE_NAME);
+
+		log->file_path = malloc(len);
+		if (!log->file_path) {
+			LOG_ERR("Failed to allocate memory for log file path");
+			goto error_free;
+		}
+
+		snprintf(log->file_path, len, "%s/" LOG_FILE_NAME, workdir);
+	}
+
+	rc = pthread_mutex_init(&log->mutex, NULL);
+	if (rc) {
+		LOG_ERR("Failed to initialize container log mutex: rc=%d", rc);
+		goto error_free;
+	}
+
+	rc = pthread_cond_init(&log->cond, NULL);
+	if (rc) {
+		LOG_ERR("Failed to initialize container log condition variable: rc=%d", rc);
+		goto error_mutex;
+	}
+
+	/* The write end is non-blocking: when the drainer falls behind and the pipe is full, guest writes fail with
+	 * EAGAIN instead of stalling the container
+	 */
+
+	if (open_channel(fds)) {
+		goto error_cond;
+	}
+
+	log->read_fd = fds[0];
+	log->write_fd = fds[1];
+
+	int capacity = CHANNEL_CAPACITY;
+	if (setsockopt(log->write_fd, SOL_SOCKET, SO_SNDBUF, &capacity, sizeof(capacity))) {
+		LOG_DBG("Failed to set log channel capacity: errno=%d", errno);
+	}
+
+	pthread_mutex_lock(&logs_mutex);
+
+	if (drainer_start()) {
+		pthread_mutex_unlock(&logs_mutex);
+		goto error_pipe;
+	}
+
+	log->next = logs;
+	logs = log;
+	logs_generation++;
+
+	pthread_mutex_unlock(&logs_mutex);
+
+	wake_drainer();
+
+	return log;
+
+error_pipe:
+	close(log->read_fd);
+	close(log->write_fd);
+
+error_cond:
+	pthread_cond_destroy(&log->cond);
+
+error_mutex:
+	pthread_mutex_destroy(&log->mutex);
+
+error_free:
+	free(log->file_path);
+	free(log->buf);
+	free(log);
+
+	return NULL;
+}
+
+void container_log_destroy(struct container_log *log)
+{
+	if (!log) {
+		return;
+	}
+
+	pthread_mutex_lock(&logs_mutex);
+
+	for (struct container_log **p = &logs; *p; p = &(*p)->next) {
+		if (*p == log) {
+			*p = log->next;
+			break;
+		}
+	}
+
+	logs_generation++;
+
+	/* The drainer may be writing to this log right now. Once it is done, the new generation keeps it away */
+
+	while (draining) {
+		pthread_cond_wait(&drained_cond, &logs_mutex);
+	}
+
+	pthread_mutex_unlock(&logs_mutex);
+
+	wake_drainer();
+
+	/* Keep what the container wrote last in the log file */
+
+	if (log->file_path) {
+		char chunk[DRAIN_CHUNK_SIZE];
+		ssize_t n;
+
+		while ((n = read(log->read_fd, chunk, sizeof(chunk))) > 0) {
+			file_write(log, chunk, n);
+		}
+	}
+
+	close(log->read_fd);
+	close(log->write_fd);
+
+	if (log->file_fd >= 0) {
+		close(log->file_fd);
+	}
+
+	pthread_cond_destroy(&log->cond);
+	pthread_mutex_destroy(&log->mutex);
+
+	free(log->file_path);
+	free(log->buf);
+	free(log);
+}
+
+int container_log_get_fd(const struct container_log *log)
+{
+	return log->write_fd;
+}
+
+int container_log_read(struct container_log *log, uint64_t *cursor, char *buf, size_t size, int timeout_ms)
+{
+	struct timespec deadline;
+
+	if (timeout_ms > 0) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&log->mutex);
+
+	while (*cursor >= log->head && timeout_ms) {
+		if (timeout_ms < 0) {
+			pthread_cond_wait(&log->cond, &log->mutex);
+		} else if (pthread_cond_timedwait(&log->cond, &log->mutex, &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+
+	/* Skip what was overwritten, and do not wait for bytes that were never written */
+
+	uint64_t tail = log->head > log->size ? log->head - log->size : 0;
+
+	if (*cursor < tail) {
+		*cursor = tail;
+	}
+
+	if (*cursor > log->head) {
+		*cursor = log->head;
+	}
+
+	size_t len = log->head - *cursor;
+	if (len > size) {
+		len = size;
+	}
+
+	if (len > INT32_MAX) {
+		len = INT32_MAX;
+	}
+
+	size_t pos = *cursor % log->size;
+	size_t first = len < log->size - pos ? len : log->size - pos;
+
+	memcpy(buf, log->buf + pos, first);
+	memcpy(buf + first, log->buf, len - first);
+
+	*cursor += len;
+
+	pthread_mutex_unlock(&log->mutex);
+
+	return (int)len;
+}
+
+void container_log_shutdown(void)
+{
+	pthread_mutex_lock(&logs_mutex);
+
+	if (!drainer_running) {
+		pthread_mutex_unlock(&logs_mutex);
+		return;
+	}
+
+	drainer_shutdown = true;
+
+	pthread_mutex_unlock(&logs_mutex);
+
+	wake_drainer();
+
+	pthread_join(drainer_thread, NULL);
+
+	close(wake_fds[0]);
+	close(wake_fds[1]);
+
+	wake_fds[0] = -1;
+	wake_fds[1] = -1;
+
+	drainer_running = false;
+}
+
+#else
+
+struct container_log *container_log_create(const char *workdir, size_t size, size_t file_size)
+{
+	(void)workdir;
+	(void)size;
+	(void)file_size;
+
+	LOG_ERR("Container log capture is not supported");
+
+	return NULL;
+}
+
+void container_log_destroy(struct container_log *log)
+{
+	(void)log;
+}
+
+int container_log_get_fd(const struct container_log *log)
+{
+	(void)log;
+
+	return -1;
+}
+
+int container_log_read(struct container_log *log, uint64_t *cursor, char *buf, size_t size, int timeout_ms)
+{
+	(void)log;
+	(void)cursor;
+	(void)buf;
+	(void)size;
+	(void)timeout_ms;
+
+	return -1;
+}
+
+void container_log_shutdown(void)
+{
+}
+
+#endif /* CONFIG_OCRE_CONTAINER_LOGS */
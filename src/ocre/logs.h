@@ -0,0 +1,24 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The captured output of a container. Its stdout and stderr are the write end of a pipe, drained by a host thread into
+ * a ring buffer, and optionally appended to a rotating file in the container working directory.
+ */
+
+struct container_log;
+
+struct container_log *container_log_create(const char *workdir, size_t size, size_t file_size);
+void container_log_destroy(struct container_log *log);
+
+int container_log_get_fd(const struct container_log *log);
+
+int container_log_read(struct container_log *log, uint64_t *cursor, char *buf, size_t size, int timeout_ms);
+
+void container_log_shutdown(void);
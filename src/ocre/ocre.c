@@ -21,6 +21,8 @@
 #include <ocre/runtime/wamr/wasip1.h>
 
 #include "context.h"
+#include "logs.h"
+#include "util/image_ref.h"
 #include "util/rm_rf.h"
 
 LOG_MODULE_REGISTER(ocre, CONFIG_OCRE_LOG_LEVEL);
@@ -70,6 +72,7 @@ static int populate_context_workdir(const char *working_directory)
 	int rc = -1;
 	char *containers_path = NULL;
 	char *images_path = NULL;
+	char *blobs_path = NULL;
 
 	rc = create_dir_if_not_exists(working_directory);
 	if (rc) {
@@ -105,9 +108,32 @@ static int populate_context_workdir(const char *working_directory)
 		goto finish;
 	}
 
+	/* Content-addressed store of the images pulled */
+
+	blobs_path = malloc(strlen(working_directory) + strlen("/blobs/sha256") + 1);
+	if (!blobs_path) {
+		LOG_ERR("Failed to allocate memory for blobs path");
+		rc = -1;
+		goto finish;
+	}
+
+	sprintf(blobs_path, "%s/blobs", working_directory);
+
+	rc = create_dir_if_not_exists(blobs_path);
+	if (!rc) {
+		strcat(blobs_path, "/sha256");
+		rc = create_dir_if_not_exists(blobs_path);
+	}
+
+	if (rc) {
+		LOG_ERR("Failed to create Ocre blobs directory '%s': errno=%d", blobs_path, errno);
+		goto finish;
+	}
+
 finish:
 	free(containers_path);
 	free(images_path);
+	free(blobs_path);
 
 	return rc;
 }
@@ -170,6 +196,82 @@ finish:
 }
 #endif
 
+/* Counts the images of a directory, or only their size if images is NULL. A reference to a blob is an image, but
+ * its size is counted with the blob, so images stored under several names are counted once
+ */
+
+static void collect_image_dir(const char *working_directory, const char *subdir, int64_t *images, int64_t *bytes)
+{
+	char digest[OCRE_IMAGE_DIGEST_SIZE];
+
+	char *dir_path = malloc(strlen(working_directory) + strlen(subdir) + 1);
+	if (!dir_path) {
+		return;
+	}
+
+	sprintf(dir_path, "%s%s", working_directory, subdir);
+
+	DIR *d = opendir(dir_path);
+	if (!d) {
+		free(dir_path);
+		return;
+	}
+
+	const struct dirent *dir;
+
+	while ((dir = readdir(d)) != NULL) {
+		struct stat st;
+
+		char *path = malloc(strlen(dir_path) + strlen(dir->d_name) + 2);
+		if (!path) {
+			break;
+		}
+
+		sprintf(path, "%s/%s", dir_path, dir->d_name);
+
+		if (!stat(path, &st) && S_ISREG(st.st_mode)) {
+			if (images) {
+				(*images)++;
+			}
+
+			if (!images || ocre_image_ref_read(path, digest)) {
+				*bytes += st.st_size;
+			}
+		}
+
+		free(path);
+	}
+
+	closedir(d);
+	free(dir_path);
+}
+
+/* Refreshes the image store gauges before every metrics dump */
+
+static void collect_image_stores(void *arg)
+{
+	struct context_node *elt;
+	int64_t images = 0;
+	int64_t bytes = 0;
+
+	(void)arg;
+
+	if (pthread_mutex_lock(&contexts_mutex)) {
+		return;
+	}
+
+	LL_FOREACH(contexts, elt)
+	{
+		collect_image_dir(elt->working_directory, "/images", &images, &bytes);
+		collect_image_dir(elt->working_directory, "/blobs/sha256", NULL, &bytes);
+	}
+
+	pthread_mutex_unlock(&contexts_mutex);
+
+	ocre_metric_set(OCRE_METRIC_IMAGES, images);
+	ocre_metric_set(OCRE_METRIC_IMAGE_STORE_BYTES, bytes);
+}
+
 static int ocre_destroy_context_locked(struct ocre_context *context)
 {
 	int rc;
@@ -381,6 +483,10 @@ int ocre_initialize(const struct ocre_runtime_vtable *const vtable[])
 		LOG_INF("Initialized '%s'", elt->runtime->runtime_name);
 	}
 
+	if (ocre_metrics_register_collector(collect_image_stores, NULL)) {
+		LOG_WRN("Failed to register the image store metrics collector");
+	}
+
 	return 0;
 
 error:
@@ -417,6 +523,8 @@ void ocre_deinitialize(void)
 	struct context_node *c_node, *c_tmp;
 	struct runtime_node *r_elt, *r_tmp;
 
+	ocre_metrics_unregister_collector(collect_image_stores, NULL);
+
 	/* Destroy all contexts */
 
 	LL_FOREACH_SAFE(contexts, c_node, c_tmp)
@@ -438,4 +546,6 @@ void ocre_deinitialize(void)
 
 		free(r_elt);
 	}
+
+	container_log_shutdown();
 }
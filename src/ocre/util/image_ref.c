@@ -0,0 +1,97 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "image_ref.h"
+
+#define IMAGE_REF_SIZE (sizeof(OCRE_IMAGE_REF_PREFIX) - 1 + OCRE_IMAGE_DIGEST_SIZE - 1 + 1)
+
+int ocre_image_ref_read(const char *path, char *digest)
+{
+	char buf[IMAGE_REF_SIZE + 1];
+	ssize_t len = 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+
+	/* Read one byte more, to tell a reference from a longer file starting like one */
+
+	while (len < (ssize_t)sizeof(buf)) {
+		ssize_t n = read(fd, buf + len, sizeof(buf) - len);
+		if (n < 0) {
+			close(fd);
+			return -1;
+		}
+
+		if (!n) {
+			break;
+		}
+
+		len += n;
+	}
+
+	close(fd);
+
+	if (len != IMAGE_REF_SIZE || memcmp(buf, OCRE_IMAGE_REF_PREFIX, strlen(OCRE_IMAGE_REF_PREFIX)) ||
+	    buf[IMAGE_REF_SIZE - 1] != '\n') {
+		return 1;
+	}
+
+	const char *hex = buf + strlen(OCRE_IMAGE_REF_PREFIX);
+
+	for (size_t i = 0; i < OCRE_IMAGE_DIGEST_SIZE - 1; i++) {
+		if (!isxdigit((unsigned char)hex[i]) || isupper((unsigned char)hex[i])) {
+			return 1;
+		}
+	}
+
+	memcpy(digest, hex, OCRE_IMAGE_DIGEST_SIZE - 1);
+	digest[OCRE_IMAGE_DIGEST_SIZE - 1] = '\0';
+
+	return 0;
+}
+
+char *image_ref_resolve(const char *working_directory, const char *image)
+{
+	char digest[OCRE_IMAGE_DIGEST_SIZE];
+
+	size_t size = strlen(working_directory) + strlen("/images/") + strlen(image) + 1;
+
+	char *path = malloc(size);
+	if (!path) {
+		return NULL;
+	}
+
+	snprintf(path, size, "%s/images/%s", working_directory, image);
+
+	/* Missing images are left to fail when loaded */
+
+	if (ocre_image_ref_read(path, digest)) {
+		return path;
+	}
+
+	free(path);
+
+	size = strlen(working_directory) + strlen("/blobs/sha256/") + OCRE_IMAGE_DIGEST_SIZE;
+
+	path = malloc(size);
+	if (!path) {
+		return NULL;
+	}
+
+	snprintf(path, size, "%s/blobs/sha256/%s", working_directory, digest);
+
+	return path;
+}
@@ -0,0 +1,23 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef IMAGE_REF_H
+#define IMAGE_REF_H
+
+#include <ocre/context.h>
+
+/* Images are either plain files in images/, or references to a blob of the content-addressed store, read with
+ * ocre_image_ref_read(). A reference is a small file holding "sha256:<digest>\n", and the content is in
+ * blobs/sha256/<digest>.
+ */
+
+/* returns the path of the file holding the content of an image, to be freed by the caller
+ * returns NULL on error
+ */
+char *image_ref_resolve(const char *working_directory, const char *image);
+
+#endif /* IMAGE_REF_H */
@@ -0,0 +1,276 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include <ocre/ocre.h>
+#include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
+
+#include "watch.h"
+
+LOG_MODULE_REGISTER(watch, CONFIG_OCRE_LOG_LEVEL);
+
+struct ocre_watch {
+	struct ocre_watch *next;
+	ocre_watch_callback_t callback;
+	void *arg;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int fd;
+	size_t capacity;
+	size_t head;
+	size_t count;
+	struct ocre_container_event events[];
+};
+
+int watch_list_init(struct watch_list *list)
+{
+	list->watches = NULL;
+	list->sequence = 0;
+
+	int rc = pthread_mutex_init(&list->mutex, NULL);
+	if (rc) {
+		LOG_ERR("Failed to initialize watch list mutex: rc=%d", rc);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void watch_free(struct ocre_watch *watch)
+{
+	if (watch->fd >= 0) {
+		close(watch->fd);
+	}
+
+	pthread_cond_destroy(&watch->cond);
+	pthread_mutex_destroy(&watch->mutex);
+	free(watch);
+}
+
+void watch_list_destroy(struct watch_list *list)
+{
+	while (list->watches) {
+		struct ocre_watch *watch = list->watches;
+
+		list->watches = watch->next;
+		watch_free(watch);
+	}
+
+	pthread_mutex_destroy(&list->mutex);
+}
+
+struct ocre_watch *watch_list_add(struct watch_list *list, size_t capacity, ocre_watch_callback_t callback, void *arg)
+{
+	if (!capacity && !callback) {
+		LOG_ERR("A watch needs a ring or a callback");
+		return NULL;
+	}
+
+	size_t size = sizeof(struct ocre_watch) + capacity * sizeof(struct ocre_container_event);
+
+	struct ocre_watch *watch = calloc(1, size);
+	if (!watch) {
+		LOG_ERR("Failed to allocate memory for a watch of %zu events", capacity);
+		return NULL;
+	}
+
+	watch->callback = callback;
+	watch->arg = arg;
+	watch->capacity = capacity;
+	watch->fd = -1;
+
+	pthread_mutex_init(&watch->mutex, NULL);
+	pthread_cond_init(&watch->cond, NULL);
+
+#ifdef __linux__
+	if (capacity) {
+		watch->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (watch->fd < 0) {
+			LOG_ERR("Failed to create the file descriptor of a watch: errno=%d", errno);
+			watch_free(watch);
+			return NULL;
+		}
+	}
+#endif
+
+	pthread_mutex_lock(&list->mutex);
+
+	watch->next = list->watches;
+	list->watches = watch;
+
+	pthread_mutex_unlock(&list->mutex);
+
+	return watch;
+}
+
+void watch_list_remove(struct watch_list *list, struct ocre_watch *watch)
+{
+	pthread_mutex_lock(&list->mutex);
+
+	for (struct ocre_watch **prev = &list->watches; *prev; prev = &(*prev)->next) {
+		if (*prev == watch) {
+			*prev = watch->next;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&list->mutex);
+
+	watch_free(watch);
+}
+
+static void watch_push(struct ocre_watch *watch, const struct ocre_container_event *event)
+{
+	if (!watch->capacity) {
+		return;
+	}
+
+	pthread_mutex_lock(&watch->mutex);
+
+	/* Drop the oldest event when full, readers see the gap in the sequence */
+
+	if (watch->count == watch->capacity) {
+		watch->head = (watch->head + 1) % watch->capacity;
+		watch->count--;
+	}
+
+	watch->events[(watch->head + watch->count) % watch->capacity] = *event;
+	watch->count++;
+
+	if (watch->count == 1 && watch->fd >= 0) {
+		uint64_t one = 1;
+
+		if (write(watch->fd, &one, sizeof(one)) < 0) {
+			LOG_WRN("Failed to signal the file descriptor of a watch: errno=%d", errno);
+		}
+	}
+
+	pthread_cond_signal(&watch->cond);
+
+	pthread_mutex_unlock(&watch->mutex);
+}
+
+void watch_list_emit(struct watch_list *list, const char *id, ocre_container_status_t old_status,
+		     ocre_container_status_t new_status, int exit_code)
+{
+	struct ocre_container_event event;
+
+	memset(&event, 0, sizeof(event));
+
+	event.timestamp_ns = ocre_metrics_now_ns();
+	event.old_status = old_status;
+	event.new_status = new_status;
+	event.exit_code = exit_code;
+	snprintf(event.id, sizeof(event.id), "%s", id ? id : "");
+
+	pthread_mutex_lock(&list->mutex);
+
+	if (!list->watches) {
+		pthread_mutex_unlock(&list->mutex);
+		return;
+	}
+
+	/* Numbered under the lock, so all the watches get the events in the same order */
+
+	event.sequence = ++list->sequence;
+
+	for (struct ocre_watch *watch = list->watches; watch; watch = watch->next) {
+		watch_push(watch, &event);
+
+		if (watch->callback) {
+			watch->callback(&event, watch->arg);
+		}
+	}
+
+	pthread_mutex_unlock(&list->mutex);
+}
+
+int ocre_watch_read(struct ocre_watch *watch, struct ocre_container_event *events, size_t max, int timeout_ms)
+{
+	struct timespec deadline;
+	int ret = 0;
+
+	if (!watch || (!events && max)) {
+		LOG_ERR("Invalid arguments");
+		return -EINVAL;
+	}
+
+	if (timeout_ms > 0) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&watch->mutex);
+
+	while (!watch->count && timeout_ms && watch->capacity) {
+		int rc;
+		if (timeout_ms > 0) {
+			rc = pthread_cond_timedwait(&watch->cond, &watch->mutex, &deadline);
+		} else {
+			rc = pthread_cond_wait(&watch->cond, &watch->mutex);
+		}
+
+		if (rc == ETIMEDOUT) {
+			break;
+		}
+
+		if (rc) {
+			LOG_ERR("Failed to wait on watch conditional variable: rc=%d", rc);
+			ret = -rc;
+			goto unlock;
+		}
+	}
+
+	while (watch->count && (size_t)ret < max) {
+		events[ret++] = watch->events[watch->head];
+		watch->head = (watch->head + 1) % watch->capacity;
+		watch->count--;
+	}
+
+	/* Not readable anymore once empty */
+
+	if (!watch->count && watch->fd >= 0) {
+		uint64_t value;
+
+		if (read(watch->fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+			LOG_WRN("Failed to clear the file descriptor of a watch: errno=%d", errno);
+		}
+	}
+
+unlock:
+	pthread_mutex_unlock(&watch->mutex);
+
+	return ret;
+}
+
+int ocre_watch_get_fd(struct ocre_watch *watch)
+{
+	if (!watch) {
+		return -EINVAL;
+	}
+
+	return watch->fd >= 0 ? watch->fd : -ENOTSUP;
+}
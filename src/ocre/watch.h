@@ -0,0 +1,28 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <ocre/ocre.h>
+
+/* The watches of a context. Its lock is taken after the container locks, from the status changes */
+
+struct watch_list {
+	pthread_mutex_t mutex;
+	struct ocre_watch *watches;
+	uint64_t sequence;
+};
+
+int watch_list_init(struct watch_list *list);
+void watch_list_destroy(struct watch_list *list);
+
+struct ocre_watch *watch_list_add(struct watch_list *list, size_t capacity, ocre_watch_callback_t callback, void *arg);
+void watch_list_remove(struct watch_list *list, struct ocre_watch *watch);
+
+void watch_list_emit(struct watch_list *list, const char *id, ocre_container_status_t old_status,
+		     ocre_container_status_t new_status, int exit_code);
@@ -10,3 +10,32 @@
 void *user_malloc(size_t size);
 void user_free(void *p);
 void *user_realloc(void *p, size_t size);
+
+/* Memory arenas
+ *
+ * While a thread has entered an arena, user_malloc() and user_realloc() of new blocks allocate from it. Blocks are
+ * freed into the arena they came from, whichever thread frees them. An arena takes memory from the host in chunks, and
+ * gives it all back at once when destroyed, along with the blocks that were not freed.
+ *
+ * Arenas are not available on every platform: user_arena_create() then returns NULL.
+ */
+
+struct user_arena;
+
+struct user_arena_stats {
+	size_t used;	 /* Bytes of the blocks allocated and not freed, rounded up to their size class */
+	size_t reserved; /* Bytes taken from the host, which the limit applies to */
+	size_t peak;	 /* Highest reserved bytes */
+	size_t limit;	 /* Limit of the reserved bytes, zero if unlimited */
+	size_t failed;	 /* Allocations that failed because of the limit */
+};
+
+struct user_arena *user_arena_create(size_t limit);
+void user_arena_destroy(struct user_arena *arena);
+
+/* Returns the arena the thread was in before, to give back to user_arena_enter() when done. NULL leaves arenas */
+
+struct user_arena *user_arena_enter(struct user_arena *arena);
+
+int user_arena_set_limit(struct user_arena *arena, size_t limit);
+void user_arena_get_stats(struct user_arena *arena, struct user_arena_stats *stats);
@@ -0,0 +1,16 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+
+/* Restricts threads created with attr to the CPUs in cpuset, a list like "0-3,6". Returns 0, -EINVAL if cpuset is
+ * malformed or names a CPU that does not exist, or -ENOTSUP if the platform cannot pin threads.
+ */
+int ocre_thread_attr_set_affinity(pthread_attr_t *attr, const char *cpuset);
+
+/* Sets the nice value of the calling thread, from -20 (highest priority) to 19. Returns 0 or a negative errno */
+int ocre_thread_set_nice(int nice);
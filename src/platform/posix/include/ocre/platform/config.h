@@ -16,6 +16,9 @@
 #define CONFIG_OCRE_MAX_TIMERS			5
 #define CONFIG_OCRE_LOG_LEVEL_DEFAULT		3
 #define CONFIG_OCRE_LOG_LEVEL			4
+#define CONFIG_OCRE_LOG_ASYNC			1
+#define CONFIG_OCRE_LOG_ASYNC_RING_SIZE		256
+#define CONFIG_OCRE_LOG_ASYNC_FLUSH_MS		10
 #define CONFIG_OCRE_NETWORKING			1
 #define CONFIG_OCRE_FILESYSTEM			1
 #define CONFIG_OCRE_CONTAINER_MESSAGING		1
@@ -24,5 +27,19 @@
 #define CONFIG_OCRE_SHARED_HEAP_BUF_VIRTUAL	1
 #define CONFIG_OCRE_SHARED_HEAP_BUF_SIZE	131072
 #define CONFIG_OCRE_WAMR_LOG_LEVEL		2
+#define CONFIG_OCRE_CONTAINER_SUSPEND		1
+#define CONFIG_OCRE_CPU_PERIOD_US_DEFAULT	100000
+#define CONFIG_OCRE_CONTAINER_PAUSE_TIMEOUT_MS	100
+#define CONFIG_OCRE_CONTAINER_STOP_TIMEOUT_MS	10000
+#define CONFIG_OCRE_RESTART_BACKOFF_MS		100
+#define CONFIG_OCRE_RESTART_BACKOFF_MAX_MS	30000
+#define CONFIG_OCRE_CONTAINER_LOGS		1
+#define CONFIG_OCRE_CONTAINER_LOG_SIZE		65536
+#define CONFIG_OCRE_MEMORY_BUDGET		0
+#define CONFIG_OCRE_EXECUTOR_WORKERS		0
+#define CONFIG_OCRE_METRICS_SHARDS		16
+#define CONFIG_OCRE_METRICS_MAX_COLLECTORS	4
+#define CONFIG_OCRE_TRACE_BUFFER_EVENTS		4096
+#define CONFIG_OCRE_TRACE_MAX_THREADS		64
 
 #endif /* OCRE_PLATFORM_POSIX_H */
@@ -14,11 +14,22 @@
 
 extern int __ocre_log_level;
 
+/* With CONFIG_OCRE_LOG_ASYNC, messages are queued with their raw arguments and formatted and written to stderr by a
+ * background thread. When the queue of the calling thread is full, messages are dropped and counted.
+ */
+void __ocre_log(int level, const char *module, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/* Waits until all queued messages are written */
+void ocre_log_flush(void);
+
+/* Number of messages dropped so far because a queue was full */
+unsigned long ocre_log_get_dropped(void);
+
 #if CONFIG_OCRE_LOG_LEVEL >= 1
 #define LOG_ERR(fmt, ...)                                                                                              \
 	do {                                                                                                           \
 		if (__ocre_log_level >= 1)                                                                             \
-			fprintf(stderr, "<err> %s: " fmt "\n", __ocre_log_module, ##__VA_ARGS__);                      \
+			__ocre_log(1, __ocre_log_module, fmt, ##__VA_ARGS__);                                          \
 	} while (0)
 #else
 #define LOG_ERR(fmt, ...)                                                                                              \
@@ -30,7 +41,7 @@ extern int __ocre_log_level;
 #define LOG_WRN(fmt, ...)                                                                                              \
 	do {                                                                                                           \
 		if (__ocre_log_level >= 2)                                                                             \
-			fprintf(stderr, "<wrn> %s: " fmt "\n", __ocre_log_module, ##__VA_ARGS__);                      \
+			__ocre_log(2, __ocre_log_module, fmt, ##__VA_ARGS__);                                          \
 	} while (0)
 #else
 #define LOG_WRN(fmt, ...)                                                                                              \
@@ -42,7 +53,7 @@ extern int __ocre_log_level;
 #define LOG_INF(fmt, ...)                                                                                              \
 	do {                                                                                                           \
 		if (__ocre_log_level >= 3)                                                                             \
-			fprintf(stderr, "<inf> %s: " fmt "\n", __ocre_log_module, ##__VA_ARGS__);                      \
+			__ocre_log(3, __ocre_log_module, fmt, ##__VA_ARGS__);                                          \
 	} while (0)
 #else
 #define LOG_INF(fmt, ...)                                                                                              \
@@ -54,7 +65,7 @@ extern int __ocre_log_level;
 #define LOG_DBG(fmt, ...)                                                                                              \
 	do {                                                                                                           \
 		if (__ocre_log_level >= 4)                                                                             \
-			fprintf(stderr, "<dbg> %s: " fmt "\n", __ocre_log_module, ##__VA_ARGS__);                      \
+			__ocre_log(4, __ocre_log_module, fmt, ##__VA_ARGS__);                                          \
 	} while (0)
 #else
 #define LOG_DBG(fmt, ...)                                                                                              \
@@ -5,6 +5,786 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
 #include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
 
 int __ocre_log_level = CONFIG_OCRE_LOG_LEVEL_DEFAULT;
+
+static const char *const level_names[] = {"???", "err", "wrn", "inf", "dbg"};
+
+static const char *level_name(int level)
+{
+	return level > 0 && level <= 4 ? level_names[level] : level_names[0];
+}
+
+#if CONFIG_OCRE_LOG_ASYNC
+
+/* Messages are not formatted by the caller. The format string is scanned for the type of each argument, and the
+ * record keeps the format pointer and the raw arguments, plus a copy of the strings, since they may be gone by the
+ * time the record is printed. Records go into a ring owned by the calling thread, with a single producer and a single
+ * consumer: the log thread, which does the formatting and the writing.
+ *
+ * Messages with formats we cannot capture (too many arguments, long double, positional arguments...) or with strings
+ * too long for the text area are formatted by the caller instead, into the whole record body. Whatever does not fit
+ * there is cut, and the message ends with "..." to show it.
+ */
+
+#define LOG_MAX_ARGS	12
+#define LOG_RECORD_SIZE 256
+#define LOG_LINE_SIZE	1024
+
+enum arg_type {
+	ARG_NONE,
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_SIZE,
+	ARG_INTMAX,
+	ARG_PTRDIFF,
+	ARG_DOUBLE,
+	ARG_PTR,
+	ARG_STR,
+	ARG_UNSUPPORTED,
+};
+
+/* A conversion specification, from the '%' to the conversion character */
+
+struct spec {
+	size_t len;
+	enum arg_type type;
+	int stars;	/* Number of '*' for width and precision, each taking an int argument */
+	int precision;	/* -1 if none, -2 if given as an argument */
+};
+
+union arg {
+	uintmax_t u;
+	double d;
+	const void *p;
+	struct {
+		uint16_t offset;
+		uint16_t len;
+	} s;
+};
+
+struct record_header {
+	uint64_t timestamp_ns;
+	const char *module;
+	const char *fmt;
+	uint8_t level;
+	uint8_t nr_args;
+	uint8_t formatted;
+	uint16_t text_len;
+};
+
+#define LOG_TEXT_SIZE (LOG_RECORD_SIZE - sizeof(struct record_header) - LOG_MAX_ARGS * sizeof(union arg))
+
+#define LOG_FORMATTED_SIZE (LOG_RECORD_SIZE - sizeof(struct record_header))
+
+struct record {
+	struct record_header h;
+	union {
+		struct {
+			union arg args[LOG_MAX_ARGS];
+			char text[LOG_TEXT_SIZE];
+		};
+		char formatted_text[LOG_FORMATTED_SIZE];
+	};
+};
+
+struct ring {
+	struct ring *next;
+	_Atomic uint32_t head; /* Written by the producer only */
+	_Atomic uint32_t tail; /* Written by the consumer only */
+	_Atomic unsigned long dropped;
+	_Atomic bool orphaned; /* The thread exited, free it once drained */
+	struct record records[CONFIG_OCRE_LOG_ASYNC_RING_SIZE];
+};
+
+static _Atomic(struct ring *) rings;
+static __thread struct ring *thread_ring;
+static __thread bool thread_exiting;
+static _Atomic unsigned long dropped_total;
+
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t log_key;
+static pthread_t log_thread;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t flush_cond = PTHREAD_COND_INITIALIZER;
+static unsigned long flush_requested;
+static unsigned long flush_done;
+static _Atomic bool log_running;
+static bool log_stop;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Scans the conversion specification at p, just after the '%' */
+
+static void parse_spec(const char *p, struct spec *spec)
+{
+	const char *start = p;
+
+	spec->type = ARG_UNSUPPORTED;
+	spec->stars = 0;
+	spec->precision = -1;
+
+	while (*p && strchr("-+ #0'", *p)) {
+		p++;
+	}
+
+	if (*p == '*') {
+		spec->stars++;
+		p++;
+	} else {
+		while (*p >= '0' && *p <= '9') {
+			p++;
+		}
+
+		/* Positional arguments */
+
+		if (*p == '$') {
+			goto done;
+		}
+	}
+
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->stars++;
+			spec->precision = -2;
+			p++;
+		} else {
+			spec->precision = 0;
+			while (*p >= '0' && *p <= '9') {
+				spec->precision = spec->precision * 10 + (*p - '0');
+				p++;
+			}
+		}
+	}
+
+	enum arg_type integer = ARG_INT;
+
+	switch (*p) {
+		case 'h':
+			p += p[1] == 'h' ? 2 : 1;
+			break;
+		case 'l':
+			integer = p[1] == 'l' ? ARG_LLONG : ARG_LONG;
+			p += p[1] == 'l' ? 2 : 1;
+			break;
+		case 'z':
+			integer = ARG_SIZE;
+			p++;
+			break;
+		case 'j':
+			integer = ARG_INTMAX;
+			p++;
+			break;
+		case 't':
+			integer = ARG_PTRDIFF;
+			p++;
+			break;
+		case 'L':
+			/* long double */
+			goto done;
+		default:
+			break;
+	}
+
+	switch (*p) {
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			spec->type = integer;
+			break;
+		case 'c':
+			spec->type = integer == ARG_INT ? ARG_INT : ARG_UNSUPPORTED;
+			break;
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			spec->type = ARG_DOUBLE;
+			break;
+		case 'p':
+			spec->type = ARG_PTR;
+			break;
+		case 's':
+			spec->type = integer == ARG_INT ? ARG_STR : ARG_UNSUPPORTED;
+			break;
+		case '%':
+			spec->type = spec->stars || spec->precision != -1 ? ARG_UNSUPPORTED : ARG_NONE;
+			break;
+		default:
+			/* %n, wide characters, or garbage */
+			goto done;
+	}
+
+	p++;
+
+done:
+	spec->len = p - start;
+}
+
+/* Captures the arguments in the record. Returns false if the format is not supported */
+
+static bool capture(struct record *record, const char *fmt, va_list ap)
+{
+	size_t text_len = 0;
+	int nr_args = 0;
+
+	for (const char *p = strchr(fmt, '%'); p; p = strchr(p, '%')) {
+		struct spec spec;
+		int precision = -1;
+
+		parse_spec(++p, &spec);
+		p += spec.len;
+
+		if (spec.type == ARG_UNSUPPORTED || nr_args + spec.stars + 1 > LOG_MAX_ARGS) {
+			return false;
+		}
+
+		if (spec.type == ARG_NONE) {
+			continue;
+		}
+
+		for (int i = 0; i < spec.stars; i++) {
+			int value = va_arg(ap, int);
+
+			record->args[nr_args++].u = (uintmax_t)(unsigned int)value;
+
+			/* The precision comes last */
+
+			precision = value;
+		}
+
+		if (spec.precision != -2) {
+			precision = spec.precision;
+		}
+
+		union arg *arg = &record->args[nr_args++];
+
+		switch (spec.type) {
+			case ARG_INT:
+				arg->u = va_arg(ap, unsigned int);
+				break;
+			case ARG_LONG:
+				arg->u = va_arg(ap, unsigned long);
+				break;
+			case ARG_LLONG:
+				arg->u = va_arg(ap, unsigned long long);
+				break;
+			case ARG_SIZE:
+				arg->u = va_arg(ap, size_t);
+				break;
+			case ARG_INTMAX:
+				arg->u = va_arg(ap, uintmax_t);
+				break;
+			case ARG_PTRDIFF:
+				arg->u = (uintmax_t)va_arg(ap, ptrdiff_t);
+				break;
+			case ARG_DOUBLE:
+				arg->d = va_arg(ap, double);
+				break;
+			case ARG_PTR:
+				arg->p = va_arg(ap, void *);
+				break;
+			case ARG_STR: {
+				const char *s = va_arg(ap, const char *);
+				if (!s) {
+					s = "(null)";
+				}
+
+				/* With a precision, the string does not need to be terminated */
+
+				size_t len = precision >= 0 ? strnlen(s, precision) : strlen(s);
+				if (len > LOG_TEXT_SIZE - text_len) {
+					return false;
+				}
+
+				memcpy(&record->text[text_len], s, len);
+				arg->s.offset = (uint16_t)text_len;
+				arg->s.len = (uint16_t)len;
+				text_len += len;
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+
+	record->h.nr_args = (uint8_t)nr_args;
+	record->h.text_len = (uint16_t)text_len;
+
+	return true;
+}
+
+/* Formats a captured record into line. Returns the length */
+
+static size_t replay(const struct record *record, char *line, size_t size)
+{
+	const char *p = record->h.fmt;
+	size_t pos = 0;
+	int arg = 0;
+
+	if (record->h.formatted) {
+		pos = record->h.text_len < size ? record->h.text_len : size - 1;
+		memcpy(line, record->formatted_text, pos);
+		line[pos] = '\0';
+		return pos;
+	}
+
+	while (*p && pos < size - 1) {
+		const char *percent = strchr(p, '%');
+		size_t literal = percent ? (size_t)(percent - p) : strlen(p);
+
+		if (literal > size - 1 - pos) {
+			literal = size - 1 - pos;
+		}
+
+		memcpy(&line[pos], p, literal);
+		pos += literal;
+
+		if (!percent) {
+			break;
+		}
+
+		struct spec spec;
+		char conv[32];
+		char str[LOG_TEXT_SIZE + 1];
+		int stars[2] = {0, 0};
+		int n = 0;
+
+		parse_spec(percent + 1, &spec);
+		p = percent + 1 + spec.len;
+
+		if (spec.type == ARG_NONE) {
+			line[pos++] = '%';
+			continue;
+		}
+
+		if (spec.len + 2 > sizeof(conv)) {
+			break;
+		}
+
+		conv[0] = '%';
+		memcpy(&conv[1], percent + 1, spec.len);
+		conv[spec.len + 1] = '\0';
+
+		for (int i = 0; i < spec.stars; i++) {
+			stars[i] = (int)(unsigned int)record->args[arg++].u;
+		}
+
+		const union arg *value = &record->args[arg++];
+		char *out = &line[pos];
+		size_t left = size - pos;
+
+		/* Two '*' at most, so three forms of the same call */
+
+#define REPLAY(v)                                                                                                      \
+	(spec.stars == 2   ? snprintf(out, left, conv, stars[0], stars[1], v)                                         \
+	 : spec.stars == 1 ? snprintf(out, left, conv, stars[0], v)                                                    \
+			   : snprintf(out, left, conv, v))
+
+		switch (spec.type) {
+			case ARG_INT:
+				n = REPLAY((unsigned int)value->u);
+				break;
+			case ARG_LONG:
+				n = REPLAY((unsigned long)value->u);
+				break;
+			case ARG_LLONG:
+				n = REPLAY((unsigned long long)value->u);
+				break;
+			case ARG_SIZE:
+				n = REPLAY((size_t)value->u);
+				break;
+			case ARG_INTMAX:
+				n = REPLAY((uintmax_t)value->u);
+				break;
+			case ARG_PTRDIFF:
+				n = REPLAY((ptrdiff_t)value->u);
+				break;
+			case ARG_DOUBLE:
+				n = REPLAY(value->d);
+				break;
+			case ARG_PTR:
+				n = REPLAY(value->p);
+				break;
+			case ARG_STR:
+				memcpy(str, &record->text[value->s.offset], value->s.len);
+				str[value->s.len] = '\0';
+				n = REPLAY(str);
+				break;
+			default:
+				break;
+		}
+
+#undef REPLAY
+
+		if (n < 0) {
+			break;
+		}
+
+		pos += (size_t)n < left ? (size_t)n : left - 1;
+	}
+
+	line[pos] = '\0';
+
+	return pos;
+}
+
+/* Writes a message with the timestamp, level and module, the same way for queued and synchronous messages */
+
+static void print_line(uint64_t timestamp_ns, int level, const char *module, const char *msg)
+{
+	char line[LOG_LINE_SIZE];
+
+	int len = snprintf(line, sizeof(line), "[%5" PRIu64 ".%06" PRIu64 "] <%s> %s: %s\n", timestamp_ns / 1000000000U,
+			   (timestamp_ns / 1000U) % 1000000U, level_name(level), module, msg);
+	if (len < 0) {
+		return;
+	}
+
+	if ((size_t)len >= sizeof(line)) {
+		len = sizeof(line) - 1;
+		line[len - 1] = '\n';
+	}
+
+	fwrite(line, 1, len, stderr);
+}
+
+static void print_record(const struct record *record)
+{
+	char msg[LOG_LINE_SIZE];
+
+	replay(record, msg, sizeof(msg));
+	print_line(record->h.timestamp_ns, record->h.level, record->h.module, msg);
+}
+
+/* Prints everything queued so far, in timestamp order. Only called by the log thread, or after it stopped */
+
+static void drain(void)
+{
+	for (;;) {
+		struct ring *oldest = NULL;
+		const struct record *next = NULL;
+
+		for (struct ring *ring = atomic_load(&rings); ring; ring = ring->next) {
+			uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+			uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+			if (tail == head) {
+				continue;
+			}
+
+			const struct record *record = &ring->records[tail % CONFIG_OCRE_LOG_ASYNC_RING_SIZE];
+			if (!next || record->h.timestamp_ns < next->h.timestamp_ns) {
+				next = record;
+				oldest = ring;
+			}
+		}
+
+		if (!next) {
+			break;
+		}
+
+		print_record(next);
+
+		atomic_fetch_add_explicit(&oldest->tail, 1, memory_order_release);
+	}
+
+	unsigned long dropped = 0;
+	for (struct ring *ring = atomic_load(&rings); ring; ring = ring->next) {
+		dropped += atomic_exchange(&ring->dropped, 0);
+	}
+
+	if (dropped) {
+		char msg[64];
+
+		atomic_fetch_add(&dropped_total, dropped);
+		snprintf(msg, sizeof(msg), "%lu messages dropped", dropped);
+		print_line(now_ns(), 2, "log", msg);
+	}
+
+	fflush(stderr);
+}
+
+/* Frees the drained rings of exited threads. New rings are only pushed at the head, so anything after it is ours */
+
+static void reap(void)
+{
+	struct ring *prev = atomic_load(&rings);
+
+	if (!prev) {
+		return;
+	}
+
+	for (struct ring *ring = prev->next; ring; ring = prev->next) {
+		if (atomic_load(&ring->orphaned) && atomic_load(&ring->tail) == atomic_load(&ring->head)) {
+			prev->next = ring->next;
+			free(ring);
+		} else {
+			prev = ring;
+		}
+	}
+}
+
+static void *log_thread_main(void *arg)
+{
+	(void)arg;
+
+	pthread_mutex_lock(&log_mutex);
+
+	while (!log_stop) {
+		struct timespec ts;
+
+		if (flush_done == flush_requested) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += (long)CONFIG_OCRE_LOG_ASYNC_FLUSH_MS * 1000000L;
+			ts.tv_sec += ts.tv_nsec / 1000000000L;
+			ts.tv_nsec %= 1000000000L;
+
+			pthread_cond_timedwait(&log_cond, &log_mutex, &ts);
+		}
+
+		unsigned long flush = flush_requested;
+
+		pthread_mutex_unlock(&log_mutex);
+
+		drain();
+		reap();
+
+		pthread_mutex_lock(&log_mutex);
+
+		flush_done = flush;
+		pthread_cond_broadcast(&flush_cond);
+	}
+
+	pthread_mutex_unlock(&log_mutex);
+
+	return NULL;
+}
+
+/* Runs in the exiting thread. Once the ring is orphaned the log thread may free it at any time, so whatever the thread
+ * still logs from here on, from other destructors for instance, is written synchronously
+ */
+
+static void log_thread_exit(void *arg)
+{
+	struct ring *ring = arg;
+
+	thread_ring = NULL;
+	thread_exiting = true;
+
+	atomic_store(&ring->orphaned, true);
+}
+
+static void log_shutdown(void)
+{
+	pthread_mutex_lock(&log_mutex);
+
+	bool running = log_running;
+	log_stop = true;
+	log_running = false;
+	pthread_cond_signal(&log_cond);
+	pthread_cond_broadcast(&flush_cond);
+
+	pthread_mutex_unlock(&log_mutex);
+
+	if (running) {
+		pthread_join(log_thread, NULL);
+	}
+
+	drain();
+}
+
+static void log_init(void)
+{
+	if (pthread_key_create(&log_key, log_thread_exit)) {
+		return;
+	}
+
+	/* Do not lose what is still in the rings when the process exits normally */
+
+	if (atexit(log_shutdown)) {
+		return;
+	}
+
+	if (!pthread_create(&log_thread, NULL, log_thread_main, NULL)) {
+		log_running = true;
+	}
+}
+
+static struct ring *get_ring(void)
+{
+	if (thread_ring) {
+		return thread_ring;
+	}
+
+	if (thread_exiting) {
+		return NULL;
+	}
+
+	pthread_once(&log_once, log_init);
+
+	if (!log_running) {
+		return NULL;
+	}
+
+	struct ring *ring = calloc(1, sizeof(struct ring));
+	if (!ring) {
+		return NULL;
+	}
+
+	if (pthread_setspecific(log_key, ring)) {
+		free(ring);
+		return NULL;
+	}
+
+	ring->next = atomic_load(&rings);
+	while (!atomic_compare_exchange_weak(&rings, &ring->next, ring)) {
+	}
+
+	thread_ring = ring;
+
+	return ring;
+}
+
+static void log_sync(int level, const char *module, const char *fmt, va_list ap)
+{
+	char msg[LOG_LINE_SIZE];
+
+	vsnprintf(msg, sizeof(msg), fmt, ap);
+	print_line(now_ns(), level, module, msg);
+}
+
+void __ocre_log(int level, const char *module, const char *fmt, ...)
+{
+	va_list ap;
+	struct ring *ring = get_ring();
+
+	va_start(ap, fmt);
+
+	if (!ring) {
+		log_sync(level, module, fmt, ap);
+		va_end(ap);
+		return;
+	}
+
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+	if (head - tail >= CONFIG_OCRE_LOG_ASYNC_RING_SIZE) {
+		atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+		va_end(ap);
+		return;
+	}
+
+	struct record *record = &ring->records[head % CONFIG_OCRE_LOG_ASYNC_RING_SIZE];
+	va_list copy;
+
+	record->h.timestamp_ns = now_ns();
+	record->h.module = module;
+	record->h.fmt = fmt;
+	record->h.level = (uint8_t)level;
+	record->h.formatted = 0;
+
+	va_copy(copy, ap);
+
+	if (!capture(record, fmt, copy)) {
+		int len = vsnprintf(record->formatted_text, LOG_FORMATTED_SIZE, fmt, ap);
+
+		if (len >= (int)LOG_FORMATTED_SIZE) {
+			len = LOG_FORMATTED_SIZE - 1;
+			memcpy(&record->formatted_text[len - 3], "...", 3);
+		}
+
+		record->h.formatted = 1;
+		record->h.nr_args = 0;
+		record->h.text_len = len < 0 ? 0 : len;
+	}
+
+	va_end(copy);
+	va_end(ap);
+
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void ocre_log_flush(void)
+{
+	/* Let the log thread do it, so the rings keep a single consumer */
+
+	pthread_mutex_lock(&log_mutex);
+
+	unsigned long flush = ++flush_requested;
+
+	pthread_cond_signal(&log_cond);
+
+	while (log_running && flush_done - flush > ULONG_MAX / 2) {
+		pthread_cond_wait(&flush_cond, &log_mutex);
+	}
+
+	pthread_mutex_unlock(&log_mutex);
+
+	fflush(stderr);
+}
+
+unsigned long ocre_log_get_dropped(void)
+{
+	return atomic_load(&dropped_total);
+}
+
+#else
+
+void __ocre_log(int level, const char *module, const char *fmt, ...)
+{
+	char msg[1024];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(msg, sizeof(msg), fmt, ap);
+	va_end(ap);
+
+	fprintf(stderr, "<%s> %s: %s\n", level_name(level), module, msg);
+}
+
+void ocre_log_flush(void)
+{
+	fflush(stderr);
+}
+
+unsigned long ocre_log_get_dropped(void)
+{
+	return 0;
+}
+
+#endif
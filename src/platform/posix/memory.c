@@ -6,19 +6,357 @@
  */
 
 #include <ocre/platform/memory.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+/* Size of the chunks arenas take from the host. Blocks larger than the biggest size class are taken on their own */
+
+#define ARENA_CHUNK_SIZE 65536
+
+/* Every block starts with a header telling the arena it came from, NULL if it came straight from the host */
+
+struct block {
+	struct user_arena *arena;
+	size_t size;
+} __attribute__((aligned(16)));
+
+struct large_block {
+	struct large_block *prev;
+	struct large_block *next;
+	struct block block;
+};
+
+struct chunk {
+	struct chunk *next;
+} __attribute__((aligned(16)));
+
+/* Blocks of an arena are rounded up to a size class. Freed blocks are kept in a list for their class, to be reused */
+
+static const size_t size_classes[] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096,
+};
+
+#define ARENA_CLASSES	(sizeof(size_classes) / sizeof(size_classes[0]))
+#define ARENA_MAX_SMALL 4096
+
+struct user_arena {
+	pthread_mutex_t mutex;
+	struct block *free_lists[ARENA_CLASSES];
+	struct chunk *chunks;
+	char *bump;
+	size_t bump_left;
+	struct large_block *large;
+	struct user_arena_stats stats;
+};
+
+static __thread struct user_arena *current_arena;
+
+static int size_class(size_t size)
+{
+	for (size_t i = 0; i < ARENA_CLASSES; i++) {
+		if (size <= size_classes[i]) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+/* Called with the arena lock held */
+
+static int reserve(struct user_arena *arena, size_t size)
+{
+	if (arena->stats.limit && size > arena->stats.limit - arena->stats.reserved) {
+		arena->stats.failed++;
+		return -1;
+	}
+
+	arena->stats.reserved += size;
+
+	if (arena->stats.reserved > arena->stats.peak) {
+		arena->stats.peak = arena->stats.reserved;
+	}
+
+	return 0;
+}
+
+static struct block *alloc_large(struct user_arena *arena, size_t size)
+{
+	size_t total = sizeof(struct large_block) + size;
+
+	if (reserve(arena, total)) {
+		return NULL;
+	}
+
+	struct large_block *large = malloc(total);
+	if (!large) {
+		arena->stats.reserved -= total;
+		return NULL;
+	}
+
+	large->prev = NULL;
+	large->next = arena->large;
+
+	if (arena->large) {
+		arena->large->prev = large;
+	}
+
+	arena->large = large;
+
+	return &large->block;
+}
+
+static struct block *alloc_small(struct user_arena *arena, int class)
+{
+	size_t slot = sizeof(struct block) + size_classes[class];
+	struct block *block = arena->free_lists[class];
+
+	if (block) {
+		arena->free_lists[class] = *(struct block **)(block + 1);
+		return block;
+	}
+
+	if (arena->bump_left < slot) {
+		if (reserve(arena, ARENA_CHUNK_SIZE)) {
+			return NULL;
+		}
+
+		struct chunk *chunk = malloc(ARENA_CHUNK_SIZE);
+		if (!chunk) {
+			arena->stats.reserved -= ARENA_CHUNK_SIZE;
+			return NULL;
+		}
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->bump = (char *)(chunk + 1);
+		arena->bump_left = ARENA_CHUNK_SIZE - sizeof(*chunk);
+	}
+
+	block = (struct block *)arena->bump;
+	arena->bump += slot;
+	arena->bump_left -= slot;
+
+	return block;
+}
+
+static void *arena_alloc(struct user_arena *arena, size_t size)
+{
+	struct block *block;
+	int class = size_class(size);
+
+	pthread_mutex_lock(&arena->mutex);
+
+	if (class < 0) {
+		block = alloc_large(arena, size);
+	} else {
+		block = alloc_small(arena, class);
+		size = size_classes[class];
+	}
+
+	if (block) {
+		block->arena = arena;
+		block->size = size;
+		arena->stats.used += size;
+	}
+
+	pthread_mutex_unlock(&arena->mutex);
+
+	return block ? block + 1 : NULL;
+}
+
+static void arena_free(struct block *block)
+{
+	struct user_arena *arena = block->arena;
+
+	pthread_mutex_lock(&arena->mutex);
+
+	arena->stats.used -= block->size;
+
+	if (block->size > ARENA_MAX_SMALL) {
+		struct large_block *large = (struct large_block *)((char *)block - offsetof(struct large_block, block));
+
+		if (large->prev) {
+			large->prev->next = large->next;
+		} else {
+			arena->large = large->next;
+		}
+
+		if (large->next) {
+			large->next->prev = large->prev;
+		}
+
+		arena->stats.reserved -= sizeof(struct large_block) + block->size;
+
+		free(large);
+	} else {
+		int class = size_class(block->size);
+
+		*(struct block **)(block + 1) = arena->free_lists[class];
+		arena->free_lists[class] = block;
+	}
+
+	pthread_mutex_unlock(&arena->mutex);
+}
 
 void *user_malloc(size_t size)
 {
-	return malloc(size);
+	if (size > SIZE_MAX - sizeof(struct large_block)) {
+		return NULL;
+	}
+
+	if (current_arena) {
+		return arena_alloc(current_arena, size);
+	}
+
+	struct block *block = malloc(sizeof(*block) + size);
+	if (!block) {
+		return NULL;
+	}
+
+	block->arena = NULL;
+	block->size = size;
+
+	return block + 1;
 }
 
 void user_free(void *p)
 {
-	free(p);
+	if (!p) {
+		return;
+	}
+
+	struct block *block = (struct block *)p - 1;
+
+	if (block->arena) {
+		arena_free(block);
+	} else {
+		free(block);
+	}
 }
 
 void *user_realloc(void *p, size_t size)
 {
-	return realloc(p, size);
+	if (!p) {
+		return user_malloc(size);
+	}
+
+	if (size > SIZE_MAX - sizeof(struct large_block)) {
+		return NULL;
+	}
+
+	struct block *block = (struct block *)p - 1;
+
+	/* Blocks stay where they were allocated, whichever arena the thread is in now */
+
+	if (!block->arena) {
+		block = realloc(block, sizeof(*block) + size);
+		if (!block) {
+			return NULL;
+		}
+
+		block->size = size;
+
+		return block + 1;
+	}
+
+	if (size <= block->size) {
+		return p;
+	}
+
+	struct user_arena *previous = user_arena_enter(block->arena);
+	void *new_p = user_malloc(size);
+	user_arena_enter(previous);
+
+	if (!new_p) {
+		return NULL;
+	}
+
+	memcpy(new_p, p, block->size);
+	arena_free(block);
+
+	return new_p;
+}
+
+struct user_arena *user_arena_create(size_t limit)
+{
+	struct user_arena *arena = calloc(1, sizeof(*arena));
+	if (!arena) {
+		return NULL;
+	}
+
+	if (pthread_mutex_init(&arena->mutex, NULL)) {
+		free(arena);
+		return NULL;
+	}
+
+	arena->stats.limit = limit;
+
+	return arena;
+}
+
+/* Gives back the chunks whole, without walking the blocks in them */
+
+void user_arena_destroy(struct user_arena *arena)
+{
+	if (!arena) {
+		return;
+	}
+
+	while (arena->chunks) {
+		struct chunk *chunk = arena->chunks;
+
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+
+	while (arena->large) {
+		struct large_block *large = arena->large;
+
+		arena->large = large->next;
+		free(large);
+	}
+
+	pthread_mutex_destroy(&arena->mutex);
+	free(arena);
+}
+
+struct user_arena *user_arena_enter(struct user_arena *arena)
+{
+	struct user_arena *previous = current_arena;
+
+	current_arena = arena;
+
+	return previous;
+}
+
+int user_arena_set_limit(struct user_arena *arena, size_t limit)
+{
+	int ret = -1;
+
+	if (!arena) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&arena->mutex);
+
+	if (!limit || arena->stats.reserved <= limit) {
+		arena->stats.limit = limit;
+		ret = 0;
+	}
+
+	pthread_mutex_unlock(&arena->mutex);
+
+	return ret;
+}
+
+void user_arena_get_stats(struct user_arena *arena, struct user_arena_stats *stats)
+{
+	pthread_mutex_lock(&arena->mutex);
+
+	*stats = arena->stats;
+
+	pthread_mutex_unlock(&arena->mutex);
 }
@@ -0,0 +1,104 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#ifdef __linux__
+
+int ocre_thread_attr_set_affinity(pthread_attr_t *attr, const char *cpuset)
+{
+	cpu_set_t set;
+	long nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	const char *p = cpuset;
+
+	if (!cpuset || !*cpuset) {
+		return -EINVAL;
+	}
+
+	CPU_ZERO(&set);
+
+	while (*p) {
+		char *end;
+		unsigned long first = strtoul(p, &end, 10);
+		unsigned long last = first;
+
+		if (end == p) {
+			return -EINVAL;
+		}
+
+		if (*end == '-') {
+			p = end + 1;
+			last = strtoul(p, &end, 10);
+			if (end == p || last < first) {
+				return -EINVAL;
+			}
+		}
+
+		if (last >= CPU_SETSIZE || (nr_cpus > 0 && last >= (unsigned long)nr_cpus)) {
+			return -EINVAL;
+		}
+
+		for (unsigned long cpu = first; cpu <= last; cpu++) {
+			CPU_SET(cpu, &set);
+		}
+
+		if (*end == ',') {
+			end++;
+			if (!*end) {
+				return -EINVAL;
+			}
+		} else if (*end) {
+			return -EINVAL;
+		}
+
+		p = end;
+	}
+
+	return -pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+}
+
+int ocre_thread_set_nice(int nice)
+{
+	/* On Linux, the nice value is per thread when given a thread ID */
+
+	if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice)) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+#else
+
+int ocre_thread_attr_set_affinity(pthread_attr_t *attr, const char *cpuset)
+{
+	(void)attr;
+	(void)cpuset;
+
+	return -ENOTSUP;
+}
+
+int ocre_thread_set_nice(int nice)
+{
+	(void)nice;
+
+	/* Elsewhere, it would apply to the whole process */
+
+	return -ENOTSUP;
+}
+
+#endif
@@ -6,10 +6,13 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <zephyr/kernel.h>
 #include <zephyr/multi_heap/shared_multi_heap.h>
 
+#include <ocre/platform/memory.h>
+
 #ifdef CONFIG_SHARED_MULTI_HEAP
 void *user_malloc(size_t size)
 {
@@ -53,3 +56,29 @@ void *user_realloc(void *ptr, size_t size)
 }
 
 #endif
+
+/* Arenas are not supported, containers allocate from the shared heap */
+
+struct user_arena *user_arena_create(size_t limit)
+{
+	return NULL;
+}
+
+void user_arena_destroy(struct user_arena *arena)
+{
+}
+
+struct user_arena *user_arena_enter(struct user_arena *arena)
+{
+	return NULL;
+}
+
+int user_arena_set_limit(struct user_arena *arena, size_t limit)
+{
+	return -1;
+}
+
+void user_arena_get_stats(struct user_arena *arena, struct user_arena_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
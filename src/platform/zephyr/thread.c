@@ -0,0 +1,28 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <pthread.h>
+
+/* Zephyr can only change the CPU mask of a thread that is not runnable, and has no nice values. Priorities are set
+ * with the SCHED_FIFO and SCHED_RR policies instead.
+ */
+
+int ocre_thread_attr_set_affinity(pthread_attr_t *attr, const char *cpuset)
+{
+	(void)attr;
+	(void)cpuset;
+
+	return -ENOTSUP;
+}
+
+int ocre_thread_set_nice(int nice)
+{
+	(void)nice;
+
+	return -ENOTSUP;
+}
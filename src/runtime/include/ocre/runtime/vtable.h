@@ -10,7 +10,9 @@
 
 #include <stddef.h>
 #include <pthread.h>
-#include <semaphore.h>
+
+struct ocre_native_stats;
+struct ocre_memory_stats;
 
 /**
  * @brief Runtime Engine Virtual Table
@@ -100,13 +102,35 @@ struct ocre_runtime_vtable {
 	 * the container's main function, block and eventually return the exit code.
 	 *
 	 * @param runtime_context Pointer to the runtime context returned by create
-	 * @param sem Pointer to the semaphore to post to when the instance is ready to
-	 * be killed
+	 * @param started Function to call once the instance is ready to be killed. It is not called if the
+	 * instance fails to start
+	 * @param arg Argument to pass to started
 	 *
 	 * @return status code of the execution: 0 on success, non-zero on failure
 	 */
 
-	int (*thread_execute)(void *runtime_context, sem_t *sem);
+	int (*thread_execute)(void *runtime_context, void (*started)(void *arg), void *arg);
+
+	/**
+	 * @brief Run a runtime instance without a dedicated thread
+	 *
+	 * This function is called instead of thread_execute when the container is started as a reactor. The
+	 * runtime should run the container on threads it manages, only while it has work to do, e.g. handling
+	 * an event. It should not block.
+	 *
+	 * Can be NULL if the runtime engine does not support reactor containers.
+	 *
+	 * @param runtime_context Pointer to the runtime context returned by create
+	 * @param started Function to call once the instance is ready to be killed. It is not called if the
+	 * instance fails to start
+	 * @param exited Function to call exactly once when the container exits, with its exit code. The
+	 * runtime context must not be used after calling it
+	 * @param arg Argument to pass to started and exited
+	 *
+	 * @return 0 on success, non-zero on failure, in which case neither started nor exited are called
+	 */
+	int (*spawn)(void *runtime_context, void (*started)(void *arg), void (*exited)(void *arg, int exit_code),
+		     void *arg);
 
 	/**
 	 * @brief Stop a runtime instance
@@ -152,6 +176,148 @@ struct ocre_runtime_vtable {
 	 * @return 0 on success, non-zero on failure
 	 */
 	int (*unpause)(void *runtime_context);
+
+	/**
+	 * @brief Set the CPU quota of a runtime instance
+	 *
+	 * This function is called right after the runtime instance is created, when the container
+	 * requests a CPU quota. The instance should be allowed to use at most quota_us of CPU time in
+	 * each period of period_us. When it exceeds its quota, it should be throttled (not
+	 * terminated) until the end of the period.
+	 *
+	 * Can be NULL if the runtime engine does not support CPU quotas.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param quota_us CPU time allowed per period, in microseconds. Zero means unlimited
+	 * @param period_us Period length in microseconds. Zero means the runtime default
+	 * @return 0 on success, non-zero on failure
+	 */
+	int (*set_cpu_quota)(void *runtime_context, unsigned int quota_us, unsigned int period_us);
+
+	/**
+	 * @brief Get the call statistics of the native functions of a runtime instance
+	 *
+	 * Works like snprintf(): at most max entries are written, and the number of native functions
+	 * is returned. Can be called at any time between create and destroy.
+	 *
+	 * Can be NULL if the runtime engine does not profile its native functions.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param stats Array to fill, can be NULL if max is zero
+	 * @param max Number of entries of the array
+	 * @return The number of native functions on success, negative on failure
+	 */
+	int (*get_native_stats)(void *runtime_context, struct ocre_native_stats *stats, size_t max);
+
+	/**
+	 * @brief Write the execution profile of the guest functions of a runtime instance
+	 *
+	 * Works like snprintf(). While the instance runs, the profile covers the execution so far.
+	 * Once it exited, the profile of the last run is written. Can be called at any time between
+	 * create and destroy.
+	 *
+	 * Can be NULL if the runtime engine does not profile guest functions.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param buf Buffer to write to, can be NULL if size is zero
+	 * @param size Size of the buffer
+	 * @return The length of the profile on success, negative on failure
+	 */
+	int (*get_profile)(void *runtime_context, char *buf, size_t size);
+
+	/**
+	 * @brief Sample the call stack of a running runtime instance
+	 *
+	 * Takes a sample of the guest call stack every period_ms, for duration_ms or until the
+	 * instance exits, then calls callback once for each distinct call stack. Blocks while
+	 * sampling.
+	 *
+	 * Can be NULL if the runtime engine does not support sampling.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param duration_ms How long to sample
+	 * @param period_ms Time between samples
+	 * @param callback Called with each distinct call stack and its number of samples
+	 * @param arg Argument of the callback
+	 * @return The number of samples taken on success, negative on failure
+	 */
+	int (*sample)(void *runtime_context, unsigned int duration_ms, unsigned int period_ms,
+		      void (*callback)(void *arg, const char *stack, unsigned int count), void *arg);
+
+	/**
+	 * @brief Save the state of a paused runtime instance to a file
+	 *
+	 * This function is called when a checkpoint of a container is requested. This is
+	 * guaranteed to be called only when the container is paused. The file either holds the
+	 * whole checkpoint or is left untouched.
+	 *
+	 * Can be NULL if the runtime engine does not support checkpoints.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param path Path of the checkpoint file to write
+	 * @return 0 on success, non-zero on failure
+	 */
+	int (*checkpoint)(void *runtime_context, const char *path);
+
+	/**
+	 * @brief Restore the state of a runtime instance from a file on its next start
+	 *
+	 * This function is called when a container is requested to be restored. This is
+	 * guaranteed to be called only when the container is created or stopped. The next start
+	 * of the instance loads the checkpoint instead of running the entry point of the module.
+	 *
+	 * Can be NULL if the runtime engine does not support checkpoints.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param path Path of the checkpoint file to load
+	 * @return 0 on success, non-zero on failure
+	 */
+	int (*restore)(void *runtime_context, const char *path);
+
+	/**
+	 * @brief Set the memory limit of a runtime instance
+	 *
+	 * This function is called right after the runtime instance is created, when the container
+	 * requests a memory limit. Allocations made by the runtime engine on behalf of the instance
+	 * should fail once they would take more than limit bytes from the host heap, without
+	 * affecting other instances.
+	 *
+	 * Can be NULL if the runtime engine does not support memory limits.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param limit Memory limit, in bytes. Zero means unlimited
+	 * @return 0 on success, non-zero on failure
+	 */
+	int (*set_memory_limit)(void *runtime_context, size_t limit);
+
+	/**
+	 * @brief Get the memory usage of a runtime instance
+	 *
+	 * Can be called at any time between create and destroy.
+	 *
+	 * Can be NULL if the runtime engine does not account memory per instance.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param stats Structure to fill
+	 * @return 0 on success, non-zero on failure
+	 */
+	int (*get_memory_stats)(void *runtime_context, struct ocre_memory_stats *stats);
+
+	/**
+	 * @brief Estimate the memory a runtime instance needs to run
+	 *
+	 * Called right after the runtime instance is created, to reserve its memory against the memory
+	 * budget of the context. Should cover the module, and what instantiating it takes: linear memory,
+	 * stacks and heap.
+	 *
+	 * Can be NULL if the runtime engine cannot tell, then only the declared memory limit and stack
+	 * size of the container are reserved.
+	 *
+	 * @param runtime_context Pointer to the runtime context
+	 * @param footprint Where to store the estimate, in bytes
+	 * @return 0 on success, non-zero on failure
+	 */
+	int (*get_footprint)(void *runtime_context, size_t *footprint);
 };
 
 #endif /* OCRE_RUNTIME_VTABLE_H */
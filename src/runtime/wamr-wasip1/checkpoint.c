@@ -0,0 +1,566 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ocre/platform/config.h>
+#include <ocre/platform/file.h>
+#include <ocre/platform/log.h>
+
+#include "ocre_api/ocre_common.h"
+#include "ocre_api/ocre_messaging/ocre_messaging.h"
+#include "ocre_api/ocre_timers/ocre_timer.h"
+
+#include "checkpoint.h"
+
+LOG_MODULE_REGISTER(wamr_checkpoint, CONFIG_OCRE_LOG_LEVEL);
+
+/* A checkpoint file starts with a header, followed by a stream of state records. The linear memory comes last, at an
+ * offset aligned to CHECKPOINT_PAGE_SIZE so that it can be mapped. Pages of the memory that are all zeroes are not
+ * written, they are left as holes of the file.
+ */
+
+#define CHECKPOINT_MAGIC     "OCRECKPT"
+#define CHECKPOINT_VERSION   1
+#define CHECKPOINT_PAGE_SIZE 4096
+
+struct checkpoint_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t wasm_page_size;
+	uint64_t module_hash;
+	uint64_t state_offset;
+	uint64_t state_size;
+	uint64_t memory_offset;
+	uint64_t memory_size;
+};
+
+enum checkpoint_record_type {
+	CHECKPOINT_RECORD_GLOBAL = 1,
+	CHECKPOINT_RECORD_DISPATCHER,
+	CHECKPOINT_RECORD_TIMER,
+	CHECKPOINT_RECORD_SUBSCRIPTION,
+};
+
+/* Each record is followed by size bytes. Globals, dispatchers and subscriptions end with a NUL terminated name */
+
+struct checkpoint_record {
+	uint32_t type;
+	uint32_t size;
+};
+
+struct checkpoint_global {
+	uint8_t kind;
+	uint8_t reserved[7];
+	uint8_t value[16];
+};
+
+struct checkpoint_dispatcher {
+	uint32_t type;
+};
+
+static const uint8_t zero_page[CHECKPOINT_PAGE_SIZE];
+
+uint64_t wamr_checkpoint_module_hash(const void *buffer, size_t size)
+{
+	const uint8_t *p = buffer;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static size_t global_value_size(wasm_valkind_t kind)
+{
+	switch (kind) {
+		case WASM_I32:
+		case WASM_F32:
+			return 4;
+		case WASM_I64:
+		case WASM_F64:
+			return 8;
+		case WASM_V128:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+/* Save */
+
+struct checkpoint_writer {
+	FILE *f;
+	uint64_t offset;
+	bool failed;
+};
+
+static void write_bytes(struct checkpoint_writer *writer, const void *data, size_t size)
+{
+	if (writer->failed || !size) {
+		return;
+	}
+
+	if (fwrite(data, 1, size, writer->f) != size) {
+		writer->failed = true;
+		return;
+	}
+
+	writer->offset += size;
+}
+
+static void write_record(struct checkpoint_writer *writer, uint32_t type, const void *data, size_t size,
+			 const char *name)
+{
+	size_t name_size = name ? strlen(name) + 1 : 0;
+	struct checkpoint_record record = {type, (uint32_t)(size + name_size)};
+
+	write_bytes(writer, &record, sizeof(record));
+	write_bytes(writer, data, size);
+	write_bytes(writer, name, name_size);
+}
+
+static void save_globals(struct checkpoint_writer *writer, wasm_module_t module, wasm_module_inst_t module_inst)
+{
+	int32_t count = wasm_runtime_get_export_count(module);
+
+	/* Immutable globals are the same in every instance */
+
+	for (int32_t i = 0; i < count; i++) {
+		wasm_export_t export;
+		wasm_global_inst_t global;
+
+		wasm_runtime_get_export_type(module, i, &export);
+
+		if (export.kind != WASM_IMPORT_EXPORT_KIND_GLOBAL ||
+		    !wasm_runtime_get_export_global_inst(module_inst, export.name, &global) || !global.is_mutable) {
+			continue;
+		}
+
+		size_t size = global_value_size(global.kind);
+		if (!size) {
+			LOG_WRN("Global %s of unsupported type %d is not saved", export.name, global.kind);
+			continue;
+		}
+
+		struct checkpoint_global record = {.kind = global.kind};
+		memcpy(record.value, global.global_data, size);
+
+		write_record(writer, CHECKPOINT_RECORD_GLOBAL, &record, sizeof(record), export.name);
+	}
+}
+
+static void save_dispatchers(struct checkpoint_writer *writer, const ocre_module_context_t *mod)
+{
+	for (uint32_t i = 0; i < OCRE_RESOURCE_TYPE_COUNT; i++) {
+		if (!mod->dispatchers[i]) {
+			continue;
+		}
+
+		struct checkpoint_dispatcher record = {i};
+
+		write_record(writer, CHECKPOINT_RECORD_DISPATCHER, &record, sizeof(record), mod->dispatcher_names[i]);
+	}
+}
+
+static int save_timers(struct checkpoint_writer *writer, wasm_module_inst_t module_inst)
+{
+	int count = ocre_timer_save(module_inst, NULL, 0);
+	if (!count) {
+		return 0;
+	}
+
+	struct ocre_timer_state *states = malloc(count * sizeof(struct ocre_timer_state));
+	if (!states) {
+		LOG_ERR("Failed to allocate memory for %d timers", count);
+		return -1;
+	}
+
+	/* The timers are owned by the paused instance, their number does not change */
+
+	count = ocre_timer_save(module_inst, states, count);
+
+	for (int i = 0; i < count; i++) {
+		write_record(writer, CHECKPOINT_RECORD_TIMER, &states[i], sizeof(states[i]), NULL);
+	}
+
+	free(states);
+
+	return 0;
+}
+
+static void save_topic(void *arg, const char *topic)
+{
+	write_record(arg, CHECKPOINT_RECORD_SUBSCRIPTION, NULL, 0, topic);
+}
+
+static void save_memory(struct checkpoint_writer *writer, const uint8_t *base, uint64_t size)
+{
+	bool hole = false;
+
+	for (uint64_t offset = 0; offset < size && !writer->failed; offset += CHECKPOINT_PAGE_SIZE) {
+		size_t len = size - offset < CHECKPOINT_PAGE_SIZE ? (size_t)(size - offset) : CHECKPOINT_PAGE_SIZE;
+
+		hole = !memcmp(base + offset, zero_page, len);
+		if (hole) {
+			continue;
+		}
+
+		if (fseek(writer->f, (long)(writer->offset + offset), SEEK_SET)) {
+			writer->failed = true;
+			return;
+		}
+
+		if (fwrite(base + offset, 1, len, writer->f) != len) {
+			writer->failed = true;
+			return;
+		}
+	}
+
+	/* The file must cover the whole memory, even if it ends with a hole */
+
+	if (hole && !writer->failed &&
+	    (fseek(writer->f, (long)(writer->offset + size - 1), SEEK_SET) || fputc(0, writer->f) == EOF)) {
+		writer->failed = true;
+	}
+
+	writer->offset += size;
+}
+
+static int write_checkpoint(FILE *f, wasm_module_t module, wasm_module_inst_t module_inst, uint64_t module_hash)
+{
+	struct checkpoint_writer writer = {f, 0, false};
+	struct checkpoint_header header = {
+		.magic = CHECKPOINT_MAGIC,
+		.version = CHECKPOINT_VERSION,
+		.module_hash = module_hash,
+		.state_offset = sizeof(struct checkpoint_header),
+	};
+	const uint8_t *base = NULL;
+
+	const ocre_module_context_t *mod = ocre_get_module_context(module_inst);
+	if (!mod) {
+		return -1;
+	}
+
+	wasm_memory_inst_t memory = wasm_runtime_get_default_memory(module_inst);
+	if (memory) {
+		header.wasm_page_size = (uint32_t)wasm_memory_get_bytes_per_page(memory);
+		header.memory_size = wasm_memory_get_cur_page_count(memory) * header.wasm_page_size;
+		base = wasm_memory_get_base_address(memory);
+	}
+
+	/* The header is written again once the sizes are known */
+
+	write_bytes(&writer, &header, sizeof(header));
+
+	save_globals(&writer, module, module_inst);
+	save_dispatchers(&writer, mod);
+
+	if (save_timers(&writer, module_inst)) {
+		return -1;
+	}
+
+	ocre_messaging_save(module_inst, save_topic, &writer);
+
+	header.state_size = writer.offset - header.state_offset;
+	header.memory_offset = (writer.offset + CHECKPOINT_PAGE_SIZE - 1) & ~(uint64_t)(CHECKPOINT_PAGE_SIZE - 1);
+
+	writer.offset = header.memory_offset;
+
+	save_memory(&writer, base, header.memory_size);
+
+	if (!writer.failed && !fseek(f, 0, SEEK_SET)) {
+		writer.offset = 0;
+		write_bytes(&writer, &header, sizeof(header));
+	} else {
+		writer.failed = true;
+	}
+
+	if (writer.failed) {
+		LOG_ERR("Failed to write checkpoint: errno=%d", errno);
+		return -1;
+	}
+
+	LOG_INF("Saved %" PRIu64 " bytes of state and %" PRIu64 " bytes of memory", header.state_size,
+		header.memory_size);
+
+	return 0;
+}
+
+int wamr_checkpoint_save(wasm_module_t module, wasm_module_inst_t module_inst, uint64_t module_hash,
+			 const char *path)
+{
+	int ret = -1;
+
+	char *tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+	if (!tmp_path) {
+		LOG_ERR("Failed to allocate memory for the checkpoint path");
+		return -1;
+	}
+
+	sprintf(tmp_path, "%s.tmp", path);
+
+	FILE *f = fopen(tmp_path, "wb");
+	if (!f) {
+		LOG_ERR("Failed to open '%s': errno=%d", tmp_path, errno);
+		goto finish;
+	}
+
+	ret = write_checkpoint(f, module, module_inst, module_hash);
+
+	if (fclose(f) && !ret) {
+		LOG_ERR("Failed to close '%s': errno=%d", tmp_path, errno);
+		ret = -1;
+	}
+
+	if (!ret && rename(tmp_path, path)) {
+		LOG_ERR("Failed to rename '%s' to '%s': errno=%d", tmp_path, path, errno);
+		ret = -1;
+	}
+
+	if (ret) {
+		remove(tmp_path);
+	}
+
+finish:
+	free(tmp_path);
+
+	return ret;
+}
+
+/* Load */
+
+static int load_memory(wasm_module_inst_t module_inst, const struct checkpoint_header *header, const uint8_t *data)
+{
+	wasm_memory_inst_t memory = wasm_runtime_get_default_memory(module_inst);
+	if (!memory) {
+		if (header->memory_size) {
+			LOG_ERR("Checkpoint has a memory, but the instance has none");
+			return -1;
+		}
+
+		return 0;
+	}
+
+	uint64_t page_size = wasm_memory_get_bytes_per_page(memory);
+	if (page_size != header->wasm_page_size || header->memory_size % page_size) {
+		LOG_ERR("Checkpoint has a different memory page size");
+		return -1;
+	}
+
+	uint64_t pages = header->memory_size / page_size;
+	uint64_t cur_pages = wasm_memory_get_cur_page_count(memory);
+
+	if (pages > cur_pages && !wasm_runtime_enlarge_memory(module_inst, pages - cur_pages)) {
+		LOG_ERR("Failed to grow the memory to %" PRIu64 " pages", pages);
+		return -1;
+	}
+
+	/* The base address changes when the memory grows */
+
+	cur_pages = wasm_memory_get_cur_page_count(memory);
+	uint8_t *base = wasm_memory_get_base_address(memory);
+
+	memcpy(base, data + header->memory_offset, header->memory_size);
+
+	/* Memory cannot shrink, clear what the instance has beyond the saved memory */
+
+	if (cur_pages > pages) {
+		memset(base + header->memory_size, 0, (cur_pages - pages) * page_size);
+	}
+
+	return 0;
+}
+
+static int load_global(wasm_module_inst_t module_inst, const uint8_t *data)
+{
+	struct checkpoint_global record;
+	wasm_global_inst_t global;
+
+	memcpy(&record, data, sizeof(record));
+
+	const char *name = (const char *)data + sizeof(record);
+
+	if (!wasm_runtime_get_export_global_inst(module_inst, name, &global) || !global.is_mutable ||
+	    global.kind != record.kind) {
+		LOG_ERR("Global %s of the checkpoint does not match the module", name);
+		return -1;
+	}
+
+	memcpy(global.global_data, record.value, global_value_size(global.kind));
+
+	return 0;
+}
+
+static int load_record(wasm_exec_env_t exec_env, const struct checkpoint_record *record, const uint8_t *data)
+{
+	wasm_module_inst_t module_inst = wasm_runtime_get_module_inst(exec_env);
+	size_t head_size = 0;
+
+	switch (record->type) {
+		case CHECKPOINT_RECORD_GLOBAL:
+			head_size = sizeof(struct checkpoint_global);
+			break;
+		case CHECKPOINT_RECORD_DISPATCHER:
+			head_size = sizeof(struct checkpoint_dispatcher);
+			break;
+		case CHECKPOINT_RECORD_TIMER:
+			if (record->size != sizeof(struct ocre_timer_state)) {
+				return -1;
+			}
+			break;
+		case CHECKPOINT_RECORD_SUBSCRIPTION:
+			break;
+		default:
+			LOG_ERR("Unknown checkpoint record type %" PRIu32, record->type);
+			return -1;
+	}
+
+	/* Names must be NUL terminated */
+
+	if (record->type != CHECKPOINT_RECORD_TIMER && (record->size <= head_size || data[record->size - 1])) {
+		return -1;
+	}
+
+	switch (record->type) {
+		case CHECKPOINT_RECORD_GLOBAL:
+			return load_global(module_inst, data);
+		case CHECKPOINT_RECORD_DISPATCHER: {
+			struct checkpoint_dispatcher dispatcher;
+
+			memcpy(&dispatcher, data, sizeof(dispatcher));
+
+			return ocre_register_dispatcher(exec_env, (ocre_resource_type_t)dispatcher.type,
+							(const char *)data + head_size);
+		}
+		case CHECKPOINT_RECORD_TIMER: {
+			struct ocre_timer_state state;
+
+			memcpy(&state, data, sizeof(state));
+
+			return ocre_timer_restore(exec_env, &state);
+		}
+		default:
+			return ocre_messaging_subscribe(exec_env, (void *)data);
+	}
+}
+
+static int load_state(wasm_exec_env_t exec_env, const struct checkpoint_header *header, const uint8_t *data)
+{
+	uint64_t offset = header->state_offset;
+	uint64_t end = header->state_offset + header->state_size;
+
+	while (offset < end) {
+		struct checkpoint_record record;
+
+		if (end - offset < sizeof(record)) {
+			goto invalid;
+		}
+
+		memcpy(&record, data + offset, sizeof(record));
+		offset += sizeof(record);
+
+		if (end - offset < record.size) {
+			goto invalid;
+		}
+
+		if (load_record(exec_env, &record, data + offset)) {
+			goto invalid;
+		}
+
+		offset += record.size;
+	}
+
+	return 0;
+
+invalid:
+	LOG_ERR("Invalid checkpoint record at offset %" PRIu64, offset);
+
+	return -1;
+}
+
+static int check_header(const struct checkpoint_header *header, size_t size, uint64_t module_hash)
+{
+	if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) || header->version != CHECKPOINT_VERSION) {
+		LOG_ERR("Not a checkpoint, or a checkpoint of an unsupported version");
+		return -1;
+	}
+
+	if (header->module_hash != module_hash) {
+		LOG_ERR("Checkpoint was taken from a different module");
+		return -1;
+	}
+
+	if (header->state_offset > size || header->state_size > size - header->state_offset ||
+	    header->memory_offset > size || header->memory_size > size - header->memory_offset) {
+		LOG_ERR("Checkpoint is truncated");
+		return -1;
+	}
+
+	return 0;
+}
+
+int wamr_checkpoint_load(wasm_module_inst_t module_inst, uint64_t module_hash, const char *path)
+{
+	struct checkpoint_header header;
+	wasm_exec_env_t exec_env = NULL;
+	size_t size = 0;
+	int ret = -1;
+
+	/* Mapped where supported, the pages of the memory are then read as they are copied */
+
+	uint8_t *data = ocre_load_file(path, &size);
+	if (!data) {
+		LOG_ERR("Failed to load checkpoint '%s': errno=%d", path, errno);
+		return -1;
+	}
+
+	if (size < sizeof(header)) {
+		LOG_ERR("Checkpoint '%s' is truncated", path);
+		goto finish;
+	}
+
+	memcpy(&header, data, sizeof(header));
+
+	if (check_header(&header, size, module_hash) || load_memory(module_inst, &header, data)) {
+		goto finish;
+	}
+
+	/* Resources are registered by the Ocre API natives, which need an execution environment */
+
+	exec_env = wasm_runtime_create_exec_env(module_inst, OCRE_WASM_STACK_SIZE);
+	if (!exec_env) {
+		LOG_ERR("Failed to create execution environment");
+		goto finish;
+	}
+
+	if (load_state(exec_env, &header, data)) {
+		goto finish;
+	}
+
+	LOG_INF("Loaded checkpoint '%s'", path);
+
+	ret = 0;
+
+finish:
+	if (exec_env) {
+		wasm_runtime_destroy_exec_env(exec_env);
+	}
+
+	ocre_unload_file(data, size);
+
+	return ret;
+}
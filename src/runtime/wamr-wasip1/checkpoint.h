@@ -0,0 +1,58 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_WAMR_CHECKPOINT_H
+#define OCRE_WAMR_CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <wasm_export.h>
+
+/**
+ * @brief Hash of a module binary, recorded in its checkpoints
+ *
+ * A checkpoint is only restored into an instance of the module it was taken from.
+ *
+ * @param buffer The module binary
+ * @param size The size of the module binary
+ *
+ * @return The 64-bit FNV-1a hash of the module binary
+ */
+uint64_t wamr_checkpoint_module_hash(const void *buffer, size_t size);
+
+/**
+ * @brief Save the state of a module instance to a file
+ *
+ * Saves the linear memory, the mutable exported globals, the event dispatchers, the timers and the messaging
+ * subscriptions. The instance must not run while it is saved. The file is written to a temporary file first, and
+ * renamed over the path once complete.
+ *
+ * @param module The module of the instance
+ * @param module_inst The instance to save
+ * @param module_hash The hash of the module binary
+ * @param path The path of the checkpoint file
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int wamr_checkpoint_save(wasm_module_t module, wasm_module_inst_t module_inst, uint64_t module_hash,
+			 const char *path);
+
+/**
+ * @brief Load the state of a module instance from a file
+ *
+ * The instance must be freshly instantiated and registered with the Ocre API, and must not run while it is loaded.
+ *
+ * @param module_inst The instance to load into
+ * @param module_hash The hash of the module binary
+ * @param path The path of the checkpoint file
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int wamr_checkpoint_load(wasm_module_inst_t module_inst, uint64_t module_hash, const char *path);
+
+#endif /* OCRE_WAMR_CHECKPOINT_H */
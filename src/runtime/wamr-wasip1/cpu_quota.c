@@ -0,0 +1,291 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <ocre/metrics.h>
+#include <ocre/platform/log.h>
+
+#include "cpu_quota.h"
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+
+LOG_MODULE_REGISTER(cpu_quota, CONFIG_OCRE_LOG_LEVEL);
+
+/* Do not wake up the governor more often than this */
+
+#define CPU_QUOTA_MIN_TICK_NS 1000000ULL
+
+static pthread_mutex_t governor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t governor_cond;
+static pthread_t governor_thread;
+static bool governor_running;
+static bool governor_shutdown;
+static struct cpu_quota *quotas;
+
+static uint64_t clock_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	if (clock_gettime(clock, &ts)) {
+		return 0;
+	}
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Called with governor_mutex held. Returns the next time (monotonic) this quota needs to be checked */
+
+static uint64_t quota_check(struct cpu_quota *quota, uint64_t now)
+{
+	uint64_t period_ns = (uint64_t)quota->period_us * 1000ULL;
+	uint64_t quota_ns = (uint64_t)quota->quota_us * 1000ULL;
+	uint64_t cpu = clock_ns(quota->clock);
+
+	if (now >= quota->period_end_ns) {
+		/* New period. Skip the periods we missed, if any */
+
+		quota->period_end_ns += ((now - quota->period_end_ns) / period_ns + 1) * period_ns;
+		quota->period_start_cpu_ns = cpu;
+
+		if (quota->throttled) {
+			quota->throttled = false;
+			wamr_suspend_release(quota->suspend, WAMR_SUSPEND_REASON_THROTTLE);
+		}
+	}
+
+	if (quota->exempt) {
+		return UINT64_MAX;
+	}
+
+	uint64_t used = cpu - quota->period_start_cpu_ns;
+
+	if (!quota->throttled && used >= quota_ns) {
+		int rc = wamr_suspend_request(quota->suspend, WAMR_SUSPEND_REASON_THROTTLE, 0);
+		if (rc) {
+			LOG_WRN("Failed to throttle thread: rc=%d", rc);
+		} else {
+			quota->throttled = true;
+			quota->nr_throttled++;
+			ocre_metric_inc(OCRE_METRIC_CONTAINER_THROTTLED_TOTAL);
+			LOG_DBG("Throttled thread after %llu us of CPU time, %llu times so far",
+				(unsigned long long)(used / 1000ULL), (unsigned long long)quota->nr_throttled);
+		}
+	}
+
+	if (quota->throttled) {
+		return quota->period_end_ns;
+	}
+
+	/* A single thread cannot use CPU time faster than wall time, so no need to look before it could possibly
+	 * have used up what is left
+	 */
+
+	uint64_t deadline = now + CPU_QUOTA_MIN_TICK_NS;
+	if (used + CPU_QUOTA_MIN_TICK_NS < quota_ns) {
+		deadline = now + (quota_ns - used);
+	}
+
+	return deadline < quota->period_end_ns ? deadline : quota->period_end_ns;
+}
+
+static void *governor(void *arg)
+{
+	(void)arg;
+
+	pthread_mutex_lock(&governor_mutex);
+
+	while (!governor_shutdown) {
+		uint64_t now = clock_ns(CLOCK_MONOTONIC);
+		uint64_t next = UINT64_MAX;
+
+		for (struct cpu_quota *quota = quotas; quota; quota = quota->next) {
+			uint64_t deadline = quota_check(quota, now);
+			if (deadline < next) {
+				next = deadline;
+			}
+		}
+
+		if (next == UINT64_MAX) {
+			pthread_cond_wait(&governor_cond, &governor_mutex);
+			continue;
+		}
+
+		struct timespec ts = {
+			.tv_sec = next / 1000000000ULL,
+			.tv_nsec = next % 1000000000ULL,
+		};
+
+		pthread_cond_timedwait(&governor_cond, &governor_mutex, &ts);
+	}
+
+	pthread_mutex_unlock(&governor_mutex);
+
+	return NULL;
+}
+
+/* Called with governor_mutex held */
+
+static int governor_start(void)
+{
+	pthread_condattr_t attr;
+	int rc;
+
+	if (governor_running) {
+		return 0;
+	}
+
+	rc = pthread_condattr_init(&attr);
+	if (rc) {
+		LOG_ERR("Failed to initialize condition attributes: rc=%d", rc);
+		return -1;
+	}
+
+	rc = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	if (rc) {
+		LOG_ERR("Failed to set condition clock: rc=%d", rc);
+		goto error_attr;
+	}
+
+	rc = pthread_cond_init(&governor_cond, &attr);
+	if (rc) {
+		LOG_ERR("Failed to initialize condition variable: rc=%d", rc);
+		goto error_attr;
+	}
+
+	governor_shutdown = false;
+
+	rc = pthread_create(&governor_thread, NULL, governor, NULL);
+	if (rc) {
+		LOG_ERR("Failed to create CPU quota governor thread: rc=%d", rc);
+		pthread_cond_destroy(&governor_cond);
+		goto error_attr;
+	}
+
+	pthread_condattr_destroy(&attr);
+
+	governor_running = true;
+
+	LOG_INF("Started CPU quota governor");
+
+	return 0;
+
+error_attr:
+	pthread_condattr_destroy(&attr);
+
+	return -1;
+}
+
+int cpu_quota_attach(struct cpu_quota *quota, struct wamr_suspend *suspend, unsigned int quota_us,
+		     unsigned int period_us)
+{
+	int rc;
+
+	if (!quota || !suspend || quota_us < CPU_QUOTA_MIN_US || period_us < quota_us) {
+		LOG_ERR("Invalid arguments");
+		return -1;
+	}
+
+	rc = pthread_getcpuclockid(pthread_self(), &quota->clock);
+	if (rc) {
+		LOG_ERR("Failed to get thread CPU clock: rc=%d", rc);
+		return -1;
+	}
+
+	quota->suspend = suspend;
+	quota->quota_us = quota_us;
+	quota->period_us = period_us;
+	quota->period_end_ns = clock_ns(CLOCK_MONOTONIC) + (uint64_t)period_us * 1000ULL;
+	quota->period_start_cpu_ns = clock_ns(quota->clock);
+	quota->throttled = false;
+	quota->exempt = false;
+	quota->nr_throttled = 0;
+
+	pthread_mutex_lock(&governor_mutex);
+
+	rc = governor_start();
+	if (!rc) {
+		quota->next = quotas;
+		quotas = quota;
+		pthread_cond_signal(&governor_cond);
+	}
+
+	pthread_mutex_unlock(&governor_mutex);
+
+	return rc;
+}
+
+void cpu_quota_detach(struct cpu_quota *quota)
+{
+	if (!quota) {
+		return;
+	}
+
+	pthread_mutex_lock(&governor_mutex);
+
+	for (struct cpu_quota **p = &quotas; *p; p = &(*p)->next) {
+		if (*p == quota) {
+			*p = quota->next;
+			break;
+		}
+	}
+
+	if (quota->throttled) {
+		quota->throttled = false;
+		wamr_suspend_release(quota->suspend, WAMR_SUSPEND_REASON_THROTTLE);
+	}
+
+	pthread_mutex_unlock(&governor_mutex);
+
+	if (quota->nr_throttled) {
+		LOG_INF("Thread was throttled %llu times", (unsigned long long)quota->nr_throttled);
+	}
+}
+
+void cpu_quota_exempt(struct cpu_quota *quota)
+{
+	if (!quota) {
+		return;
+	}
+
+	pthread_mutex_lock(&governor_mutex);
+
+	quota->exempt = true;
+
+	if (quota->throttled) {
+		quota->throttled = false;
+		wamr_suspend_release(quota->suspend, WAMR_SUSPEND_REASON_THROTTLE);
+	}
+
+	pthread_mutex_unlock(&governor_mutex);
+}
+
+void cpu_quota_shutdown(void)
+{
+	pthread_mutex_lock(&governor_mutex);
+
+	if (!governor_running) {
+		pthread_mutex_unlock(&governor_mutex);
+		return;
+	}
+
+	governor_shutdown = true;
+	pthread_cond_signal(&governor_cond);
+
+	pthread_mutex_unlock(&governor_mutex);
+
+	pthread_join(governor_thread, NULL);
+
+	pthread_cond_destroy(&governor_cond);
+
+	governor_running = false;
+}
+
+#endif /* CONFIG_OCRE_CONTAINER_SUSPEND */
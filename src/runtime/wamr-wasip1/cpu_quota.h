@@ -0,0 +1,80 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_WAMR_CPU_QUOTA_H
+#define OCRE_WAMR_CPU_QUOTA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <ocre/platform/config.h>
+
+#include "suspend.h"
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+
+/* Smallest quota we can enforce with reasonable accuracy */
+
+#define CPU_QUOTA_MIN_US 1000
+
+/**
+ * @brief CPU bandwidth control of a container thread
+ *
+ * The governor thread samples the CPU time of every attached thread. When a thread uses more than quota_us of CPU
+ * time within a period of period_us, it is suspended until the end of the period.
+ */
+struct cpu_quota {
+	struct cpu_quota *next;
+	struct wamr_suspend *suspend;
+	clockid_t clock;
+	unsigned int quota_us;
+	unsigned int period_us;
+	uint64_t period_end_ns;
+	uint64_t period_start_cpu_ns;
+	bool throttled;
+	bool exempt;
+	uint64_t nr_throttled;
+};
+
+/**
+ * @brief Start enforcing a CPU quota on the calling thread
+ *
+ * @param quota Quota state, owned by the caller until cpu_quota_detach()
+ * @param suspend Suspension handle already attached to the calling thread
+ * @param quota_us CPU time allowed per period, in microseconds
+ * @param period_us Period length, in microseconds
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int cpu_quota_attach(struct cpu_quota *quota, struct wamr_suspend *suspend, unsigned int quota_us,
+		     unsigned int period_us);
+
+/**
+ * @brief Stop enforcing the CPU quota. Must be called from the same thread as cpu_quota_attach()
+ *
+ * @param quota Quota state
+ */
+void cpu_quota_detach(struct cpu_quota *quota);
+
+/**
+ * @brief Lift the throttling of a thread and stop throttling it until it is attached again
+ *
+ * Used when the thread must be able to run to completion, e.g. when the container is killed.
+ *
+ * @param quota Quota state
+ */
+void cpu_quota_exempt(struct cpu_quota *quota);
+
+/**
+ * @brief Stop the governor thread
+ */
+void cpu_quota_shutdown(void);
+
+#endif /* CONFIG_OCRE_CONTAINER_SUSPEND */
+
+#endif /* OCRE_WAMR_CPU_QUOTA_H */
@@ -0,0 +1,237 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <ocre/trace.h>
+#include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
+
+#include <wasm_export.h>
+
+#include "executor.h"
+
+LOG_MODULE_REGISTER(executor, CONFIG_OCRE_LOG_LEVEL);
+
+#define TASK_IDLE    0
+#define TASK_QUEUED  1
+#define TASK_RUNNING 2
+#define TASK_RERUN   3 /* Submitted again while running */
+
+static pthread_mutex_t executor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t executor_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t *workers;
+static int nr_workers;
+static int nr_busy;
+static bool executor_shutdown_requested;
+static struct executor_task *queue_head;
+static struct executor_task *queue_tail;
+
+/* Called with executor_mutex held */
+
+static void enqueue(struct executor_task *task)
+{
+	task->state = TASK_QUEUED;
+	task->next = NULL;
+
+	if (queue_tail) {
+		queue_tail->next = task;
+	} else {
+		queue_head = task;
+	}
+
+	queue_tail = task;
+
+	if (nr_busy == nr_workers) {
+		LOG_DBG("All %d workers are busy, task %p is queued", nr_workers, (void *)task);
+	}
+
+	pthread_cond_signal(&executor_cond);
+}
+
+/* Called with executor_mutex held */
+
+static struct executor_task *dequeue(void)
+{
+	struct executor_task *task = queue_head;
+
+	if (task) {
+		queue_head = task->next;
+		if (!queue_head) {
+			queue_tail = NULL;
+		}
+
+		task->next = NULL;
+	}
+
+	return task;
+}
+
+static void *worker(void *arg)
+{
+	(void)arg;
+
+	wasm_runtime_init_thread_env();
+
+	OCRE_TRACE_THREAD_NAME("executor");
+
+	pthread_mutex_lock(&executor_mutex);
+
+	while (!executor_shutdown_requested) {
+		struct executor_task *task = dequeue();
+		if (!task) {
+			pthread_cond_wait(&executor_cond, &executor_mutex);
+			continue;
+		}
+
+		task->state = TASK_RUNNING;
+		nr_busy++;
+
+		pthread_mutex_unlock(&executor_mutex);
+
+		bool keep = task->run(task);
+
+		pthread_mutex_lock(&executor_mutex);
+
+		nr_busy--;
+
+		if (!keep) {
+			continue;
+		}
+
+		if (task->state == TASK_RERUN) {
+			enqueue(task);
+		} else {
+			task->state = TASK_IDLE;
+		}
+	}
+
+	pthread_mutex_unlock(&executor_mutex);
+
+	wasm_runtime_destroy_thread_env();
+
+	return NULL;
+}
+
+static int executor_size(void)
+{
+	int size = CONFIG_OCRE_EXECUTOR_WORKERS;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	if (size <= 0) {
+		size = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+#endif
+
+	return size > 0 ? size : 1;
+}
+
+/* Called with executor_mutex held */
+
+static int executor_start(void)
+{
+	if (workers) {
+		return 0;
+	}
+
+	int size = executor_size();
+
+	workers = calloc(size, sizeof(pthread_t));
+	if (!workers) {
+		LOG_ERR("Failed to allocate memory for %d workers", size);
+		return -1;
+	}
+
+	executor_shutdown_requested = false;
+
+	for (nr_workers = 0; nr_workers < size; nr_workers++) {
+		int rc = pthread_create(&workers[nr_workers], NULL, worker, NULL);
+		if (rc) {
+			LOG_ERR("Failed to create worker thread: rc=%d", rc);
+			break;
+		}
+	}
+
+	if (!nr_workers) {
+		free(workers);
+		workers = NULL;
+		return -1;
+	}
+
+	LOG_INF("Started executor with %d workers", nr_workers);
+
+	return 0;
+}
+
+void executor_task_init(struct executor_task *task, bool (*run)(struct executor_task *task))
+{
+	task->next = NULL;
+	task->run = run;
+	task->state = TASK_IDLE;
+}
+
+int executor_submit(struct executor_task *task)
+{
+	int rc = 0;
+
+	if (!task || !task->run) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&executor_mutex);
+
+	switch (task->state) {
+		case TASK_IDLE:
+			rc = executor_start();
+			if (!rc) {
+				enqueue(task);
+			}
+			break;
+		case TASK_RUNNING:
+			task->state = TASK_RERUN;
+			break;
+		default:
+			/* Already going to run */
+			break;
+	}
+
+	pthread_mutex_unlock(&executor_mutex);
+
+	return rc;
+}
+
+void executor_shutdown(void)
+{
+	pthread_mutex_lock(&executor_mutex);
+
+	if (!workers) {
+		pthread_mutex_unlock(&executor_mutex);
+		return;
+	}
+
+	if (queue_head || nr_busy) {
+		LOG_WRN("Shutting down executor with tasks left");
+	}
+
+	executor_shutdown_requested = true;
+	pthread_cond_broadcast(&executor_cond);
+
+	pthread_mutex_unlock(&executor_mutex);
+
+	for (int i = 0; i < nr_workers; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	free(workers);
+	workers = NULL;
+	nr_workers = 0;
+	queue_head = NULL;
+	queue_tail = NULL;
+}
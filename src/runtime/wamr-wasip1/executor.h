@@ -0,0 +1,51 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_WAMR_EXECUTOR_H
+#define OCRE_WAMR_EXECUTOR_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Unit of work run by the executor worker pool
+ *
+ * A task is queued at most once. Submitting a task while it runs makes it run again once it returns, so a task never
+ * runs on two workers at the same time.
+ */
+struct executor_task {
+	struct executor_task *next;
+	bool (*run)(struct executor_task *task);
+	unsigned int state;
+};
+
+/**
+ * @brief Initialize a task. Must not be called while the task is queued or running
+ *
+ * @param task Task to initialize
+ * @param run Function run by a worker. Returns false when the task is finished and its memory may already be gone,
+ * in which case the executor does not touch it anymore
+ */
+void executor_task_init(struct executor_task *task, bool (*run)(struct executor_task *task));
+
+/**
+ * @brief Queue a task to be run by the next free worker
+ *
+ * Starts the worker pool if needed. Tasks are run in submission order; when all workers are busy, they wait in the
+ * queue. Does not block, so it can be called with locks held.
+ *
+ * @param task Task to run
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int executor_submit(struct executor_task *task);
+
+/**
+ * @brief Stop the worker pool. There must be no task left
+ */
+void executor_shutdown(void);
+
+#endif /* OCRE_WAMR_EXECUTOR_H */
@@ -0,0 +1,158 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "core_external.h"
+
+static __thread core_cancel_t *current_cancel;
+
+int core_cancel_init(core_cancel_t *cancel)
+{
+	pthread_condattr_t attr;
+	int rc;
+
+	if (!cancel) {
+		return -EINVAL;
+	}
+
+	memset(cancel, 0, sizeof(*cancel));
+
+	rc = pthread_condattr_init(&attr);
+	if (rc) {
+		return -rc;
+	}
+
+	/* Timeouts must not be affected by changes to the wall clock */
+
+	rc = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	if (rc) {
+		goto error_attr;
+	}
+
+	rc = pthread_cond_init(&cancel->cond, &attr);
+	if (rc) {
+		goto error_attr;
+	}
+
+	rc = pthread_mutex_init(&cancel->mutex, NULL);
+	if (rc) {
+		pthread_cond_destroy(&cancel->cond);
+		goto error_attr;
+	}
+
+	pthread_condattr_destroy(&attr);
+
+	return 0;
+
+error_attr:
+	pthread_condattr_destroy(&attr);
+
+	return -rc;
+}
+
+void core_cancel_destroy(core_cancel_t *cancel)
+{
+	if (!cancel) {
+		return;
+	}
+
+	pthread_mutex_destroy(&cancel->mutex);
+	pthread_cond_destroy(&cancel->cond);
+}
+
+void core_cancel_attach(core_cancel_t *cancel)
+{
+	if (!cancel) {
+		return;
+	}
+
+	pthread_mutex_lock(&cancel->mutex);
+	cancel->cancelled = false;
+	pthread_mutex_unlock(&cancel->mutex);
+
+	current_cancel = cancel;
+}
+
+void core_cancel_detach(void)
+{
+	current_cancel = NULL;
+}
+
+core_cancel_t *core_cancel_current(void)
+{
+	return current_cancel;
+}
+
+void core_cancel_signal(core_cancel_t *cancel)
+{
+	if (!cancel) {
+		return;
+	}
+
+	pthread_mutex_lock(&cancel->mutex);
+	cancel->cancelled = true;
+	pthread_cond_broadcast(&cancel->cond);
+	pthread_mutex_unlock(&cancel->mutex);
+}
+
+int core_cancel_wait(core_cancel_t *cancel, int timeout_ms)
+{
+	struct timespec ts;
+	int rc = 0;
+
+	if (!cancel) {
+		if (timeout_ms < 0) {
+			return -EINVAL;
+		}
+
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+
+		/* The sleep can be interrupted when the thread is throttled or paused. Sleep for the remaining time */
+
+		while (nanosleep(&ts, &ts) && errno == EINTR) {
+		}
+
+		return 0;
+	}
+
+	if (timeout_ms >= 0) {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ts.tv_sec += timeout_ms / 1000;
+		ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&cancel->mutex);
+
+	/* Spurious wakeups, including the ones caused by suspension, just go back to waiting */
+
+	while (!cancel->cancelled && !rc) {
+		if (timeout_ms < 0) {
+			rc = pthread_cond_wait(&cancel->cond, &cancel->mutex);
+		} else {
+			rc = pthread_cond_timedwait(&cancel->cond, &cancel->mutex, &ts);
+		}
+	}
+
+	bool cancelled = cancel->cancelled;
+
+	pthread_mutex_unlock(&cancel->mutex);
+
+	if (cancelled) {
+		return -ECANCELED;
+	}
+
+	return rc == ETIMEDOUT ? 0 : -rc;
+}
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <time.h>
 
 #include "core_internal.h"
 
@@ -223,6 +224,41 @@ int core_construct_filepath(char *path, size_t len, char *name);
  */
 uint32_t core_uptime_get(void);
 
+/**
+ * @brief Read a fast monotonic cycle counter.
+ *
+ * Reads the time stamp counter on x86-64 and the virtual counter on AArch64, without a system call. Falls back to the
+ * monotonic clock elsewhere. Only differences are meaningful, convert them with core_cycles_to_ns().
+ *
+ * @return The current value of the counter.
+ */
+static inline uint64_t core_cycles(void)
+{
+#if defined(__x86_64__)
+	uint32_t lo, hi;
+	__asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+	uint64_t value;
+	__asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+	return value;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Convert a number of cycles of core_cycles() to nanoseconds.
+ *
+ * The first call may take a few milliseconds to calibrate the counter.
+ *
+ * @param cycles Number of cycles.
+ * @return The duration in nanoseconds.
+ */
+uint64_t core_cycles_to_ns(uint64_t cycles);
+
 /**
  * @brief Lock a spinlock and return the interrupt key.
  *
@@ -283,4 +319,58 @@ int core_eventq_put(core_eventq_t *eventq, const void *event);
  */
 void core_eventq_destroy(core_eventq_t *eventq);
 
+typedef struct core_cancel core_cancel_t;
+
+/**
+ * @brief Initialize a cancellation point.
+ *
+ * @param cancel Pointer to the cancellation structure.
+ * @return 0 on success, negative value on error.
+ */
+int core_cancel_init(core_cancel_t *cancel);
+
+/**
+ * @brief Destroy a cancellation point. It must be detached.
+ *
+ * @param cancel Pointer to the cancellation structure.
+ */
+void core_cancel_destroy(core_cancel_t *cancel);
+
+/**
+ * @brief Make a cancellation point the current one of the calling thread, and clear any previous cancellation.
+ *
+ * @param cancel Pointer to the cancellation structure.
+ */
+void core_cancel_attach(core_cancel_t *cancel);
+
+/**
+ * @brief Detach the calling thread from its cancellation point.
+ */
+void core_cancel_detach(void);
+
+/**
+ * @brief Get the cancellation point of the calling thread.
+ *
+ * @return Pointer to the cancellation structure, or NULL if none is attached.
+ */
+core_cancel_t *core_cancel_current(void);
+
+/**
+ * @brief Cancel all current and future waits on a cancellation point, until it is attached again.
+ *
+ * @param cancel Pointer to the cancellation structure.
+ */
+void core_cancel_signal(core_cancel_t *cancel);
+
+/**
+ * @brief Wait until a timeout expires or the cancellation point is signaled.
+ *
+ * If @p cancel is NULL, this is a plain sleep.
+ *
+ * @param cancel Pointer to the cancellation structure, may be NULL.
+ * @param timeout_ms Time to wait in milliseconds, negative to wait until signaled.
+ * @return 0 if the timeout expired, -ECANCELED if signaled, other negative value on error.
+ */
+int core_cancel_wait(core_cancel_t *cancel, int timeout_ms);
+
 #endif /* OCRE_CORE_EXTERNAL_H */
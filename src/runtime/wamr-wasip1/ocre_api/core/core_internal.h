@@ -79,6 +79,17 @@ struct core_timer {
 	void *user_data;	  /*!< User data for the callback */
 };
 
+/**
+ * @brief Structure representing a cancellation point in the Ocre runtime.
+ *
+ * Blocking host calls wait on it instead of sleeping, so they return as soon as the container is killed.
+ */
+struct core_cancel {
+	pthread_mutex_t mutex; /*!< Protects cancelled */
+	pthread_cond_t cond;   /*!< Signaled when cancelled is set */
+	bool cancelled;	       /*!< Whether the container was cancelled */
+};
+
 /* Generic singly-linked list iteration macros */
 #define CORE_SLIST_CONTAINER_OF(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
 
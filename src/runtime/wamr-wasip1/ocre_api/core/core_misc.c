@@ -22,6 +22,51 @@ uint32_t core_uptime_get(void)
 	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
+#if defined(__x86_64__) || defined(__aarch64__)
+static pthread_once_t cycles_once = PTHREAD_ONCE_INIT;
+static double ns_per_cycle;
+
+static void calibrate_cycles(void)
+{
+#if defined(__aarch64__)
+	uint64_t frequency;
+	__asm__ volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+	ns_per_cycle = 1e9 / (double)frequency;
+#else
+	/* The time stamp counter frequency is not exposed, measure it against the monotonic clock */
+
+	struct timespec start, end;
+	struct timespec delay = {.tv_sec = 0, .tv_nsec = 10000000};
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	uint64_t start_cycles = core_cycles();
+
+	nanosleep(&delay, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	uint64_t end_cycles = core_cycles();
+
+	double elapsed_ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+
+	ns_per_cycle = elapsed_ns / (double)(end_cycles - start_cycles);
+#endif
+}
+
+uint64_t core_cycles_to_ns(uint64_t cycles)
+{
+	pthread_once(&cycles_once, calibrate_cycles);
+
+	return (uint64_t)((double)cycles * ns_per_cycle);
+}
+#else
+uint64_t core_cycles_to_ns(uint64_t cycles)
+{
+	/* The fallback counter is already in nanoseconds */
+
+	return cycles;
+}
+#endif
+
 core_spinlock_key_t core_spinlock_lock(core_spinlock_t *lock)
 {
 	pthread_mutex_lock(&lock->mutex);
@@ -9,6 +9,7 @@
 #define _GNU_SOURCE
 #endif
 
+#include <errno.h>
 #include <stdio.h>
 #include <sys/utsname.h>
 #include <string.h>
@@ -16,8 +17,11 @@
 #include <sys/types.h>
 
 #include "ocre_api.h"
+#include "core/core_external.h"
 #include "utils/strlcat.h"
 
+#include <ocre/trace.h>
+
 #include <ocre/platform/config.h>
 
 #ifdef CONFIG_OCRE_TIMER
@@ -25,7 +29,7 @@
 #endif
 
 #if defined(CONFIG_OCRE_TIMER) || defined(CONFIG_OCRE_GPIO) || defined(CONFIG_OCRE_SENSORS) ||                         \
-	defined(CONFIG_OCRE_CONTAINER_MESSAGING)
+	defined(CONFIG_OCRE_CONTAINER_MESSAGING) || defined(CONFIG_OCRE_API_PROFILING)
 #include "ocre_common.h"
 #endif
 
@@ -93,66 +97,211 @@ int _ocre_posix_uname(wasm_exec_env_t exec_env, struct _ocre_posix_utsname *name
 
 int ocre_sleep(wasm_exec_env_t exec_env, int milliseconds)
 {
-	usleep(milliseconds * 1000);
+	if (milliseconds <= 0) {
+		return 0;
+	}
+
+	/* Return early if the container is killed. The termination takes effect as soon as we are back in wasm */
+
+	if (core_cancel_wait(core_cancel_current(), milliseconds) == -ECANCELED) {
+		return -1;
+	}
+
 	return 0;
 }
 
-// Ocre Runtime API
-NativeSymbol ocre_api_table[] = {
-	{"uname", _ocre_posix_uname, "(*)i", NULL},
-	{"ocre_sleep", ocre_sleep, "(i)i", NULL},
+/* Natives of the Ocre Runtime API, as X(name, function, signature, return type, parameter types...). The table and
+ * the wrappers tracing and profiling the natives are generated from these lists.
+ */
+
+#define OCRE_API_BASE_NATIVES(X)                                                                                       \
+	X("uname", _ocre_posix_uname, "(*)i", int, wasm_exec_env_t, struct _ocre_posix_utsname *)                      \
+	X("ocre_sleep", ocre_sleep, "(i)i", int, wasm_exec_env_t, int)
+
 #if defined(CONFIG_OCRE_TIMER) || defined(CONFIG_OCRE_GPIO) || defined(CONFIG_OCRE_SENSORS) ||                         \
 	defined(CONFIG_OCRE_CONTAINER_MESSAGING)
-	{"ocre_get_event", ocre_get_event, "(iiiiii)i", NULL},
-	{"ocre_register_dispatcher", ocre_register_dispatcher, "(i$)i", NULL},
+#define OCRE_API_EVENT_NATIVES(X)                                                                                      \
+	X("ocre_get_event", ocre_get_event, "(iiiiii)i", int, wasm_exec_env_t, uint32_t, uint32_t, uint32_t, uint32_t, \
+	  uint32_t, uint32_t)                                                                                          \
+	X("ocre_register_dispatcher", ocre_register_dispatcher, "(i$)i", int, wasm_exec_env_t, ocre_resource_type_t,   \
+	  const char *)
+#else
+#define OCRE_API_EVENT_NATIVES(X)
 #endif
+
 // Container Messaging API
 #ifdef CONFIG_OCRE_CONTAINER_MESSAGING
-	{"ocre_publish_message", ocre_messaging_publish, "(***i)i", NULL},
-	{"ocre_subscribe_message", ocre_messaging_subscribe, "(*)i", NULL},
-	{"ocre_messaging_free_module_event_data", ocre_messaging_free_module_event_data, "(iii)i", NULL},
+#define OCRE_API_MESSAGING_NATIVES(X)                                                                                  \
+	X("ocre_publish_message", ocre_messaging_publish, "(***i)i", int, wasm_exec_env_t, void *, void *, void *,     \
+	  int)                                                                                                         \
+	X("ocre_subscribe_message", ocre_messaging_subscribe, "(*)i", int, wasm_exec_env_t, void *)                    \
+	X("ocre_messaging_free_module_event_data", ocre_messaging_free_module_event_data, "(iii)i", int,               \
+	  wasm_exec_env_t, uint32_t, uint32_t, uint32_t)
+#else
+#define OCRE_API_MESSAGING_NATIVES(X)
 #endif
+
 // Sensor API
 #ifdef CONFIG_OCRE_SENSORS
-	{"ocre_sensors_init", ocre_sensors_init, "()i", NULL},
-	{"ocre_sensors_discover", ocre_sensors_discover, "()i", NULL},
-	{"ocre_sensors_open", ocre_sensors_open, "(i)i", NULL},
-	{"ocre_sensors_get_handle", ocre_sensors_get_handle, "(i)i", NULL},
-	{"ocre_sensors_get_channel_count", ocre_sensors_get_channel_count, "(i)i", NULL},
-	{"ocre_sensors_get_channel_type", ocre_sensors_get_channel_type, "(ii)i", NULL},
-	{"ocre_sensors_read", ocre_sensors_read, "(ii)F", NULL},
-	{"ocre_sensors_open_by_name", ocre_sensors_open_by_name, "($)i", NULL},
-	{"ocre_sensors_get_handle_by_name", ocre_sensors_get_handle_by_name, "($)i", NULL},
-	{"ocre_sensors_get_channel_count_by_name", ocre_sensors_get_channel_count_by_name, "($)i", NULL},
-	{"ocre_sensors_get_channel_type_by_name", ocre_sensors_get_channel_type_by_name, "($i)i", NULL},
-	{"ocre_sensors_read_by_name", ocre_sensors_read_by_name, "($i)F", NULL},
-	{"ocre_sensors_get_list", ocre_sensors_get_list, "($i)i", NULL},
+#define OCRE_API_SENSOR_NATIVES(X)                                                                                     \
+	X("ocre_sensors_init", ocre_sensors_init, "()i", int, wasm_exec_env_t)                                         \
+	X("ocre_sensors_discover", ocre_sensors_discover, "()i", int, wasm_exec_env_t)                                 \
+	X("ocre_sensors_open", ocre_sensors_open, "(i)i", int, wasm_exec_env_t, ocre_sensor_handle_t)                  \
+	X("ocre_sensors_get_handle", ocre_sensors_get_handle, "(i)i", int, wasm_exec_env_t, int)                       \
+	X("ocre_sensors_get_channel_count", ocre_sensors_get_channel_count, "(i)i", int, wasm_exec_env_t, int)         \
+	X("ocre_sensors_get_channel_type", ocre_sensors_get_channel_type, "(ii)i", int, wasm_exec_env_t, int, int)     \
+	X("ocre_sensors_read", ocre_sensors_read, "(ii)F", double, wasm_exec_env_t, int, int)                          \
+	X("ocre_sensors_open_by_name", ocre_sensors_open_by_name, "($)i", int, wasm_exec_env_t, const char *)          \
+	X("ocre_sensors_get_handle_by_name", ocre_sensors_get_handle_by_name, "($)i", int, wasm_exec_env_t,            \
+	  const char *)                                                                                                \
+	X("ocre_sensors_get_channel_count_by_name", ocre_sensors_get_channel_count_by_name, "($)i", int,               \
+	  wasm_exec_env_t, const char *)                                                                               \
+	X("ocre_sensors_get_channel_type_by_name", ocre_sensors_get_channel_type_by_name, "($i)i", int,                \
+	  wasm_exec_env_t, const char *, int)                                                                          \
+	X("ocre_sensors_read_by_name", ocre_sensors_read_by_name, "($i)F", double, wasm_exec_env_t, const char *, int) \
+	X("ocre_sensors_get_list", ocre_sensors_get_list, "($i)i", int, wasm_exec_env_t, char **, int)
+#else
+#define OCRE_API_SENSOR_NATIVES(X)
 #endif
+
 // Timer API
 #ifdef CONFIG_OCRE_TIMER
-	{"ocre_timer_create", ocre_timer_create, "(i)i", NULL},
-	{"ocre_timer_start", ocre_timer_start, "(iii)i", NULL},
-	{"ocre_timer_stop", ocre_timer_stop, "(i)i", NULL},
-	{"ocre_timer_delete", ocre_timer_delete, "(i)i", NULL},
-	{"ocre_timer_get_remaining", ocre_timer_get_remaining, "(i)i", NULL},
+#define OCRE_API_TIMER_NATIVES(X)                                                                                      \
+	X("ocre_timer_create", ocre_timer_create, "(i)i", int, wasm_exec_env_t, int)                                   \
+	X("ocre_timer_start", ocre_timer_start, "(iii)i", int, wasm_exec_env_t, ocre_timer_t, int, int)                \
+	X("ocre_timer_stop", ocre_timer_stop, "(i)i", int, wasm_exec_env_t, ocre_timer_t)                              \
+	X("ocre_timer_delete", ocre_timer_delete, "(i)i", int, wasm_exec_env_t, ocre_timer_t)                          \
+	X("ocre_timer_get_remaining", ocre_timer_get_remaining, "(i)i", int, wasm_exec_env_t, ocre_timer_t)
+#else
+#define OCRE_API_TIMER_NATIVES(X)
 #endif
+
 // GPIO API
 #ifdef CONFIG_OCRE_GPIO
-	{"ocre_gpio_init", ocre_gpio_wasm_init, "()i", NULL},
-	{"ocre_gpio_configure", ocre_gpio_wasm_configure, "(iii)i", NULL},
-	{"ocre_gpio_pin_set", ocre_gpio_wasm_set, "(iii)i", NULL},
-	{"ocre_gpio_pin_get", ocre_gpio_wasm_get, "(ii)i", NULL},
-	{"ocre_gpio_pin_toggle", ocre_gpio_wasm_toggle, "(ii)i", NULL},
-	{"ocre_gpio_register_callback", ocre_gpio_wasm_register_callback, "(ii)i", NULL},
-	{"ocre_gpio_unregister_callback", ocre_gpio_wasm_unregister_callback, "(ii)i", NULL},
-
-	{"ocre_gpio_configure_by_name", ocre_gpio_wasm_configure_by_name, "($i)i", NULL},
-	{"ocre_gpio_set_by_name", ocre_gpio_wasm_set_by_name, "($i)i", NULL},
-	{"ocre_gpio_get_by_name", ocre_gpio_wasm_get_by_name, "($)i", NULL},
-	{"ocre_gpio_toggle_by_name", ocre_gpio_wasm_toggle_by_name, "($)i", NULL},
-	{"ocre_gpio_register_callback_by_name", ocre_gpio_wasm_register_callback_by_name, "($)i", NULL},
-	{"ocre_gpio_unregister_callback_by_name", ocre_gpio_wasm_unregister_callback_by_name, "($)i", NULL},
+#define OCRE_API_GPIO_NATIVES(X)                                                                                       \
+	X("ocre_gpio_init", ocre_gpio_wasm_init, "()i", int, wasm_exec_env_t)                                          \
+	X("ocre_gpio_configure", ocre_gpio_wasm_configure, "(iii)i", int, wasm_exec_env_t, int, int, int)              \
+	X("ocre_gpio_pin_set", ocre_gpio_wasm_set, "(iii)i", int, wasm_exec_env_t, int, int, int)                      \
+	X("ocre_gpio_pin_get", ocre_gpio_wasm_get, "(ii)i", int, wasm_exec_env_t, int, int)                            \
+	X("ocre_gpio_pin_toggle", ocre_gpio_wasm_toggle, "(ii)i", int, wasm_exec_env_t, int, int)                      \
+	X("ocre_gpio_register_callback", ocre_gpio_wasm_register_callback, "(ii)i", int, wasm_exec_env_t, int, int)    \
+	X("ocre_gpio_unregister_callback", ocre_gpio_wasm_unregister_callback, "(ii)i", int, wasm_exec_env_t, int,     \
+	  int)                                                                                                         \
+	X("ocre_gpio_configure_by_name", ocre_gpio_wasm_configure_by_name, "($i)i", int, wasm_exec_env_t,              \
+	  const char *, int)                                                                                           \
+	X("ocre_gpio_set_by_name", ocre_gpio_wasm_set_by_name, "($i)i", int, wasm_exec_env_t, const char *, int)       \
+	X("ocre_gpio_get_by_name", ocre_gpio_wasm_get_by_name, "($)i", int, wasm_exec_env_t, const char *)             \
+	X("ocre_gpio_toggle_by_name", ocre_gpio_wasm_toggle_by_name, "($)i", int, wasm_exec_env_t, const char *)       \
+	X("ocre_gpio_register_callback_by_name", ocre_gpio_wasm_register_callback_by_name, "($)i", int,                \
+	  wasm_exec_env_t, const char *)                                                                               \
+	X("ocre_gpio_unregister_callback_by_name", ocre_gpio_wasm_unregister_callback_by_name, "($)i", int,            \
+	  wasm_exec_env_t, const char *)
+#else
+#define OCRE_API_GPIO_NATIVES(X)
 #endif
+
+#define OCRE_API_NATIVES(X)                                                                                            \
+	OCRE_API_BASE_NATIVES(X)                                                                                       \
+	OCRE_API_EVENT_NATIVES(X)                                                                                      \
+	OCRE_API_MESSAGING_NATIVES(X)                                                                                  \
+	OCRE_API_SENSOR_NATIVES(X)                                                                                     \
+	OCRE_API_TIMER_NATIVES(X)                                                                                      \
+	OCRE_API_GPIO_NATIVES(X)
+
+#if defined(CONFIG_OCRE_TRACE) || defined(CONFIG_OCRE_API_PROFILING)
+
+/* Parameter and argument lists of the wrappers, from the parameter types */
+
+#define OCRE_API_NARGS(...)			  OCRE_API_NTH(__VA_ARGS__, 7, 6, 5, 4, 3, 2, 1, 0)
+#define OCRE_API_NTH(a, b, c, d, e, f, g, n, ...) n
+#define OCRE_API_CONCAT(a, b)			  OCRE_API_CONCAT_(a, b)
+#define OCRE_API_CONCAT_(a, b)			  a##b
+
+#define OCRE_API_PARAMS(...)			  OCRE_API_CONCAT(OCRE_API_P, OCRE_API_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define OCRE_API_P1(t1)				  t1 a1
+#define OCRE_API_P2(t1, t2)			  t1 a1, t2 a2
+#define OCRE_API_P3(t1, t2, t3)			  t1 a1, t2 a2, t3 a3
+#define OCRE_API_P4(t1, t2, t3, t4)		  t1 a1, t2 a2, t3 a3, t4 a4
+#define OCRE_API_P5(t1, t2, t3, t4, t5)		  t1 a1, t2 a2, t3 a3, t4 a4, t5 a5
+#define OCRE_API_P6(t1, t2, t3, t4, t5, t6)	  t1 a1, t2 a2, t3 a3, t4 a4, t5 a5, t6 a6
+#define OCRE_API_P7(t1, t2, t3, t4, t5, t6, t7)	  t1 a1, t2 a2, t3 a3, t4 a4, t5 a5, t6 a6, t7 a7
+
+#define OCRE_API_ARGS(...)			  OCRE_API_CONCAT(OCRE_API_A, OCRE_API_NARGS(__VA_ARGS__))
+#define OCRE_API_A1				  a1
+#define OCRE_API_A2				  a1, a2
+#define OCRE_API_A3				  a1, a2, a3
+#define OCRE_API_A4				  a1, a2, a3, a4
+#define OCRE_API_A5				  a1, a2, a3, a4, a5
+#define OCRE_API_A6				  a1, a2, a3, a4, a5, a6
+#define OCRE_API_A7				  a1, a2, a3, a4, a5, a6, a7
+
+#ifdef CONFIG_OCRE_API_PROFILING
+
+/* Indexes of the natives in the table */
+
+#define OCRE_API_INDEX(name, func, ...) OCRE_API_INDEX_##func,
+
+enum {
+	OCRE_API_NATIVES(OCRE_API_INDEX)
 };
 
+static void profile_native(wasm_exec_env_t exec_env, int index, uint64_t cycles)
+{
+	wasm_module_inst_t module_inst = wasm_runtime_get_module_inst(exec_env);
+	if (!module_inst) {
+		return;
+	}
+
+	/* Modules without the Ocre API capability have no context and are not profiled */
+
+	ocre_module_context_t *ctx = wasm_runtime_get_custom_data(module_inst);
+	if (!ctx || !ctx->profile) {
+		return;
+	}
+
+	/* Only the thread running the module updates its counters, so there is no need for atomic additions */
+
+	struct ocre_api_profile *profile = &ctx->profile[index];
+
+	atomic_store_explicit(&profile->calls, atomic_load_explicit(&profile->calls, memory_order_relaxed) + 1,
+			      memory_order_relaxed);
+	atomic_store_explicit(&profile->cycles, atomic_load_explicit(&profile->cycles, memory_order_relaxed) + cycles,
+			      memory_order_relaxed);
+}
+
+#define OCRE_API_PROFILE_BEGIN(start) uint64_t start = core_cycles()
+#define OCRE_API_PROFILE_END(exec_env, func, start)                                                                    \
+	profile_native(exec_env, OCRE_API_INDEX_##func, core_cycles() - start)
+#else
+#define OCRE_API_PROFILE_BEGIN(start)                                                                                  \
+	do {                                                                                                           \
+	} while (0)
+#define OCRE_API_PROFILE_END(exec_env, func, start)                                                                    \
+	do {                                                                                                           \
+	} while (0)
+#endif
+
+/* The first parameter of every native is the execution environment */
+
+#define OCRE_API_WRAPPER(name, func, signature, ret, ...)                                                              \
+	static ret wrapped_##func(OCRE_API_PARAMS(__VA_ARGS__))                                                        \
+	{                                                                                                              \
+		OCRE_TRACE_BEGIN(span, "api", name);                                                                   \
+		OCRE_API_PROFILE_BEGIN(start);                                                                         \
+		ret result = func(OCRE_API_ARGS(__VA_ARGS__));                                                         \
+		OCRE_API_PROFILE_END(a1, func, start);                                                                 \
+		OCRE_TRACE_END(span);                                                                                  \
+		return result;                                                                                         \
+	}
+
+OCRE_API_NATIVES(OCRE_API_WRAPPER)
+
+#define OCRE_API_SYMBOL(name, func, signature, ...) {name, wrapped_##func, signature, NULL},
+#else
+#define OCRE_API_SYMBOL(name, func, signature, ...) {name, func, signature, NULL},
+#endif
+
+// Ocre Runtime API
+NativeSymbol ocre_api_table[] = {OCRE_API_NATIVES(OCRE_API_SYMBOL)};
+
 int ocre_api_table_size = sizeof(ocre_api_table) / sizeof(NativeSymbol);
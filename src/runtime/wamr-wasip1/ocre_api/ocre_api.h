@@ -29,4 +29,19 @@ int _ocre_posix_uname(wasm_exec_env_t exec_env, struct _ocre_posix_utsname *name
 
 extern NativeSymbol ocre_api_table[];
 extern int ocre_api_table_size;
+
+#ifdef CONFIG_OCRE_API_PROFILING
+#include <stdatomic.h>
+
+/**
+ * @brief Call counters of one native of the Ocre API, for one module instance.
+ *
+ * Profiles are arrays of ocre_api_table_size entries, in the order of ocre_api_table. Only the thread running the
+ * module updates them, readers can load them at any time.
+ */
+struct ocre_api_profile {
+	atomic_uint_least64_t calls;  ///< Number of calls
+	atomic_uint_least64_t cycles; ///< Time spent in the native, in core_cycles() units
+};
+#endif
 #endif
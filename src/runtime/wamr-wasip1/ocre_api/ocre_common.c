@@ -13,6 +13,8 @@
 #include <string.h>
 #include <inttypes.h>
 
+#include <ocre/metrics.h>
+#include <ocre/trace.h>
 #include <ocre/platform/log.h>
 
 #include "core/core_external.h"
@@ -77,6 +79,113 @@ static void event_thread_fn(void *arg1)
 }
 #endif
 
+/* Modules with a private event queue. Protected by ocre_event_queue_lock */
+static ocre_module_context_t *private_queues;
+
+/* Called with ocre_event_queue_lock held. Only compares the owner, as it may already be gone */
+
+static ocre_module_context_t *find_private_queue(wasm_module_inst_t owner)
+{
+	for (ocre_module_context_t *ctx = private_queues; ctx; ctx = ctx->next) {
+		if (ctx->inst == owner) {
+			return ctx;
+		}
+	}
+
+	return NULL;
+}
+
+int ocre_event_get_fields(const ocre_event_t *event, uint32_t fields[OCRE_EVENT_FIELDS])
+{
+	memset(fields, 0, sizeof(uint32_t) * OCRE_EVENT_FIELDS);
+	fields[0] = event->type;
+
+	switch (event->type) {
+		case OCRE_RESOURCE_TYPE_TIMER: {
+			LOG_DBG("Retrieved Timer event timer_id=%u, owner=%p", event->data.timer_event.timer_id,
+				(void *)event->owner);
+			fields[1] = event->data.timer_event.timer_id;
+			break;
+		}
+		case OCRE_RESOURCE_TYPE_GPIO: {
+			LOG_DBG("Retrieved Gpio event pin_id=%u, port=%u, state=%u, owner=%p",
+				event->data.gpio_event.pin_id, event->data.gpio_event.port,
+				event->data.gpio_event.state, (void *)event->owner);
+			fields[1] = event->data.gpio_event.pin_id;
+			fields[2] = event->data.gpio_event.port;
+			fields[3] = event->data.gpio_event.state;
+			break;
+		}
+		case OCRE_RESOURCE_TYPE_SENSOR: {
+			// Not used as we don't use callbacks in sensor API yet
+			break;
+		}
+		case OCRE_RESOURCE_TYPE_MESSAGING: {
+			LOG_DBG("Retrieved Messaging event: message_id=%" PRIu32 ", topic=%s, "
+				"topic_offset=%" PRIu32 ", content_type=%s, "
+				"content_type_offset=%" PRIu32 ", payload_len=%" PRIu32 ", owner=%p",
+				event->data.messaging_event.message_id, event->data.messaging_event.topic,
+				event->data.messaging_event.topic_offset, event->data.messaging_event.content_type,
+				event->data.messaging_event.content_type_offset,
+				event->data.messaging_event.payload_len, (void *)event->owner);
+			fields[1] = event->data.messaging_event.message_id;
+			fields[2] = event->data.messaging_event.topic_offset;
+			fields[3] = event->data.messaging_event.content_type_offset;
+			fields[4] = event->data.messaging_event.payload_offset;
+			fields[5] = event->data.messaging_event.payload_len;
+			break;
+		}
+		case OCRE_RESOURCE_TYPE_LIFECYCLE: {
+			LOG_DBG("Retrieved Lifecycle event=%" PRIu32 ", owner=%p", event->data.lifecycle_event.event,
+				(void *)event->owner);
+			fields[1] = event->data.lifecycle_event.event;
+			break;
+		}
+		/*
+		    =================================
+		    Place to add more resource types
+		    =================================
+		*/
+		default: {
+			LOG_ERR("Invalid event type: %" PRIu32, event->type);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* Takes the next event of a module out of its queue */
+
+static int dequeue_event(wasm_module_inst_t module_inst, ocre_event_t *event)
+{
+	int ret;
+
+	/* Generic event queue implementation for both platforms */
+	core_spinlock_key_t key = core_spinlock_lock(&ocre_event_queue_lock);
+
+	ocre_module_context_t *ctx = find_private_queue(module_inst);
+	if (ctx) {
+		ret = core_eventq_get(ctx->events, event);
+		if (ret != 0) {
+			ret = -ENOMSG;
+		}
+	} else {
+		ret = core_eventq_peek(&ocre_event_queue, event);
+		if (ret != 0) {
+			ret = -ENOMSG;
+		} else if (event->owner != module_inst) {
+			ret = -EPERM;
+		} else if (core_eventq_get(&ocre_event_queue, event) != 0) {
+			ret = -ENOENT;
+		}
+	}
+
+	core_spinlock_unlock(&ocre_event_queue_lock, key);
+
+	return ret;
+}
+
 int ocre_get_event(wasm_exec_env_t exec_env, uint32_t type_offset, uint32_t id_offset, uint32_t port_offset,
 		   uint32_t state_offset, uint32_t extra_offset, uint32_t payload_len_offset)
 {
@@ -99,85 +208,142 @@ int ocre_get_event(wasm_exec_env_t exec_env, uint32_t type_offset, uint32_t id_o
 	}
 
 	ocre_event_t event;
+
+	OCRE_TRACE_BEGIN(dequeue_span, "event", "dequeue");
+
+	int ret = dequeue_event(module_inst, &event);
+
+	OCRE_TRACE_END(dequeue_span);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	// Send event correctly to WASM
+	uint32_t fields[OCRE_EVENT_FIELDS];
+	ret = ocre_event_get_fields(&event, fields);
+	if (ret != 0) {
+		return ret;
+	}
+
+	/* Sensor events are not delivered yet */
+
+	if (event.type == OCRE_RESOURCE_TYPE_SENSOR) {
+		return 0;
+	}
+
+	ocre_metric_inc(OCRE_METRIC_EVENTS_DELIVERED_TOTAL);
+
+	*type_native = fields[0];
+	*id_native = fields[1];
+	*port_native = fields[2];
+	*state_native = fields[3];
+	*extra_native = fields[4];
+	*payload_len_native = fields[5];
+
+	return 0;
+}
+
+int ocre_post_event(const ocre_event_t *event)
+{
 	int ret;
 
-	/* Generic event queue implementation for both platforms */
+	OCRE_TRACE_BEGIN(enqueue_span, "event", "enqueue");
+
 	core_spinlock_key_t key = core_spinlock_lock(&ocre_event_queue_lock);
-	ret = core_eventq_peek(&ocre_event_queue, &event);
-	if (ret != 0) {
-		core_spinlock_unlock(&ocre_event_queue_lock, key);
-		return -ENOMSG;
+
+	ocre_module_context_t *ctx = find_private_queue(event->owner);
+	if (ctx) {
+		ret = core_eventq_put(ctx->events, event);
+		if (ret == 0) {
+			ctx->notify(ctx->notify_arg);
+		}
+	} else {
+		ret = core_eventq_put(&ocre_event_queue, event);
 	}
 
-	if (event.owner != module_inst) {
-		core_spinlock_unlock(&ocre_event_queue_lock, key);
-		return -EPERM;
+	core_spinlock_unlock(&ocre_event_queue_lock, key);
+
+	OCRE_TRACE_END(enqueue_span);
+
+	ocre_metric_inc(ret == 0 ? OCRE_METRIC_EVENTS_ENQUEUED_TOTAL : OCRE_METRIC_EVENTS_DROPPED_TOTAL);
+
+	return ret;
+}
+
+int ocre_module_set_event_queue(ocre_module_context_t *ctx, ocre_event_notify_t notify, void *arg)
+{
+	if (!ctx || !notify || ctx->events) {
+		return -EINVAL;
 	}
 
-	ret = core_eventq_get(&ocre_event_queue, &event);
+	core_eventq_t *events = malloc(sizeof(core_eventq_t));
+	if (!events) {
+		return -ENOMEM;
+	}
+
+	int ret = core_eventq_init(events, sizeof(ocre_event_t), SIZE_OCRE_EVENT_BUFFER);
 	if (ret != 0) {
-		core_spinlock_unlock(&ocre_event_queue_lock, key);
-		return -ENOENT;
+		free(events);
+		return ret;
 	}
 
-	// Send event correctly to WASM
-	switch (event.type) {
-		case OCRE_RESOURCE_TYPE_TIMER: {
-			LOG_DBG("Retrieved Timer event timer_id=%u, owner=%p", event.data.timer_event.timer_id,
-				(void *)event.owner);
-			*type_native = event.type;
-			*id_native = event.data.timer_event.timer_id;
-			*port_native = 0;
-			*state_native = 0;
-			*extra_native = 0;
-			*payload_len_native = 0;
-			break;
-		}
-		case OCRE_RESOURCE_TYPE_GPIO: {
-			LOG_DBG("Retrieved Gpio event pin_id=%u, port=%u, state=%u, owner=%p",
-				event.data.gpio_event.pin_id, event.data.gpio_event.port, event.data.gpio_event.state,
-				(void *)event.owner);
-			*type_native = event.type;
-			*id_native = event.data.gpio_event.pin_id;
-			*port_native = event.data.gpio_event.port;
-			*state_native = event.data.gpio_event.state;
-			*extra_native = 0;
-			*payload_len_native = 0;
-			break;
-		}
-		case OCRE_RESOURCE_TYPE_SENSOR: {
-			// Not used as we don't use callbacks in sensor API yet
-			break;
-		}
-		case OCRE_RESOURCE_TYPE_MESSAGING: {
-			LOG_DBG("Retrieved Messaging event: message_id=%" PRIu32 ", topic=%s, "
-				"topic_offset=%" PRIu32 ", content_type=%s, "
-				"content_type_offset=%" PRIu32 ", payload_len=%" PRIu32 ", owner=%p",
-				event.data.messaging_event.message_id, event.data.messaging_event.topic,
-				event.data.messaging_event.topic_offset, event.data.messaging_event.content_type,
-				event.data.messaging_event.content_type_offset, event.data.messaging_event.payload_len,
-				(void *)event.owner);
-			*type_native = event.type;
-			*id_native = event.data.messaging_event.message_id;
-			*port_native = event.data.messaging_event.topic_offset;
-			*state_native = event.data.messaging_event.content_type_offset;
-			*extra_native = event.data.messaging_event.payload_offset;
-			*payload_len_native = event.data.messaging_event.payload_len;
+	core_spinlock_key_t key = core_spinlock_lock(&ocre_event_queue_lock);
+
+	ctx->events = events;
+	ctx->notify = notify;
+	ctx->notify_arg = arg;
+	ctx->next = private_queues;
+	private_queues = ctx;
+
+	core_spinlock_unlock(&ocre_event_queue_lock, key);
+
+	return 0;
+}
+
+int ocre_module_get_event(ocre_module_context_t *ctx, ocre_event_t *event)
+{
+	if (!ctx || !ctx->events) {
+		return -EINVAL;
+	}
+
+	OCRE_TRACE_BEGIN(dequeue_span, "event", "dequeue");
+
+	core_spinlock_key_t key = core_spinlock_lock(&ocre_event_queue_lock);
+	int ret = core_eventq_get(ctx->events, event);
+	core_spinlock_unlock(&ocre_event_queue_lock, key);
+
+	OCRE_TRACE_END(dequeue_span);
+
+	if (ret == 0) {
+		ocre_metric_inc(OCRE_METRIC_EVENTS_DELIVERED_TOTAL);
+	}
+
+	return ret;
+}
+
+/* Stop routing events to the private queue of a module and release it */
+
+static void ocre_release_event_queue(ocre_module_context_t *ctx)
+{
+	if (!ctx->events) {
+		return;
+	}
+
+	core_spinlock_key_t key = core_spinlock_lock(&ocre_event_queue_lock);
+
+	for (ocre_module_context_t **p = &private_queues; *p; p = &(*p)->next) {
+		if (*p == ctx) {
+			*p = ctx->next;
 			break;
 		}
-		/*
-		    =================================
-		    Place to add more resource types
-		    =================================
-		*/
-		default: {
-			core_spinlock_unlock(&ocre_event_queue_lock, key);
-			LOG_ERR("Invalid event type: %" PRIu32, event.type);
-			return -EINVAL;
-		}
 	}
+
 	core_spinlock_unlock(&ocre_event_queue_lock, key);
-	return 0;
+
+	core_eventq_destroy(ctx->events);
+	free(ctx->events);
+	ctx->events = NULL;
 }
 
 int ocre_common_init(void)
@@ -274,11 +440,47 @@ ocre_module_context_t *ocre_register_module(wasm_module_inst_t module_inst)
 	ctx->last_activity = core_uptime_get();
 	memset(ctx->resource_count, 0, sizeof(ctx->resource_count));
 	memset(ctx->dispatchers, 0, sizeof(ctx->dispatchers));
+	memset(ctx->dispatcher_names, 0, sizeof(ctx->dispatcher_names));
+	ctx->events = NULL;
+	ctx->notify = NULL;
+	ctx->notify_arg = NULL;
+	ctx->next = NULL;
 
 	LOG_INF("Module registered: %p", (void *)module_inst);
 	return ctx;
 }
 
+/* Drop the events still queued for a module, they would otherwise block the queue for every other module */
+
+static void ocre_purge_module_events(wasm_module_inst_t module_inst)
+{
+	ocre_event_t events[SIZE_OCRE_EVENT_BUFFER];
+	size_t count = 0;
+	size_t purged = 0;
+
+	core_spinlock_key_t key = core_spinlock_lock(&ocre_event_queue_lock);
+
+	while (count < SIZE_OCRE_EVENT_BUFFER && core_eventq_get(&ocre_event_queue, &events[count]) == 0) {
+		if (events[count].owner == module_inst) {
+			purged++;
+			continue;
+		}
+
+		count++;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		core_eventq_put(&ocre_event_queue, &events[i]);
+	}
+
+	core_spinlock_unlock(&ocre_event_queue_lock, key);
+
+	if (purged) {
+		LOG_INF("Purged %zu pending events of module %p", purged, (void *)module_inst);
+		ocre_metric_add(OCRE_METRIC_EVENTS_DROPPED_TOTAL, purged);
+	}
+}
+
 void ocre_unregister_module(wasm_module_inst_t module_inst)
 {
 	if (!module_inst) {
@@ -288,7 +490,13 @@ void ocre_unregister_module(wasm_module_inst_t module_inst)
 
 	ocre_cleanup_module_resources(module_inst);
 
+	ocre_purge_module_events(module_inst);
+
 	ocre_module_context_t *ret = (ocre_module_context_t *)wasm_runtime_get_custom_data(module_inst);
+	if (ret) {
+		ocre_release_event_queue(ret);
+	}
+
 	free(ret);
 
 	LOG_INF("Module unregistered: %p", (void *)module_inst);
@@ -335,8 +543,12 @@ int ocre_register_dispatcher(wasm_exec_env_t exec_env, ocre_resource_type_t type
 		LOG_ERR("Function %s not found in module %p", function_name, (void *)module_inst);
 		return -EINVAL;
 	}
+	if (strlen(function_name) >= OCRE_DISPATCHER_NAME_LEN) {
+		LOG_WRN("Dispatcher name %s is too long to be checkpointed", function_name);
+	}
 	core_mutex_lock(&registry_mutex);
 	ctx->dispatchers[type] = func;
+	snprintf(ctx->dispatcher_names[type], OCRE_DISPATCHER_NAME_LEN, "%s", function_name);
 	core_mutex_unlock(&registry_mutex);
 	LOG_INF("Registered dispatcher for type %d: %s", type, function_name);
 	return 0;
@@ -18,6 +18,7 @@
 #define OCRE_EVENT_THREAD_PRIORITY   5
 #define OCRE_WASM_STACK_SIZE	     16384
 #define EVENT_THREAD_POOL_SIZE	     0
+#define OCRE_DISPATCHER_NAME_LEN     64
 
 extern bool common_initialized;
 extern bool ocre_event_queue_initialized;
@@ -36,13 +37,23 @@ typedef enum {
 	OCRE_RESOURCE_TYPE_GPIO,      ///< GPIO resource
 	OCRE_RESOURCE_TYPE_SENSOR,    ///< Sensor resource
 	OCRE_RESOURCE_TYPE_MESSAGING, ///< Messaging resource
+	OCRE_RESOURCE_TYPE_LIFECYCLE, ///< Container lifecycle notifications
 	OCRE_RESOURCE_TYPE_COUNT      ///< Total number of resource types
 } ocre_resource_type_t;
 
+/**
+ * @brief Callback notified when an event is queued in the private queue of a module.
+ *
+ * Called with the event queue lock held, so it must not block nor use the event queue.
+ *
+ * @param arg User argument given to ocre_module_set_event_queue().
+ */
+typedef void (*ocre_event_notify_t)(void *arg);
+
 /**
  * @brief Structure representing the context of an OCRE module.
  */
-typedef struct {
+typedef struct ocre_module_context {
 	wasm_module_inst_t inst; ///< WASM module instance
 	// wasm_exec_env_t exec_env;				    ///< WASM execution
 	// environment
@@ -51,6 +62,15 @@ typedef struct {
 	uint32_t resource_count[OCRE_RESOURCE_TYPE_COUNT];	    ///< Count of resources per type
 	wasm_function_inst_t dispatchers[OCRE_RESOURCE_TYPE_COUNT]; ///< Event dispatchers per resource
 								    ///< type
+	char dispatcher_names[OCRE_RESOURCE_TYPE_COUNT][OCRE_DISPATCHER_NAME_LEN]; ///< Names of the dispatchers, for
+										   ///< checkpoints
+	core_eventq_t *events;					    ///< Private event queue, NULL if shared
+	ocre_event_notify_t notify;				    ///< Called on new private events
+	void *notify_arg;					    ///< Argument of notify
+	struct ocre_module_context *next;			    ///< Next module with a private event queue
+#ifdef CONFIG_OCRE_API_PROFILING
+	struct ocre_api_profile *profile;			    ///< Native call counters, NULL if not profiled
+#endif
 } ocre_module_context_t;
 
 /**
@@ -60,6 +80,13 @@ typedef struct {
  */
 typedef void (*ocre_cleanup_handler_t)(wasm_module_inst_t module_inst);
 
+/**
+ * @brief Lifecycle event: the container is requested to stop.
+ *
+ * The container should clean up and exit. It is killed if it does not exit before the stop deadline.
+ */
+#define OCRE_LIFECYCLE_EVENT_STOP 1
+
 /**
  * @brief Structure representing an OCRE event for dispatching.
  */
@@ -88,6 +115,9 @@ typedef struct {
 			uint32_t payload_offset;      ///< Message payload offset
 			uint32_t payload_len;	      ///< Payload length
 		} messaging_event;		      ///< Messaging event data
+		struct {
+			uint32_t event; ///< Lifecycle event (OCRE_LIFECYCLE_EVENT_*)
+		} lifecycle_event;	///< Lifecycle event data
 						      /*
 							  =============================
 							  Place to add more event data
@@ -203,6 +233,54 @@ wasm_module_inst_t ocre_get_current_module(void);
 int ocre_get_event(wasm_exec_env_t exec_env, uint32_t type_offset, uint32_t id_offset, uint32_t port_offset,
 		   uint32_t state_offset, uint32_t extra_offset, uint32_t payload_len_offset);
 
+/**
+ * @brief Number of values describing an event, as returned by ocre_get_event().
+ */
+#define OCRE_EVENT_FIELDS 6
+
+/**
+ * @brief Get the values describing an event, in the order returned by ocre_get_event().
+ *
+ * These are the type, id, port, state, extra and payload length.
+ *
+ * @param event The event.
+ * @param fields Array to store the values.
+ * @return 0 on success, -EINVAL if the event type is unknown.
+ */
+int ocre_event_get_fields(const ocre_event_t *event, uint32_t fields[OCRE_EVENT_FIELDS]);
+
+/**
+ * @brief Queue an event for its owner module.
+ *
+ * The event goes to the private queue of the owner if it has one, otherwise to the shared queue.
+ *
+ * @param event The event to queue.
+ * @return 0 on success, -ENOMEM if the queue is full.
+ */
+int ocre_post_event(const ocre_event_t *event);
+
+/**
+ * @brief Give a module its own event queue.
+ *
+ * The events of the module are no longer put in the shared queue, and @p notify is called for each new event.
+ * Used for modules whose events are dispatched by the host instead of polled by the module.
+ *
+ * @param ctx The module context.
+ * @param notify Callback notified of new events.
+ * @param arg Argument given to @p notify.
+ * @return 0 on success, negative error code on failure.
+ */
+int ocre_module_set_event_queue(ocre_module_context_t *ctx, ocre_event_notify_t notify, void *arg);
+
+/**
+ * @brief Get and remove the next event from the private queue of a module.
+ *
+ * @param ctx The module context.
+ * @param event Pointer to store the event.
+ * @return 0 on success, -ENOENT if there is no event, -EINVAL if the module has no private queue.
+ */
+int ocre_module_get_event(ocre_module_context_t *ctx, ocre_event_t *event);
+
 void ocre_common_shutdown(void);
 
 #endif /* OCRE_COMMON_H */
@@ -8,6 +8,7 @@
 #include <string.h>
 #include <inttypes.h>
 
+#include <ocre/metrics.h>
 #include <ocre/platform/log.h>
 
 #include "../core/core_external.h"
@@ -82,6 +83,30 @@ void ocre_messaging_cleanup_container(wasm_module_inst_t module_inst)
 	LOG_DBG("Cleaned up messaging resources for module %p", (void *)module_inst);
 }
 
+/* Get the topics of a module, to checkpoint it */
+int ocre_messaging_save(wasm_module_inst_t module_inst, void (*callback)(void *arg, const char *topic), void *arg)
+{
+	int count = 0;
+
+	if (!messaging_system_initialized || !module_inst) {
+		return 0;
+	}
+
+	core_mutex_lock(&messaging_system.mutex);
+
+	for (int i = 0; i < CONFIG_OCRE_MESSAGING_MAX_SUBSCRIPTIONS; i++) {
+		if (messaging_system.subscriptions[i].is_active &&
+		    messaging_system.subscriptions[i].module_inst == module_inst) {
+			callback(arg, messaging_system.subscriptions[i].topic);
+			count++;
+		}
+	}
+
+	core_mutex_unlock(&messaging_system.mutex);
+
+	return count;
+}
+
 /* Subscribe to a topic */
 int ocre_messaging_subscribe(wasm_exec_env_t exec_env, void *topic)
 {
@@ -169,6 +194,8 @@ int ocre_messaging_publish(wasm_exec_env_t exec_env, void *topic, void *content_
 	static uint32_t message_id = 0;
 	bool message_sent = false;
 
+	ocre_metric_inc(OCRE_METRIC_MESSAGES_PUBLISHED_TOTAL);
+
 	core_mutex_lock(&messaging_system.mutex);
 
 	// Find matching subscriptions
@@ -185,9 +212,12 @@ int ocre_messaging_publish(wasm_exec_env_t exec_env, void *topic, void *content_
 			continue; // No prefix match
 		}
 
+		ocre_metric_inc(OCRE_METRIC_MESSAGES_MATCHED_TOTAL);
+
 		wasm_module_inst_t target_module = messaging_system.subscriptions[i].module_inst;
 		if (!target_module) {
 			LOG_ERR("Invalid module instance for subscription %d", i);
+			ocre_metric_inc(OCRE_METRIC_MESSAGES_DROPPED_TOTAL);
 			continue;
 		}
 
@@ -196,6 +226,7 @@ int ocre_messaging_publish(wasm_exec_env_t exec_env, void *topic, void *content_
 			(uint32_t)wasm_runtime_module_dup_data(target_module, (char *)topic, strlen((char *)topic) + 1);
 		if (topic_offset == 0) {
 			LOG_ERR("Failed to allocate WASM memory for topic");
+			ocre_metric_inc(OCRE_METRIC_MESSAGES_DROPPED_TOTAL);
 			continue;
 		}
 
@@ -204,6 +235,7 @@ int ocre_messaging_publish(wasm_exec_env_t exec_env, void *topic, void *content_
 		if (content_offset == 0) {
 			LOG_ERR("Failed to allocate WASM memory for content_type");
 			wasm_runtime_module_free(target_module, topic_offset);
+			ocre_metric_inc(OCRE_METRIC_MESSAGES_DROPPED_TOTAL);
 			continue;
 		}
 
@@ -212,6 +244,7 @@ int ocre_messaging_publish(wasm_exec_env_t exec_env, void *topic, void *content_
 			LOG_ERR("Failed to allocate WASM memory for payload");
 			wasm_runtime_module_free(target_module, topic_offset);
 			wasm_runtime_module_free(target_module, content_offset);
+			ocre_metric_inc(OCRE_METRIC_MESSAGES_DROPPED_TOTAL);
 			continue;
 		}
 
@@ -232,17 +265,16 @@ int ocre_messaging_publish(wasm_exec_env_t exec_env, void *topic, void *content_
 			", topic=%s, content_type=%s, payload_len=%d for module %p",
 			message_id, (char *)topic, (char *)content_type, payload_len, (void *)target_module);
 
-		core_spinlock_key_t key = core_spinlock_lock(&ocre_event_queue_lock);
-		if (core_eventq_put(&ocre_event_queue, &event) != 0) {
+		if (ocre_post_event(&event) != 0) {
 			LOG_ERR("Failed to queue messaging event for message ID %" PRIu32, message_id);
 			wasm_runtime_module_free(target_module, topic_offset);
 			wasm_runtime_module_free(target_module, content_offset);
 			wasm_runtime_module_free(target_module, payload_offset);
+			ocre_metric_inc(OCRE_METRIC_MESSAGES_DROPPED_TOTAL);
 		} else {
 			message_sent = true;
 			LOG_DBG("Queued messaging event for message ID %" PRIu32, message_id);
 		}
-		core_spinlock_unlock(&ocre_event_queue_lock, key);
 	}
 
 	core_mutex_unlock(&messaging_system.mutex);
@@ -57,6 +57,19 @@ int ocre_messaging_subscribe(wasm_exec_env_t exec_env, void *topic);
  */
 void ocre_messaging_cleanup_container(wasm_module_inst_t module_inst);
 
+/**
+ * @brief Get the topics a WASM module is subscribed to.
+ *
+ * Calls @p callback once for each topic. The callback is called with the lock of the messaging system held, so it
+ * must not subscribe nor publish.
+ *
+ * @param module_inst The WASM module instance.
+ * @param callback Called with each topic.
+ * @param arg Argument given to @p callback.
+ * @return The number of topics.
+ */
+int ocre_messaging_save(wasm_module_inst_t module_inst, void (*callback)(void *arg, const char *topic), void *arg);
+
 /**
  * @brief Frees allocated memory for a messaging event in the WASM module.
  *
@@ -12,6 +12,7 @@
 #include <string.h>
 #include <inttypes.h>
 
+#include <ocre/metrics.h>
 #include <ocre/platform/log.h>
 
 #include <wasm_export.h>
@@ -229,6 +230,74 @@ void ocre_timer_cleanup_container(wasm_module_inst_t module_inst)
 	LOG_DBG("Cleaned up timer resources for module %p", (void *)module_inst);
 }
 
+int ocre_timer_save(wasm_module_inst_t module_inst, struct ocre_timer_state *states, size_t max)
+{
+	int count = 0;
+	uint32_t now = core_uptime_get();
+
+	for (int i = 0; i < CONFIG_OCRE_MAX_TIMERS; i++) {
+		const ocre_timer_internal *timer = &timers[i];
+
+		if (!timer->in_use || timer->owner != module_inst) {
+			continue;
+		}
+
+		if ((size_t)count < max) {
+			struct ocre_timer_state *state = &states[count];
+			uint32_t elapsed = now - timer->start_time;
+
+			state->id = timer->id;
+			state->interval = timer->interval;
+			state->periodic = timer->periodic;
+			state->running = timer->running;
+			state->remaining = timer->running && elapsed < timer->interval ? timer->interval - elapsed : 0;
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
+int ocre_timer_restore(wasm_exec_env_t exec_env, const struct ocre_timer_state *state)
+{
+	int ret = ocre_timer_create(exec_env, (int)state->id);
+	if (ret) {
+		return ret;
+	}
+
+	if (!state->running) {
+		return 0;
+	}
+
+	if (!state->interval || state->interval > 65535 || state->remaining > state->interval) {
+		LOG_ERR("Invalid saved state of timer %" PRIu32, state->id);
+		ocre_timer_delete(exec_env, (ocre_timer_t)state->id);
+		return -EINVAL;
+	}
+
+	ocre_timer_internal *timer = &timers[state->id - 1];
+
+	/* Expire after the time that was remaining when saved, then go on with the saved period */
+
+	uint32_t remaining = state->remaining ? state->remaining : 1;
+
+	timer->interval = state->interval;
+	timer->periodic = state->periodic;
+	timer->start_time = core_uptime_get() - (state->interval - remaining);
+	timer->running = 1;
+
+	if (core_timer_start(&timer->timer, (int)remaining, state->periodic ? (int)state->interval : 0) != 0) {
+		LOG_ERR("Failed to start core timer %" PRIu32, state->id);
+		timer->running = 0;
+		ocre_timer_delete(exec_env, (ocre_timer_t)state->id);
+		return -EINVAL;
+	}
+
+	LOG_INF("Restored timer %" PRIu32 " with %" PRIu32 "ms remaining", state->id, remaining);
+	return 0;
+}
+
 /* Unified timer callback using core_timer API */
 static void unified_timer_callback(void *user_data)
 {
@@ -245,12 +314,22 @@ static void unified_timer_callback(void *user_data)
 
 	LOG_DBG("Timer callback for timer %" PRIu32, timer->id);
 
+	ocre_metric_inc(OCRE_METRIC_TIMER_FIRES_TOTAL);
+
 	// For non-periodic timers, mark as not running
 	if (!timer->periodic) {
 		timer->running = 0;
 	} else {
 		// For periodic timers, update start time for next cycle
-		timer->start_time = core_uptime_get();
+		uint32_t now = core_uptime_get();
+		uint32_t elapsed = now - timer->start_time;
+
+		// Periods that went by without a callback were missed
+		if (timer->interval && elapsed >= 2u * timer->interval) {
+			ocre_metric_add(OCRE_METRIC_TIMER_OVERRUNS_TOTAL, elapsed / timer->interval - 1);
+		}
+
+		timer->start_time = now;
 	}
 
 	// Create and queue timer event
@@ -262,11 +341,9 @@ static void unified_timer_callback(void *user_data)
 	LOG_DBG("Creating timer event: type=%d, id=%" PRIu32 ", for owner %p", event.type, timer->id,
 		(void *)timer->owner);
 
-	core_spinlock_key_t key = core_spinlock_lock(&ocre_event_queue_lock);
-	if (core_eventq_put(&ocre_event_queue, &event) != 0) {
+	if (ocre_post_event(&event) != 0) {
 		LOG_ERR("Failed to queue timer event for timer %" PRIu32, timer->id);
 	} else {
 		LOG_DBG("Queued timer event for timer %" PRIu32, timer->id);
 	}
-	core_spinlock_unlock(&ocre_event_queue_lock, key);
 }
@@ -79,4 +79,35 @@ void ocre_timer_cleanup_container(wasm_module_inst_t module_inst);
 void ocre_timer_init(void);
 
 int ocre_timer_set_callback(wasm_exec_env_t exec_env, const char *callback_name);
+
+/**
+ * @brief State of a timer, as saved in the checkpoint of a container
+ */
+struct ocre_timer_state {
+	uint32_t id;	    ///< Timer identifier
+	uint32_t interval;  ///< Interval in milliseconds
+	uint32_t periodic;  ///< 1 for a periodic timer, 0 for one-shot
+	uint32_t running;   ///< 1 if the timer is started
+	uint32_t remaining; ///< Time until the next expiration in milliseconds
+};
+
+/**
+ * @brief Gets the state of the timers of a WASM module instance
+ *
+ * Works like snprintf(): at most max states are written, and the number of timers is returned.
+ *
+ * @param module_inst WASM module instance
+ * @param states Array to fill, can be NULL if max is zero
+ * @param max Number of entries of the array
+ * @return The number of timers of the module instance
+ */
+int ocre_timer_save(wasm_module_inst_t module_inst, struct ocre_timer_state *states, size_t max);
+
+/**
+ * @brief Creates a timer from its saved state, and starts it if it was running
+ * @param exec_env WASM execution environment
+ * @param state Saved state of the timer
+ * @return 0 on success, negative error number on failure
+ */
+int ocre_timer_restore(wasm_exec_env_t exec_env, const struct ocre_timer_state *state);
 #endif /* OCRE_TIMER_H */
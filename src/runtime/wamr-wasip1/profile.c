@@ -0,0 +1,410 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
+
+#include "profile.h"
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+
+LOG_MODULE_REGISTER(wamr_profile, CONFIG_OCRE_LOG_LEVEL);
+
+/* WAMR has no API returning its profiling data, it only prints it. We capture what it prints and parse it. */
+
+struct capture {
+	char *buf;
+	size_t len;
+	size_t size;
+	bool failed;
+};
+
+static __thread struct capture *current_capture;
+
+static int capture_append(struct capture *capture, const char *format, va_list ap)
+{
+	va_list copy;
+
+	va_copy(copy, ap);
+	int len = vsnprintf(capture->buf + capture->len, capture->size - capture->len, format, copy);
+	va_end(copy);
+
+	if (len < 0) {
+		return len;
+	}
+
+	if ((size_t)len >= capture->size - capture->len) {
+		size_t new_size = (capture->len + len + 1) * 2;
+
+		char *new_buf = realloc(capture->buf, new_size);
+		if (!new_buf) {
+			capture->failed = true;
+			return len;
+		}
+
+		capture->buf = new_buf;
+		capture->size = new_size;
+
+		vsnprintf(capture->buf + capture->len, capture->size - capture->len, format, ap);
+	}
+
+	capture->len += len;
+
+	return len;
+}
+
+int wamr_profile_vprintf(const char *format, va_list ap)
+{
+	struct capture *capture = current_capture;
+
+	if (!capture) {
+		return vprintf(format, ap);
+	}
+
+	return capture_append(capture, format, ap);
+}
+
+static int capture_begin(struct capture *capture)
+{
+	capture->size = 1024;
+	capture->len = 0;
+	capture->failed = false;
+
+	capture->buf = malloc(capture->size);
+	if (!capture->buf) {
+		return -1;
+	}
+
+	capture->buf[0] = '\0';
+
+	current_capture = capture;
+
+	return 0;
+}
+
+static int capture_end(struct capture *capture)
+{
+	current_capture = NULL;
+
+	if (capture->failed) {
+		LOG_ERR("Failed to allocate memory for the profiling data");
+		free(capture->buf);
+		capture->buf = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* WAMR prints a line per function, in the order of the function index space:
+ *   func <name or index>, execution time: <ms> ms, execution count: <n> times, children execution time: <ms> ms
+ */
+
+static int parse_func(struct wamr_profile_func *func, const char *line, size_t index)
+{
+	char *name = malloc(strlen(line) + 1);
+	if (!name) {
+		return -1;
+	}
+
+	func->children_ms = 0;
+
+	int n = sscanf(line,
+		       " func %[^,], execution time: %lf ms, execution count: %" SCNu32
+		       " times, children execution time: %lf ms",
+		       name, &func->total_ms, &func->calls, &func->children_ms);
+	if (n < 3) {
+		free(name);
+		return 1;
+	}
+
+	/* Functions without a name are printed by index */
+
+	if (strspn(name, "0123456789") == strlen(name)) {
+		snprintf(name, strlen(line) + 1, "func[%zu]", index);
+	}
+
+	func->name = name;
+
+	return 0;
+}
+
+static int parse_perf(struct wamr_profile *profile, char *text)
+{
+	size_t nr_lines = 1;
+
+	for (const char *p = text; *p; p++) {
+		if (*p == '\n') {
+			nr_lines++;
+		}
+	}
+
+	profile->funcs = calloc(nr_lines, sizeof(struct wamr_profile_func));
+	if (!profile->funcs) {
+		return -1;
+	}
+
+	for (char *line = text; line && *line;) {
+		char *next = strchr(line, '\n');
+		if (next) {
+			*next++ = '\0';
+		}
+
+		int rc = parse_func(&profile->funcs[profile->nr_funcs], line, profile->nr_funcs);
+		if (rc < 0) {
+			return -1;
+		}
+
+		if (!rc) {
+			profile->nr_funcs++;
+		}
+
+		line = next;
+	}
+
+	return 0;
+}
+
+int wamr_profile_collect(struct wamr_profile *profile, wasm_module_inst_t module_inst, wasm_exec_env_t exec_env)
+{
+	struct capture capture;
+
+	memset(profile, 0, sizeof(*profile));
+
+	if (capture_begin(&capture)) {
+		return -1;
+	}
+
+	wasm_runtime_dump_perf_profiling(module_inst);
+
+	if (capture_end(&capture)) {
+		return -1;
+	}
+
+	int rc = parse_perf(profile, capture.buf);
+
+	free(capture.buf);
+
+	if (rc) {
+		LOG_ERR("Failed to allocate memory for the function statistics");
+		goto error;
+	}
+
+	if (exec_env) {
+		if (capture_begin(&capture)) {
+			goto error;
+		}
+
+		wasm_runtime_dump_mem_consumption(exec_env);
+
+		if (capture_end(&capture)) {
+			goto error;
+		}
+
+		profile->memory = capture.buf;
+	}
+
+	return 0;
+
+error:
+	wamr_profile_free(profile);
+
+	return -1;
+}
+
+void wamr_profile_free(struct wamr_profile *profile)
+{
+	for (size_t i = 0; i < profile->nr_funcs; i++) {
+		free(profile->funcs[i].name);
+	}
+
+	free(profile->funcs);
+	free(profile->memory);
+
+	memset(profile, 0, sizeof(*profile));
+}
+
+/* Report */
+
+struct writer {
+	char *buf;
+	size_t size;
+	size_t len;
+};
+
+static void writef(struct writer *writer, const char *format, ...)
+{
+	va_list ap;
+	char *buf = NULL;
+	size_t size = 0;
+
+	if (writer->len < writer->size) {
+		buf = writer->buf + writer->len;
+		size = writer->size - writer->len;
+	}
+
+	va_start(ap, format);
+	int len = vsnprintf(buf, size, format, ap);
+	va_end(ap);
+
+	if (len > 0) {
+		writer->len += len;
+	}
+}
+
+static double self_ms(const struct wamr_profile_func *func)
+{
+	double self = func->total_ms - func->children_ms;
+
+	return self > 0 ? self : 0;
+}
+
+static int compare_self(const void *a, const void *b)
+{
+	double self_a = self_ms(*(const struct wamr_profile_func *const *)a);
+	double self_b = self_ms(*(const struct wamr_profile_func *const *)b);
+
+	if (self_a != self_b) {
+		return self_a < self_b ? 1 : -1;
+	}
+
+	return 0;
+}
+
+int wamr_profile_format(const struct wamr_profile *profile, char *buf, size_t size)
+{
+	struct writer writer = {buf, size, 0};
+
+	if (size) {
+		buf[0] = '\0';
+	}
+
+	const struct wamr_profile_func **funcs = malloc((profile->nr_funcs + 1) * sizeof(*funcs));
+	if (!funcs) {
+		return -1;
+	}
+
+	size_t nr_called = 0;
+	for (size_t i = 0; i < profile->nr_funcs; i++) {
+		if (profile->funcs[i].calls) {
+			funcs[nr_called++] = &profile->funcs[i];
+		}
+	}
+
+	qsort(funcs, nr_called, sizeof(*funcs), compare_self);
+
+	writef(&writer, "FUNCTION\tCALLS\tTOTAL (ms)\tSELF (ms)\n");
+
+	for (size_t i = 0; i < nr_called; i++) {
+		writef(&writer, "%s\t%" PRIu32 "\t%.3f\t%.3f\n", funcs[i]->name, funcs[i]->calls, funcs[i]->total_ms,
+		       self_ms(funcs[i]));
+	}
+
+	if (profile->memory) {
+		writef(&writer, "\n%s", profile->memory);
+	}
+
+	free(funcs);
+
+	return (int)writer.len;
+}
+
+/* Sampling */
+
+static const char *func_name(const struct wamr_profile *profile, uint32_t index)
+{
+	return index < profile->nr_funcs ? profile->funcs[index].name : "[unknown]";
+}
+
+int wamr_profile_stacks_add(struct wamr_profile_stacks *stacks, const struct wamr_profile *profile,
+			    const WASMCApiFrame *frames, uint32_t nr_frames)
+{
+	size_t len = 0;
+
+	if (!nr_frames) {
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < nr_frames; i++) {
+		len += strlen(func_name(profile, frames[i].func_index)) + 1;
+	}
+
+	if (stacks->nr_stacks == stacks->size) {
+		size_t new_size = stacks->size ? stacks->size * 2 : 256;
+
+		char **new_stacks = realloc(stacks->stacks, new_size * sizeof(char *));
+		if (!new_stacks) {
+			return -1;
+		}
+
+		stacks->stacks = new_stacks;
+		stacks->size = new_size;
+	}
+
+	char *stack = malloc(len);
+	if (!stack) {
+		return -1;
+	}
+
+	/* Folded stacks start with the outermost frame */
+
+	char *p = stack;
+	for (uint32_t i = nr_frames; i-- > 0;) {
+		const char *name = func_name(profile, frames[i].func_index);
+		size_t name_len = strlen(name);
+
+		memcpy(p, name, name_len);
+		p += name_len;
+		*p++ = i ? ';' : '\0';
+	}
+
+	stacks->stacks[stacks->nr_stacks++] = stack;
+
+	return 0;
+}
+
+static int compare_stacks(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+void wamr_profile_stacks_fold(struct wamr_profile_stacks *stacks, ocre_stack_callback_t callback, void *arg)
+{
+	qsort(stacks->stacks, stacks->nr_stacks, sizeof(char *), compare_stacks);
+
+	for (size_t i = 0; i < stacks->nr_stacks;) {
+		size_t j = i + 1;
+
+		while (j < stacks->nr_stacks && !strcmp(stacks->stacks[i], stacks->stacks[j])) {
+			j++;
+		}
+
+		callback(arg, stacks->stacks[i], (unsigned int)(j - i));
+
+		i = j;
+	}
+}
+
+void wamr_profile_stacks_free(struct wamr_profile_stacks *stacks)
+{
+	for (size_t i = 0; i < stacks->nr_stacks; i++) {
+		free(stacks->stacks[i]);
+	}
+
+	free(stacks->stacks);
+
+	memset(stacks, 0, sizeof(*stacks));
+}
+
+#endif /* CONFIG_OCRE_WAMR_PROFILING */
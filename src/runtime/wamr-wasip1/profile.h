@@ -0,0 +1,125 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_WAMR_PROFILE_H
+#define OCRE_WAMR_PROFILE_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ocre/stats.h>
+
+#include <wasm_export.h>
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+
+/* Deepest call stack recorded by the sampler, deeper frames are dropped */
+
+#define WAMR_PROFILE_MAX_FRAMES 64
+
+/**
+ * @brief Execution statistics of a wasm function, as collected by WAMR
+ */
+struct wamr_profile_func {
+	char *name;
+	uint32_t calls;
+	double total_ms;
+	double children_ms;
+};
+
+/**
+ * @brief Snapshot of the WAMR performance and memory profiling data of an instance
+ *
+ * The functions are in the order of the function index space, imports first.
+ */
+struct wamr_profile {
+	struct wamr_profile_func *funcs;
+	size_t nr_funcs;
+	char *memory;
+};
+
+/**
+ * @brief Call stacks recorded by the sampler
+ */
+struct wamr_profile_stacks {
+	char **stacks;
+	size_t nr_stacks;
+	size_t size;
+};
+
+/**
+ * @brief Print hook of WAMR, set with WAMR_BH_VPRINTF
+ *
+ * WAMR only prints its profiling data. The output is captured while collecting a profile on the calling thread, and
+ * goes to stdout otherwise.
+ */
+int wamr_profile_vprintf(const char *format, va_list ap);
+
+/**
+ * @brief Collect the profiling data of an instance
+ *
+ * The instance must not run while its data is collected.
+ *
+ * @param profile Profile to fill, freed with wamr_profile_free()
+ * @param module_inst The instance
+ * @param exec_env Execution environment to report the memory consumption of, NULL to skip it
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int wamr_profile_collect(struct wamr_profile *profile, wasm_module_inst_t module_inst, wasm_exec_env_t exec_env);
+
+/**
+ * @brief Free the data of a profile
+ *
+ * @param profile The profile
+ */
+void wamr_profile_free(struct wamr_profile *profile);
+
+/**
+ * @brief Format a profile as text, like snprintf()
+ *
+ * @param profile The profile
+ * @param buf Buffer to write to, can be NULL if size is zero
+ * @param size Size of the buffer
+ *
+ * @return The length of the report, negative on failure
+ */
+int wamr_profile_format(const struct wamr_profile *profile, char *buf, size_t size);
+
+/**
+ * @brief Record a call stack
+ *
+ * @param stacks Recorded call stacks, freed with wamr_profile_stacks_free()
+ * @param profile Profile naming the functions
+ * @param frames Frames, innermost first, as copied by wasm_copy_callstack()
+ * @param nr_frames Number of frames
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int wamr_profile_stacks_add(struct wamr_profile_stacks *stacks, const struct wamr_profile *profile,
+			    const WASMCApiFrame *frames, uint32_t nr_frames);
+
+/**
+ * @brief Report each distinct recorded call stack with its number of samples
+ *
+ * @param stacks Recorded call stacks
+ * @param callback Called for each distinct call stack
+ * @param arg Argument of the callback
+ */
+void wamr_profile_stacks_fold(struct wamr_profile_stacks *stacks, ocre_stack_callback_t callback, void *arg);
+
+/**
+ * @brief Free the recorded call stacks
+ *
+ * @param stacks Recorded call stacks
+ */
+void wamr_profile_stacks_free(struct wamr_profile_stacks *stacks);
+
+#endif /* CONFIG_OCRE_WAMR_PROFILING */
+
+#endif /* OCRE_WAMR_PROFILE_H */
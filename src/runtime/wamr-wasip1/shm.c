@@ -0,0 +1,169 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ocre/common.h>
+
+#include <ocre/platform/config.h>
+#include <ocre/platform/log.h>
+
+#include <wasm_export.h>
+
+#include "shm.h"
+
+#ifdef CONFIG_OCRE_SHARED_HEAP
+
+LOG_MODULE_REGISTER(wamr_shm, CONFIG_OCRE_LOG_LEVEL);
+
+#define SHM_NAME_MAX 32
+
+struct shm_region {
+	struct shm_region *next;
+	char name[SHM_NAME_MAX];
+	uint32_t size;
+	wasm_shared_heap_t heap;
+};
+
+static pthread_mutex_t regions_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct shm_region *regions;
+
+/* Parses SIZE[k|M], zero if invalid */
+
+static uint32_t parse_size(const char *str)
+{
+	char *end;
+	unsigned long long size = strtoull(str, &end, 10);
+
+	if (end == str || str[0] == '-') {
+		return 0;
+	}
+
+	switch (tolower((unsigned char)*end)) {
+		case 'k':
+			size *= 1024;
+			end++;
+			break;
+		case 'm':
+			size *= 1024 * 1024;
+			end++;
+			break;
+	}
+
+	if (*end || size > UINT32_MAX) {
+		return 0;
+	}
+
+	return (uint32_t)size;
+}
+
+wasm_shared_heap_t wamr_shm_get(const char *spec)
+{
+	char name[SHM_NAME_MAX];
+	uint32_t size = 0;
+	wasm_shared_heap_t heap = NULL;
+
+	const char *colon = strchr(spec, ':');
+	size_t name_len = colon ? (size_t)(colon - spec) : strlen(spec);
+
+	if (name_len >= sizeof(name)) {
+		LOG_ERR("Invalid shared memory region '%s': name too long", spec);
+		return NULL;
+	}
+
+	memcpy(name, spec, name_len);
+	name[name_len] = '\0';
+
+	if (!ocre_is_valid_name(name)) {
+		LOG_ERR("Invalid shared memory region name '%s'", name);
+		return NULL;
+	}
+
+	if (colon) {
+		size = parse_size(colon + 1);
+		if (!size) {
+			LOG_ERR("Invalid size of shared memory region '%s': must be SIZE[k|M]", name);
+			return NULL;
+		}
+	}
+
+	pthread_mutex_lock(&regions_mutex);
+
+	struct shm_region *region;
+	for (region = regions; region; region = region->next) {
+		if (!strcmp(region->name, name)) {
+			break;
+		}
+	}
+
+	if (region) {
+		if (size && size != region->size) {
+			LOG_ERR("Shared memory region '%s' exists with size %u, not %u", name, region->size, size);
+			goto unlock;
+		}
+
+		heap = region->heap;
+		goto unlock;
+	}
+
+	if (!size) {
+		LOG_ERR("Shared memory region '%s' does not exist: the first container naming it must give its size",
+			name);
+		goto unlock;
+	}
+
+	region = calloc(1, sizeof(*region));
+	if (!region) {
+		LOG_ERR("Failed to allocate memory for shared memory region '%s'", name);
+		goto unlock;
+	}
+
+	SharedHeapInitArgs heap_init_args;
+	memset(&heap_init_args, 0, sizeof(heap_init_args));
+	heap_init_args.size = size;
+
+	region->heap = wasm_runtime_create_shared_heap(&heap_init_args);
+	if (!region->heap) {
+		LOG_ERR("Failed to create shared memory region '%s' of %u bytes", name, size);
+		free(region);
+		goto unlock;
+	}
+
+	strcpy(region->name, name);
+	region->size = size;
+	region->next = regions;
+	regions = region;
+
+	LOG_INF("Created shared memory region '%s' of %u bytes", name, size);
+
+	heap = region->heap;
+
+unlock:
+	pthread_mutex_unlock(&regions_mutex);
+
+	return heap;
+}
+
+void wamr_shm_shutdown(void)
+{
+	pthread_mutex_lock(&regions_mutex);
+
+	while (regions) {
+		struct shm_region *region = regions;
+
+		regions = region->next;
+		free(region);
+	}
+
+	pthread_mutex_unlock(&regions_mutex);
+}
+
+#endif /* CONFIG_OCRE_SHARED_HEAP */
@@ -0,0 +1,41 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_WAMR_SHM_H
+#define OCRE_WAMR_SHM_H
+
+#include <ocre/platform/config.h>
+
+#include <wasm_export.h>
+
+#ifdef CONFIG_OCRE_SHARED_HEAP
+
+/**
+ * @brief Get a named shared memory region
+ *
+ * Regions are named by the "ocre:shm=NAME[:SIZE]" capability of the containers attaching to them. The first container
+ * naming a region must give its size, with an optional k or M suffix, and creates it. The next ones attach to the same
+ * region, and must give the same size or none.
+ *
+ * Each region is a shared heap of its own. Regions live until wamr_shm_shutdown().
+ *
+ * @param spec The value of the capability, "NAME[:SIZE]"
+ *
+ * @return The shared heap of the region, or NULL on failure
+ */
+wasm_shared_heap_t wamr_shm_get(const char *spec);
+
+/**
+ * @brief Forget all the regions
+ *
+ * Must be called before the runtime is destroyed, which frees their shared heaps.
+ */
+void wamr_shm_shutdown(void);
+
+#endif /* CONFIG_OCRE_SHARED_HEAP */
+
+#endif /* OCRE_WAMR_SHM_H */
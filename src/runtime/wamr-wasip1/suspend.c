@@ -0,0 +1,216 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "suspend.h"
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+
+/* Not part of the public API of WAMR, built with the include directories and definitions of WAMR */
+
+#include "thread_manager.h"
+
+/* How often a request checks whether the thread stopped, and for how long its CPU clock must stand still */
+
+#define WAMR_SUSPEND_POLL_NS 100000L
+#define WAMR_SUSPEND_IDLE_NS 300000ULL
+
+static int clock_ns(clockid_t clock, uint64_t *ns)
+{
+	struct timespec ts;
+
+	if (clock_gettime(clock, &ts)) {
+		return -errno;
+	}
+
+	*ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+	return 0;
+}
+
+/* The interpreter checks the flag and waits for it to be cleared with wait_lock held. Clear it under the same lock,
+ * or the wake up may come before the wait and be lost
+ */
+
+static void resume_thread(wasm_exec_env_t exec_env)
+{
+	os_mutex_lock(&exec_env->wait_lock);
+	wasm_cluster_resume_thread(exec_env);
+	os_mutex_unlock(&exec_env->wait_lock);
+}
+
+int wamr_suspend_init(struct wamr_suspend *suspend)
+{
+	if (!suspend) {
+		return -EINVAL;
+	}
+
+	memset(suspend, 0, sizeof(*suspend));
+
+	int rc = pthread_mutex_init(&suspend->lock, NULL);
+	if (rc) {
+		return -rc;
+	}
+
+	return 0;
+}
+
+void wamr_suspend_destroy(struct wamr_suspend *suspend)
+{
+	if (!suspend) {
+		return;
+	}
+
+	pthread_mutex_destroy(&suspend->lock);
+}
+
+int wamr_suspend_attach(struct wamr_suspend *suspend, wasm_exec_env_t exec_env)
+{
+	clockid_t clock;
+
+	if (!suspend || !exec_env) {
+		return -EINVAL;
+	}
+
+	int rc = pthread_getcpuclockid(pthread_self(), &clock);
+	if (rc) {
+		return -rc;
+	}
+
+	pthread_mutex_lock(&suspend->lock);
+
+	suspend->exec_env = exec_env;
+	suspend->clock = clock;
+
+	if (suspend->reasons) {
+		wasm_cluster_suspend_thread(exec_env);
+	}
+
+	pthread_mutex_unlock(&suspend->lock);
+
+	return 0;
+}
+
+void wamr_suspend_detach(struct wamr_suspend *suspend)
+{
+	if (!suspend) {
+		return;
+	}
+
+	pthread_mutex_lock(&suspend->lock);
+
+	if (suspend->exec_env && suspend->reasons) {
+		resume_thread(suspend->exec_env);
+	}
+
+	suspend->exec_env = NULL;
+
+	pthread_mutex_unlock(&suspend->lock);
+}
+
+int wamr_suspend_request(struct wamr_suspend *suspend, unsigned int reason, int timeout_ms)
+{
+	uint64_t now, deadline, cpu, last_cpu = 0, idle_since = 0;
+	int rc;
+
+	if (!suspend || !reason) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&suspend->lock);
+
+	suspend->reasons |= reason;
+
+	if (suspend->exec_env) {
+		wasm_cluster_suspend_thread(suspend->exec_env);
+	}
+
+	pthread_mutex_unlock(&suspend->lock);
+
+	if (timeout_ms <= 0) {
+		return 0;
+	}
+
+	rc = clock_ns(CLOCK_MONOTONIC, &now);
+	if (rc) {
+		return rc;
+	}
+
+	deadline = now + (uint64_t)timeout_ms * 1000000ULL;
+
+	/* WAMR does not tell when the thread got to a safe point. The thread does not use CPU time once it waits
+	 * there, so wait for its CPU clock to stand still. The lock keeps the thread, and its clock, from going away.
+	 */
+
+	for (;;) {
+		pthread_mutex_lock(&suspend->lock);
+
+		bool attached = suspend->exec_env != NULL;
+
+		rc = attached ? clock_ns(suspend->clock, &cpu) : 0;
+
+		pthread_mutex_unlock(&suspend->lock);
+
+		if (!attached) {
+			/* Not running wasm code anymore */
+
+			return 0;
+		}
+
+		if (rc) {
+			return rc;
+		}
+
+		rc = clock_ns(CLOCK_MONOTONIC, &now);
+		if (rc) {
+			return rc;
+		}
+
+		if (!idle_since || cpu != last_cpu) {
+			last_cpu = cpu;
+			idle_since = now;
+		} else if (now - idle_since >= WAMR_SUSPEND_IDLE_NS) {
+			return 0;
+		}
+
+		if (now >= deadline) {
+			return -ETIMEDOUT;
+		}
+
+		struct timespec ts = {0, WAMR_SUSPEND_POLL_NS};
+		nanosleep(&ts, NULL);
+	}
+}
+
+int wamr_suspend_release(struct wamr_suspend *suspend, unsigned int reason)
+{
+	if (!suspend || !reason) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&suspend->lock);
+
+	suspend->reasons &= ~reason;
+
+	/* Still suspended if another reason is left */
+
+	if (!suspend->reasons && suspend->exec_env) {
+		resume_thread(suspend->exec_env);
+	}
+
+	pthread_mutex_unlock(&suspend->lock);
+
+	return 0;
+}
+
+#endif /* CONFIG_OCRE_CONTAINER_SUSPEND */
@@ -0,0 +1,105 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_WAMR_SUSPEND_H
+#define OCRE_WAMR_SUSPEND_H
+
+#include <pthread.h>
+#include <time.h>
+
+#include <ocre/platform/config.h>
+
+#include <wasm_export.h>
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+
+/* Reasons a container is suspended for. It runs again once none is left */
+
+#define WAMR_SUSPEND_REASON_PAUSE    (1U << 0)
+#define WAMR_SUSPEND_REASON_THROTTLE (1U << 1)
+#define WAMR_SUSPEND_REASON_SAMPLE   (1U << 2)
+
+/**
+ * @brief Suspension of the thread running a container
+ *
+ * The thread is suspended with the thread manager of WAMR: the interpreter checks the suspension flag of the
+ * execution environment at branches, and waits there until the flag is cleared. So a suspended thread is always
+ * between two wasm instructions, and never holds a lock of Ocre, of the C library or of WAMR. A thread in a host call
+ * is suspended once it is back in wasm code.
+ */
+struct wamr_suspend {
+	pthread_mutex_t lock;
+	wasm_exec_env_t exec_env; /*!< Environment of the attached thread, NULL if none */
+	clockid_t clock;	  /*!< CPU clock of the attached thread */
+	unsigned int reasons;	  /*!< Bitmask of WAMR_SUSPEND_REASON_* */
+};
+
+/**
+ * @brief Initialize a suspension handle
+ *
+ * @param suspend Suspension handle
+ *
+ * @return 0 on success, negative value on error
+ */
+int wamr_suspend_init(struct wamr_suspend *suspend);
+
+/**
+ * @brief Destroy a suspension handle. The handle must be detached
+ *
+ * @param suspend Suspension handle
+ */
+void wamr_suspend_destroy(struct wamr_suspend *suspend);
+
+/**
+ * @brief Attach the calling thread, which runs wasm code in @p exec_env
+ *
+ * Reasons set while no thread was attached take effect now.
+ *
+ * @param suspend Suspension handle
+ * @param exec_env Execution environment of the calling thread
+ *
+ * @return 0 on success, negative value on error
+ */
+int wamr_suspend_attach(struct wamr_suspend *suspend, wasm_exec_env_t exec_env);
+
+/**
+ * @brief Detach the calling thread, before its execution environment goes away
+ *
+ * The reasons are kept, and take effect again when a thread is attached.
+ *
+ * @param suspend Suspension handle
+ */
+void wamr_suspend_detach(struct wamr_suspend *suspend);
+
+/**
+ * @brief Suspend the attached thread
+ *
+ * If @p timeout_ms is positive, waits until the thread stopped running: its CPU clock no longer advances. A thread
+ * blocked in a host call counts as stopped, it cannot run wasm code again before it is released. If no thread is
+ * attached, the reason is recorded and takes effect on attach.
+ *
+ * @param suspend Suspension handle
+ * @param reason One of WAMR_SUSPEND_REASON_*
+ * @param timeout_ms Maximum time to wait for the thread to stop, 0 to not wait
+ *
+ * @return 0 on success, -ETIMEDOUT if the thread did not stop in time, other negative value on error
+ */
+int wamr_suspend_request(struct wamr_suspend *suspend, unsigned int reason, int timeout_ms);
+
+/**
+ * @brief Release a suspension reason. The thread runs again once no reason is left
+ *
+ * @param suspend Suspension handle
+ * @param reason One of WAMR_SUSPEND_REASON_*
+ *
+ * @return 0 on success, negative value on error
+ */
+int wamr_suspend_release(struct wamr_suspend *suspend, unsigned int reason);
+
+#endif /* CONFIG_OCRE_CONTAINER_SUSPEND */
+
+#endif /* OCRE_WAMR_SUSPEND_H */
@@ -6,15 +6,19 @@
  */
 
 #include <errno.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
-#include <semaphore.h>
+#include <time.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <ocre/metrics.h>
+#include <ocre/stats.h>
+#include <ocre/trace.h>
 #include <ocre/runtime/vtable.h>
 
 #include <ocre/platform/config.h>
@@ -29,9 +33,28 @@
 #include "ocre_api/ocre_common.h"
 #include "ocre_api/ocre_timers/ocre_timer.h"
 
+#include "checkpoint.h"
+#include "cpu_quota.h"
+#include "executor.h"
+#include "profile.h"
+#include "shm.h"
+#include "suspend.h"
+
 LOG_MODULE_REGISTER(wamr_runtime, CONFIG_OCRE_LOG_LEVEL);
 
+/* Operand stack and application heap of every instance */
+
+#define WAMR_STACK_SIZE 8192
+#define WAMR_HEAP_SIZE	8192
+
+/* Linear memories without a declared maximum can grow to 4 GiB */
+
+#define WASM_PAGE_SIZE	  65536
+#define WASM_MAX_PAGES_32 65536
+
+#ifdef CONFIG_OCRE_SHARED_HEAP
 static wasm_shared_heap_t _shared_heap = NULL;
+#endif
 
 static void *shared_heap_buf = NULL;
 
@@ -44,17 +67,93 @@ struct wamr_context {
 	char **argv;
 	char **envp;
 	bool uses_ocre_api;
-	bool uses_shared_heap;
+	wasm_shared_heap_t shared_heap;
 	char **dir_map_list;
 	size_t dir_map_list_len;
+	pthread_mutex_t lock;
+	bool running;
+	core_cancel_t cancel;
+	bool reactor;
+	bool exiting;
+	bool paused;
+	bool dispatching;
+	char *restore_path;
+	uint64_t module_hash;
+	struct user_arena *arena;
+	struct executor_task task;
+	void (*started)(void *arg);
+	void (*exited)(void *arg, int exit_code);
+	void *exited_arg;
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	struct wamr_suspend suspend;
+	struct cpu_quota cpu_quota;
+	unsigned int cpu_quota_us;
+	unsigned int cpu_period_us;
+#endif
+#ifdef CONFIG_OCRE_API_PROFILING
+	struct ocre_api_profile *profile;
+#endif
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+	wasm_exec_env_t exec_env;
+	struct wamr_profile exit_profile;
+	bool sampling;
+#endif
 };
 
-static int instance_execute(void *runtime_context, sem_t *sem)
+static void set_running(struct wamr_context *context, bool running)
+{
+	pthread_mutex_lock(&context->lock);
+
+	context->running = running;
+
+	pthread_mutex_unlock(&context->lock);
+}
+
+static void attach_shared_heap(struct wamr_context *context)
+{
+	if (!context->shared_heap) {
+		return;
+	}
+
+	if (!wasm_runtime_attach_shared_heap(context->module_inst, context->shared_heap)) {
+		LOG_ERR("Failed to attach shared heap");
+		return;
+	}
+
+	LOG_INF("Shared heap capability enabled");
+}
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+/* The profiling data goes away with the instance, keep it to report it after the container exited */
+
+static void keep_profile(struct wamr_context *context)
+{
+	struct wamr_profile profile;
+
+	if (wamr_profile_collect(&profile, context->module_inst, context->exec_env)) {
+		LOG_WRN("Failed to collect the profile of container %p", context);
+	} else {
+		pthread_mutex_lock(&context->lock);
+
+		wamr_profile_free(&context->exit_profile);
+		context->exit_profile = profile;
+
+		pthread_mutex_unlock(&context->lock);
+	}
+}
+#endif
+
+static int instance_execute(void *runtime_context, void (*started)(void *arg), void *arg)
 {
 	struct wamr_context *context = runtime_context;
 
-	context->module_inst =
-		wasm_runtime_instantiate(context->module, 8192, 8192, context->error_buf, sizeof(context->error_buf));
+	OCRE_TRACE_BEGIN(instantiate_span, "wamr", "instantiate");
+
+	context->module_inst = wasm_runtime_instantiate(context->module, WAMR_STACK_SIZE, WAMR_HEAP_SIZE,
+							context->error_buf, sizeof(context->error_buf));
+
+	OCRE_TRACE_END(instantiate_span);
+
 	if (!context->module_inst) {
 		LOG_ERR("Failed to instantiate module: %s, for context %p", context->error_buf, context);
 		return -1;
@@ -62,33 +161,62 @@ static int instance_execute(void *runtime_context, sem_t *sem)
 
 	if (context->uses_ocre_api) {
 		ocre_module_context_t *mod = ocre_register_module(context->module_inst);
+		if (mod) {
+#ifdef CONFIG_OCRE_API_PROFILING
+			mod->profile = context->profile;
+#endif
+		}
+
 		wasm_runtime_set_custom_data(context->module_inst, mod);
 	}
 
-	if (context->uses_shared_heap) {
-		if (!wasm_runtime_attach_shared_heap(context->module_inst, _shared_heap)) {
-			LOG_ERR("Failed to attach shared heap");
-		}
-		LOG_INF("Shared heap capability enabled");
-	}
+	attach_shared_heap(context);
 
 	/* Clear any previous exceptions */
 
 	wasm_runtime_clear_exception(context->module_inst);
 
+#if defined(CONFIG_OCRE_CONTAINER_SUSPEND) || defined(CONFIG_OCRE_WAMR_PROFILING)
+	/* Main runs in the singleton environment. Create it from this thread, so it can be suspended and sampled */
+
+	wasm_exec_env_t exec_env = wasm_runtime_get_exec_env_singleton(context->module_inst);
+#endif
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+	context->exec_env = exec_env;
+#endif
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	bool quota_attached = false;
+
+	if (wamr_suspend_attach(&context->suspend, exec_env)) {
+		LOG_WRN("Failed to attach suspension handle, container %p cannot be paused or throttled", context);
+	} else if (context->cpu_quota_us) {
+		if (cpu_quota_attach(&context->cpu_quota, &context->suspend, context->cpu_quota_us,
+				     context->cpu_period_us)) {
+			LOG_WRN("Failed to enforce CPU quota on container %p", context);
+		} else {
+			quota_attached = true;
+		}
+	}
+#endif
+
+	/* From now on, the instance can be stopped and killed */
+
+	set_running(context, true);
+
 	/* Notify the starting waiter that we are ready
 	 * We should notify only after we are ready to process the kill call.
 	 * In WAMR, this is managed by the exception message, so we are good if we just cleared the
 	 * exception.
 	 */
 
-	int rc = sem_post(sem);
-	if (rc) {
-		LOG_WRN("Failed to signal start semaphore: rc=%d", rc);
-	}
+	started(arg);
 
 	/* Execute main function */
 
+	OCRE_TRACE_BEGIN(main_span, "wamr", "main");
+
 	const char *exception = NULL;
 	if (!wasm_application_execute_main(context->module_inst, 1, context->argv)) {
 		LOG_WRN("Main function returned error in context %p exception: %s", context,
@@ -100,6 +228,30 @@ static int instance_execute(void *runtime_context, sem_t *sem)
 		}
 	}
 
+	OCRE_TRACE_END(main_span);
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	/* The environment goes away with the instance */
+
+	if (quota_attached) {
+		cpu_quota_detach(&context->cpu_quota);
+	}
+
+	wamr_suspend_detach(&context->suspend);
+#endif
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+	keep_profile(context);
+#endif
+
+	/* The instance is going away, stop and kill are not possible anymore */
+
+	set_running(context, false);
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+	context->exec_env = NULL;
+#endif
+
 	if (context->uses_ocre_api) {
 		/* Cleanup module resources if using Ocre API */
 
@@ -121,19 +273,346 @@ static int instance_execute(void *runtime_context, sem_t *sem)
 	return exit_code;
 }
 
-static int instance_thread_execute(void *arg, sem_t *sem)
+static int instance_thread_execute(void *runtime_context, void (*started)(void *arg), void *arg)
 {
-	struct wamr_context *context = arg;
+	struct wamr_context *context = runtime_context;
 
 	wasm_runtime_init_thread_env();
 
-	int ret = instance_execute(context, sem);
+	/* What WAMR allocates for the instance from now on is accounted to the container */
+
+	struct user_arena *previous_arena = user_arena_enter(context->arena);
+
+	/* Blocking host calls wait on this, so they can be interrupted by kill */
+
+	core_cancel_attach(&context->cancel);
+
+	int ret = instance_execute(context, started, arg);
+
+	core_cancel_detach();
+
+	user_arena_enter(previous_arena);
 
 	wasm_runtime_destroy_thread_env();
 
 	return ret;
 }
 
+/* Reactor containers run on the executor worker pool. Their entry point runs once and registers the event
+ * dispatchers, then the instance stays alive without a thread of its own. A worker calls the dispatchers when events
+ * arrive, so the container only occupies it while handling them.
+ */
+
+static struct wamr_context *task_to_context(struct executor_task *task)
+{
+	return (struct wamr_context *)((char *)task - offsetof(struct wamr_context, task));
+}
+
+static void reactor_notify(void *arg)
+{
+	struct wamr_context *context = arg;
+
+	int rc = executor_submit(&context->task);
+	if (rc) {
+		LOG_ERR("Failed to schedule container %p: rc=%d", context, rc);
+	}
+}
+
+static bool reactor_is_exception(wasm_module_inst_t module_inst)
+{
+	const char *exception = wasm_runtime_get_exception(module_inst);
+
+	/* Exiting through proc_exit is not an error */
+
+	return exception && !strstr(exception, "wasi proc exit");
+}
+
+static uint64_t module_hash(struct wamr_context *context)
+{
+	if (!context->module_hash) {
+		context->module_hash = wamr_checkpoint_module_hash(context->buffer, context->size);
+	}
+
+	return context->module_hash;
+}
+
+/* Returns true if the instance exited */
+
+static bool reactor_init(struct wamr_context *context)
+{
+	OCRE_TRACE_BEGIN(instantiate_span, "wamr", "instantiate");
+
+	context->module_inst = wasm_runtime_instantiate(context->module, WAMR_STACK_SIZE, WAMR_HEAP_SIZE,
+							context->error_buf, sizeof(context->error_buf));
+
+	OCRE_TRACE_END(instantiate_span);
+
+	if (!context->module_inst) {
+		LOG_ERR("Failed to instantiate module: %s, for context %p", context->error_buf, context);
+		return true;
+	}
+
+	ocre_module_context_t *mod = ocre_register_module(context->module_inst);
+	if (!mod) {
+		return true;
+	}
+
+#ifdef CONFIG_OCRE_API_PROFILING
+	mod->profile = context->profile;
+#endif
+
+	wasm_runtime_set_custom_data(context->module_inst, mod);
+
+	int rc = ocre_module_set_event_queue(mod, reactor_notify, context);
+	if (rc) {
+		LOG_ERR("Failed to create event queue for context %p: rc=%d", context, rc);
+		return true;
+	}
+
+	attach_shared_heap(context);
+
+	wasm_runtime_clear_exception(context->module_inst);
+
+	set_running(context, true);
+
+	/* A restored container does not run its entry point again, the checkpoint has the state it left */
+
+	if (context->restore_path) {
+		rc = wamr_checkpoint_load(context->module_inst, module_hash(context), context->restore_path);
+
+		free(context->restore_path);
+		context->restore_path = NULL;
+
+		if (rc) {
+			LOG_ERR("Failed to restore container %p", context);
+			return true;
+		}
+	} else if (wasm_runtime_lookup_wasi_start_function(context->module_inst) &&
+		   !wasm_application_execute_main(context->module_inst, 1, context->argv) &&
+		   reactor_is_exception(context->module_inst)) {
+		/* WASI reactors have no entry point, WAMR already ran their initialization when instantiating them */
+
+		LOG_ERR("Container %p exception: %s", context, wasm_runtime_get_exception(context->module_inst));
+		return true;
+	}
+
+	if (wasm_runtime_get_wasi_exit_code(context->module_inst)) {
+		return true;
+	}
+
+	for (int i = 0; i < OCRE_RESOURCE_TYPE_COUNT; i++) {
+		if (mod->dispatchers[i]) {
+			wasm_runtime_clear_exception(context->module_inst);
+			return false;
+		}
+	}
+
+	LOG_INF("Container %p has no event dispatcher, nothing left to do", context);
+
+	return true;
+}
+
+/* Returns true if the instance exited */
+
+static bool reactor_dispatch(struct wamr_context *context, wasm_exec_env_t *exec_env)
+{
+	ocre_module_context_t *mod = wasm_runtime_get_custom_data(context->module_inst);
+	ocre_event_t event;
+
+	for (;;) {
+		pthread_mutex_lock(&context->lock);
+		bool exiting = context->exiting;
+		bool paused = context->paused;
+		pthread_mutex_unlock(&context->lock);
+
+		if (exiting) {
+			return true;
+		}
+
+		/* Events keep queuing until we are unpaused */
+
+		if (paused || ocre_module_get_event(mod, &event)) {
+			return false;
+		}
+
+		wasm_function_inst_t func = event.type < OCRE_RESOURCE_TYPE_COUNT ? mod->dispatchers[event.type] : NULL;
+		if (!func) {
+			LOG_WRN("No dispatcher for event type %d in container %p, dropping event", event.type, context);
+			continue;
+		}
+
+		/* The dispatchers get the same values as ocre_get_event(), but the type */
+
+		uint32_t fields[OCRE_EVENT_FIELDS];
+		if (ocre_event_get_fields(&event, fields)) {
+			continue;
+		}
+
+		uint32_t argc = wasm_func_get_param_count(func, context->module_inst);
+		if (argc > OCRE_EVENT_FIELDS - 1) {
+			LOG_ERR("Dispatcher for event type %d in container %p has too many parameters", event.type,
+				context);
+			continue;
+		}
+
+		if (!*exec_env) {
+			*exec_env = wasm_runtime_create_exec_env(context->module_inst, OCRE_WASM_STACK_SIZE);
+			if (!*exec_env) {
+				LOG_ERR("Failed to create execution environment for container %p", context);
+				return true;
+			}
+		}
+
+		if (!wasm_runtime_call_wasm(*exec_env, func, argc, &fields[1])) {
+			if (reactor_is_exception(context->module_inst)) {
+				LOG_ERR("Container %p exception: %s", context,
+					wasm_runtime_get_exception(context->module_inst));
+			}
+
+			return true;
+		}
+	}
+}
+
+static int reactor_exit(struct wamr_context *context)
+{
+	if (!context->module_inst) {
+		return -1;
+	}
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+	keep_profile(context);
+#endif
+
+	set_running(context, false);
+
+	/* reactor_init() may have failed before registering the module */
+
+	if (wasm_runtime_get_custom_data(context->module_inst)) {
+		ocre_cleanup_module_resources(context->module_inst);
+
+		ocre_unregister_module(context->module_inst);
+	}
+
+	int exit_code = wasm_runtime_get_wasi_exit_code(context->module_inst);
+
+	wasm_runtime_deinstantiate(context->module_inst);
+
+	context->module_inst = NULL;
+
+	return exit_code;
+}
+
+static bool reactor_run(struct executor_task *task)
+{
+	struct wamr_context *context = task_to_context(task);
+	wasm_exec_env_t exec_env = NULL;
+	bool exited = false;
+
+	/* From now on, kill interrupts blocking host calls */
+
+	core_cancel_attach(&context->cancel);
+
+	struct user_arena *previous_arena = user_arena_enter(context->arena);
+
+	if (!context->module_inst) {
+		exited = reactor_init(context);
+
+		/* When it failed to start, the container learns it from the exit */
+
+		if (!exited) {
+			context->started(context->exited_arg);
+		}
+	}
+
+	if (!exited) {
+		OCRE_TRACE_BEGIN(dispatch_span, "wamr", "dispatch");
+
+		/* A checkpoint waits for the dispatchers to return */
+
+		pthread_mutex_lock(&context->lock);
+		context->dispatching = true;
+		pthread_mutex_unlock(&context->lock);
+
+		exited = reactor_dispatch(context, &exec_env);
+
+		pthread_mutex_lock(&context->lock);
+		context->dispatching = false;
+		pthread_mutex_unlock(&context->lock);
+
+		OCRE_TRACE_END(dispatch_span);
+	}
+
+	if (exec_env) {
+		wasm_runtime_destroy_exec_env(exec_env);
+	}
+
+	user_arena_enter(previous_arena);
+
+	core_cancel_detach();
+
+	if (!exited) {
+		return true;
+	}
+
+	void (*exited_cb)(void *arg, int exit_code) = context->exited;
+	void *exited_arg = context->exited_arg;
+
+	int exit_code = reactor_exit(context);
+
+	LOG_INF("Context %p completed", context);
+
+	/* The context may be gone once the container knows */
+
+	exited_cb(exited_arg, exit_code);
+
+	return false;
+}
+
+static int instance_spawn(void *runtime_context, void (*started)(void *arg), void (*exited)(void *arg, int exit_code),
+			  void *arg)
+{
+	struct wamr_context *context = runtime_context;
+
+	if (!context || !started || !exited) {
+		return -1;
+	}
+
+	/* Events are only delivered through the Ocre API */
+
+	if (!context->uses_ocre_api) {
+		LOG_ERR("Reactor container %p needs the ocre:api capability", context);
+		return -1;
+	}
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	if (context->cpu_quota_us) {
+		LOG_ERR("CPU quotas are not supported for reactor container %p", context);
+		return -1;
+	}
+#endif
+
+	pthread_mutex_lock(&context->lock);
+	context->reactor = true;
+	context->exiting = false;
+	context->paused = false;
+	pthread_mutex_unlock(&context->lock);
+
+	context->started = started;
+	context->exited = exited;
+	context->exited_arg = arg;
+
+	executor_task_init(&context->task, reactor_run);
+
+	int rc = executor_submit(&context->task);
+	if (rc) {
+		LOG_ERR("Failed to schedule container %p: rc=%d", context, rc);
+		return -1;
+	}
+
+	return 0;
+}
+
 static int runtime_init(void)
 {
 #if defined(CONFIG_OCRE_SHARED_HEAP_BUF_VIRTUAL)
@@ -197,7 +676,7 @@ error_runtime:
 
 error_sh_heap_buf:
 #if defined(CONFIG_OCRE_SHARED_HEAP_BUF_VIRTUAL)
-	free(shared_heap_buf);
+	user_free(shared_heap_buf);
 	shared_heap_buf = NULL;
 #endif
 
@@ -206,12 +685,22 @@ error_sh_heap_buf:
 
 static int runtime_deinit(void)
 {
+	executor_shutdown();
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	cpu_quota_shutdown();
+#endif
+
 	ocre_common_shutdown();
 
+#ifdef CONFIG_OCRE_SHARED_HEAP
+	wamr_shm_shutdown();
+#endif
+
 	wasm_runtime_destroy();
 
 #ifdef CONFIG_OCRE_SHARED_HEAP_BUF_VIRTUAL
-	free(shared_heap_buf);
+	user_free(shared_heap_buf);
 #endif
 
 	return 0;
@@ -237,6 +726,37 @@ static void *instance_create(const char *container_id, const char *img_path, con
 
 	memset(context, 0, sizeof(struct wamr_context));
 
+	int rc = pthread_mutex_init(&context->lock, NULL);
+	if (rc) {
+		LOG_ERR("Failed to initialize mutex: rc=%d", rc);
+		free(context);
+		return NULL;
+	}
+
+	rc = core_cancel_init(&context->cancel);
+	if (rc) {
+		LOG_ERR("Failed to initialize cancellation point: rc=%d", rc);
+		pthread_mutex_destroy(&context->lock);
+		free(context);
+		return NULL;
+	}
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	if (wamr_suspend_init(&context->suspend)) {
+		LOG_ERR("Failed to initialize suspension handle");
+		core_cancel_destroy(&context->cancel);
+		pthread_mutex_destroy(&context->lock);
+		free(context);
+		return NULL;
+	}
+#endif
+
+	/* WAMR allocates from the arena of the container while working on its behalf. Without arenas on this
+	 * platform, it allocates from the host heap
+	 */
+
+	context->arena = user_arena_create(0);
+
 	/* For envp we can just keep a reference
 	 * as the container is guaranteed to only free it after our destruction
 	 */
@@ -288,7 +808,14 @@ static void *instance_create(const char *container_id, const char *img_path, con
 
 	/* Memory-map file */
 
-	context->buffer = ocre_load_file(img_path, &context->size);
+	uint64_t load_start_ns = ocre_metrics_now_ns();
+
+	OCRE_TRACE_BEGIN(load_file_span, "wamr", "load_file");
+
+	context->buffer = ocre_load_file(img_path, &context->size);
+
+	OCRE_TRACE_END(load_file_span);
+
 	if (!context->buffer) {
 		LOG_ERR("Failed to load wasm program into buffer errno=%d", errno);
 		goto error;
@@ -296,18 +823,48 @@ static void *instance_create(const char *container_id, const char *img_path, con
 
 	LOG_INF("Buffer loaded successfully: %p", context->buffer);
 
+	OCRE_TRACE_BEGIN(load_span, "wamr", "wasm_runtime_load");
+
+	struct user_arena *previous_arena = user_arena_enter(context->arena);
+
 	context->module = wasm_runtime_load((uint8_t *)context->buffer, context->size, context->error_buf,
 					    sizeof(context->error_buf));
+
+	user_arena_enter(previous_arena);
+
+	OCRE_TRACE_END(load_span);
+
 	if (!context->module) {
 		LOG_ERR("Failed to load module: %s", context->error_buf);
 		goto error;
 	}
 
+	ocre_metric_observe(OCRE_HISTOGRAM_MODULE_LOAD, ocre_metrics_now_ns() - load_start_ns);
+
 	/* Process capabilities */
 
 	for (const char **cap = capabilities; cap && *cap; cap++) {
-		if (!strcmp(*cap, "ocre:shared_heap")) {
-			context->uses_shared_heap = true;
+		if (!strcmp(*cap, "ocre:shared_heap") || !strncmp(*cap, "ocre:shm=", strlen("ocre:shm="))) {
+			/* An instance is attached to a single shared heap */
+
+			if (context->shared_heap) {
+				LOG_ERR("Capability '%s' conflicts with another shared heap", *cap);
+				goto error;
+			}
+
+#ifdef CONFIG_OCRE_SHARED_HEAP
+			if (!strcmp(*cap, "ocre:shared_heap")) {
+				context->shared_heap = _shared_heap;
+			} else {
+				context->shared_heap = wamr_shm_get(*cap + strlen("ocre:shm="));
+				if (!context->shared_heap) {
+					goto error;
+				}
+			}
+#else
+			LOG_ERR("Capability '%s' requires shared heap support", *cap);
+			goto error;
+#endif
 		} else if (!strcmp(*cap, "ocre:api")) {
 			context->uses_ocre_api = true;
 		}
@@ -404,6 +961,18 @@ static void *instance_create(const char *container_id, const char *img_path, con
 				      context->dir_map_list_len, envp, envn, context->argv, argc + 1, stdin_fd,
 				      stdout_fd, stderr_fd);
 
+#ifdef CONFIG_OCRE_API_PROFILING
+	/* Only modules with the Ocre API capability have a module context to count their native calls */
+
+	if (context->uses_ocre_api) {
+		context->profile = calloc(ocre_api_table_size, sizeof(struct ocre_api_profile));
+		if (!context->profile) {
+			LOG_ERR("Failed to allocate memory for the native profile");
+			goto error;
+		}
+	}
+#endif
+
 	return context;
 
 error_module:
@@ -420,6 +989,8 @@ error:
 			context->buffer = NULL;
 		}
 
+		user_arena_destroy(context->arena);
+
 		for (char **dir_map = context->dir_map_list; dir_map && *dir_map; dir_map++) {
 			free(*dir_map);
 		}
@@ -435,6 +1006,14 @@ error:
 		}
 
 		free(context->argv);
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+		wamr_suspend_destroy(&context->suspend);
+#endif
+
+		core_cancel_destroy(&context->cancel);
+
+		pthread_mutex_destroy(&context->lock);
 	}
 
 	free(context);
@@ -450,7 +1029,283 @@ static int instance_kill(void *runtime_context)
 		return -1;
 	}
 
-	wasm_runtime_terminate(context->module_inst);
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	/* A suspended thread waits for the suspension flag to be cleared, and only checks for the termination before
+	 * it waits. Let it run again first.
+	 */
+
+	cpu_quota_exempt(&context->cpu_quota);
+	wamr_suspend_release(&context->suspend, WAMR_SUSPEND_REASON_PAUSE);
+#endif
+
+	pthread_mutex_lock(&context->lock);
+
+	if (context->running) {
+		wasm_runtime_terminate(context->module_inst);
+	}
+
+	context->exiting = true;
+
+	bool reactor = context->reactor;
+
+	pthread_mutex_unlock(&context->lock);
+
+	/* The termination is only seen once the thread is back in wasm code, so interrupt any blocking host call */
+
+	core_cancel_signal(&context->cancel);
+
+	/* An idle reactor needs a worker to exit */
+
+	if (reactor) {
+		int rc = executor_submit(&context->task);
+		if (rc) {
+			LOG_ERR("Failed to schedule container %p: rc=%d", context, rc);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int instance_stop(void *runtime_context)
+{
+	struct wamr_context *context = runtime_context;
+	int ret = -1;
+
+	if (!context) {
+		return -1;
+	}
+
+	/* Without the Ocre API, the container has no way to receive the stop request */
+
+	if (!context->uses_ocre_api) {
+		LOG_INF("Container %p does not use the Ocre API, cannot deliver stop event", context);
+		return -1;
+	}
+
+	pthread_mutex_lock(&context->lock);
+
+	if (!context->running) {
+		LOG_ERR("Container %p is not running", context);
+		goto unlock;
+	}
+
+	/* A reactor only gets the event if it has a dispatcher for it */
+
+	if (context->reactor) {
+		ocre_module_context_t *mod = ocre_get_module_context(context->module_inst);
+		if (!mod || !mod->dispatchers[OCRE_RESOURCE_TYPE_LIFECYCLE]) {
+			LOG_INF("Container %p has no lifecycle dispatcher, cannot deliver stop event", context);
+			goto unlock;
+		}
+	}
+
+	ocre_event_t event;
+	memset(&event, 0, sizeof(event));
+	event.type = OCRE_RESOURCE_TYPE_LIFECYCLE;
+	event.data.lifecycle_event.event = OCRE_LIFECYCLE_EVENT_STOP;
+	event.owner = context->module_inst;
+
+	ret = ocre_post_event(&event);
+
+	if (ret) {
+		LOG_ERR("Failed to queue stop event for container %p: rc=%d", context, ret);
+	}
+
+unlock:
+	pthread_mutex_unlock(&context->lock);
+
+	return ret;
+}
+
+static int instance_pause(void *runtime_context)
+{
+	struct wamr_context *context = runtime_context;
+
+	if (!context) {
+		return -1;
+	}
+
+	/* A reactor stops getting events once its current dispatcher, if any, returns */
+
+	if (context->reactor) {
+		pthread_mutex_lock(&context->lock);
+		context->paused = true;
+		pthread_mutex_unlock(&context->lock);
+
+		return 0;
+	}
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	int rc = wamr_suspend_request(&context->suspend, WAMR_SUSPEND_REASON_PAUSE,
+				      CONFIG_OCRE_CONTAINER_PAUSE_TIMEOUT_MS);
+	if (rc) {
+		LOG_ERR("Container %p did not suspend in %d ms: rc=%d", context, CONFIG_OCRE_CONTAINER_PAUSE_TIMEOUT_MS,
+			rc);
+		wamr_suspend_release(&context->suspend, WAMR_SUSPEND_REASON_PAUSE);
+		return -1;
+	}
+
+	return 0;
+#else
+	LOG_ERR("Container %p cannot be paused, suspension is not supported", context);
+
+	return -1;
+#endif
+}
+
+static int instance_unpause(void *runtime_context)
+{
+	struct wamr_context *context = runtime_context;
+
+	if (!context) {
+		return -1;
+	}
+
+	if (context->reactor) {
+		pthread_mutex_lock(&context->lock);
+		context->paused = false;
+		pthread_mutex_unlock(&context->lock);
+
+		/* Handle the events queued in the meantime */
+
+		int rc = executor_submit(&context->task);
+		if (rc) {
+			LOG_ERR("Failed to schedule container %p: rc=%d", context, rc);
+			return -1;
+		}
+
+		return 0;
+	}
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	int rc = wamr_suspend_release(&context->suspend, WAMR_SUSPEND_REASON_PAUSE);
+	if (rc) {
+		LOG_ERR("Failed to resume container %p: rc=%d", context, rc);
+		return -1;
+	}
+
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+static int instance_set_cpu_quota(void *runtime_context, unsigned int quota_us, unsigned int period_us)
+{
+	struct wamr_context *context = runtime_context;
+
+	if (!context) {
+		return -1;
+	}
+
+	if (!period_us) {
+		period_us = CONFIG_OCRE_CPU_PERIOD_US_DEFAULT;
+	}
+
+	if (quota_us && (quota_us < CPU_QUOTA_MIN_US || quota_us > period_us)) {
+		LOG_ERR("Invalid CPU quota %u us per %u us period: must be between %u us and the period",
+			quota_us, period_us, CPU_QUOTA_MIN_US);
+		return -1;
+	}
+
+	context->cpu_quota_us = quota_us;
+	context->cpu_period_us = period_us;
+
+	return 0;
+}
+#endif
+
+static int instance_set_memory_limit(void *runtime_context, size_t limit)
+{
+	struct wamr_context *context = runtime_context;
+
+	if (!context) {
+		return -1;
+	}
+
+	if (!context->arena) {
+		LOG_ERR("Memory limits are not supported on this platform");
+		return -1;
+	}
+
+	if (user_arena_set_limit(context->arena, limit)) {
+		LOG_ERR("Container %p already uses more than %zu bytes", context, limit);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int instance_get_memory_stats(void *runtime_context, struct ocre_memory_stats *stats)
+{
+	struct wamr_context *context = runtime_context;
+	struct user_arena_stats arena_stats;
+
+	if (!context || !context->arena) {
+		return -1;
+	}
+
+	user_arena_get_stats(context->arena, &arena_stats);
+
+	stats->used = arena_stats.used;
+	stats->reserved = arena_stats.reserved;
+	stats->peak = arena_stats.peak;
+	stats->limit = arena_stats.limit;
+	stats->failed = arena_stats.failed;
+
+	return 0;
+}
+
+/* Linear memory is reserved up to its declared maximum, or at its initial size if it has none, as reserving 4 GiB
+ * would reject every container
+ */
+
+static uint64_t memory_footprint(wasm_memory_type_t memory_type)
+{
+	uint64_t pages = wasm_memory_type_get_max_page_count(memory_type);
+
+	if (pages >= WASM_MAX_PAGES_32) {
+		pages = wasm_memory_type_get_init_page_count(memory_type);
+	}
+
+	return pages * WASM_PAGE_SIZE;
+}
+
+static int instance_get_footprint(void *runtime_context, size_t *footprint)
+{
+	struct wamr_context *context = runtime_context;
+
+	if (!context || !context->module) {
+		return -1;
+	}
+
+	uint64_t total = context->size + WAMR_STACK_SIZE + WAMR_HEAP_SIZE;
+
+	int32_t count = wasm_runtime_get_import_count(context->module);
+	for (int32_t i = 0; i < count; i++) {
+		wasm_import_t import;
+
+		wasm_runtime_get_import_type(context->module, i, &import);
+
+		if (import.kind == WASM_IMPORT_EXPORT_KIND_MEMORY) {
+			total += memory_footprint(import.u.memory_type);
+		}
+	}
+
+	count = wasm_runtime_get_export_count(context->module);
+	for (int32_t i = 0; i < count; i++) {
+		wasm_export_t export;
+
+		wasm_runtime_get_export_type(context->module, i, &export);
+
+		if (export.kind == WASM_IMPORT_EXPORT_KIND_MEMORY) {
+			total += memory_footprint(export.u.memory_type);
+		}
+	}
+
+	*footprint = total > SIZE_MAX ? SIZE_MAX : (size_t)total;
 
 	return 0;
 }
@@ -470,6 +1325,20 @@ static int instance_destroy(void *runtime_context)
 	}
 	context->buffer = NULL;
 
+	/* Whatever WAMR did not free goes away with the arena, in a single pass over its chunks */
+
+	if (context->arena) {
+		struct user_arena_stats stats;
+
+		user_arena_get_stats(context->arena, &stats);
+
+		if (stats.used) {
+			LOG_DBG("Releasing %zu bytes still allocated by container %p", stats.used, context);
+		}
+
+		user_arena_destroy(context->arena);
+	}
+
 	for (char **dir_map = context->dir_map_list; dir_map && *dir_map; dir_map++) {
 		free(*dir_map);
 	}
@@ -479,11 +1348,260 @@ static int instance_destroy(void *runtime_context)
 	free(context->argv[0]);
 	free(context->argv);
 
+	free(context->restore_path);
+
+#ifdef CONFIG_OCRE_API_PROFILING
+	free(context->profile);
+#endif
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+	wamr_profile_free(&context->exit_profile);
+#endif
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	wamr_suspend_destroy(&context->suspend);
+#endif
+
+	core_cancel_destroy(&context->cancel);
+
+	pthread_mutex_destroy(&context->lock);
+
 	free(context);
 
 	return 0;
 }
 
+/* Only reactors are checkpointed: between two dispatches, they have no wasm frames whose state would be lost */
+
+static int instance_checkpoint(void *runtime_context, const char *path)
+{
+	struct wamr_context *context = runtime_context;
+
+	if (!context || !path) {
+		return -1;
+	}
+
+	if (!context->reactor) {
+		LOG_ERR("Container %p is not a reactor, it cannot be checkpointed", context);
+		return -1;
+	}
+
+	uint64_t hash = module_hash(context);
+
+	/* The container is paused, but the dispatcher it was running may not have returned yet */
+
+	for (int waited_ms = 0;; waited_ms++) {
+		pthread_mutex_lock(&context->lock);
+
+		if (!context->dispatching) {
+			break;
+		}
+
+		pthread_mutex_unlock(&context->lock);
+
+		if (waited_ms >= CONFIG_OCRE_CONTAINER_PAUSE_TIMEOUT_MS) {
+			LOG_ERR("Container %p is still dispatching after %d ms", context,
+				CONFIG_OCRE_CONTAINER_PAUSE_TIMEOUT_MS);
+			return -1;
+		}
+
+		struct timespec ts = {0, 1000000L};
+		nanosleep(&ts, NULL);
+	}
+
+	/* Holding the lock keeps the next dispatch from starting */
+
+	int ret = -1;
+
+	if (!context->paused || !context->module_inst) {
+		LOG_ERR("Container %p is not paused", context);
+	} else {
+		ret = wamr_checkpoint_save(context->module, context->module_inst, hash, path);
+	}
+
+	pthread_mutex_unlock(&context->lock);
+
+	return ret;
+}
+
+static int instance_restore(void *runtime_context, const char *path)
+{
+	struct wamr_context *context = runtime_context;
+
+	if (!context || !path) {
+		return -1;
+	}
+
+	char *restore_path = strdup(path);
+	if (!restore_path) {
+		LOG_ERR("Failed to allocate memory for the checkpoint path");
+		return -1;
+	}
+
+	free(context->restore_path);
+	context->restore_path = restore_path;
+
+	return 0;
+}
+
+#ifdef CONFIG_OCRE_API_PROFILING
+static int instance_get_native_stats(void *runtime_context, struct ocre_native_stats *stats, size_t max)
+{
+	struct wamr_context *context = runtime_context;
+
+	for (size_t i = 0; i < max && i < (size_t)ocre_api_table_size; i++) {
+		stats[i].name = ocre_api_table[i].symbol;
+		stats[i].calls = 0;
+		stats[i].total_ns = 0;
+
+		if (context->profile) {
+			stats[i].calls = atomic_load_explicit(&context->profile[i].calls, memory_order_relaxed);
+			stats[i].total_ns = core_cycles_to_ns(
+				atomic_load_explicit(&context->profile[i].cycles, memory_order_relaxed));
+		}
+	}
+
+	return ocre_api_table_size;
+}
+#endif
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+static int instance_get_profile(void *runtime_context, char *buf, size_t size)
+{
+	struct wamr_context *context = runtime_context;
+	int ret = -1;
+
+	if (!context) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&context->lock);
+
+	if (context->running && context->module_inst) {
+		/* The counters are read while the instance runs, the profile is only approximate */
+
+		struct wamr_profile profile;
+
+		if (!wamr_profile_collect(&profile, context->module_inst, context->exec_env)) {
+			ret = wamr_profile_format(&profile, buf, size);
+			wamr_profile_free(&profile);
+		}
+	} else {
+		ret = wamr_profile_format(&context->exit_profile, buf, size);
+	}
+
+	pthread_mutex_unlock(&context->lock);
+
+	return ret;
+}
+
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+/* Copies the call stack of the container, with the container suspended. Returns the number of frames, 0 if there is
+ * no call stack to sample, negative if the container did not stop.
+ */
+
+static int copy_call_stack(struct wamr_context *context, WASMCApiFrame *frames, bool *running)
+{
+	char error_buf[128];
+	int ret = 0;
+
+	int rc = wamr_suspend_request(&context->suspend, WAMR_SUSPEND_REASON_SAMPLE,
+				      CONFIG_OCRE_CONTAINER_PAUSE_TIMEOUT_MS);
+	if (rc) {
+		ret = rc;
+	} else {
+		pthread_mutex_lock(&context->lock);
+
+		*running = context->running;
+
+		if (context->running && context->exec_env) {
+			ret = (int)wasm_copy_callstack(context->exec_env, frames, WAMR_PROFILE_MAX_FRAMES, 0, error_buf,
+						       sizeof(error_buf));
+		}
+
+		pthread_mutex_unlock(&context->lock);
+	}
+
+	wamr_suspend_release(&context->suspend, WAMR_SUSPEND_REASON_SAMPLE);
+
+	return ret;
+}
+
+static int instance_sample(void *runtime_context, unsigned int duration_ms, unsigned int period_ms,
+			   ocre_stack_callback_t callback, void *arg)
+{
+	struct wamr_context *context = runtime_context;
+	struct wamr_profile profile;
+	struct wamr_profile_stacks stacks = {0};
+	WASMCApiFrame frames[WAMR_PROFILE_MAX_FRAMES];
+	int nr_samples = 0;
+	int ret = -1;
+
+	if (!context || !callback || !period_ms) {
+		return -1;
+	}
+
+	if (context->reactor) {
+		LOG_ERR("Container %p is a reactor, it has no call stack to sample", context);
+		return -1;
+	}
+
+	/* The function names of the call stacks come from the profiling data */
+
+	int rc = -1;
+
+	pthread_mutex_lock(&context->lock);
+
+	if (context->running && context->exec_env && !context->sampling) {
+		rc = wamr_profile_collect(&profile, context->module_inst, NULL);
+		context->sampling = !rc;
+	}
+
+	pthread_mutex_unlock(&context->lock);
+
+	if (rc) {
+		LOG_ERR("Container %p is not running or is already being sampled", context);
+		return -1;
+	}
+
+	uint64_t end_ns = ocre_metrics_now_ns() + (uint64_t)duration_ms * 1000000ULL;
+	bool running = true;
+
+	while (running && ocre_metrics_now_ns() < end_ns) {
+		int nr_frames = copy_call_stack(context, frames, &running);
+		if (nr_frames < 0) {
+			LOG_WRN("Container %p did not suspend in %d ms: rc=%d", context,
+				CONFIG_OCRE_CONTAINER_PAUSE_TIMEOUT_MS, nr_frames);
+		} else if (nr_frames > 0) {
+			if (wamr_profile_stacks_add(&stacks, &profile, frames, (uint32_t)nr_frames)) {
+				LOG_ERR("Failed to allocate memory for the call stacks");
+				goto finish;
+			}
+
+			nr_samples++;
+		}
+
+		struct timespec ts = {period_ms / 1000, (long)(period_ms % 1000) * 1000000L};
+		nanosleep(&ts, NULL);
+	}
+
+	wamr_profile_stacks_fold(&stacks, callback, arg);
+
+	ret = nr_samples;
+
+finish:
+	wamr_profile_stacks_free(&stacks);
+	wamr_profile_free(&profile);
+
+	pthread_mutex_lock(&context->lock);
+	context->sampling = false;
+	pthread_mutex_unlock(&context->lock);
+
+	return ret;
+}
+#endif
+#endif
+
 const struct ocre_runtime_vtable wamr_vtable = {
 	.runtime_name = "wamr/wasip1",
 	.init = runtime_init,
@@ -491,5 +1609,26 @@ const struct ocre_runtime_vtable wamr_vtable = {
 	.create = instance_create,
 	.destroy = instance_destroy,
 	.thread_execute = instance_thread_execute,
+	.spawn = instance_spawn,
+	.stop = instance_stop,
 	.kill = instance_kill,
+	.pause = instance_pause,
+	.unpause = instance_unpause,
+	.checkpoint = instance_checkpoint,
+	.restore = instance_restore,
+	.set_memory_limit = instance_set_memory_limit,
+	.get_memory_stats = instance_get_memory_stats,
+	.get_footprint = instance_get_footprint,
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	.set_cpu_quota = instance_set_cpu_quota,
+#endif
+#ifdef CONFIG_OCRE_API_PROFILING
+	.get_native_stats = instance_get_native_stats,
+#endif
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+	.get_profile = instance_get_profile,
+#ifdef CONFIG_OCRE_CONTAINER_SUSPEND
+	.sample = instance_sample,
+#endif
+#endif
 };
@@ -0,0 +1,144 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <ocre/ocre.h>
+#include <ocre/platform/config.h>
+
+#include <ocre/shell/shell.h>
+
+#define DEFAULT_SOCKET_PATH CONFIG_OCRE_DEFAULT_WORKING_DIRECTORY "/ocred.sock"
+
+static int usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-s SOCKET] [-w WORKDIR]\n", argv0);
+	fprintf(stderr, "\nRuns the Ocre containers, and the commands of the ocre shell sent to its socket.\n");
+	fprintf(stderr, "\nOptions:\n");
+	fprintf(stderr, "  -s SOCKET   Path of the socket (default $OCRE_SOCKET or %s)\n", DEFAULT_SOCKET_PATH);
+	fprintf(stderr, "  -w WORKDIR  Working directory of the context (default %s)\n",
+		CONFIG_OCRE_DEFAULT_WORKING_DIRECTORY);
+	return -1;
+}
+
+/* Kills the containers, so the commands waiting for them finish */
+
+static void kill_containers(struct ocre_context *ctx)
+{
+	struct ocre_container **containers;
+	int count;
+
+	/* Commands may create containers meanwhile. With room for one more, we know when the list did not fit */
+
+	for (;;) {
+		int size = ocre_context_get_container_count(ctx);
+		if (size <= 0) {
+			return;
+		}
+
+		containers = calloc(size + 1, sizeof(struct ocre_container *));
+		if (!containers) {
+			fprintf(stderr, "Failed to allocate memory for the containers\n");
+			return;
+		}
+
+		count = ocre_context_get_containers(ctx, containers, size + 1);
+		if (count <= size) {
+			break;
+		}
+
+		free(containers);
+	}
+
+	for (int i = 0; i < count; i++) {
+		ocre_container_status_t status = ocre_container_get_status(containers[i]);
+
+		if (status == OCRE_CONTAINER_STATUS_RUNNING || status == OCRE_CONTAINER_STATUS_PAUSED) {
+			ocre_container_kill(containers[i]);
+		}
+	}
+
+	free(containers);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *socket_path = getenv("OCRE_SOCKET");
+	const char *workdir = NULL;
+	sigset_t signals;
+	int signal;
+	int opt;
+
+	if (!socket_path || !*socket_path) {
+		socket_path = DEFAULT_SOCKET_PATH;
+	}
+
+	while ((opt = getopt(argc, argv, "s:w:")) != -1) {
+		switch (opt) {
+			case 's': {
+				socket_path = optarg;
+				continue;
+			}
+			case 'w': {
+				workdir = optarg;
+				continue;
+			}
+			default: {
+				return usage(argv[0]);
+			}
+		}
+	}
+
+	if (optind != argc) {
+		return usage(argv[0]);
+	}
+
+	/* Block the signals before creating any thread, they are only taken by sigwait() */
+
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigaddset(&signals, SIGHUP);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	if (ocre_initialize(NULL)) {
+		return -1;
+	}
+
+	struct ocre_context *ctx = ocre_create_context(workdir);
+	if (!ctx) {
+		fprintf(stderr, "Failed to create Ocre context\n");
+		ocre_deinitialize();
+		return -1;
+	}
+
+	struct ocre_shell_server *server = ocre_shell_server_start(ctx, socket_path);
+	if (!server) {
+		fprintf(stderr, "Failed to listen on '%s'\n", socket_path);
+		ocre_destroy_context(ctx);
+		ocre_deinitialize();
+		return -1;
+	}
+
+	fprintf(stderr, "Listening on '%s'\n", socket_path);
+
+	sigwait(&signals, &signal);
+
+	fprintf(stderr, "Stopping on signal %d\n", signal);
+
+	kill_containers(ctx);
+
+	ocre_shell_server_stop(server);
+
+	ocre_destroy_context(ctx);
+	ocre_deinitialize();
+
+	return 0;
+}
@@ -5,18 +5,42 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <ocre/ocre.h>
+#include <ocre/platform/config.h>
 
 #include <ocre/shell/shell.h>
 
+#define DEFAULT_SOCKET_PATH CONFIG_OCRE_DEFAULT_WORKING_DIRECTORY "/ocred.sock"
+
 /* keep a reference to the single instance of the runtime */
 
 struct ocre_context *ocre_global_context = NULL;
 
 int main(int argc, char *argv[])
 {
+	int status;
+
+	/* Let the daemon run the command if one is running */
+
+	const char *socket_path = getenv("OCRE_SOCKET");
+	if (!socket_path || !*socket_path) {
+		socket_path = DEFAULT_SOCKET_PATH;
+	}
+
+	int rc = ocre_shell_remote(socket_path, argc, argv, &status);
+	if (!rc) {
+		return status;
+	}
+
+	if (rc != -ENOENT && rc != -ECONNREFUSED) {
+		fprintf(stderr, "Failed to run the command in the daemon at '%s': rc=%d\n", socket_path, rc);
+		return -1;
+	}
+
 	/* Initialize Ocre */
 
 	if (ocre_initialize(NULL)) {
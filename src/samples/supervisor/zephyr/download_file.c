@@ -20,11 +20,18 @@
 #include <zephyr/net/http/client.h>
 #include <zephyr/net/http/status.h>
 
+#include "sha256/sha256.h"
+
 #define OCRE_DOWNLOAD_RESPONSE_BUFFER_SIZE (256)
 
+struct download {
+	int fd;
+	struct sha256_buff buff;
+};
+
 static int response_cb(struct http_response *rsp, enum http_final_call final_data, void *user_data)
 {
-	int fd = *(int *)user_data;
+	struct download *download = user_data;
 
 	if (rsp->http_status_code != HTTP_200_OK) {
 		fprintf(stderr, "Got invalid HTTP status code %d\n", rsp->http_status_code);
@@ -34,20 +41,26 @@ static int response_cb(struct http_response *rsp, enum http_final_call final_dat
 	if (rsp->body_frag_start && rsp->body_frag_len) {
 		size_t body_frag_len = rsp->data_len - (rsp->body_frag_start - rsp->recv_buf);
 
-		int rc = write(fd, rsp->body_frag_start, body_frag_len);
+		int rc = write(download->fd, rsp->body_frag_start, body_frag_len);
 		if (rc < 0) {
 			fprintf(stderr, "Failed to write file: %d\n", rc);
 			return -1;
 		}
+
+		/* Hashed as it arrives, so the image store does not read the file again */
+
+		sha256_update(&download->buff, rsp->body_frag_start, body_frag_len);
 	}
 
 	return 0;
 }
 
-int ocre_download_file(const char *url, const char *filepath)
+int ocre_download_file(const char *url, const char *filepath, char *digest)
 {
+	struct download download = {
+		.fd = -1,
+	};
 	int rc = -1;
-	int fd = -1;
 	int sock = -1;
 	char *hostname = NULL;
 	struct addrinfo *res = NULL;
@@ -129,8 +142,8 @@ int ocre_download_file(const char *url, const char *filepath)
 
 	/* Create file */
 
-	fd = open(filepath, O_CREAT | O_WRONLY, 0644);
-	if (fd < 0) {
+	download.fd = open(filepath, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+	if (download.fd < 0) {
 		fprintf(stderr, "Failed to create file '%s'\n", filepath);
 		goto finish;
 	}
@@ -170,7 +183,9 @@ int ocre_download_file(const char *url, const char *filepath)
 	req.recv_buf = response;
 	req.recv_buf_len = OCRE_DOWNLOAD_RESPONSE_BUFFER_SIZE;
 
-	st = http_client_req(sock, &req, timeout, (void *)&fd);
+	sha256_init(&download.buff);
+
+	st = http_client_req(sock, &req, timeout, &download);
 	fprintf(stderr, "st is %d\n", st);
 	if (st < 0) {
 		fprintf(stderr, "HTTP Client error %d\n", st);
@@ -179,12 +194,18 @@ int ocre_download_file(const char *url, const char *filepath)
 		fprintf(stderr, "finished downloading file!!!!\n");
 	}
 
+	if (digest) {
+		sha256_finalize(&download.buff);
+		sha256_read_hex(&download.buff, digest);
+		digest[64] = '\0';
+	}
+
 	rc = 0;
 
 finish:
 
-	if (fd >= 0) {
-		close(fd);
+	if (download.fd >= 0) {
+		close(download.fd);
 	}
 
 	if (sock >= 0) {
@@ -5,9 +5,34 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdio.h>
+
 #include <ocre/ocre.h>
 
 struct ocre_command {
 	char *name;
 	int (*func)(struct ocre_context *ctx, const char *argv0, int argc, char **argv);
 };
+
+/* Commands print to these streams instead of stdout and stderr. When the daemon runs a command, they send the output
+ * to its client.
+ */
+
+#define shell_out ocre_shell_stdout()
+#define shell_err ocre_shell_stderr()
+
+FILE *ocre_shell_stdout(void);
+FILE *ocre_shell_stderr(void);
+
+/* The streams are per thread. Threads started by a command call this with the streams of the command, NULL for stdout
+ * and stderr
+ */
+
+void ocre_shell_set_streams(FILE *out, FILE *err);
+
+/* getopt() keeps its state in globals, and the daemon runs the commands of several clients at once. Commands hold this
+ * lock while parsing their options, and copy optind before releasing it. Taking the lock resets the parser.
+ */
+
+void ocre_shell_getopt_begin(void);
+void ocre_shell_getopt_end(void);
@@ -12,9 +12,13 @@
 
 #include "command.h"
 
+#include "container/checkpoint.h"
 #include "container/create.h"
 #include "container/kill.h"
+#include "container/logs.h"
+#include "container/natives.h"
 #include "container/pause.h"
+#include "container/profile.h"
 #include "container/ps.h"
 #include "container/rm.h"
 #include "container/start.h"
@@ -24,34 +28,44 @@
 
 static int print_usage(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
 {
-	fprintf(stderr, "Usage: %s container <COMMAND>\n", argv0);
+	fprintf(shell_err, "Usage: %s container <COMMAND>\n", argv0);
 
-	fprintf(stderr, "\nCommands:\n");
-	fprintf(stderr, "  run       Created and starts a new container\n");
-	fprintf(stderr, "  create    Create a new container\n");
-	fprintf(stderr, "  start     Start a container\n");
-	// fprintf(stderr, "  stop      Stop a running or paused container\n");
-	fprintf(stderr, "  kill      Kill a running or paused container\n");
-	// fprintf(stderr, "  pause     Pause a running container\n");
-	// fprintf(stderr, "  unpause   Resume a paused container\n");
-	fprintf(stderr, "  wait      Wait for a container to exit\n");
-	fprintf(stderr, "  ps        List containers\n");
-	fprintf(stderr, "  rm        Remove a stopped container\n");
+	fprintf(shell_err, "\nCommands:\n");
+	fprintf(shell_err, "  run         Created and starts a new container\n");
+	fprintf(shell_err, "  create      Create a new container\n");
+	fprintf(shell_err, "  start       Start a container\n");
+	fprintf(shell_err, "  stop        Stop a running or paused container\n");
+	fprintf(shell_err, "  kill        Kill a running or paused container\n");
+	fprintf(shell_err, "  pause       Pause a running container\n");
+	fprintf(shell_err, "  unpause     Resume a paused container\n");
+	fprintf(shell_err, "  wait        Wait for a container to exit\n");
+	fprintf(shell_err, "  logs        Show the output of a container\n");
+	fprintf(shell_err, "  ps          List containers\n");
+	fprintf(shell_err, "  rm          Remove a stopped container\n");
+	fprintf(shell_err, "  natives     Show the calls to the native functions of a container\n");
+	fprintf(shell_err, "  profile     Profile the functions of a container\n");
+	fprintf(shell_err, "  checkpoint  Save the state of a paused container to a file\n");
+	fprintf(shell_err, "  restore     Restore the state of a container from a file and start it\n");
 	return 0;
 }
 
 static const struct ocre_command commands[] = {
-	{"help", print_usage},		      //
-	{"run", cmd_container_create_run},    //
-	{"create", cmd_container_create_run}, //
-	{"start", cmd_container_start},	      //
-	{"stop", cmd_container_stop},	      //
-	{"kill", cmd_container_kill},	      //
-	{"pause", cmd_container_pause},	      //
-	{"unpause", cmd_container_unpause},   //
-	{"wait", cmd_container_wait},	      //
-	{"ps", cmd_container_ps},	      //
-	{"rm", cmd_container_rm},	      //
+	{"help", print_usage},			  //
+	{"run", cmd_container_create_run},	  //
+	{"create", cmd_container_create_run},	  //
+	{"start", cmd_container_start},		  //
+	{"stop", cmd_container_stop},		  //
+	{"kill", cmd_container_kill},		  //
+	{"pause", cmd_container_pause},		  //
+	{"unpause", cmd_container_unpause},	  //
+	{"wait", cmd_container_wait},		  //
+	{"logs", cmd_container_logs},		  //
+	{"ps", cmd_container_ps},		  //
+	{"rm", cmd_container_rm},		  //
+	{"natives", cmd_container_natives},	  //
+	{"profile", cmd_container_profile},	  //
+	{"checkpoint", cmd_container_checkpoint}, //
+	{"restore", cmd_container_restore},	  //
 };
 
 int cmd_container(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
@@ -66,7 +80,7 @@ int cmd_container(struct ocre_context *ctx, const char *argv0, int argc, char **
 		}
 	}
 
-	fprintf(stderr, "Invalid command: '%s container %s'\n\n", argv0, argv[1]);
+	fprintf(shell_err, "Invalid command: '%s container %s'\n\n", argv0, argv[1]);
 
 	return print_usage(ctx, argv0, argc, argv);
 }
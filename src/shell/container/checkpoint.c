@@ -0,0 +1,195 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#include <ocre/ocre.h>
+
+#include "../command.h"
+
+extern int optind, opterr, optopt;
+
+static int usage(const char *argv0, const char *command)
+{
+	fprintf(shell_err, "Usage: %s container %s [options] CONTAINER\n", argv0, command);
+
+	if (!strcmp(command, "checkpoint")) {
+		fprintf(shell_err, "\nSaves the state of a paused reactor container to a file.\n");
+	} else {
+		fprintf(shell_err, "\nRestores the state of a reactor container from a file, and starts it.\n");
+	}
+
+	fprintf(shell_err, "\nOptions:\n");
+	fprintf(shell_err, "  -f FILE  Sets the checkpoint file (default: checkpoints/CONTAINER.ckpt in the working "
+			   "directory)\n");
+	return -1;
+}
+
+/* Parses the options, returns the container id or NULL */
+
+static const char *parse_args(const char *argv0, const char *command, int argc, char **argv, const char **file)
+{
+	bool valid = true;
+
+	ocre_shell_getopt_begin();
+
+	int opt;
+	while (valid && (opt = getopt(argc, argv, "+f:")) != -1) {
+		switch (opt) {
+			case 'f': {
+				*file = optarg;
+				continue;
+			}
+			default: {
+				usage(argv0, command);
+				valid = false;
+				continue;
+			}
+		}
+	}
+
+	int first_arg = optind;
+
+	ocre_shell_getopt_end();
+
+	if (!valid) {
+		return NULL;
+	}
+
+	if (first_arg != argc - 1) {
+		fprintf(shell_err, "'%s container %s' requires exactly one container\n\n", argv0, command);
+		usage(argv0, command);
+		return NULL;
+	}
+
+	return argv[first_arg];
+}
+
+static char *default_path(struct ocre_context *ctx, const char *id, bool create_dir)
+{
+	const char *working_directory = ocre_context_get_working_directory(ctx);
+
+	size_t size = strlen(working_directory) + strlen("/checkpoints/") + strlen(id) + strlen(".ckpt") + 1;
+
+	char *path = malloc(size);
+	if (!path) {
+		fprintf(shell_err, "Failed to allocate memory for the checkpoint path\n");
+		return NULL;
+	}
+
+	snprintf(path, size, "%s/checkpoints", working_directory);
+
+	if (create_dir && mkdir(path, 0755) && errno != EEXIST) {
+		fprintf(shell_err, "Failed to create directory '%s': errno=%d\n", path, errno);
+		free(path);
+		return NULL;
+	}
+
+	snprintf(path, size, "%s/checkpoints/%s.ckpt", working_directory, id);
+
+	return path;
+}
+
+int cmd_container_checkpoint(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
+{
+	const char *file = NULL;
+	char *path = NULL;
+
+	const char *id = parse_args(argv0, "checkpoint", argc, argv, &file);
+	if (!id) {
+		return -1;
+	}
+
+	struct ocre_container *container = ocre_context_get_container_by_id(ctx, id);
+	if (!container) {
+		fprintf(shell_err, "Failed to get container '%s'\n", id);
+		return -1;
+	}
+
+	if (ocre_container_get_status(container) != OCRE_CONTAINER_STATUS_PAUSED) {
+		fprintf(shell_err, "Container '%s' must be paused to be checkpointed\n", id);
+		return -1;
+	}
+
+	if (!file) {
+		path = default_path(ctx, id, true);
+		if (!path) {
+			return -1;
+		}
+
+		file = path;
+	}
+
+	int rc = ocre_container_checkpoint(container, file);
+	if (rc) {
+		fprintf(shell_err, "Failed to checkpoint container '%s'\n", id);
+	} else {
+		fprintf(shell_out, "%s\n", file);
+	}
+
+	free(path);
+
+	return rc;
+}
+
+int cmd_container_restore(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
+{
+	const char *file = NULL;
+	char *path = NULL;
+
+	const char *id = parse_args(argv0, "restore", argc, argv, &file);
+	if (!id) {
+		return -1;
+	}
+
+	struct ocre_container *container = ocre_context_get_container_by_id(ctx, id);
+	if (!container) {
+		fprintf(shell_err, "Failed to get container '%s'\n", id);
+		return -1;
+	}
+
+	ocre_container_status_t status = ocre_container_get_status(container);
+	if (status != OCRE_CONTAINER_STATUS_CREATED && status != OCRE_CONTAINER_STATUS_STOPPED) {
+		fprintf(shell_err, "Container '%s' is not ready to run\n", id);
+		return -1;
+	}
+
+	if (!file) {
+		path = default_path(ctx, id, false);
+		if (!path) {
+			return -1;
+		}
+
+		file = path;
+	}
+
+	int rc = ocre_container_restore(container, file);
+	if (rc) {
+		fprintf(shell_err, "Failed to restore container '%s' from '%s'\n", id, file);
+		goto finish;
+	}
+
+	rc = ocre_container_start(container);
+	if (rc) {
+		fprintf(shell_err, "Failed to start container '%s'\n", id);
+		goto finish;
+	}
+
+	fprintf(shell_out, "%s\n", id);
+
+finish:
+	free(path);
+
+	return rc;
+}
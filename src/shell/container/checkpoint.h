@@ -0,0 +1,12 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ocre/ocre.h>
+
+int cmd_container_checkpoint(struct ocre_context *ctx, const char *argv0, int argc, char **argv);
+
+int cmd_container_restore(struct ocre_context *ctx, const char *argv0, int argc, char **argv);
@@ -5,6 +5,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,23 +19,50 @@
 extern char *optarg;
 extern int optind, opterr, optopt;
 
+/* Parses SIZE[k|m], returns zero if invalid */
+
+static unsigned long parse_size(const char *arg)
+{
+	char *end;
+	unsigned long size = strtoul(arg, &end, 10);
+
+	if (*end == 'k' || *end == 'K') {
+		size *= 1024;
+		end++;
+	} else if (*end == 'm' || *end == 'M') {
+		size *= 1024 * 1024;
+		end++;
+	}
+
+	return *end == '\0' ? size : 0;
+}
+
 static int usage(const char *argv0, const char *cmd)
 {
-	fprintf(stderr, "Usage: %s container %s [options] IMAGE [ARG...]\n", argv0, cmd);
+	fprintf(shell_err, "Usage: %s container %s [options] IMAGE [ARG...]\n", argv0, cmd);
 	if (!strcmp(cmd, "create")) {
-		fprintf(stderr, "\nCreates a container in the Ocre context.\n");
+		fprintf(shell_err, "\nCreates a container in the Ocre context.\n");
 	} else if (!strcmp(cmd, "run")) {
-		fprintf(stderr, "\nCreates and starts a container in the Ocre context.\n");
+		fprintf(shell_err, "\nCreates and starts a container in the Ocre context.\n");
 	}
-	fprintf(stderr, "\nOptions:\n");
-	fprintf(stderr, "  -d                       Creates a detached container\n");
-	fprintf(stderr, "  -n CONTAINER_ID          Specifies a container ID\n");
-	fprintf(stderr, "  -r RUNTIME               Specifies the runtime to use\n");
-	fprintf(stderr, "  -v VOLUME:MOUNTPOINT     Adds a volume to be mounted into the container\n");
-	fprintf(stderr, "  -v /ABSPATH:MOUNTPOINT   Adds a directory to be mounted into the container\n");
-	fprintf(stderr, "  -k CAPABILITY            Adds a capability to the container\n");
-	fprintf(stderr, "  -e VAR=VALUE             Sets an environment variable in the container\n");
-	fprintf(stderr, "\nOptions '-v' and '-e' and '-k' can be supplied multiple times.\n");
+	fprintf(shell_err, "\nOptions:\n");
+	fprintf(shell_err, "  -d                       Creates a detached container\n");
+	fprintf(shell_err, "  -n CONTAINER_ID          Specifies a container ID\n");
+	fprintf(shell_err, "  -r RUNTIME               Specifies the runtime to use\n");
+	fprintf(shell_err, "  -v VOLUME:MOUNTPOINT     Adds a volume to be mounted into the container\n");
+	fprintf(shell_err, "  -v /ABSPATH:MOUNTPOINT   Adds a directory to be mounted into the container\n");
+	fprintf(shell_err, "  -k CAPABILITY            Adds a capability to the container\n");
+	fprintf(shell_err, "  -e VAR=VALUE             Sets an environment variable in the container\n");
+	fprintf(shell_err, "  -c QUOTA_US[:PERIOD_US]  Limits CPU time per period (default period 100000)\n");
+	fprintf(shell_err, "  -m SIZE[k|m]             Limits the memory the runtime allocates for the container\n");
+	fprintf(shell_err, "  -R                       Runs the container as a reactor on the shared worker pool\n");
+	fprintf(shell_err, "  -s SIZE[k|m]             Sets the native stack size of the container thread\n");
+	fprintf(shell_err, "  -C CPUSET                Pins the container thread to CPUs (e.g. 0-3,6)\n");
+	fprintf(shell_err, "  -S POLICY[:PRIORITY]     Sets the scheduling policy (other, fifo or rr)\n");
+	fprintf(shell_err, "  -P POLICY[:MAX_RETRIES]  Sets the restart policy (no, on-failure or always)\n");
+	fprintf(shell_err, "  -L                       Captures the output of the container, for 'container logs'\n");
+	fprintf(shell_err, "  -l SIZE[k|m]             Also writes the captured output to a file rotated at SIZE\n");
+	fprintf(shell_err, "\nOptions '-v' and '-e' and '-k' can be supplied multiple times.\n");
 
 	return -1;
 }
@@ -44,11 +72,12 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 	int ret = -1;
 
 	if (argc < 2) {
-		fprintf(stderr, "'%s container %s' requires arguments\n\n", argv0, argv[0]);
+		fprintf(shell_err, "'%s container %s' requires arguments\n\n", argv0, argv[0]);
 		return usage(argv0, argv[0]);
 	}
 
 	bool detached = false;
+	bool reactor = false;
 	const char *runtime = NULL;
 	const char *container_id = NULL;
 	const char **capabilities = NULL;
@@ -59,12 +88,67 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 	size_t environment_count = 0;
 	size_t mounts_count = 0;
 
+	unsigned long cpu_quota_us = 0;
+	unsigned long cpu_period_us = 0;
+	unsigned long memory_limit = 0;
+
+	unsigned long stack_size = 0;
+	const char *cpuset = NULL;
+	enum ocre_sched_policy sched_policy = OCRE_SCHED_DEFAULT;
+	long sched_priority = 0;
+	enum ocre_restart_policy restart_policy = OCRE_RESTART_NO;
+	unsigned long restart_max_retries = 0;
+	bool restart_set = false;
+	bool capture_logs = false;
+	unsigned long log_file_size = 0;
+
+	/* Released once the options are parsed, or on cleanup */
+
+	bool parsing = true;
+	ocre_shell_getopt_begin();
+
 	int opt;
-	while ((opt = getopt(argc, argv, "+de:k:n:r:v:")) != -1) {
+	while ((opt = getopt(argc, argv, "+C:c:de:k:Ll:m:n:P:Rr:S:s:v:")) != -1) {
 		switch (opt) {
+			case 'C': {
+				if (cpuset) {
+					fprintf(shell_err, "CPU set can be set only once\n\n");
+					usage(argv0, argv[0]);
+					goto cleanup;
+				}
+
+				cpuset = optarg;
+				continue;
+			}
+			case 'c': {
+				if (cpu_quota_us) {
+					fprintf(shell_err, "CPU quota can be set only once\n\n");
+					usage(argv0, argv[0]);
+					goto cleanup;
+				}
+
+				char *end;
+				cpu_quota_us = strtoul(optarg, &end, 10);
+				if (*end == ':') {
+					cpu_period_us = strtoul(end + 1, &end, 10);
+					if (!cpu_period_us) {
+						fprintf(shell_err, "Invalid CPU quota period in '%s'\n", optarg);
+						goto cleanup;
+					}
+				}
+
+				if (*end != '\0' || !cpu_quota_us || cpu_quota_us > UINT_MAX ||
+				    cpu_period_us > UINT_MAX) {
+					fprintf(shell_err, "Invalid CPU quota '%s': must be QUOTA_US[:PERIOD_US]\n",
+						optarg);
+					goto cleanup;
+				}
+
+				continue;
+			}
 			case 'd': {
 				if (detached) {
-					fprintf(stderr, "Detached mode can be set only once\n\n");
+					fprintf(shell_err, "Detached mode can be set only once\n\n");
 					usage(argv0, argv[0]);
 					goto cleanup;
 				}
@@ -72,9 +156,24 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 				detached = true;
 				continue;
 			}
+			case 'm': {
+				if (memory_limit) {
+					fprintf(shell_err, "Memory limit can be set only once\n\n");
+					usage(argv0, argv[0]);
+					goto cleanup;
+				}
+
+				memory_limit = parse_size(optarg);
+				if (!memory_limit) {
+					fprintf(shell_err, "Invalid memory limit '%s': must be SIZE[k|m]\n", optarg);
+					goto cleanup;
+				}
+
+				continue;
+			}
 			case 'n': {
 				if (container_id) {
-					fprintf(stderr, "Container ID can be set only once\n\n");
+					fprintf(shell_err, "Container ID can be set only once\n\n");
 					usage(argv0, argv[0]);
 					goto cleanup;
 				}
@@ -82,7 +181,7 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 				/* Check if the provided container ID is valid */
 
 				if (optarg && !ocre_is_valid_name(optarg)) {
-					fprintf(stderr,
+					fprintf(shell_err,
 						"Invalid characters in container ID '%s'. Valid are [a-z0-9_-.] "
 						"(lowercase alphanumeric) and cannot start with '.'\n",
 						optarg);
@@ -92,9 +191,76 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 				container_id = optarg;
 				continue;
 			}
+			case 'P': {
+				if (restart_set) {
+					fprintf(shell_err, "Restart policy can be set only once\n\n");
+					usage(argv0, argv[0]);
+					goto cleanup;
+				}
+
+				char *end = strchr(optarg, ':');
+				size_t len = end ? (size_t)(end - optarg) : strlen(optarg);
+
+				if (len == 2 && !strncmp(optarg, "no", len)) {
+					restart_policy = OCRE_RESTART_NO;
+				} else if (len == 10 && !strncmp(optarg, "on-failure", len)) {
+					restart_policy = OCRE_RESTART_ON_FAILURE;
+				} else if (len == 6 && !strncmp(optarg, "always", len)) {
+					restart_policy = OCRE_RESTART_ALWAYS;
+				} else {
+					fprintf(shell_err,
+						"Invalid restart policy '%s': must be no, on-failure or always\n",
+						optarg);
+					goto cleanup;
+				}
+
+				if (end) {
+					const char *retries = end + 1;
+
+					restart_max_retries = strtoul(retries, &end, 10);
+					if (end == retries || *end != '\0' || restart_max_retries > UINT_MAX) {
+						fprintf(shell_err, "Invalid maximum number of retries in '%s'\n",
+							optarg);
+						goto cleanup;
+					}
+				}
+
+				restart_set = true;
+				continue;
+			}
+			case 'L': {
+				capture_logs = true;
+				continue;
+			}
+			case 'l': {
+				if (log_file_size) {
+					fprintf(shell_err, "Log file size can be set only once\n\n");
+					usage(argv0, argv[0]);
+					goto cleanup;
+				}
+
+				log_file_size = parse_size(optarg);
+				if (!log_file_size) {
+					fprintf(shell_err, "Invalid log file size '%s': must be SIZE[k|m]\n", optarg);
+					goto cleanup;
+				}
+
+				capture_logs = true;
+				continue;
+			}
+			case 'R': {
+				if (reactor) {
+					fprintf(shell_err, "Reactor mode can be set only once\n\n");
+					usage(argv0, argv[0]);
+					goto cleanup;
+				}
+
+				reactor = true;
+				continue;
+			}
 			case 'r': {
 				if (runtime) {
-					fprintf(stderr, "Runtime can be set only once\n\n");
+					fprintf(shell_err, "Runtime can be set only once\n\n");
 					usage(argv0, argv[0]);
 					goto cleanup;
 				}
@@ -102,6 +268,56 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 				runtime = optarg;
 				continue;
 			}
+			case 'S': {
+				if (sched_policy != OCRE_SCHED_DEFAULT) {
+					fprintf(shell_err, "Scheduling policy can be set only once\n\n");
+					usage(argv0, argv[0]);
+					goto cleanup;
+				}
+
+				char *end = strchr(optarg, ':');
+				size_t len = end ? (size_t)(end - optarg) : strlen(optarg);
+
+				if (len == 5 && !strncmp(optarg, "other", len)) {
+					sched_policy = OCRE_SCHED_OTHER;
+				} else if (len == 4 && !strncmp(optarg, "fifo", len)) {
+					sched_policy = OCRE_SCHED_FIFO;
+				} else if (len == 2 && !strncmp(optarg, "rr", len)) {
+					sched_policy = OCRE_SCHED_RR;
+				} else {
+					fprintf(shell_err,
+						"Invalid scheduling policy '%s': must be other, fifo or rr\n", optarg);
+					goto cleanup;
+				}
+
+				if (end) {
+					const char *priority = end + 1;
+
+					sched_priority = strtol(priority, &end, 10);
+					if (end == priority || *end != '\0' || sched_priority < INT_MIN ||
+					    sched_priority > INT_MAX) {
+						fprintf(shell_err, "Invalid scheduling priority in '%s'\n", optarg);
+						goto cleanup;
+					}
+				}
+
+				continue;
+			}
+			case 's': {
+				if (stack_size) {
+					fprintf(shell_err, "Stack size can be set only once\n\n");
+					usage(argv0, argv[0]);
+					goto cleanup;
+				}
+
+				stack_size = parse_size(optarg);
+				if (!stack_size) {
+					fprintf(shell_err, "Invalid stack size '%s': must be SIZE[k|m]\n", optarg);
+					goto cleanup;
+				}
+
+				continue;
+			}
 			case 'v': {
 
 				/* Check mounts parameters of format <source>:<destination>
@@ -111,29 +327,29 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 				 */
 
 				if (optarg[0] != '/') {
-					fprintf(stderr, "Invalid mount format: '%s': source must be absolute path\n",
+					fprintf(shell_err, "Invalid mount format: '%s': source must be absolute path\n",
 						optarg);
 					goto cleanup;
 				}
 
 				char *dst = strchr(optarg, ':');
 				if (!dst) {
-					fprintf(stderr, "Invalid mount format: '%s': must be <source>:<destination>\n",
-						optarg);
+					fprintf(shell_err,
+						"Invalid mount format: '%s': must be <source>:<destination>\n", optarg);
 					goto cleanup;
 				}
 
 				dst++;
 
 				if (dst[0] != '/') {
-					fprintf(stderr,
+					fprintf(shell_err,
 						"Invalid mount format: '%s': destination must be absolute path\n",
 						optarg);
 					goto cleanup;
 				}
 
 				if (dst[1] == '\0') {
-					fprintf(stderr, "Invalid mount format: '%s': destination must not be '/'\n",
+					fprintf(shell_err, "Invalid mount format: '%s': destination must not be '/'\n",
 						optarg);
 					goto cleanup;
 				}
@@ -173,16 +389,21 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 				continue;
 			}
 			case '?': {
-				fprintf(stderr, "Invalid option '-%c'\n", optopt);
+				fprintf(shell_err, "Invalid option '-%c'\n", optopt);
 				goto cleanup;
 			}
 			default: {
-				fprintf(stderr, "Invalid option '-%c'\n", optopt);
+				fprintf(shell_err, "Invalid option '-%c'\n", optopt);
 				goto cleanup;
 			}
 		}
 	}
 
+	int first_arg = optind;
+
+	ocre_shell_getopt_end();
+	parsing = false;
+
 	environment = realloc(environment, sizeof(char *) * (environment_count + 1));
 	environment[environment_count++] = NULL;
 
@@ -192,41 +413,53 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 	mounts = realloc(mounts, sizeof(char *) * (mounts_count + 1));
 	mounts[mounts_count++] = NULL;
 
-	if (optind >= argc) {
-		fprintf(stderr, "'%s container %s' requires at least one non option argument\n\n", argv0, argv[0]);
+	if (first_arg >= argc) {
+		fprintf(shell_err, "'%s container %s' requires at least one non option argument\n\n", argv0, argv[0]);
 		usage(argv0, argv[0]);
 		goto cleanup;
 	}
 
 	/* Check if the provided image ID is valid */
 
-	if (argv[optind] && !ocre_is_valid_name(argv[optind])) {
-		fprintf(stderr,
+	if (argv[first_arg] && !ocre_is_valid_name(argv[first_arg])) {
+		fprintf(shell_err,
 			"Invalid characters in image ID '%s'. Valid are [a-z0-9_-.] (lowercase alphanumeric) and "
 			"cannot start with '.'",
-			argv[optind]);
+			argv[first_arg]);
 		goto cleanup;
 	}
 
 	const struct ocre_container_args arguments = {
-		.argv = (const char **)&argv[optind + 1],
+		.argv = (const char **)&argv[first_arg + 1],
 		.capabilities = capabilities,
 		.envp = environment,
 		.mounts = mounts,
+		.cpu_quota_us = (unsigned int)cpu_quota_us,
+		.cpu_period_us = (unsigned int)cpu_period_us,
+		.memory_limit = (size_t)memory_limit,
+		.reactor = reactor,
+		.stack_size = (size_t)stack_size,
+		.cpuset = cpuset,
+		.sched_policy = sched_policy,
+		.sched_priority = (int)sched_priority,
+		.restart_policy = restart_policy,
+		.restart_max_retries = (unsigned int)restart_max_retries,
+		.capture_logs = capture_logs,
+		.log_file_size = (size_t)log_file_size,
 	};
 
 	struct ocre_container *container =
-		ocre_context_create_container(ctx, argv[optind], runtime, container_id, detached, &arguments,
+		ocre_context_create_container(ctx, argv[first_arg], runtime, container_id, detached, &arguments,
 					      STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO);
 
 	if (!container) {
-		fprintf(stderr, "Failed to create container\n");
+		fprintf(shell_err, "Failed to create container\n");
 		goto cleanup;
 	}
 
 	if (!strcmp(argv[0], "run")) {
 		if (ocre_container_start(container)) {
-			fprintf(stderr, "Failed to start container\n");
+			fprintf(shell_err, "Failed to start container\n");
 			goto cleanup;
 		}
 	}
@@ -234,12 +467,16 @@ int cmd_container_create_run(struct ocre_context *ctx, const char *argv0, int ar
 	if (detached || !strcmp(argv[0], "create")) {
 		const char *cid = ocre_container_get_id(container);
 
-		fprintf(stdout, "%s\n", cid);
+		fprintf(shell_out, "%s\n", cid);
 	}
 
 	ret = 0;
 
 cleanup:
+	if (parsing) {
+		ocre_shell_getopt_end();
+	}
+
 	free(mounts);
 	free(capabilities);
 	free(environment);
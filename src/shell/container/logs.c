@@ -0,0 +1,119 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <ocre/ocre.h>
+
+#include "../command.h"
+
+extern int optind, opterr, optopt;
+
+/* How long to wait for output before checking whether the container is still running */
+
+#define FOLLOW_POLL_MS 500
+
+static int usage(const char *argv0)
+{
+	fprintf(shell_err, "Usage: %s container logs [options] CONTAINER\n", argv0);
+	fprintf(shell_err, "\nShows the output of a container created with capture of its output.\n");
+	fprintf(shell_err, "\nOptions:\n");
+	fprintf(shell_err, "  -f  Follows the output until the container exits\n");
+	return -1;
+}
+
+static bool is_active(struct ocre_container *container)
+{
+	ocre_container_status_t status = ocre_container_get_status(container);
+
+	return status == OCRE_CONTAINER_STATUS_RUNNING || status == OCRE_CONTAINER_STATUS_PAUSED;
+}
+
+int cmd_container_logs(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
+{
+	bool follow = false;
+	bool valid = true;
+
+	ocre_shell_getopt_begin();
+
+	int opt;
+	while (valid && (opt = getopt(argc, argv, "+f")) != -1) {
+		switch (opt) {
+			case 'f': {
+				follow = true;
+				continue;
+			}
+			default: {
+				usage(argv0);
+				valid = false;
+				continue;
+			}
+		}
+	}
+
+	int first_arg = optind;
+
+	ocre_shell_getopt_end();
+
+	if (!valid) {
+		return -1;
+	}
+
+	if (first_arg != argc - 1) {
+		fprintf(shell_err, "'%s container logs' requires exactly one container\n\n", argv0);
+		return usage(argv0);
+	}
+
+	const char *id = argv[first_arg];
+
+	struct ocre_container *container = ocre_context_get_container_by_id(ctx, id);
+	if (!container) {
+		fprintf(shell_err, "Failed to get container '%s'\n", id);
+		return -1;
+	}
+
+	char buf[1024];
+	uint64_t cursor = 0;
+	bool active = follow && is_active(container);
+
+	for (;;) {
+		/* Check before reading, so the output written until the container exited is not missed */
+
+		if (active) {
+			active = is_active(container);
+		}
+
+		int n = ocre_container_read_logs(container, &cursor, buf, sizeof(buf), active ? FOLLOW_POLL_MS : 0);
+		if (n < 0) {
+			fprintf(shell_err, "Output of container '%s' is not captured\n", id);
+			return -1;
+		}
+
+		if (n > 0) {
+			fwrite(buf, 1, n, shell_out);
+			fflush(shell_out);
+
+			/* Stop following when the client went away */
+
+			if (ferror(shell_out)) {
+				return -1;
+			}
+
+			continue;
+		}
+
+		if (!active) {
+			break;
+		}
+	}
+
+	return 0;
+}
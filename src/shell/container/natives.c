@@ -0,0 +1,93 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ocre/ocre.h>
+
+#include "../command.h"
+
+static int usage(const char *argv0)
+{
+	fprintf(shell_err, "Usage: %s container natives CONTAINER\n", argv0);
+	fprintf(shell_err, "\nShows the calls to the native functions of a container.\n");
+	return -1;
+}
+
+static int compare_total(const void *a, const void *b)
+{
+	const struct ocre_native_stats *sa = a;
+	const struct ocre_native_stats *sb = b;
+
+	if (sa->total_ns != sb->total_ns) {
+		return sa->total_ns < sb->total_ns ? 1 : -1;
+	}
+
+	return strcmp(sa->name, sb->name);
+}
+
+static int show_natives(struct ocre_container *container, const char *id)
+{
+	int count = ocre_container_get_native_stats(container, NULL, 0);
+	if (count < 0) {
+		fprintf(shell_err, "Native profiling is not available for container '%s'\n", id);
+		return -1;
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+
+	struct ocre_native_stats *stats = malloc(sizeof(struct ocre_native_stats) * count);
+	if (!stats) {
+		fprintf(shell_err, "Failed to allocate memory for native statistics\n");
+		return -1;
+	}
+
+	count = ocre_container_get_native_stats(container, stats, count);
+	if (count < 0) {
+		fprintf(shell_err, "Failed to get native statistics of container '%s'\n", id);
+		free(stats);
+		return -1;
+	}
+
+	qsort(stats, count, sizeof(struct ocre_native_stats), compare_total);
+
+	fprintf(shell_out, "NATIVE\tCALLS\tTOTAL (us)\tAVERAGE (ns)\n");
+
+	for (int i = 0; i < count; i++) {
+		if (!stats[i].calls) {
+			continue;
+		}
+
+		fprintf(shell_out, "%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\n", stats[i].name, stats[i].calls,
+			stats[i].total_ns / 1000, stats[i].total_ns / stats[i].calls);
+	}
+
+	free(stats);
+
+	return 0;
+}
+
+int cmd_container_natives(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
+{
+	if (argc != 2) {
+		fprintf(shell_err, "'%s container natives' requires exactly one argument\n\n", argv0);
+		return usage(argv0);
+	}
+
+	struct ocre_container *container = ocre_context_get_container_by_id(ctx, argv[1]);
+	if (!container) {
+		fprintf(shell_err, "Failed to get container '%s'\n", argv[1]);
+		return -1;
+	}
+
+	return show_natives(container, argv[1]);
+}
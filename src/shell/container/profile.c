@@ -0,0 +1,159 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <ocre/ocre.h>
+
+#include "../command.h"
+
+extern int optind, opterr, optopt;
+
+#define DEFAULT_SAMPLE_PERIOD_MS 10
+
+static int usage(const char *argv0)
+{
+	fprintf(shell_err, "Usage: %s container profile [options] CONTAINER\n", argv0);
+	fprintf(shell_err, "\nShows the calls, execution time and memory of the functions of a container.\n");
+	fprintf(shell_err, "\nOptions:\n");
+	fprintf(shell_err, "  -s SECONDS    Samples the call stack of the running container instead, and prints\n");
+	fprintf(shell_err, "                the folded stacks for flame graph tools\n");
+	fprintf(shell_err, "  -p PERIOD_MS  Sets the time between samples (default %d)\n", DEFAULT_SAMPLE_PERIOD_MS);
+	return -1;
+}
+
+static int parse_uint(const char *arg, unsigned int *value)
+{
+	char *end;
+	unsigned long n = strtoul(arg, &end, 10);
+
+	if (end == arg || *end != '\0' || !n || n > UINT_MAX) {
+		return -1;
+	}
+
+	*value = (unsigned int)n;
+
+	return 0;
+}
+
+static int show_profile(struct ocre_container *container, const char *id)
+{
+	char *buf = NULL;
+	size_t size = 0;
+
+	int len = ocre_container_get_profile(container, NULL, 0);
+
+	/* The profile of a running container may grow between two calls, so try again until it fits */
+
+	while (len >= 0 && (size_t)len >= size) {
+		size = len + 1;
+
+		char *new_buf = realloc(buf, size);
+		if (!new_buf) {
+			fprintf(shell_err, "Failed to allocate memory for the profile\n");
+			free(buf);
+			return -1;
+		}
+
+		buf = new_buf;
+		len = ocre_container_get_profile(container, buf, size);
+	}
+
+	if (len < 0) {
+		fprintf(shell_err, "Profiling is not available for container '%s'\n", id);
+		free(buf);
+		return -1;
+	}
+
+	fputs(buf, shell_out);
+
+	free(buf);
+
+	return 0;
+}
+
+static void print_stack(void *arg, const char *stack, unsigned int count)
+{
+	(void)arg;
+
+	fprintf(shell_out, "%s %u\n", stack, count);
+}
+
+int cmd_container_profile(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
+{
+	unsigned int sample_s = 0;
+	unsigned int period_ms = DEFAULT_SAMPLE_PERIOD_MS;
+
+	bool valid = true;
+
+	ocre_shell_getopt_begin();
+
+	int opt;
+	while (valid && (opt = getopt(argc, argv, "+p:s:")) != -1) {
+		switch (opt) {
+			case 'p': {
+				if (parse_uint(optarg, &period_ms)) {
+					fprintf(shell_err, "Invalid sampling period '%s'\n", optarg);
+					valid = false;
+				}
+
+				continue;
+			}
+			case 's': {
+				if (parse_uint(optarg, &sample_s) || sample_s > UINT_MAX / 1000) {
+					fprintf(shell_err, "Invalid sampling duration '%s'\n", optarg);
+					valid = false;
+				}
+
+				continue;
+			}
+			default: {
+				usage(argv0);
+				valid = false;
+				continue;
+			}
+		}
+	}
+
+	int first_arg = optind;
+
+	ocre_shell_getopt_end();
+
+	if (!valid) {
+		return -1;
+	}
+
+	if (first_arg != argc - 1) {
+		fprintf(shell_err, "'%s container profile' requires exactly one container\n\n", argv0);
+		return usage(argv0);
+	}
+
+	const char *id = argv[first_arg];
+
+	struct ocre_container *container = ocre_context_get_container_by_id(ctx, id);
+	if (!container) {
+		fprintf(shell_err, "Failed to get container '%s'\n", id);
+		return -1;
+	}
+
+	if (!sample_s) {
+		return show_profile(container, id);
+	}
+
+	int rc = ocre_container_sample(container, sample_s * 1000, period_ms, print_stack, NULL);
+	if (rc < 0) {
+		fprintf(shell_err, "Failed to sample container '%s'\n", id);
+		return -1;
+	}
+
+	return 0;
+}
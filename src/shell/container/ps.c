@@ -23,14 +23,30 @@ static const char *container_statuses[] = {"UNKNOWN", //
 
 static int usage(const char *argv0)
 {
-	fprintf(stderr, "Usage: %s container ps [CONTAINER]\n", argv0);
-	fprintf(stderr, "\nList containers in Ocre context.\n");
+	fprintf(shell_err, "Usage: %s container ps [CONTAINER]\n", argv0);
+	fprintf(shell_err, "\nList containers in Ocre context.\n");
 	return -1;
 }
 
 static void header(void)
 {
-	printf("ID\tSTATUS\tIMAGE\n");
+	fprintf(shell_out, "ID\tSTATUS\tIMAGE\tMEMORY\n");
+}
+
+/* Memory allocated for the container, and its limit if any. Dash if not accounted */
+
+static void format_memory(struct ocre_container *container, char *buf, size_t size)
+{
+	struct ocre_memory_stats stats;
+
+	if (ocre_container_get_memory_stats(container, &stats)) {
+		snprintf(buf, size, "-");
+	} else if (stats.limit) {
+		snprintf(buf, size, "%lluk/%lluk", (unsigned long long)(stats.reserved / 1024),
+			 (unsigned long long)(stats.limit / 1024));
+	} else {
+		snprintf(buf, size, "%lluk", (unsigned long long)(stats.reserved / 1024));
+	}
 }
 
 static int list_container(struct ocre_container *container)
@@ -43,7 +59,10 @@ static int list_container(struct ocre_container *container)
 		return -1;
 	}
 
-	printf("%s\t%s\t%s\n", id, container_statuses[status], image);
+	char memory[48];
+	format_memory(container, memory, sizeof(memory));
+
+	fprintf(shell_out, "%s\t%s\t%s\t%s\n", id, container_statuses[status], image, memory);
 
 	return 0;
 }
@@ -53,7 +72,7 @@ static int list_containers(struct ocre_context *ctx)
 	int ret = -1;
 	int num_containers = ocre_context_get_container_count(ctx);
 	if (num_containers < 0) {
-		fprintf(stderr, "Failed to get number of containers\n");
+		fprintf(shell_err, "Failed to get number of containers\n");
 		return -1;
 	}
 
@@ -63,19 +82,19 @@ static int list_containers(struct ocre_context *ctx)
 
 	struct ocre_container **containers = malloc(sizeof(struct ocre_container *) * num_containers);
 	if (!containers) {
-		fprintf(stderr, "Failed to allocate memory for containers\n");
+		fprintf(shell_err, "Failed to allocate memory for containers\n");
 		return -1;
 	}
 
 	num_containers = ocre_context_get_containers(ctx, containers, num_containers);
 	if (num_containers < 0) {
-		fprintf(stderr, "Failed to list containers\n");
+		fprintf(shell_err, "Failed to list containers\n");
 		goto finish;
 	}
 
 	for (int i = 0; i < num_containers; i++) {
 		if (list_container(containers[i])) {
-			fprintf(stderr, "Failed to list container %d\n", i);
+			fprintf(shell_err, "Failed to list container %d\n", i);
 			goto finish;
 		}
 	}
@@ -97,7 +116,7 @@ int cmd_container_ps(struct ocre_context *ctx, const char *argv0, int argc, char
 		case 2: {
 			struct ocre_container *container = ocre_context_get_container_by_id(ctx, argv[1]);
 			if (!container) {
-				fprintf(stderr, "Failed to get container '%s'\n", argv[1]);
+				fprintf(shell_err, "Failed to get container '%s'\n", argv[1]);
 				return -1;
 			}
 
@@ -105,7 +124,7 @@ int cmd_container_ps(struct ocre_context *ctx, const char *argv0, int argc, char
 			return list_container(container);
 		}
 		default:
-			fprintf(stderr, "'%s container ps' requires at most one argument\n\n", argv0);
+			fprintf(shell_err, "'%s container ps' requires at most one argument\n\n", argv0);
 			return usage(argv0);
 	}
 }
@@ -14,8 +14,8 @@
 
 static int usage(const char *argv0)
 {
-	fprintf(stderr, "Usage: %s container start CONTAINER\n", argv0);
-	fprintf(stderr, "\nStarts a container in the Ocre context.\n");
+	fprintf(shell_err, "Usage: %s container start CONTAINER\n", argv0);
+	fprintf(shell_err, "\nStarts a container in the Ocre context.\n");
 	return -1;
 }
 
@@ -24,23 +24,23 @@ int cmd_container_start(struct ocre_context *ctx, const char *argv0, int argc, c
 	if (argc == 2) {
 		struct ocre_container *container = ocre_context_get_container_by_id(ctx, argv[1]);
 		if (!container) {
-			fprintf(stderr, "Failed to get container '%s'\n", argv[1]);
+			fprintf(shell_err, "Failed to get container '%s'\n", argv[1]);
 			return -1;
 		}
 
 		ocre_container_status_t status = ocre_container_get_status(container);
 		if (status != OCRE_CONTAINER_STATUS_CREATED && status != OCRE_CONTAINER_STATUS_STOPPED) {
-			fprintf(stderr, "Container '%s' is not ready to run\n", argv[1]);
+			fprintf(shell_err, "Container '%s' is not ready to run\n", argv[1]);
 			return -1;
 		}
 
 		int rc = ocre_container_start(container);
 
-		fprintf(stdout, "%s\n", argv[1]);
+		fprintf(shell_out, "%s\n", argv[1]);
 
 		return rc;
 	} else {
-		fprintf(stderr, "'%s container start' requires exactly one argument\n\n", argv0);
+		fprintf(shell_err, "'%s container start' requires exactly one argument\n\n", argv0);
 		return usage(argv0);
 	}
 
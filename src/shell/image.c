@@ -16,12 +16,12 @@
 
 static int print_usage(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
 {
-	fprintf(stderr, "Usage: %s image <COMMAND>\n", argv0);
+	fprintf(shell_err, "Usage: %s image <COMMAND>\n", argv0);
 
-	fprintf(stderr, "\nCommands:\n");
-	fprintf(stderr, "  ls        List images\n");
-	fprintf(stderr, "  pull      Pull an image\n");
-	fprintf(stderr, "  rm        Remove an image\n");
+	fprintf(shell_err, "\nCommands:\n");
+	fprintf(shell_err, "  ls        List images\n");
+	fprintf(shell_err, "  pull      Pull an image\n");
+	fprintf(shell_err, "  rm        Remove an image\n");
 	return -1;
 }
 
@@ -44,7 +44,7 @@ int cmd_image(struct ocre_context *ctx, const char *argv0, int argc, char **argv
 		}
 	}
 
-	fprintf(stderr, "Invalid command: '%s image %s'\n\n", argv0, argv[1]);
+	fprintf(shell_err, "Invalid command: '%s image %s'\n\n", argv0, argv[1]);
 
 	return print_usage(ctx, argv0, argc, argv);
 }
@@ -0,0 +1,1051 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* HTTP downloads for `ocre image pull`, on POSIX. Zephyr applications provide their own ocre_download_file().
+ *
+ * The body is written to the given path and hashed while it arrives, so the image store does not read it again. A
+ * transfer that fails keeps what was received in order, along with a FILE.resume file holding the URL and the validator
+ * of the server (ETag or Last-Modified): the next download of the same URL to the same path asks only for the rest,
+ * with a Range request that the server honours only if the content did not change (If-Range).
+ *
+ * Large bodies are fetched over several connections, each one asking for a range. The first range is hashed as it
+ * arrives, the others are hashed from the file once the ranges before them are complete.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "../command.h"
+#include "../sha256/sha256.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define DOWNLOAD_CONNECTIONS	   4
+#define DOWNLOAD_PARALLEL_MIN_SIZE (8 * 1024 * 1024)
+#define DOWNLOAD_BUFFER_SIZE	   65536
+#define DOWNLOAD_LINE_SIZE	   8192
+#define DOWNLOAD_TIMEOUT_S	   30
+#define DOWNLOAD_MAX_REDIRECTS	   5
+#define DOWNLOAD_VALIDATOR_SIZE	   256
+#define DOWNLOAD_LOCATION_SIZE	   2048
+
+struct url {
+	char host[256];
+	char port[6];
+	char path[DOWNLOAD_LOCATION_SIZE];
+};
+
+struct connection {
+	int sock;
+	char buf[DOWNLOAD_LINE_SIZE];
+	size_t start;
+	size_t end;
+	bool chunked;
+	int64_t chunk_left; /* Bytes left in the current chunk, -1 before the first one */
+};
+
+struct response {
+	int status;
+	int64_t content_length; /* -1 if not given */
+	int64_t range_start;	/* From Content-Range, -1 if not given */
+	int64_t total;		/* Size of the whole content, -1 if unknown */
+	char validator[DOWNLOAD_VALIDATOR_SIZE];
+	char location[DOWNLOAD_LOCATION_SIZE];
+};
+
+struct download;
+
+struct segment {
+	struct download *download;
+	struct connection conn;
+	pthread_t thread;
+	int64_t start;
+	int64_t end; /* Exclusive, -1 to read until the server closes the connection */
+	int64_t done;
+	bool finished;
+	bool failed;
+};
+
+struct download {
+	struct url url;
+	FILE *out; /* Streams of the command, for the threads of the segments */
+	FILE *err;
+	char validator[DOWNLOAD_VALIDATOR_SIZE];
+	int fd;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool failed;
+	int count;
+	struct segment segments[DOWNLOAD_CONNECTIONS];
+};
+
+/* URLs */
+
+static int parse_url(const char *url, struct url *parsed)
+{
+	if (strncmp(url, "http://", strlen("http://"))) {
+		if (!strncmp(url, "https://", strlen("https://"))) {
+			fprintf(shell_err, "HTTPS is not supported, use an http:// URL\n");
+		} else {
+			fprintf(shell_err, "Unsupported URL '%s', use http://HOST[:PORT]/PATH\n", url);
+		}
+
+		return -1;
+	}
+
+	const char *host = url + strlen("http://");
+	const char *path = strchr(host, '/');
+	if (!path) {
+		path = host + strlen(host);
+	}
+
+	const char *port = memchr(host, ':', path - host);
+	const char *host_end = port ? port : path;
+
+	if (host_end == host || (size_t)(host_end - host) >= sizeof(parsed->host)) {
+		fprintf(shell_err, "Invalid host in URL '%s'\n", url);
+		return -1;
+	}
+
+	memcpy(parsed->host, host, host_end - host);
+	parsed->host[host_end - host] = '\0';
+
+	if (port) {
+		port++;
+
+		if (path == port || (size_t)(path - port) >= sizeof(parsed->port)) {
+			fprintf(shell_err, "Invalid port in URL '%s'\n", url);
+			return -1;
+		}
+
+		memcpy(parsed->port, port, path - port);
+		parsed->port[path - port] = '\0';
+	} else {
+		strcpy(parsed->port, "80");
+	}
+
+	if (snprintf(parsed->path, sizeof(parsed->path), "%s", *path ? path : "/") >= (int)sizeof(parsed->path)) {
+		fprintf(shell_err, "URL '%s' is too long\n", url);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Follows a Location header, absolute or relative to the host */
+
+static int redirect_url(struct url *url, const char *location)
+{
+	if (location[0] == '/') {
+		if (strlen(location) >= sizeof(url->path)) {
+			return -1;
+		}
+
+		strcpy(url->path, location);
+
+		return 0;
+	}
+
+	return parse_url(location, url);
+}
+
+/* Connections */
+
+static int connect_to(const struct url *url)
+{
+	struct addrinfo hints;
+	struct addrinfo *res = NULL;
+	int sock = -1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	int rc = getaddrinfo(url->host, url->port, &hints, &res);
+	if (rc) {
+		fprintf(shell_err, "Unable to resolve '%s': %s\n", url->host, gai_strerror(rc));
+		return -1;
+	}
+
+	for (const struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+		sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (sock < 0) {
+			continue;
+		}
+
+		struct timeval timeout = {
+			.tv_sec = DOWNLOAD_TIMEOUT_S,
+		};
+
+		setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		if (!connect(sock, ai->ai_addr, ai->ai_addrlen)) {
+			break;
+		}
+
+		close(sock);
+		sock = -1;
+	}
+
+	if (sock < 0) {
+		fprintf(shell_err, "Failed to connect to '%s:%s': errno=%d\n", url->host, url->port, errno);
+	}
+
+	freeaddrinfo(res);
+
+	return sock;
+}
+
+static int send_all(int sock, const char *data, size_t len)
+{
+	while (len) {
+		ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return -1;
+		}
+
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* Receives more data in the buffer. Returns the number of bytes received, 0 when the server closed the connection */
+
+static ssize_t conn_fill(struct connection *conn)
+{
+	if (conn->start) {
+		memmove(conn->buf, conn->buf + conn->start, conn->end - conn->start);
+		conn->end -= conn->start;
+		conn->start = 0;
+	}
+
+	if (conn->end == sizeof(conn->buf)) {
+		return -1;
+	}
+
+	for (;;) {
+		ssize_t n = recv(conn->sock, conn->buf + conn->end, sizeof(conn->buf) - conn->end, 0);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n > 0) {
+			conn->end += n;
+		}
+
+		return n;
+	}
+}
+
+/* Reads a line, without its CRLF */
+
+static int conn_getline(struct connection *conn, char *line, size_t size)
+{
+	for (;;) {
+		char *eol = memchr(conn->buf + conn->start, '\n', conn->end - conn->start);
+
+		if (eol) {
+			size_t len = eol - (conn->buf + conn->start);
+
+			if (len && eol[-1] == '\r') {
+				len--;
+			}
+
+			if (len >= size) {
+				return -1;
+			}
+
+			memcpy(line, conn->buf + conn->start, len);
+			line[len] = '\0';
+
+			conn->start = eol + 1 - conn->buf;
+
+			return 0;
+		}
+
+		if (conn_fill(conn) <= 0) {
+			return -1;
+		}
+	}
+}
+
+static ssize_t conn_read_raw(struct connection *conn, void *data, size_t len)
+{
+	if (conn->start < conn->end) {
+		size_t n = conn->end - conn->start;
+
+		if (n > len) {
+			n = len;
+		}
+
+		memcpy(data, conn->buf + conn->start, n);
+		conn->start += n;
+
+		return n;
+	}
+
+	for (;;) {
+		ssize_t n = recv(conn->sock, data, len, 0);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		return n;
+	}
+}
+
+/* Reads the body, decoding chunked transfers. Returns 0 at the end of the body */
+
+static ssize_t conn_read_body(struct connection *conn, void *data, size_t len)
+{
+	char line[64];
+
+	if (!conn->chunked) {
+		return conn_read_raw(conn, data, len);
+	}
+
+	if (!conn->chunk_left) {
+		return 0;
+	}
+
+	if (conn->chunk_left < 0) {
+		if (conn_getline(conn, line, sizeof(line))) {
+			return -1;
+		}
+
+		char *end;
+		conn->chunk_left = strtoll(line, &end, 16);
+		if (end == line || conn->chunk_left < 0) {
+			return -1;
+		}
+
+		if (!conn->chunk_left) {
+			return 0;
+		}
+	}
+
+	if ((int64_t)len > conn->chunk_left) {
+		len = conn->chunk_left;
+	}
+
+	ssize_t n = conn_read_raw(conn, data, len);
+	if (n <= 0) {
+		return -1;
+	}
+
+	conn->chunk_left -= n;
+
+	/* Each chunk ends with a CRLF, before the size of the next one */
+
+	if (!conn->chunk_left) {
+		if (conn_getline(conn, line, sizeof(line)) || line[0]) {
+			return -1;
+		}
+
+		conn->chunk_left = -1;
+	}
+
+	return n;
+}
+
+static int64_t parse_int64(const char *s)
+{
+	char *end;
+
+	errno = 0;
+	long long value = strtoll(s, &end, 10);
+	if (errno || end == s || value < 0) {
+		return -1;
+	}
+
+	return value;
+}
+
+/* Copies a header value, if it fits */
+
+static void copy_value(char *dst, size_t size, const char *value)
+{
+	if (strlen(value) < size) {
+		strcpy(dst, value);
+	}
+}
+
+static int read_response(struct connection *conn, struct response *rsp)
+{
+	char line[DOWNLOAD_LINE_SIZE];
+	char last_modified[DOWNLOAD_VALIDATOR_SIZE] = "";
+
+	memset(rsp, 0, sizeof(*rsp));
+	rsp->content_length = -1;
+	rsp->range_start = -1;
+	rsp->total = -1;
+
+	if (conn_getline(conn, line, sizeof(line)) || strncmp(line, "HTTP/1.", strlen("HTTP/1.")) ||
+	    sscanf(line, "HTTP/1.%*d %d", &rsp->status) != 1) {
+		fprintf(shell_err, "Invalid HTTP response\n");
+		return -1;
+	}
+
+	for (;;) {
+		if (conn_getline(conn, line, sizeof(line))) {
+			fprintf(shell_err, "Invalid HTTP headers\n");
+			return -1;
+		}
+
+		if (!line[0]) {
+			break;
+		}
+
+		char *value = strchr(line, ':');
+		if (!value) {
+			continue;
+		}
+
+		*value++ = '\0';
+		value += strspn(value, " \t");
+
+		if (!strcasecmp(line, "Content-Length")) {
+			rsp->content_length = parse_int64(value);
+		} else if (!strcasecmp(line, "Content-Range")) {
+			/* bytes START-END/TOTAL, with * instead of START-END when the range cannot be satisfied */
+
+			if (!strncasecmp(value, "bytes ", strlen("bytes "))) {
+				value += strlen("bytes ");
+
+				if (*value != '*') {
+					rsp->range_start = parse_int64(value);
+				}
+
+				const char *total = strchr(value, '/');
+				if (total && total[1] != '*') {
+					rsp->total = parse_int64(total + 1);
+				}
+			}
+		} else if (!strcasecmp(line, "Transfer-Encoding")) {
+			conn->chunked = strcasestr(value, "chunked") != NULL;
+		} else if (!strcasecmp(line, "ETag")) {
+			/* Weak validators cannot be used for ranges */
+
+			if (strncmp(value, "W/", 2)) {
+				copy_value(rsp->validator, sizeof(rsp->validator), value);
+			}
+		} else if (!strcasecmp(line, "Last-Modified")) {
+			copy_value(last_modified, sizeof(last_modified), value);
+		} else if (!strcasecmp(line, "Location")) {
+			copy_value(rsp->location, sizeof(rsp->location), value);
+		}
+	}
+
+	if (!rsp->validator[0]) {
+		strcpy(rsp->validator, last_modified);
+	}
+
+	conn->chunk_left = -1;
+
+	return 0;
+}
+
+/* Sets the socket of a connection, which abort_segments() may shut down from another thread */
+
+static void set_socket(struct download *download, struct connection *conn, int sock)
+{
+	pthread_mutex_lock(&download->mutex);
+
+	conn->sock = sock;
+
+	pthread_mutex_unlock(&download->mutex);
+}
+
+static void close_socket(struct download *download, struct connection *conn)
+{
+	int sock = conn->sock;
+
+	set_socket(download, conn, -1);
+
+	if (sock >= 0) {
+		close(sock);
+	}
+}
+
+/* Sends a request for the bytes from start to end (exclusive, -1 for the rest), and reads the response headers. The
+ * range is only returned if the content still matches the validator of the download, if any
+ */
+
+static int request(struct download *download, struct connection *conn, int64_t start, int64_t end,
+		   struct response *rsp)
+{
+	const struct url *url = &download->url;
+	char req[DOWNLOAD_LOCATION_SIZE + 1024];
+	int len;
+
+	conn->start = 0;
+	conn->end = 0;
+	conn->chunked = false;
+
+	int sock = connect_to(url);
+	if (sock < 0) {
+		return -1;
+	}
+
+	set_socket(download, conn, sock);
+
+	len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ocre\r\nConnection: close\r\n",
+		       url->path, url->host);
+
+	if (end < 0) {
+		len += snprintf(req + len, sizeof(req) - len, "Range: bytes=%" PRId64 "-\r\n", start);
+	} else {
+		len += snprintf(req + len, sizeof(req) - len, "Range: bytes=%" PRId64 "-%" PRId64 "\r\n", start,
+				end - 1);
+	}
+
+	if (download->validator[0]) {
+		len += snprintf(req + len, sizeof(req) - len, "If-Range: %s\r\n", download->validator);
+	}
+
+	len += snprintf(req + len, sizeof(req) - len, "\r\n");
+
+	if (len >= (int)sizeof(req) || send_all(sock, req, len) || read_response(conn, rsp)) {
+		fprintf(shell_err, "Request to '%s:%s' failed\n", url->host, url->port);
+		close_socket(download, conn);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Resume state */
+
+static char *resume_path(const char *filepath)
+{
+	char *path = malloc(strlen(filepath) + strlen(".resume") + 1);
+	if (path) {
+		sprintf(path, "%s.resume", filepath);
+	}
+
+	return path;
+}
+
+/* Returns how much of the file can be kept, 0 if it was not downloaded from this URL */
+
+static int64_t read_resume(const char *filepath, const char *url, char *validator)
+{
+	char line[DOWNLOAD_LOCATION_SIZE + 2];
+	struct stat st;
+	int64_t offset = 0;
+
+	char *path = resume_path(filepath);
+	if (!path) {
+		return 0;
+	}
+
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		free(path);
+		return 0;
+	}
+
+	if (fgets(line, sizeof(line), f) && fgets(validator, DOWNLOAD_VALIDATOR_SIZE, f)) {
+		line[strcspn(line, "\n")] = '\0';
+		validator[strcspn(validator, "\n")] = '\0';
+
+		if (!strcmp(line, url) && validator[0] && !stat(filepath, &st)) {
+			offset = st.st_size;
+		}
+	}
+
+	fclose(f);
+	free(path);
+
+	if (!offset) {
+		validator[0] = '\0';
+	}
+
+	return offset;
+}
+
+static void write_resume(const char *filepath, const char *url, const char *validator)
+{
+	char *path = resume_path(filepath);
+	if (!path) {
+		return;
+	}
+
+	FILE *f = fopen(path, "w");
+	if (f) {
+		fprintf(f, "%s\n%s\n", url, validator);
+		fclose(f);
+	}
+
+	free(path);
+}
+
+static void remove_resume(const char *filepath)
+{
+	char *path = resume_path(filepath);
+	if (path) {
+		unlink(path);
+		free(path);
+	}
+}
+
+/* Transfers */
+
+static bool segment_complete(const struct segment *segment)
+{
+	return segment->finished && !segment->failed;
+}
+
+/* Receives the body of a segment into the file, hashing it if buff is not NULL */
+
+static int receive(struct segment *segment, struct sha256_buff *buff)
+{
+	struct download *download = segment->download;
+	int ret = -1;
+
+	char *data = malloc(DOWNLOAD_BUFFER_SIZE);
+	if (!data) {
+		goto finish;
+	}
+
+	for (;;) {
+		size_t len = DOWNLOAD_BUFFER_SIZE;
+
+		if (segment->end >= 0) {
+			int64_t left = segment->end - segment->start - segment->done;
+
+			if (!left) {
+				ret = 0;
+				break;
+			}
+
+			if ((int64_t)len > left) {
+				len = left;
+			}
+		}
+
+		ssize_t n = conn_read_body(&segment->conn, data, len);
+
+		if (!n && segment->end < 0) {
+			ret = 0;
+			break;
+		}
+
+		if (n <= 0) {
+			fprintf(shell_err, "Connection lost after %" PRId64 " bytes at offset %" PRId64 "\n",
+				segment->done, segment->start);
+			break;
+		}
+
+		if (pwrite(download->fd, data, n, segment->start + segment->done) != n) {
+			fprintf(shell_err, "Failed to write file: errno=%d\n", errno);
+			break;
+		}
+
+		if (buff) {
+			sha256_update(buff, data, n);
+		}
+
+		pthread_mutex_lock(&download->mutex);
+
+		segment->done += n;
+
+		bool failed = download->failed;
+
+		pthread_cond_broadcast(&download->cond);
+		pthread_mutex_unlock(&download->mutex);
+
+		if (failed) {
+			break;
+		}
+	}
+
+finish:
+	free(data);
+
+	pthread_mutex_lock(&download->mutex);
+
+	segment->finished = true;
+	segment->failed = ret != 0;
+
+	if (ret) {
+		download->failed = true;
+	}
+
+	close(segment->conn.sock);
+	segment->conn.sock = -1;
+
+	pthread_cond_broadcast(&download->cond);
+	pthread_mutex_unlock(&download->mutex);
+
+	return ret;
+}
+
+static void *segment_thread(void *arg)
+{
+	struct segment *segment = arg;
+	struct download *download = segment->download;
+	struct response rsp;
+
+	ocre_shell_set_streams(download->out, download->err);
+
+	if (request(download, &segment->conn, segment->start, segment->end, &rsp)) {
+		goto fail;
+	}
+
+	/* The content changed since the first range was requested */
+
+	if (rsp.status != 206 || rsp.range_start != segment->start) {
+		fprintf(shell_err, "Server did not return the range at offset %" PRId64 " (status %d)\n",
+			segment->start, rsp.status);
+		close_socket(download, &segment->conn);
+		goto fail;
+	}
+
+	receive(segment, NULL);
+
+	return NULL;
+
+fail:
+	pthread_mutex_lock(&download->mutex);
+
+	segment->finished = true;
+	segment->failed = true;
+	download->failed = true;
+
+	pthread_cond_broadcast(&download->cond);
+	pthread_mutex_unlock(&download->mutex);
+
+	return NULL;
+}
+
+/* Hashes bytes of the file that are already written */
+
+static int hash_file(int fd, int64_t start, int64_t end, struct sha256_buff *buff)
+{
+	char *data = malloc(DOWNLOAD_BUFFER_SIZE);
+	if (!data) {
+		return -1;
+	}
+
+	while (start < end) {
+		size_t len = DOWNLOAD_BUFFER_SIZE;
+
+		if ((int64_t)len > end - start) {
+			len = end - start;
+		}
+
+		ssize_t n = pread(fd, data, len, start);
+		if (n <= 0) {
+			free(data);
+			return -1;
+		}
+
+		sha256_update(buff, data, n);
+		start += n;
+	}
+
+	free(data);
+
+	return 0;
+}
+
+/* Hashes a segment received by another thread, as it is written */
+
+static int hash_segment(struct download *download, struct segment *segment, struct sha256_buff *buff)
+{
+	int64_t hashed = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&download->mutex);
+
+		while (segment->done == hashed && !segment->finished && !download->failed) {
+			pthread_cond_wait(&download->cond, &download->mutex);
+		}
+
+		int64_t done = segment->done;
+		bool finished = segment->finished;
+		bool failed = download->failed;
+
+		pthread_mutex_unlock(&download->mutex);
+
+		if (failed) {
+			return -1;
+		}
+
+		if (hash_file(download->fd, segment->start + hashed, segment->start + done, buff)) {
+			return -1;
+		}
+
+		hashed = done;
+
+		if (finished) {
+			return 0;
+		}
+	}
+}
+
+/* Stops the other connections once the download failed */
+
+static void abort_segments(struct download *download)
+{
+	pthread_mutex_lock(&download->mutex);
+
+	download->failed = true;
+
+	for (int i = 1; i < download->count; i++) {
+		if (download->segments[i].conn.sock >= 0) {
+			shutdown(download->segments[i].conn.sock, SHUT_RDWR);
+		}
+	}
+
+	pthread_mutex_unlock(&download->mutex);
+}
+
+/* Length of the beginning of the file received without gaps */
+
+static int64_t contiguous_size(const struct download *download)
+{
+	int64_t size = download->segments[0].start;
+
+	for (int i = 0; i < download->count; i++) {
+		const struct segment *segment = &download->segments[i];
+
+		if (segment->start != size) {
+			break;
+		}
+
+		size += segment->done;
+
+		if (!segment_complete(segment)) {
+			break;
+		}
+	}
+
+	return size;
+}
+
+/* Downloads url into filepath. Fills digest with the hexadecimal SHA-256 of the file, if not NULL */
+
+int ocre_download_file(const char *url, const char *filepath, char *digest)
+{
+	struct download download;
+	struct segment *first = &download.segments[0];
+	struct sha256_buff buff;
+	struct response rsp;
+	int started = 0;
+	int ret = -1;
+
+	memset(&download, 0, sizeof(download));
+	download.fd = -1;
+	download.out = shell_out;
+	download.err = shell_err;
+
+	pthread_mutex_init(&download.mutex, NULL);
+	pthread_cond_init(&download.cond, NULL);
+
+	for (int i = 0; i < DOWNLOAD_CONNECTIONS; i++) {
+		download.segments[i].download = &download;
+		download.segments[i].conn.sock = -1;
+	}
+
+	if (parse_url(url, &download.url)) {
+		goto finish;
+	}
+
+	int64_t offset = read_resume(filepath, url, download.validator);
+
+	download.fd = open(filepath, O_RDWR | O_CREAT | (offset ? 0 : O_TRUNC), 0644);
+	if (download.fd < 0) {
+		fprintf(shell_err, "Failed to create file '%s': errno=%d\n", filepath, errno);
+		goto finish;
+	}
+
+	/* Ask for the rest of the file, and learn its size and whether the server accepts ranges */
+
+	for (int redirects = 0;; redirects++) {
+		if (request(&download, &first->conn, offset, -1, &rsp)) {
+			goto finish;
+		}
+
+		if (rsp.status < 300 || rsp.status >= 400 || !rsp.location[0]) {
+			break;
+		}
+
+		close_socket(&download, &first->conn);
+
+		if (redirects == DOWNLOAD_MAX_REDIRECTS || redirect_url(&download.url, rsp.location)) {
+			fprintf(shell_err, "Too many or invalid redirects\n");
+			goto finish;
+		}
+	}
+
+	int64_t total = -1;
+
+	if (rsp.status == 200) {
+		/* Ranges are not supported, or the content changed */
+
+		offset = 0;
+		total = rsp.content_length;
+
+		if (ftruncate(download.fd, 0)) {
+			goto finish;
+		}
+	} else if (rsp.status == 206 && rsp.range_start == offset) {
+		total = rsp.total;
+	} else if (rsp.status == 416 && offset && rsp.total == offset) {
+		/* Already complete */
+
+		total = offset;
+	} else {
+		fprintf(shell_err, "Failed to download '%s': HTTP status %d\n", url, rsp.status);
+		goto finish;
+	}
+
+	if (rsp.validator[0]) {
+		strcpy(download.validator, rsp.validator);
+		write_resume(filepath, url, download.validator);
+	} else {
+		download.validator[0] = '\0';
+		remove_resume(filepath);
+	}
+
+	if (offset) {
+		fprintf(shell_err, "Resuming download at %" PRId64 " bytes\n", offset);
+	}
+
+	/* Split what is left in ranges, when it is large enough and can be resumed */
+
+	int64_t left = total >= 0 ? total - offset : -1;
+
+	download.count = 1;
+
+	if (rsp.status == 206 && download.validator[0] && left >= DOWNLOAD_PARALLEL_MIN_SIZE) {
+		download.count = DOWNLOAD_CONNECTIONS;
+	}
+
+	int64_t size = left >= 0 ? left / download.count : -1;
+
+	for (int i = 0; i < download.count; i++) {
+		struct segment *segment = &download.segments[i];
+
+		segment->start = offset + i * size;
+		segment->end = left < 0 ? -1 : (i == download.count - 1 ? total : segment->start + size);
+	}
+
+	if (rsp.status == 416) {
+		close_socket(&download, &first->conn);
+		first->finished = true;
+	}
+
+	for (started = 1; started < download.count; started++) {
+		struct segment *segment = &download.segments[started];
+
+		if (pthread_create(&segment->thread, NULL, segment_thread, segment)) {
+			fprintf(shell_err, "Failed to start download thread\n");
+			abort_segments(&download);
+			goto finish;
+		}
+	}
+
+	sha256_init(&buff);
+
+	if (hash_file(download.fd, 0, offset, &buff)) {
+		fprintf(shell_err, "Failed to read '%s'\n", filepath);
+		abort_segments(&download);
+		goto finish;
+	}
+
+	/* The first range is hashed as it arrives, the others as they are completed in order */
+
+	if (!first->finished && receive(first, &buff)) {
+		abort_segments(&download);
+		goto finish;
+	}
+
+	for (int i = 1; i < download.count; i++) {
+		if (hash_segment(&download, &download.segments[i], &buff)) {
+			abort_segments(&download);
+			goto finish;
+		}
+	}
+
+	if (total >= 0 && contiguous_size(&download) != total) {
+		fprintf(shell_err, "Download of '%s' is incomplete\n", url);
+		goto finish;
+	}
+
+	sha256_finalize(&buff);
+
+	if (digest) {
+		sha256_read_hex(&buff, digest);
+		digest[64] = '\0';
+	}
+
+	ret = 0;
+
+finish:
+	for (int i = 1; i < started; i++) {
+		pthread_join(download.segments[i].thread, NULL);
+	}
+
+	if (first->conn.sock >= 0) {
+		close(first->conn.sock);
+	}
+
+	if (download.fd >= 0) {
+		/* Keep what can be resumed, with its validator, or nothing */
+
+		if (ret && download.validator[0] && download.count) {
+			if (ftruncate(download.fd, contiguous_size(&download))) {
+				download.validator[0] = '\0';
+			}
+		}
+
+		close(download.fd);
+
+		if (ret && !download.validator[0]) {
+			unlink(filepath);
+		}
+	}
+
+	if (!ret || !download.validator[0]) {
+		remove_resume(filepath);
+	}
+
+	pthread_cond_destroy(&download.cond);
+	pthread_mutex_destroy(&download.mutex);
+
+	return ret;
+}
@@ -9,154 +9,109 @@
 #include <stdlib.h>
 #include <dirent.h>
 #include <string.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#include <fcntl.h>
 #include <stdint.h>
 
 #include <ocre/ocre.h>
 
 #include "../command.h"
-#include "sha256_file.h"
+#include "store.h"
 
 static int usage(const char *argv0)
 {
-	fprintf(stderr, "Usage: %s image ls [IMAGE]\n", argv0);
-	fprintf(stderr, "\nList images in local storage.\n");
+	fprintf(shell_err, "Usage: %s image ls [IMAGE]\n", argv0);
+	fprintf(shell_err, "\nList images in local storage.\n");
 	return -1;
 }
 
 static void header()
 {
-	printf("SHA-256\t\t\t\t\t\t\t\t\tSIZE\tNAME\n");
+	fprintf(shell_out, "SHA-256\t\t\t\t\t\t\t\t\tSIZE\tNAME\n");
 }
 
-static int list_image(const char *name, const char *path)
-{
-	struct stat st;
-
-	if (!path) {
-		fprintf(stderr, "Invalid image path\n");
-		return -1;
-	}
-
-	if (stat(path, &st)) {
-		fprintf(stderr, "Failed to stat image '%s'\n", path);
-		return -1;
-	}
-
-	if (S_ISREG(st.st_mode)) {
-		char hash[65] = {0}; /* hash[64] is null-byte */
+/* returns 1 if there is no image of that name */
 
-		sha256_file(path, hash);
+static int list_image(struct image_store *store, const char *name)
+{
+	struct image_info info;
 
-		printf("%s\t%ju\t%s\n", hash, (uintmax_t)st.st_size, name);
+	int rc = image_store_get(store, name, &info);
+	if (!rc) {
+		fprintf(shell_out, "%s\t%ju\t%s\n", info.digest, (uintmax_t)info.size, name);
 	}
 
-	return 0;
+	return rc;
 }
 
-static int list_images(const char *path)
+static int list_images(struct image_store *store)
 {
 	int ret = 0;
 	DIR *d;
 	const struct dirent *dir;
 
-	d = opendir(path);
+	d = opendir(store->images_dir);
 	if (!d) {
-		fprintf(stderr, "Failed to open directory '%s'\n", path);
+		fprintf(shell_err, "Failed to open directory '%s'\n", store->images_dir);
 		return -1;
 	}
 
 	while ((dir = readdir(d)) != NULL) {
-		char *image_path = malloc(strlen(path) + strlen(dir->d_name) + 2);
-		if (!image_path) {
-			fprintf(stderr, "Failed to allocate memory for image path\n");
+		if (list_image(store, dir->d_name) < 0) {
+			fprintf(shell_err, "Failed to list image '%s'\n", dir->d_name);
 			ret = -1;
-			break;
 		}
+	}
 
-		strcpy(image_path, path);
-		strcat(image_path, "/");
-		strcat(image_path, dir->d_name);
+	closedir(d);
 
-		if (list_image(dir->d_name, image_path)) {
-			fprintf(stderr, "Failed to list image '%s'\n", image_path);
-			ret = -1;
-		}
+	/* Every image was looked up, the others are gone */
 
-		free(image_path);
+	if (!ret) {
+		image_store_prune(store);
 	}
 
-	closedir(d);
-
 	return ret;
 }
 
 /* cppcheck-suppress constParameterPointer */
 int cmd_image_ls(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
 {
-	switch (argc) {
-		case 1: {
-			const char *working_directory = ocre_context_get_working_directory(ctx);
+	struct image_store store;
 
-			char *image_dir = malloc(strlen(working_directory) + strlen("/images") + 1);
-			if (!image_dir) {
-				fprintf(stderr, "Failed to allocate memory for image directory path\n");
-				return -1;
-			}
-
-			strcpy(image_dir, working_directory);
-			strcat(image_dir, "/images");
-
-			header();
-
-			if (list_images(image_dir)) {
-				fprintf(stderr, "Failed to list images in directory '%s'\n", image_dir);
-			}
-
-			free(image_dir);
-
-			break;
-		}
-		case 2: {
-			const char *working_directory = ocre_context_get_working_directory(ctx);
-
-			/* Check if the provided image ID is valid */
-
-			if (argv[1] && !ocre_is_valid_name(argv[1])) {
-				fprintf(stderr,
-					"Invalid characters in image ID '%s'. Valid are [a-z0-9_-.] (lowercase "
-					"alphanumeric) and cannot start with '.'\n",
-					argv[1]);
-				return -1;
-			}
-
-			char *image_path = malloc(strlen(working_directory) + strlen("/images") + strlen(argv[1]) + 2);
-			if (!image_path) {
-				fprintf(stderr, "Failed to allocate memory for image path\n");
-				return -1;
-			}
+	if (argc > 2) {
+		fprintf(shell_err, "'%s image ls' requires at most one argument\n\n", argv0);
+		return usage(argv0);
+	}
 
-			strcpy(image_path, working_directory);
-			strcat(image_path, "/images/");
-			strcat(image_path, argv[1]);
+	/* Check if the provided image ID is valid */
 
-			header();
+	if (argc == 2 && !ocre_is_valid_name(argv[1])) {
+		fprintf(shell_err,
+			"Invalid characters in image ID '%s'. Valid are [a-z0-9_-.] (lowercase "
+			"alphanumeric) and cannot start with '.'\n",
+			argv[1]);
+		return -1;
+	}
 
-			if (list_image(argv[1], image_path)) {
-				fprintf(stderr, "Failed to list image '%s'\n", image_path);
-			}
+	if (image_store_open(&store, ocre_context_get_working_directory(ctx))) {
+		return -1;
+	}
 
-			free(image_path);
+	header();
 
-			break;
+	if (argc == 1) {
+		if (list_images(&store)) {
+			fprintf(shell_err, "Failed to list images in directory '%s'\n", store.images_dir);
 		}
-		default: {
-			fprintf(stderr, "'%s image ls' requires at most one argument\n\n", argv0);
-			return usage(argv0);
+	} else {
+		int rc = list_image(&store, argv[1]);
+		if (rc > 0) {
+			fprintf(shell_err, "Image '%s' not found\n", argv[1]);
+		} else if (rc < 0) {
+			fprintf(shell_err, "Failed to list image '%s'\n", argv[1]);
 		}
 	}
 
+	image_store_close(&store);
+
 	return 0;
 }
@@ -5,46 +5,117 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <ctype.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include <ocre/ocre.h>
 
 #include "../command.h"
 #include "sha256_file.h"
+#include "store.h"
 
-extern int ocre_download_file(const char *url, const char *filepath);
+extern int optind, opterr, optopt;
+
+/* Provided by the application. Downloads url to filepath, and fills digest with the hexadecimal SHA-256 of the file if
+ * it computed it while downloading, else leaves it empty. On failure, filepath may be kept to resume the download
+ */
+
+extern int ocre_download_file(const char *url, const char *filepath, char *digest);
 
 static int usage(const char *argv0)
 {
-	fprintf(stderr, "Usage: %s image pull URL\n", argv0); // TODO: NAME[:TAG|@DIGEST]
-	fprintf(stderr, "\nDownloads an image from a remote repository to the local storage.\n");
+	fprintf(shell_err, "Usage: %s image pull [options] URL [NAME]\n", argv0); // TODO: NAME[:TAG|@DIGEST]
+	fprintf(shell_err, "\nDownloads an image from a remote repository to the local storage.\n");
+	fprintf(shell_err, "\nOptions:\n");
+	fprintf(shell_err, "  -d DIGEST  Expected digest of the image, as sha256:HEX\n");
 	return -1;
 }
 
+/* Accepts sha256:HEX or HEX, and returns the hexadecimal digest in lowercase */
+
+static int parse_digest(const char *arg, char *digest)
+{
+	if (!strncmp(arg, "sha256:", strlen("sha256:"))) {
+		arg += strlen("sha256:");
+	}
+
+	if (strlen(arg) != OCRE_IMAGE_DIGEST_SIZE - 1) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < OCRE_IMAGE_DIGEST_SIZE - 1; i++) {
+		if (!isxdigit((unsigned char)arg[i])) {
+			return -1;
+		}
+
+		digest[i] = tolower((unsigned char)arg[i]);
+	}
+
+	digest[OCRE_IMAGE_DIGEST_SIZE - 1] = '\0';
+
+	return 0;
+}
+
 /* cppcheck-suppress constParameterPointer */
 int cmd_image_pull(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
 {
+	char expected[OCRE_IMAGE_DIGEST_SIZE] = {0};
 	char *local_name = NULL;
+	bool valid = true;
 	int ret = -1;
+	int opt;
+
+	ocre_shell_getopt_begin();
+
+	while (valid && (opt = getopt(argc, argv, "+d:")) != -1) {
+		switch (opt) {
+			case 'd': {
+				if (parse_digest(optarg, expected)) {
+					fprintf(shell_err, "Invalid digest '%s': must be sha256:HEX\n", optarg);
+					valid = false;
+				}
+
+				continue;
+			}
+			default: {
+				usage(argv0);
+				valid = false;
+				continue;
+			}
+		}
+	}
+
+	int first_arg = optind;
+
+	ocre_shell_getopt_end();
+
+	if (!valid) {
+		return -1;
+	}
+
+	argc -= first_arg - 1;
+	argv += first_arg - 1;
 
 	if (argc < 2) {
-		fprintf(stderr, "'%s image pull' requires at least one argument\n\n", argv0);
+		fprintf(shell_err, "'%s image pull' requires at least one argument\n\n", argv0);
 		return usage(argv0);
 	}
 
 	if (argc == 2) {
 		local_name = strrchr(argv[1], '/');
 		if (local_name == NULL) {
-			fprintf(stderr, "'Cannot determine image name from URL '%s'\n", argv[1]);
+			fprintf(shell_err, "'Cannot determine image name from URL '%s'\n", argv[1]);
 			return -1;
 		} else {
 			local_name++;
 		}
 		if (*local_name == '\0') {
-			fprintf(stderr, "'Cannot determine image name from URL '%s'\n", argv[1]);
+			fprintf(shell_err, "'Cannot determine image name from URL '%s'\n", argv[1]);
 			return -1;
 		}
 
@@ -55,24 +126,27 @@ int cmd_image_pull(struct ocre_context *ctx, const char *argv0, int argc, char *
 	/* Check if the provided image ID is valid */
 
 	if (!ocre_is_valid_name(local_name)) {
-		fprintf(stderr,
+		fprintf(shell_err,
 			"Invalid characters in image ID '%s'. Valid are [a-z0-9_-.] (lowercase "
 			"alphanumeric) and cannot start with '.'\n",
 			local_name);
 		return -1;
 	}
 
-	const char *working_directory = ocre_context_get_working_directory(ctx);
+	struct image_store store;
+	char *tmp_path = NULL;
 
-	char *image_path = malloc(strlen(working_directory) + strlen("/images/") + strlen(local_name) + 1);
-	if (!image_path) {
-		fprintf(stderr, "Failed to allocate memory for image directory path\n");
+	if (image_store_open(&store, ocre_context_get_working_directory(ctx))) {
 		return -1;
 	}
 
-	strcpy(image_path, working_directory);
-	strcat(image_path, "/images/");
-	strcat(image_path, local_name);
+	char *image_path = malloc(strlen(store.images_dir) + strlen(local_name) + 2);
+	if (!image_path) {
+		fprintf(shell_err, "Failed to allocate memory for image directory path\n");
+		goto finish;
+	}
+
+	sprintf(image_path, "%s/%s", store.images_dir, local_name);
 
 	/* Check if image already exists */
 
@@ -80,28 +154,64 @@ int cmd_image_pull(struct ocre_context *ctx, const char *argv0, int argc, char *
 
 	ret = stat(image_path, &st);
 	if (!ret) {
-		fprintf(stderr, "Image '%s' already exists\n", local_name);
+		fprintf(shell_err, "Image '%s' already exists\n", local_name);
+		ret = -1;
+		goto finish;
+	}
+
+	/* Downloaded next to the blobs, and moved into the store once complete */
+
+	tmp_path = image_store_temp_path(&store, local_name);
+	if (!tmp_path) {
+		fprintf(shell_err, "Failed to allocate memory for download path\n");
+		ret = -1;
 		goto finish;
 	}
 
-	fprintf(stderr, "Pulling '%s' from '%s'\n", local_name, argv[1]);
+	fprintf(shell_err, "Pulling '%s' from '%s'\n", local_name, argv[1]);
 
-	ret = ocre_download_file(argv[1], image_path);
+	char digest[OCRE_IMAGE_DIGEST_SIZE] = {0};
+
+	/* What was downloaded is kept on failure, for the next pull to resume */
+
+	ret = ocre_download_file(argv[1], tmp_path, digest);
 	if (ret) {
-		fprintf(stderr, "Failed to download image '%s'\n", argv[1]);
+		fprintf(shell_err, "Failed to download image '%s'\n", argv[1]);
+		image_store_keep_partial(&store, local_name, tmp_path);
 		goto finish;
 	}
 
-	char hash[65] = {0}; /* hash[64] is null-byte */
+	if (!*digest && sha256_file(tmp_path, digest)) {
+		fprintf(shell_err, "Failed to hash '%s'\n", tmp_path);
+		remove(tmp_path);
+		ret = -1;
+		goto finish;
+	}
 
-	sha256_file(image_path, hash);
+	if (*expected && strcmp(expected, digest)) {
+		fprintf(shell_err, "Digest of image '%s' is sha256:%s, expected sha256:%s\n", local_name, digest,
+			expected);
+		remove(tmp_path);
+		ret = -1;
+		goto finish;
+	}
 
-	fprintf(stderr, "Digest: %s\n", hash);
+	ret = image_store_import(&store, local_name, tmp_path, digest);
+	if (ret) {
+		fprintf(shell_err, "Failed to store image '%s'\n", local_name);
+		remove(tmp_path);
+		goto finish;
+	}
 
-	fprintf(stdout, "%s\n", local_name);
+	fprintf(shell_err, "Digest: %s\n", digest);
+
+	fprintf(shell_out, "%s\n", local_name);
 
 finish:
+	free(tmp_path);
 	free(image_path);
 
+	image_store_close(&store);
+
 	return ret;
 }
@@ -8,17 +8,78 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 
+#ifndef __ZEPHYR__
+#include <sys/mman.h>
+#endif
+
 #include "../sha256/sha256.h"
 
-#define FILE_BUFFER_SIZE 1024
+/* Files that cannot be mapped are read in chunks this large. Kept small on Zephyr, where it comes from the heap */
+
+#ifdef __ZEPHYR__
+#define FILE_BUFFER_SIZE 4096
+#else
+#define FILE_BUFFER_SIZE 65536
+#endif
+
+#ifndef __ZEPHYR__
+
+/* Hashes the file in place from the page cache, without copying it. Returns 1 if it cannot be mapped */
+
+static int sha256_mapped(int fd, size_t size, struct sha256_buff *buff)
+{
+	void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		return 1;
+	}
+
+	madvise(data, size, MADV_SEQUENTIAL);
+
+	sha256_update(buff, data, size);
+
+	munmap(data, size);
+
+	return 0;
+}
+
+#endif
+
+static int sha256_read_fd(int fd, off_t file_size, struct sha256_buff *buff)
+{
+	void *buffer = malloc(FILE_BUFFER_SIZE);
+	if (!buffer) {
+		return -1;
+	}
+
+	off_t total_bytes_read = 0;
+	while (total_bytes_read < file_size) {
+		ssize_t bytes_read = read(fd, buffer, FILE_BUFFER_SIZE);
+		if (bytes_read < 0) {
+			free(buffer);
+			return -1;
+		}
+
+		if (!bytes_read) {
+			break;
+		}
+
+		sha256_update(buff, buffer, bytes_read);
+
+		total_bytes_read += bytes_read;
+	}
+
+	free(buffer);
+
+	return 0;
+}
 
 int sha256_file(const char *path, char *hash)
 {
 	int ret = -1;
-	void *buffer = NULL;
 
 	if (!path || !hash) {
 		return -1;
@@ -41,28 +102,23 @@ int sha256_file(const char *path, char *hash)
 		goto finish;
 	}
 
-	buffer = malloc(FILE_BUFFER_SIZE);
-	if (!buffer) {
-		goto finish;
-	}
-
 	struct sha256_buff buff;
 	sha256_init(&buff);
 
-	off_t total_bytes_read = 0;
-	while (total_bytes_read < file_size) {
-		ssize_t bytes_read = read(fd, buffer, FILE_BUFFER_SIZE);
-		if (bytes_read < 0) {
-			goto finish;
-		}
+	rc = 1;
 
-		if (!bytes_read) {
-			break;
-		}
+#ifndef __ZEPHYR__
+	if ((uintmax_t)file_size <= SIZE_MAX) {
+		rc = sha256_mapped(fd, (size_t)file_size, &buff);
+	}
+#endif
 
-		sha256_update(&buff, buffer, bytes_read);
+	if (rc) {
+		rc = sha256_read_fd(fd, file_size, &buff);
+	}
 
-		total_bytes_read += bytes_read;
+	if (rc) {
+		goto finish;
 	}
 
 	ret = 0;
@@ -71,7 +127,6 @@ int sha256_file(const char *path, char *hash)
 	sha256_read_hex(&buff, hash);
 
 finish:
-	free(buffer);
 	close(fd);
 
 	return ret;
@@ -0,0 +1,697 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef __ZEPHYR__
+#include <sys/file.h>
+#endif
+
+#include <ocre/ocre.h>
+
+#include "../command.h"
+#include "sha256_file.h"
+#include "store.h"
+
+#define INDEX_LINE_SIZE 512
+
+/* Suffix of the unique names of temporary files, replaced by mkstemp() */
+
+#define TEMP_SUFFIX ".XXXXXX"
+
+/* What a failed pull of an image kept, for the next pull of the same image to resume */
+
+#define PARTIAL_SUFFIX ".partial"
+#define RESUME_SUFFIX  ".resume"
+
+#ifdef __ZEPHYR__
+/* There is a single process and no flock(), all the stores share a mutex */
+
+static pthread_mutex_t store_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+struct image_index_entry {
+	char *name;
+	char digest[OCRE_IMAGE_DIGEST_SIZE];
+	uint64_t size;
+	int64_t mtime;
+	uint64_t ino;
+	bool seen;
+};
+
+static char *join(const char *dir, const char *name)
+{
+	char *path = malloc(strlen(dir) + strlen(name) + 2);
+	if (!path) {
+		return NULL;
+	}
+
+	strcpy(path, dir);
+	strcat(path, "/");
+	strcat(path, name);
+
+	return path;
+}
+
+/* To be freed by the caller */
+
+static char *concat(const char *prefix, const char *suffix)
+{
+	char *path = malloc(strlen(prefix) + strlen(suffix) + 1);
+	if (!path) {
+		return NULL;
+	}
+
+	strcpy(path, prefix);
+	strcat(path, suffix);
+
+	return path;
+}
+
+/* Creates a file with a unique name from a template ending with TEMP_SUFFIX. Returns its descriptor */
+
+static int make_temp(char *template)
+{
+	int fd = mkstemp(template);
+
+#ifndef __ZEPHYR__
+	/* Readable by others like the files it replaces, mkstemp() creates them private */
+
+	if (fd >= 0) {
+		fchmod(fd, 0644);
+	}
+#endif
+
+	return fd;
+}
+
+/* Same, opened for writing */
+
+static FILE *create_temp(char *template)
+{
+	int fd = make_temp(template);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	FILE *f = fdopen(fd, "w");
+	if (!f) {
+		close(fd);
+		remove(template);
+	}
+
+	return f;
+}
+
+/* Serializes the updates of the index, and the changes of the images and blobs, between the threads of the daemon and
+ * with other processes using the same store. Held from the first use of the index until the store is closed.
+ */
+
+static int lock_store(struct image_store *store)
+{
+	if (store->locked) {
+		return 0;
+	}
+
+#ifdef __ZEPHYR__
+	pthread_mutex_lock(&store_mutex);
+#else
+	/* Every open of the directory gets a lock of its own, even within a process */
+
+	store->lock_fd = open(store->blobs_dir, O_RDONLY);
+	if (store->lock_fd < 0) {
+		fprintf(shell_err, "Failed to open '%s': errno=%d\n", store->blobs_dir, errno);
+		return -1;
+	}
+
+	while (flock(store->lock_fd, LOCK_EX)) {
+		if (errno != EINTR) {
+			fprintf(shell_err, "Failed to lock '%s': errno=%d\n", store->blobs_dir, errno);
+			close(store->lock_fd);
+			store->lock_fd = -1;
+			return -1;
+		}
+	}
+#endif
+
+	store->locked = true;
+
+	return 0;
+}
+
+static void unlock_store(struct image_store *store)
+{
+	if (!store->locked) {
+		return;
+	}
+
+#ifdef __ZEPHYR__
+	pthread_mutex_unlock(&store_mutex);
+#else
+	close(store->lock_fd);
+	store->lock_fd = -1;
+#endif
+
+	store->locked = false;
+}
+
+/* Written next to the blobs, then renamed over the image, so it is never seen half-written */
+
+static int write_ref(const struct image_store *store, const char *name, const char *digest)
+{
+	int ret = -1;
+
+	char *prefix = join(store->blobs_dir, name);
+	char *tmp_path = prefix ? concat(prefix, ".ref" TEMP_SUFFIX) : NULL;
+	char *path = join(store->images_dir, name);
+	if (!tmp_path || !path) {
+		goto finish;
+	}
+
+	FILE *f = create_temp(tmp_path);
+	if (!f) {
+		fprintf(shell_err, "Failed to create '%s'\n", tmp_path);
+		goto finish;
+	}
+
+	int rc = fprintf(f, OCRE_IMAGE_REF_PREFIX "%s\n", digest);
+
+	if (fclose(f) || rc < 0 || rename(tmp_path, path)) {
+		fprintf(shell_err, "Failed to write image '%s'\n", path);
+		remove(tmp_path);
+		goto finish;
+	}
+
+	ret = 0;
+
+finish:
+	free(prefix);
+	free(tmp_path);
+	free(path);
+
+	return ret;
+}
+
+static struct image_index_entry *find_entry(const struct image_store *store, const char *name)
+{
+	for (size_t i = 0; i < store->count; i++) {
+		if (!strcmp(store->entries[i].name, name)) {
+			return &store->entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct image_index_entry *add_entry(struct image_store *store, const char *name)
+{
+	struct image_index_entry *entries = realloc(store->entries, (store->count + 1) * sizeof(*entries));
+	if (!entries) {
+		return NULL;
+	}
+
+	store->entries = entries;
+
+	struct image_index_entry *entry = &entries[store->count];
+
+	memset(entry, 0, sizeof(*entry));
+
+	entry->name = strdup(name);
+	if (!entry->name) {
+		return NULL;
+	}
+
+	store->count++;
+
+	return entry;
+}
+
+static void remove_entry(struct image_store *store, struct image_index_entry *entry)
+{
+	free(entry->name);
+
+	*entry = store->entries[--store->count];
+
+	store->dirty = true;
+}
+
+static void load_index(struct image_store *store)
+{
+	char line[INDEX_LINE_SIZE];
+
+	FILE *f = fopen(store->index_path, "r");
+	if (!f) {
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		char digest[OCRE_IMAGE_DIGEST_SIZE];
+		char name[INDEX_LINE_SIZE];
+		unsigned long long size, ino;
+		long long mtime;
+
+		if (sscanf(line, "%64s %llu %lld %llu %s", digest, &size, &mtime, &ino, name) != 5 ||
+		    strlen(digest) != OCRE_IMAGE_DIGEST_SIZE - 1 || find_entry(store, name)) {
+			continue;
+		}
+
+		struct image_index_entry *entry = add_entry(store, name);
+		if (!entry) {
+			break;
+		}
+
+		strcpy(entry->digest, digest);
+		entry->size = size;
+		entry->mtime = mtime;
+		entry->ino = ino;
+	}
+
+	fclose(f);
+}
+
+/* The index is loaded on first use, with the store locked */
+
+static int use_index(struct image_store *store)
+{
+	if (store->locked) {
+		return 0;
+	}
+
+	if (lock_store(store)) {
+		return -1;
+	}
+
+	load_index(store);
+
+	return 0;
+}
+
+static void save_index(const struct image_store *store)
+{
+	char *tmp_path = concat(store->index_path, TEMP_SUFFIX);
+	if (!tmp_path) {
+		return;
+	}
+
+	FILE *f = create_temp(tmp_path);
+	if (!f) {
+		fprintf(shell_err, "Failed to write image index '%s'\n", tmp_path);
+		free(tmp_path);
+		return;
+	}
+
+	int rc = 0;
+
+	for (size_t i = 0; i < store->count && rc >= 0; i++) {
+		const struct image_index_entry *entry = &store->entries[i];
+
+		rc = fprintf(f, "%s %llu %lld %llu %s\n", entry->digest, (unsigned long long)entry->size,
+			     (long long)entry->mtime, (unsigned long long)entry->ino, entry->name);
+	}
+
+	if (fclose(f) || rc < 0 || rename(tmp_path, store->index_path)) {
+		fprintf(shell_err, "Failed to write image index '%s'\n", store->index_path);
+		remove(tmp_path);
+	}
+
+	free(tmp_path);
+}
+
+int image_store_open(struct image_store *store, const char *working_directory)
+{
+	memset(store, 0, sizeof(*store));
+
+	store->images_dir = join(working_directory, "images");
+	store->blobs_dir = join(working_directory, "blobs");
+	store->index_path = join(working_directory, "blobs/index");
+
+	if (!store->images_dir || !store->blobs_dir || !store->index_path) {
+		fprintf(shell_err, "Failed to allocate memory for image store paths\n");
+		image_store_close(store);
+		return -1;
+	}
+
+	store->lock_fd = -1;
+
+	return 0;
+}
+
+void image_store_close(struct image_store *store)
+{
+	if (store->dirty) {
+		save_index(store);
+	}
+
+	unlock_store(store);
+
+	for (size_t i = 0; i < store->count; i++) {
+		free(store->entries[i].name);
+	}
+
+	free(store->entries);
+	free(store->images_dir);
+	free(store->blobs_dir);
+	free(store->index_path);
+
+	memset(store, 0, sizeof(*store));
+}
+
+static int get_blob(const struct image_store *store, const char *name, struct image_info *info)
+{
+	struct stat st;
+	char blob[sizeof("sha256/") + OCRE_IMAGE_DIGEST_SIZE];
+
+	snprintf(blob, sizeof(blob), "sha256/%s", info->digest);
+
+	char *blob_path = join(store->blobs_dir, blob);
+	if (!blob_path) {
+		return -1;
+	}
+
+	int rc = stat(blob_path, &st);
+
+	free(blob_path);
+
+	if (rc) {
+		fprintf(shell_err, "Image '%s' refers to missing blob '%s'\n", name, info->digest);
+		return -1;
+	}
+
+	info->size = st.st_size;
+	info->is_ref = true;
+
+	return 0;
+}
+
+int image_store_get(struct image_store *store, const char *name, struct image_info *info)
+{
+	int ret = -1;
+	struct stat st;
+
+	if (!ocre_is_valid_name(name)) {
+		return 1;
+	}
+
+	char *path = join(store->images_dir, name);
+	if (!path) {
+		return -1;
+	}
+
+	if (stat(path, &st) || !S_ISREG(st.st_mode)) {
+		ret = 1;
+		goto finish;
+	}
+
+	int rc = ocre_image_ref_read(path, info->digest);
+	if (rc < 0) {
+		fprintf(shell_err, "Failed to read image '%s'\n", path);
+		goto finish;
+	}
+
+	if (!rc) {
+		ret = get_blob(store, name, info);
+		goto finish;
+	}
+
+	/* A plain image, hashed only if it changed since it was last hashed */
+
+	if (use_index(store)) {
+		goto finish;
+	}
+
+	struct image_index_entry *entry = find_entry(store, name);
+
+	if (!entry || entry->size != (uint64_t)st.st_size || entry->mtime != (int64_t)st.st_mtime ||
+	    entry->ino != (uint64_t)st.st_ino) {
+		char digest[OCRE_IMAGE_DIGEST_SIZE] = {0};
+
+		if (sha256_file(path, digest)) {
+			fprintf(shell_err, "Failed to hash image '%s'\n", path);
+			goto finish;
+		}
+
+		if (!entry) {
+			entry = add_entry(store, name);
+			if (!entry) {
+				fprintf(shell_err, "Failed to allocate memory for image index\n");
+				goto finish;
+			}
+		}
+
+		strcpy(entry->digest, digest);
+		entry->size = st.st_size;
+		entry->mtime = st.st_mtime;
+		entry->ino = st.st_ino;
+
+		store->dirty = true;
+	}
+
+	entry->seen = true;
+
+	strcpy(info->digest, entry->digest);
+	info->size = entry->size;
+	info->is_ref = false;
+
+	ret = 0;
+
+finish:
+	free(path);
+
+	return ret;
+}
+
+void image_store_prune(struct image_store *store)
+{
+	if (use_index(store)) {
+		return;
+	}
+
+	for (size_t i = 0; i < store->count;) {
+		if (store->entries[i].seen) {
+			i++;
+		} else {
+			remove_entry(store, &store->entries[i]);
+		}
+	}
+}
+
+/* Renames a download, and its resume state if any. Without the state, the download starts over */
+
+static int rename_download(const char *from, const char *to)
+{
+	if (rename(from, to)) {
+		return -1;
+	}
+
+	char *from_resume = concat(from, RESUME_SUFFIX);
+	char *to_resume = concat(to, RESUME_SUFFIX);
+
+	if (from_resume && to_resume) {
+		rename(from_resume, to_resume);
+	}
+
+	free(from_resume);
+	free(to_resume);
+
+	return 0;
+}
+
+char *image_store_temp_path(const struct image_store *store, const char *name)
+{
+	char *prefix = join(store->blobs_dir, name);
+	char *path = prefix ? concat(prefix, TEMP_SUFFIX) : NULL;
+	char *partial = prefix ? concat(prefix, PARTIAL_SUFFIX) : NULL;
+
+	if (!path || !partial) {
+		goto error;
+	}
+
+	int fd = make_temp(path);
+	if (fd < 0) {
+		fprintf(shell_err, "Failed to create '%s': errno=%d\n", path, errno);
+		goto error;
+	}
+
+	close(fd);
+
+	/* Take over what a failed pull of the same image kept. Renaming is atomic, so only one pull gets it */
+
+	rename_download(partial, path);
+
+	free(prefix);
+	free(partial);
+
+	return path;
+
+error:
+	free(prefix);
+	free(path);
+	free(partial);
+
+	return NULL;
+}
+
+void image_store_keep_partial(const struct image_store *store, const char *name, const char *path)
+{
+	char *prefix = join(store->blobs_dir, name);
+	char *partial = prefix ? concat(prefix, PARTIAL_SUFFIX) : NULL;
+
+	if (!partial || rename_download(path, partial)) {
+		remove(path);
+	}
+
+	free(prefix);
+	free(partial);
+}
+
+int image_store_import(struct image_store *store, const char *name, const char *path, char *digest)
+{
+	struct stat st;
+	char blob[sizeof("sha256/") + OCRE_IMAGE_DIGEST_SIZE];
+
+	if (!*digest && sha256_file(path, digest)) {
+		fprintf(shell_err, "Failed to hash '%s'\n", path);
+		return -1;
+	}
+
+	/* Another pull or rm may be using the same blob */
+
+	if (use_index(store)) {
+		return -1;
+	}
+
+	snprintf(blob, sizeof(blob), "sha256/%s", digest);
+
+	char *blob_path = join(store->blobs_dir, blob);
+	if (!blob_path) {
+		return -1;
+	}
+
+	/* Identical images are stored once */
+
+	if (!stat(blob_path, &st)) {
+		remove(path);
+	} else if (rename(path, blob_path)) {
+		fprintf(shell_err, "Failed to store blob '%s': errno=%d\n", blob_path, errno);
+		free(blob_path);
+		return -1;
+	}
+
+	free(blob_path);
+
+	if (write_ref(store, name, digest)) {
+		return -1;
+	}
+
+	struct image_index_entry *entry = find_entry(store, name);
+	if (entry) {
+		remove_entry(store, entry);
+	}
+
+	return 0;
+}
+
+static bool blob_referenced(const struct image_store *store, const char *digest)
+{
+	bool referenced = false;
+	char ref_digest[OCRE_IMAGE_DIGEST_SIZE];
+	const struct dirent *dir;
+
+	DIR *d = opendir(store->images_dir);
+	if (!d) {
+		return true;
+	}
+
+	while (!referenced && (dir = readdir(d)) != NULL) {
+		if (!ocre_is_valid_name(dir->d_name)) {
+			continue;
+		}
+
+		char *path = join(store->images_dir, dir->d_name);
+		if (!path) {
+			referenced = true;
+			break;
+		}
+
+		/* An image that cannot be read may be a reference to the blob, keep it */
+
+		int rc = ocre_image_ref_read(path, ref_digest);
+
+		referenced = rc < 0 || (!rc && !strcmp(ref_digest, digest));
+
+		free(path);
+	}
+
+	closedir(d);
+
+	return referenced;
+}
+
+int image_store_remove(struct image_store *store, const char *name)
+{
+	int ret = -1;
+	char digest[OCRE_IMAGE_DIGEST_SIZE];
+
+	/* Keeps another pull from referring to the blob while it is removed */
+
+	if (use_index(store)) {
+		return -1;
+	}
+
+	char *path = join(store->images_dir, name);
+	if (!path) {
+		return -1;
+	}
+
+	int rc = ocre_image_ref_read(path, digest);
+	if (rc < 0) {
+		fprintf(shell_err, "Failed to read image '%s'\n", path);
+		goto finish;
+	}
+
+	bool is_ref = !rc;
+
+	if (remove(path)) {
+		fprintf(shell_err, "Failed to remove image '%s'\n", path);
+		goto finish;
+	}
+
+	struct image_index_entry *entry = find_entry(store, name);
+	if (entry) {
+		remove_entry(store, entry);
+	}
+
+	/* Running containers keep their blob mapped, it goes away when they are done with it */
+
+	if (is_ref && !blob_referenced(store, digest)) {
+		char blob[sizeof("sha256/") + OCRE_IMAGE_DIGEST_SIZE];
+
+		snprintf(blob, sizeof(blob), "sha256/%s", digest);
+
+		char *blob_path = join(store->blobs_dir, blob);
+		if (blob_path && remove(blob_path)) {
+			fprintf(shell_err, "Failed to remove blob '%s'\n", blob_path);
+		}
+
+		free(blob_path);
+	}
+
+	ret = 0;
+
+finish:
+	free(path);
+
+	return ret;
+}
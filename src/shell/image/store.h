@@ -0,0 +1,75 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ocre/ocre.h>
+
+/* Content-addressed image store
+ *
+ * Pulled images are stored once per content, in blobs/sha256/<digest>, and named by a reference in images/ holding
+ * "sha256:<digest>\n". Plain files copied to images/ are images too: their digests are cached in blobs/index, along
+ * with the size, mtime and inode they were computed for, so they are hashed again only when they change.
+ *
+ * The index is loaded on first use, and the store is locked from then until it is closed, so that concurrent commands
+ * of the daemon, or other processes, do not lose each other's updates or remove a blob that is being referred to.
+ */
+
+struct image_index_entry;
+
+struct image_store {
+	char *images_dir;
+	char *blobs_dir;
+	char *index_path;
+	struct image_index_entry *entries;
+	size_t count;
+	bool dirty;
+	bool locked; /* Loaded the index, and holds the lock of the store */
+	int lock_fd;
+};
+
+struct image_info {
+	char digest[OCRE_IMAGE_DIGEST_SIZE];
+	uint64_t size;
+	bool is_ref; /* Stored in a blob, rather than a plain file */
+};
+
+int image_store_open(struct image_store *store, const char *working_directory);
+
+/* Saves the index if it changed, and releases the lock of the store */
+
+void image_store_close(struct image_store *store);
+
+/* returns 0 and fills info, 1 if there is no image of that name, negative on error */
+
+int image_store_get(struct image_store *store, const char *name, struct image_info *info);
+
+/* Forgets the cached digests of the plain images not looked up since the store was opened */
+
+void image_store_prune(struct image_store *store);
+
+/* Path of a new file where to write a file to import, in the same filesystem as the blobs. If a previous download of
+ * name was kept by image_store_keep_partial(), the file holds it. To be freed by the caller
+ */
+
+char *image_store_temp_path(const struct image_store *store, const char *name);
+
+/* Keeps the failed download at path, made by image_store_temp_path(), for the next download of name to resume */
+
+void image_store_keep_partial(const struct image_store *store, const char *name, const char *path);
+
+/* Moves the file at path into the store, named name. digest is the digest of the file, or an empty string to compute
+ * it, and is filled on return. The file is removed if the store already holds the same content
+ */
+
+int image_store_import(struct image_store *store, const char *name, const char *path, char *digest);
+
+/* Removes an image, and its blob if no other image refers to it */
+
+int image_store_remove(struct image_store *store, const char *name);
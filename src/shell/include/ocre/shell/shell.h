@@ -5,6 +5,69 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdio.h>
+
 #include <ocre/ocre.h>
 
 int ocre_shell(struct ocre_context *ctx, int argc, char *argv[]);
+
+/**
+ * @brief Runs a shell command with its output sent to the given streams
+ *
+ * Commands of several threads can run at once, each with its own streams.
+ *
+ * @param ctx The context to run the command in
+ * @param argc The number of arguments
+ * @param argv The arguments, starting with the program name
+ * @param out The stream of the normal output, or NULL for stdout
+ * @param err The stream of the errors and usage, or NULL for stderr
+ *
+ * @return The result of the command
+ */
+int ocre_shell_run(struct ocre_context *ctx, int argc, char *argv[], FILE *out, FILE *err);
+
+#ifndef __ZEPHYR__
+
+/**
+ * @brief A daemon serving shell commands on a Unix socket
+ */
+struct ocre_shell_server;
+
+/**
+ * @brief Runs a shell command in the daemon listening on a Unix socket
+ *
+ * The output of the command is written to stdout and stderr.
+ *
+ * @param socket_path The path of the socket of the daemon
+ * @param argc The number of arguments
+ * @param argv The arguments, starting with the program name
+ * @param[out] status The result of the command
+ *
+ * @return 0 if the daemon ran the command, -ENOENT or -ECONNREFUSED if no daemon listens on the socket, other negative
+ * error number on failure
+ */
+int ocre_shell_remote(const char *socket_path, int argc, char *argv[], int *status);
+
+/**
+ * @brief Starts serving shell commands on a Unix socket
+ *
+ * Each connection runs one command in its own thread. A stale socket file is replaced.
+ *
+ * @param ctx The context to run the commands in
+ * @param socket_path The path of the socket to create
+ *
+ * @return The server, or NULL on failure
+ */
+struct ocre_shell_server *ocre_shell_server_start(struct ocre_context *ctx, const char *socket_path);
+
+/**
+ * @brief Stops serving shell commands and removes the socket
+ *
+ * Disconnects the clients and waits for their commands to finish. If commands are still running after a while, e.g.
+ * waiting for a container, the running containers of the context are killed.
+ *
+ * @param server The server to stop
+ */
+void ocre_shell_server_stop(struct ocre_shell_server *server);
+
+#endif
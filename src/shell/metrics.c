@@ -0,0 +1,54 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ocre/ocre.h>
+
+#include "command.h"
+
+static int usage(const char *argv0)
+{
+	fprintf(shell_err, "Usage: %s metrics\n", argv0);
+	fprintf(shell_err, "\nDisplays the metrics in Prometheus text format.\n");
+	return -1;
+}
+
+int cmd_metrics(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
+{
+	if (argc != 1) {
+		fprintf(shell_err, "'%s metrics' does not take arguments\n\n", argv0);
+		return usage(argv0);
+	}
+
+	char *buf = NULL;
+	size_t size = 0;
+	size_t len = ocre_metrics_dump(NULL, 0);
+
+	/* Values may grow between two dumps, so try again until it fits */
+
+	while (len >= size) {
+		size = len + 1;
+
+		char *new_buf = realloc(buf, size);
+		if (!new_buf) {
+			fprintf(shell_err, "Failed to allocate memory for the metrics\n");
+			free(buf);
+			return -1;
+		}
+
+		buf = new_buf;
+		len = ocre_metrics_dump(buf, size);
+	}
+
+	fputs(buf, shell_out);
+
+	free(buf);
+
+	return 0;
+}
@@ -5,9 +5,6 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
-int ocre_download_file(const char *url, const char *filepath)
-{
-	/* Not implemented */
+#include <ocre/ocre.h>
 
-	return -1;
-}
+int cmd_metrics(struct ocre_context *ctx, const char *argv0, int argc, char **argv);
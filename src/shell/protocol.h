@@ -0,0 +1,35 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef OCRE_SHELL_PROTOCOL_H
+#define OCRE_SHELL_PROTOCOL_H
+
+/* Protocol between the ocre shell and the ocred daemon, over a Unix stream socket.
+ *
+ * Each message is a type byte and a 32-bit big-endian payload length, followed by the payload. A connection runs a
+ * single command:
+ *
+ *   client -> daemon  COMMAND  version byte, then each argument of the command, NUL-terminated
+ *   daemon -> client  STDOUT   output of the command, any number of times
+ *   daemon -> client  STDERR   errors of the command, any number of times
+ *   daemon -> client  EXIT     32-bit big-endian result of the command, then the daemon closes the connection
+ */
+
+#define OCRE_SHELL_PROTOCOL_VERSION 1
+
+#define OCRE_SHELL_HEADER_SIZE 5
+
+#define OCRE_SHELL_MAX_COMMAND_SIZE (64 * 1024)
+
+enum ocre_shell_message_type {
+	OCRE_SHELL_MESSAGE_COMMAND = 1,
+	OCRE_SHELL_MESSAGE_STDOUT = 2,
+	OCRE_SHELL_MESSAGE_STDERR = 3,
+	OCRE_SHELL_MESSAGE_EXIT = 4,
+};
+
+#endif /* OCRE_SHELL_PROTOCOL_H */
@@ -0,0 +1,750 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/* Zephyr has no Unix sockets, the Zephyr shell runs the commands */
+
+#ifndef __ZEPHYR__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+
+#include <ocre/ocre.h>
+#include <ocre/shell/shell.h>
+
+#include "protocol.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Commands still running this long after their clients were disconnected are waiting for containers, e.g. wait or
+ * logs -f, which are then killed
+ */
+
+#define SERVER_STOP_TIMEOUT_MS 2000
+
+/* The Linux C libraries have fopencookie(), the BSDs and macOS have funopen() instead */
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define STREAM_FUNOPEN
+#endif
+
+/* Messages */
+
+static int send_all(int fd, const void *data, size_t len)
+{
+	const char *p = data;
+
+	while (len) {
+		ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n <= 0) {
+			return n < 0 ? -errno : -EPIPE;
+		}
+
+		p += n;
+		len -= (size_t)n;
+	}
+
+	return 0;
+}
+
+static int recv_all(int fd, void *data, size_t len)
+{
+	char *p = data;
+
+	while (len) {
+		ssize_t n = recv(fd, p, len, 0);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n <= 0) {
+			return n < 0 ? -errno : -EPIPE;
+		}
+
+		p += n;
+		len -= (size_t)n;
+	}
+
+	return 0;
+}
+
+static void put_u32(unsigned char *p, uint32_t value)
+{
+	p[0] = (unsigned char)(value >> 24);
+	p[1] = (unsigned char)(value >> 16);
+	p[2] = (unsigned char)(value >> 8);
+	p[3] = (unsigned char)value;
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static int send_message(int fd, enum ocre_shell_message_type type, const void *data, size_t len)
+{
+	unsigned char header[OCRE_SHELL_HEADER_SIZE];
+
+	header[0] = (unsigned char)type;
+	put_u32(&header[1], (uint32_t)len);
+
+	int rc = send_all(fd, header, sizeof(header));
+	if (rc) {
+		return rc;
+	}
+
+	return send_all(fd, data, len);
+}
+
+static int recv_header(int fd, unsigned char *type, uint32_t *len)
+{
+	unsigned char header[OCRE_SHELL_HEADER_SIZE];
+
+	int rc = recv_all(fd, header, sizeof(header));
+	if (rc) {
+		return rc;
+	}
+
+	*type = header[0];
+	*len = get_u32(&header[1]);
+
+	return 0;
+}
+
+static int unix_address(struct sockaddr_un *addr, const char *socket_path)
+{
+	if (!socket_path || !*socket_path) {
+		return -EINVAL;
+	}
+
+	if (strlen(socket_path) >= sizeof(addr->sun_path)) {
+		return -ENAMETOOLONG;
+	}
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, socket_path);
+
+	return 0;
+}
+
+/* Client */
+
+static int send_command(int fd, int argc, char *argv[])
+{
+	size_t size = 1;
+
+	for (int i = 0; i < argc; i++) {
+		size += strlen(argv[i]) + 1;
+	}
+
+	if (size > OCRE_SHELL_MAX_COMMAND_SIZE) {
+		return -E2BIG;
+	}
+
+	char *payload = malloc(size);
+	if (!payload) {
+		return -ENOMEM;
+	}
+
+	char *p = payload;
+	*p++ = OCRE_SHELL_PROTOCOL_VERSION;
+
+	for (int i = 0; i < argc; i++) {
+		size_t len = strlen(argv[i]) + 1;
+
+		memcpy(p, argv[i], len);
+		p += len;
+	}
+
+	int rc = send_message(fd, OCRE_SHELL_MESSAGE_COMMAND, payload, size);
+
+	free(payload);
+
+	return rc;
+}
+
+static int forward_output(int fd, FILE *stream, uint32_t len)
+{
+	char buf[1024];
+
+	while (len) {
+		size_t n = len < sizeof(buf) ? len : sizeof(buf);
+
+		int rc = recv_all(fd, buf, n);
+		if (rc) {
+			return rc;
+		}
+
+		fwrite(buf, 1, n, stream);
+		len -= (uint32_t)n;
+	}
+
+	fflush(stream);
+
+	return 0;
+}
+
+int ocre_shell_remote(const char *socket_path, int argc, char *argv[], int *status)
+{
+	struct sockaddr_un addr;
+	int ret = -1;
+
+	if (argc < 1 || !argv || !status) {
+		return -EINVAL;
+	}
+
+	int rc = unix_address(&addr, socket_path);
+	if (rc) {
+		return rc;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		ret = -errno;
+		goto finish;
+	}
+
+	ret = send_command(fd, argc, argv);
+	if (ret) {
+		goto finish;
+	}
+
+	for (;;) {
+		unsigned char type;
+		uint32_t len;
+
+		ret = recv_header(fd, &type, &len);
+		if (ret) {
+			goto finish;
+		}
+
+		switch (type) {
+			case OCRE_SHELL_MESSAGE_STDOUT: {
+				ret = forward_output(fd, stdout, len);
+				break;
+			}
+			case OCRE_SHELL_MESSAGE_STDERR: {
+				ret = forward_output(fd, stderr, len);
+				break;
+			}
+			case OCRE_SHELL_MESSAGE_EXIT: {
+				unsigned char value[4];
+
+				if (len != sizeof(value)) {
+					ret = -EPROTO;
+					goto finish;
+				}
+
+				ret = recv_all(fd, value, sizeof(value));
+				if (!ret) {
+					*status = (int32_t)get_u32(value);
+				}
+
+				goto finish;
+			}
+			default: {
+				ret = -EPROTO;
+				break;
+			}
+		}
+
+		if (ret) {
+			goto finish;
+		}
+	}
+
+finish:
+	close(fd);
+
+	return ret;
+}
+
+/* Server */
+
+struct client {
+	struct client *next;
+	struct ocre_shell_server *server;
+	int fd;
+};
+
+struct ocre_shell_server {
+	struct ocre_context *ctx;
+	char *socket_path;
+	int fd;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct client *clients;
+};
+
+struct stream {
+	int fd;
+	enum ocre_shell_message_type type;
+};
+
+static ssize_t stream_write(void *cookie, const char *buf, size_t size)
+{
+	struct stream *stream = cookie;
+
+	if (size > OCRE_SHELL_MAX_COMMAND_SIZE) {
+		size = OCRE_SHELL_MAX_COMMAND_SIZE;
+	}
+
+	if (send_message(stream->fd, stream->type, buf, size)) {
+		return -1;
+	}
+
+	return (ssize_t)size;
+}
+
+static int stream_close(void *cookie)
+{
+	free(cookie);
+
+	return 0;
+}
+
+#ifdef STREAM_FUNOPEN
+static int stream_funopen_write(void *cookie, const char *buf, int size)
+{
+	return (int)stream_write(cookie, buf, (size_t)size);
+}
+#endif
+
+static FILE *open_stream(int fd, enum ocre_shell_message_type type)
+{
+	struct stream *stream = malloc(sizeof(struct stream));
+	if (!stream) {
+		return NULL;
+	}
+
+	stream->fd = fd;
+	stream->type = type;
+
+#ifdef STREAM_FUNOPEN
+	FILE *f = funopen(stream, NULL, stream_funopen_write, NULL, stream_close);
+#else
+	cookie_io_functions_t functions = {
+		.write = stream_write,
+		.close = stream_close,
+	};
+
+	FILE *f = fopencookie(stream, "w", functions);
+#endif
+	if (!f) {
+		free(stream);
+		return NULL;
+	}
+
+	setvbuf(f, NULL, _IOLBF, BUFSIZ);
+
+	return f;
+}
+
+/* Returns the number of arguments, with argv pointing into the payload */
+
+static int parse_command(char *payload, uint32_t len, char ***argv)
+{
+	if (len < 2 || payload[0] != OCRE_SHELL_PROTOCOL_VERSION || payload[len - 1] != '\0') {
+		return -1;
+	}
+
+	int argc = 0;
+	for (uint32_t i = 1; i < len; i++) {
+		if (payload[i] == '\0') {
+			argc++;
+		}
+	}
+
+	*argv = calloc(argc + 1, sizeof(char *));
+	if (!*argv) {
+		return -1;
+	}
+
+	char *p = payload + 1;
+	for (int i = 0; i < argc; i++) {
+		(*argv)[i] = p;
+		p += strlen(p) + 1;
+	}
+
+	return argc;
+}
+
+static void run_client(struct client *client)
+{
+	char *payload = NULL;
+	char **argv = NULL;
+	FILE *out = NULL;
+	FILE *err = NULL;
+	unsigned char type;
+	uint32_t len;
+
+	if (recv_header(client->fd, &type, &len)) {
+		return;
+	}
+
+	if (type != OCRE_SHELL_MESSAGE_COMMAND || len > OCRE_SHELL_MAX_COMMAND_SIZE) {
+		fprintf(stderr, "Invalid command message from client\n");
+		return;
+	}
+
+	payload = malloc(len ? len : 1);
+	if (!payload) {
+		return;
+	}
+
+	if (recv_all(client->fd, payload, len)) {
+		goto finish;
+	}
+
+	int argc = parse_command(payload, len, &argv);
+	if (argc < 1) {
+		fprintf(stderr, "Invalid command from client\n");
+		goto finish;
+	}
+
+	out = open_stream(client->fd, OCRE_SHELL_MESSAGE_STDOUT);
+	err = open_stream(client->fd, OCRE_SHELL_MESSAGE_STDERR);
+	if (!out || !err) {
+		fprintf(stderr, "Failed to open the streams of the client\n");
+		goto finish;
+	}
+
+	int rc = ocre_shell_run(client->server->ctx, argc, argv, out, err);
+
+	/* Flush the output before the result */
+
+	fclose(out);
+	out = NULL;
+	fclose(err);
+	err = NULL;
+
+	unsigned char value[4];
+	put_u32(value, (uint32_t)(int32_t)rc);
+
+	send_message(client->fd, OCRE_SHELL_MESSAGE_EXIT, value, sizeof(value));
+
+finish:
+	if (out) {
+		fclose(out);
+	}
+
+	if (err) {
+		fclose(err);
+	}
+
+	free(argv);
+	free(payload);
+}
+
+static void *client_thread(void *arg)
+{
+	struct client *client = arg;
+	struct ocre_shell_server *server = client->server;
+
+	run_client(client);
+
+	pthread_mutex_lock(&server->mutex);
+
+	for (struct client **p = &server->clients; *p; p = &(*p)->next) {
+		if (*p == client) {
+			*p = client->next;
+			break;
+		}
+	}
+
+	close(client->fd);
+	free(client);
+
+	pthread_cond_broadcast(&server->cond);
+	pthread_mutex_unlock(&server->mutex);
+
+	return NULL;
+}
+
+/* The commands have the access of the daemon to the containers and to the files, only its user may run them */
+
+static int peer_uid(int fd, uid_t *uid)
+{
+#ifdef __linux__
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len)) {
+		return -errno;
+	}
+
+	*uid = cred.uid;
+#else
+	gid_t gid;
+
+	if (getpeereid(fd, uid, &gid)) {
+		return -errno;
+	}
+#endif
+
+	return 0;
+}
+
+static void *accept_thread(void *arg)
+{
+	struct ocre_shell_server *server = arg;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	for (;;) {
+		int fd = accept(server->fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+
+			/* The listening socket was shut down */
+
+			break;
+		}
+
+		uid_t uid;
+		if (peer_uid(fd, &uid) || uid != geteuid()) {
+			fprintf(stderr, "Rejected client of another user\n");
+			close(fd);
+			continue;
+		}
+
+		struct client *client = calloc(1, sizeof(struct client));
+		if (!client) {
+			close(fd);
+			continue;
+		}
+
+		client->server = server;
+		client->fd = fd;
+
+		pthread_mutex_lock(&server->mutex);
+
+		client->next = server->clients;
+		server->clients = client;
+
+		pthread_t thread;
+		int rc = pthread_create(&thread, &attr, client_thread, client);
+		if (rc) {
+			fprintf(stderr, "Failed to create client thread: rc=%d\n", rc);
+			server->clients = client->next;
+			close(fd);
+			free(client);
+		}
+
+		pthread_mutex_unlock(&server->mutex);
+	}
+
+	pthread_attr_destroy(&attr);
+
+	return NULL;
+}
+
+static int listen_unix(const char *socket_path)
+{
+	struct sockaddr_un addr;
+
+	int rc = unix_address(&addr, socket_path);
+	if (rc) {
+		fprintf(stderr, "Invalid socket path '%s'\n", socket_path);
+		return rc;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	/* Only replace the socket of a daemon that is gone */
+
+	if (!connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		fprintf(stderr, "A daemon is already listening on '%s'\n", socket_path);
+		close(fd);
+		return -EADDRINUSE;
+	}
+
+	close(fd);
+	unlink(socket_path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	/* Connections are refused until we listen, so nobody can connect before the socket is private */
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || chmod(socket_path, 0600) || listen(fd, SOMAXCONN)) {
+		rc = -errno;
+		fprintf(stderr, "Failed to listen on '%s': errno=%d\n", socket_path, errno);
+		close(fd);
+		return rc;
+	}
+
+	return fd;
+}
+
+struct ocre_shell_server *ocre_shell_server_start(struct ocre_context *ctx, const char *socket_path)
+{
+	if (!ctx) {
+		return NULL;
+	}
+
+	struct ocre_shell_server *server = calloc(1, sizeof(struct ocre_shell_server));
+	if (!server) {
+		return NULL;
+	}
+
+	server->ctx = ctx;
+
+	server->socket_path = strdup(socket_path ? socket_path : "");
+	if (!server->socket_path) {
+		goto error;
+	}
+
+	server->fd = listen_unix(server->socket_path);
+	if (server->fd < 0) {
+		goto error;
+	}
+
+	pthread_mutex_init(&server->mutex, NULL);
+	pthread_cond_init(&server->cond, NULL);
+
+	int rc = pthread_create(&server->thread, NULL, accept_thread, server);
+	if (rc) {
+		fprintf(stderr, "Failed to create server thread: rc=%d\n", rc);
+		pthread_cond_destroy(&server->cond);
+		pthread_mutex_destroy(&server->mutex);
+		close(server->fd);
+		unlink(server->socket_path);
+		goto error;
+	}
+
+	return server;
+
+error:
+	free(server->socket_path);
+	free(server);
+
+	return NULL;
+}
+
+/* Kills the running containers of the context, so the commands waiting for them finish */
+
+static void kill_containers(struct ocre_context *ctx)
+{
+	int count = ocre_context_get_container_count(ctx);
+	if (count <= 0) {
+		return;
+	}
+
+	struct ocre_container **containers = calloc(count, sizeof(struct ocre_container *));
+	if (!containers) {
+		return;
+	}
+
+	count = ocre_context_get_containers(ctx, containers, count);
+
+	for (int i = 0; i < count; i++) {
+		ocre_container_status_t status = ocre_container_get_status(containers[i]);
+
+		if (status == OCRE_CONTAINER_STATUS_RUNNING || status == OCRE_CONTAINER_STATUS_PAUSED) {
+			ocre_container_kill(containers[i]);
+		}
+	}
+
+	free(containers);
+}
+
+void ocre_shell_server_stop(struct ocre_shell_server *server)
+{
+	if (!server) {
+		return;
+	}
+
+	/* Wakes up accept() */
+
+	shutdown(server->fd, SHUT_RDWR);
+	pthread_join(server->thread, NULL);
+
+	close(server->fd);
+	unlink(server->socket_path);
+
+	/* Disconnect the clients, their commands fail to write their output and finish */
+
+	pthread_mutex_lock(&server->mutex);
+
+	for (struct client *client = server->clients; client; client = client->next) {
+		shutdown(client->fd, SHUT_RDWR);
+	}
+
+	while (server->clients) {
+		struct timespec ts;
+		int rc = 0;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += SERVER_STOP_TIMEOUT_MS / 1000;
+		ts.tv_nsec += (long)(SERVER_STOP_TIMEOUT_MS % 1000) * 1000000L;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+
+		while (server->clients && rc != ETIMEDOUT) {
+			rc = pthread_cond_timedwait(&server->cond, &server->mutex, &ts);
+		}
+
+		if (server->clients) {
+			fprintf(stderr, "Commands are still running, killing the containers\n");
+
+			/* The clients need the lock to finish */
+
+			pthread_mutex_unlock(&server->mutex);
+			kill_containers(server->ctx);
+			pthread_mutex_lock(&server->mutex);
+		}
+	}
+
+	pthread_mutex_unlock(&server->mutex);
+
+	pthread_cond_destroy(&server->cond);
+	pthread_mutex_destroy(&server->mutex);
+
+	free(server->socket_path);
+	free(server);
+}
+
+#endif /* __ZEPHYR__ */
@@ -26,6 +26,39 @@
    See sha256.h for short documentation on library usage */
 
 #include "sha256.h"
+#include "sha256_hw.h"
+
+static void sha256_calc_blocks(uint32_t h[8], const uint8_t *data, size_t blocks);
+
+/* Implementation of the compression function, picked on first use. Selecting it again from another thread stores the
+   same pointer, so there is no need to lock */
+static sha256_blocks_t sha256_blocks;
+static const char *sha256_backend_name;
+
+static void sha256_select(int scalar)
+{
+	sha256_blocks_t blocks = scalar ? NULL : sha256_hw_detect(&sha256_backend_name);
+
+	if (!blocks) {
+		blocks = sha256_calc_blocks;
+		sha256_backend_name = "scalar";
+	}
+
+	sha256_blocks = blocks;
+}
+
+const char *sha256_backend(void)
+{
+	if (!sha256_blocks)
+		sha256_select(0);
+
+	return sha256_backend_name;
+}
+
+void sha256_force_scalar(int scalar)
+{
+	sha256_select(scalar);
+}
 
 void sha256_init(struct sha256_buff *buff)
 {
@@ -39,9 +72,12 @@ void sha256_init(struct sha256_buff *buff)
 	buff->h[7] = 0x5be0cd19;
 	buff->data_size = 0;
 	buff->chunk_size = 0;
+
+	if (!sha256_blocks)
+		sha256_select(0);
 }
 
-static const uint32_t k[64] = {
+const uint32_t sha256_k[64] = {
 	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
 	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
 	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
@@ -53,7 +89,7 @@ static const uint32_t k[64] = {
 
 #define rotate_r(val, bits) (val >> bits | val << (32 - bits))
 
-static void sha256_calc_chunk(struct sha256_buff *buff, const uint8_t *chunk)
+static void sha256_calc_chunk(uint32_t h[8], const uint8_t *chunk)
 {
 	uint32_t w[64];
 	uint32_t tv[8];
@@ -72,12 +108,12 @@ static void sha256_calc_chunk(struct sha256_buff *buff, const uint8_t *chunk)
 	}
 
 	for (i = 0; i < 8; ++i)
-		tv[i] = buff->h[i];
+		tv[i] = h[i];
 
 	for (i = 0; i < 64; ++i) {
 		uint32_t S1 = rotate_r(tv[4], 6) ^ rotate_r(tv[4], 11) ^ rotate_r(tv[4], 25);
 		uint32_t ch = (tv[4] & tv[5]) ^ (~tv[4] & tv[6]);
-		uint32_t temp1 = tv[7] + S1 + ch + k[i] + w[i];
+		uint32_t temp1 = tv[7] + S1 + ch + sha256_k[i] + w[i];
 		uint32_t S0 = rotate_r(tv[0], 2) ^ rotate_r(tv[0], 13) ^ rotate_r(tv[0], 22);
 		uint32_t maj = (tv[0] & tv[1]) ^ (tv[0] & tv[2]) ^ (tv[1] & tv[2]);
 		uint32_t temp2 = S0 + maj;
@@ -93,7 +129,15 @@ static void sha256_calc_chunk(struct sha256_buff *buff, const uint8_t *chunk)
 	}
 
 	for (i = 0; i < 8; ++i)
-		buff->h[i] += tv[i];
+		h[i] += tv[i];
+}
+
+static void sha256_calc_blocks(uint32_t h[8], const uint8_t *data, size_t blocks)
+{
+	while (blocks--) {
+		sha256_calc_chunk(h, data);
+		data += 64;
+	}
 }
 
 void sha256_update(struct sha256_buff *buff, const void *data, size_t size)
@@ -108,13 +152,13 @@ void sha256_update(struct sha256_buff *buff, const void *data, size_t size)
 		ptr += (64 - buff->chunk_size);
 		size -= (64 - buff->chunk_size);
 		buff->chunk_size = 0;
-		sha256_calc_chunk(buff, tmp_chunk);
+		sha256_blocks(buff->h, tmp_chunk, 1);
 	}
-	/* Run over data chunks */
-	while (size >= 64) {
-		sha256_calc_chunk(buff, ptr);
-		ptr += 64;
-		size -= 64;
+	/* Run over data chunks, all at once so accelerated implementations keep their state in registers */
+	if (size >= 64) {
+		sha256_blocks(buff->h, ptr, size / 64);
+		ptr += size & ~(size_t)63;
+		size &= 63;
 	}
 
 	/* Save remaining data in buff, will be reused on next call or finalize */
@@ -130,7 +174,7 @@ void sha256_finalize(struct sha256_buff *buff)
 
 	/* If there isn't enough space to fit int64, pad chunk with zeroes and prepare next chunk */
 	if (buff->chunk_size > 56) {
-		sha256_calc_chunk(buff, buff->last_chunk);
+		sha256_blocks(buff->h, buff->last_chunk, 1);
 		memset(buff->last_chunk, 0, 64);
 	}
 
@@ -142,7 +186,7 @@ void sha256_finalize(struct sha256_buff *buff)
 		size >>= 8;
 	}
 
-	sha256_calc_chunk(buff, buff->last_chunk);
+	sha256_blocks(buff->h, buff->last_chunk, 1);
 }
 
 void sha256_read(const struct sha256_buff *buff, uint8_t *hash)
@@ -52,4 +52,11 @@ void sha256_read(const struct sha256_buff *buff, uint8_t *hash);
 /* Read digest into 64-char string as hex (without null-byte) */
 void sha256_read_hex(const struct sha256_buff *buff, char *hex);
 
+/* Name of the implementation in use: "scalar", or the CPU instructions it uses ("sha-ni", "armv8-sha2") */
+const char *sha256_backend(void);
+
+/* Use the portable implementation even if the CPU has SHA-256 instructions, or go back to the fastest one.
+   Not to be called while hashing in other threads */
+void sha256_force_scalar(int scalar);
+
 #endif
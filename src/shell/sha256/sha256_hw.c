@@ -0,0 +1,174 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* SHA-256 compression using the instructions of x86 (SHA-NI) and ARMv8 (SHA2 crypto extension) CPUs.
+ *
+ * Both keep the state in two vector registers, and compute four words of the message schedule at a time: group i of
+ * the schedule is derived from groups i-4 to i-1, kept in a ring of four registers. Functions are built for their
+ * instructions with target attributes, so the rest of the shell needs no special compiler flags, and are only called
+ * once the CPU is known to support them.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256_hw.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+__attribute__((target("sha,sse4.1"))) static void sha256_blocks_shani(uint32_t h[8], const uint8_t *data,
+								       size_t blocks)
+{
+	const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	/* The instructions work on the state as ABEF and CDGH */
+
+	__m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[0]), 0xb1);
+	__m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[4]), 0x1b);
+
+	__m128i abef = _mm_alignr_epi8(dcba, efgh, 8);
+	__m128i cdgh = _mm_blend_epi16(efgh, dcba, 0xf0);
+
+	while (blocks--) {
+		__m128i abef_save = abef;
+		__m128i cdgh_save = cdgh;
+		__m128i m[4];
+
+		for (int i = 0; i < 16; i++) {
+			__m128i w;
+
+			if (i < 4) {
+				w = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), byteswap);
+			} else {
+				w = _mm_sha256msg1_epu32(m[i & 3], m[(i + 1) & 3]);
+				w = _mm_add_epi32(w, _mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4));
+				w = _mm_sha256msg2_epu32(w, m[(i + 3) & 3]);
+			}
+
+			m[i & 3] = w;
+
+			__m128i wk = _mm_add_epi32(w, _mm_loadu_si128((const __m128i *)&sha256_k[4 * i]));
+
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0e));
+		}
+
+		abef = _mm_add_epi32(abef, abef_save);
+		cdgh = _mm_add_epi32(cdgh, cdgh_save);
+
+		data += 64;
+	}
+
+	__m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+	__m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+
+	_mm_storeu_si128((__m128i *)&h[0], _mm_blend_epi16(feba, dchg, 0xf0));
+	_mm_storeu_si128((__m128i *)&h[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+
+sha256_blocks_t sha256_hw_detect(const char **name)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1)) {
+		return NULL;
+	}
+
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_SHA)) {
+		return NULL;
+	}
+
+	*name = "sha-ni";
+
+	return sha256_blocks_shani;
+}
+
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <arm_neon.h>
+
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#if defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+#define SHA256_ARM_TARGET
+#elif defined(__clang__)
+#define SHA256_ARM_TARGET __attribute__((target("sha2")))
+#else
+#define SHA256_ARM_TARGET __attribute__((target("+crypto")))
+#endif
+
+SHA256_ARM_TARGET static void sha256_blocks_armv8(uint32_t h[8], const uint8_t *data, size_t blocks)
+{
+	uint32x4_t abcd = vld1q_u32(&h[0]);
+	uint32x4_t efgh = vld1q_u32(&h[4]);
+
+	while (blocks--) {
+		uint32x4_t abcd_save = abcd;
+		uint32x4_t efgh_save = efgh;
+		uint32x4_t m[4];
+
+		for (int i = 0; i < 16; i++) {
+			uint32x4_t w;
+
+			if (i < 4) {
+				w = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+			} else {
+				w = vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]);
+				w = vsha256su1q_u32(w, m[(i + 2) & 3], m[(i + 3) & 3]);
+			}
+
+			m[i & 3] = w;
+
+			uint32x4_t wk = vaddq_u32(w, vld1q_u32(&sha256_k[4 * i]));
+			uint32x4_t abcd_prev = abcd;
+
+			abcd = vsha256hq_u32(abcd, efgh, wk);
+			efgh = vsha256h2q_u32(efgh, abcd_prev, wk);
+		}
+
+		abcd = vaddq_u32(abcd, abcd_save);
+		efgh = vaddq_u32(efgh, efgh_save);
+
+		data += 64;
+	}
+
+	vst1q_u32(&h[0], abcd);
+	vst1q_u32(&h[4], efgh);
+}
+
+sha256_blocks_t sha256_hw_detect(const char **name)
+{
+#if defined(__linux__) && defined(HWCAP_SHA2)
+	if (!(getauxval(AT_HWCAP) & HWCAP_SHA2)) {
+		return NULL;
+	}
+#elif !defined(__ARM_FEATURE_SHA2) && !defined(__ARM_FEATURE_CRYPTO)
+	/* No way to ask the CPU, and the target does not promise the extension */
+
+	return NULL;
+#endif
+
+	*name = "armv8-sha2";
+
+	return sha256_blocks_armv8;
+}
+
+#else
+
+sha256_blocks_t sha256_hw_detect(const char **name)
+{
+	(void)name;
+
+	return NULL;
+}
+
+#endif
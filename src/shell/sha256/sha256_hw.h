@@ -0,0 +1,28 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SHA256_HW_H
+#define SHA256_HW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compression function, run over a number of consecutive 64-byte blocks */
+
+typedef void (*sha256_blocks_t)(uint32_t h[8], const uint8_t *data, size_t blocks);
+
+/* Round constants, defined in sha256.c */
+
+extern const uint32_t sha256_k[64];
+
+/* Returns the implementation using the SHA-256 instructions of the CPU, and sets its name. NULL if the CPU has none,
+ * or they are not supported for this target
+ */
+
+sha256_blocks_t sha256_hw_detect(const char **name);
+
+#endif
@@ -7,6 +7,7 @@
 
 #define _POSIX_C_SOURCE 200809L
 
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -18,8 +19,10 @@
 #include "image.h"
 #include "image/ls.h"
 #include "image/pull.h"
+#include "metrics.h"
 #include "container.h"
 #include "container/kill.h"
+#include "container/logs.h"
 #include "container/pause.h"
 #include "container/ps.h"
 #include "container/rm.h"
@@ -29,42 +32,84 @@
 #include "container/wait.h"
 #include "container/create.h"
 
+#ifdef __ZEPHYR__
+/* The Zephyr shell runs one command at a time */
+#define SHELL_THREAD_LOCAL
+#else
+#define SHELL_THREAD_LOCAL __thread
+#endif
+
+static SHELL_THREAD_LOCAL FILE *thread_out;
+static SHELL_THREAD_LOCAL FILE *thread_err;
+
+static pthread_mutex_t getopt_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+FILE *ocre_shell_stdout(void)
+{
+	return thread_out ? thread_out : stdout;
+}
+
+FILE *ocre_shell_stderr(void)
+{
+	return thread_err ? thread_err : stderr;
+}
+
+void ocre_shell_set_streams(FILE *out, FILE *err)
+{
+	thread_out = out;
+	thread_err = err;
+}
+
+void ocre_shell_getopt_begin(void)
+{
+	pthread_mutex_lock(&getopt_mutex);
+
+	optind = 1;
+}
+
+void ocre_shell_getopt_end(void)
+{
+	pthread_mutex_unlock(&getopt_mutex);
+}
+
 static int print_version(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
 {
-	fprintf(stdout, "Ocre version: %s\n", ocre_build_configuration.version);
-	fprintf(stdout, "Commit ID: %s\n", ocre_build_configuration.commit_id);
-	fprintf(stdout, "Build information: %s\n", ocre_build_configuration.build_info);
-	fprintf(stdout, "Build date: %s\n", ocre_build_configuration.build_date);
+	fprintf(shell_out, "Ocre version: %s\n", ocre_build_configuration.version);
+	fprintf(shell_out, "Commit ID: %s\n", ocre_build_configuration.commit_id);
+	fprintf(shell_out, "Build information: %s\n", ocre_build_configuration.build_info);
+	fprintf(shell_out, "Build date: %s\n", ocre_build_configuration.build_date);
 
 	return 0;
 }
 
 static int print_usage(struct ocre_context *ctx, const char *argv0, int argc, char **argv)
 {
-	fprintf(stderr, "Usage: %s [-v] <COMMAND>\n", argv0);
-
-	fprintf(stderr, "\nOptions:\n");
-	fprintf(stderr, "  -v        Verbose mode\n");
-
-	fprintf(stderr, "\nCommands:\n");
-	fprintf(stderr, "  help      Display this help message\n");
-	fprintf(stderr, "  version   Display version information\n");
-	fprintf(stderr, "  image     Image manipulation commands\n");
-	fprintf(stderr, "  container Container management commands\n");
-
-	fprintf(stderr, "\nShortcut Commands:\n");
-	fprintf(stderr, "  ps        container ps\n");
-	fprintf(stderr, "  create    container create\n");
-	fprintf(stderr, "  run       container run\n");
-	fprintf(stderr, "  start     container start\n");
-	// fprintf(stderr, "  stop      container stop\n");
-	fprintf(stderr, "  wait      container wait\n");
-	fprintf(stderr, "  kill      container kill\n");
-	// fprintf(stderr, "  pause     container pause\n");
-	// fprintf(stderr, "  unpause   container unpause\n");
-	fprintf(stderr, "  rm        container rm\n");
-	fprintf(stderr, "  images    image ls\n");
-	fprintf(stderr, "  pull      image pull\n");
+	fprintf(shell_err, "Usage: %s [-v] <COMMAND>\n", argv0);
+
+	fprintf(shell_err, "\nOptions:\n");
+	fprintf(shell_err, "  -v        Verbose mode\n");
+
+	fprintf(shell_err, "\nCommands:\n");
+	fprintf(shell_err, "  help      Display this help message\n");
+	fprintf(shell_err, "  version   Display version information\n");
+	fprintf(shell_err, "  image     Image manipulation commands\n");
+	fprintf(shell_err, "  container Container management commands\n");
+	fprintf(shell_err, "  metrics   Display metrics\n");
+
+	fprintf(shell_err, "\nShortcut Commands:\n");
+	fprintf(shell_err, "  ps        container ps\n");
+	fprintf(shell_err, "  create    container create\n");
+	fprintf(shell_err, "  run       container run\n");
+	fprintf(shell_err, "  start     container start\n");
+	fprintf(shell_err, "  stop      container stop\n");
+	fprintf(shell_err, "  wait      container wait\n");
+	fprintf(shell_err, "  kill      container kill\n");
+	fprintf(shell_err, "  pause     container pause\n");
+	fprintf(shell_err, "  unpause   container unpause\n");
+	fprintf(shell_err, "  rm        container rm\n");
+	fprintf(shell_err, "  logs      container logs\n");
+	fprintf(shell_err, "  images    image ls\n");
+	fprintf(shell_err, "  pull      image pull\n");
 	return -1;
 }
 
@@ -74,6 +119,7 @@ static const struct ocre_command commands[] = {
 	{"version", print_version},
 	{"image", cmd_image},
 	{"container", cmd_container},
+	{"metrics", cmd_metrics},
 	/* container shortcuts */
 	{"ps", cmd_container_ps},
 	{"create", cmd_container_create_run},
@@ -85,6 +131,7 @@ static const struct ocre_command commands[] = {
 	{"pause", cmd_container_pause},
 	{"unpause", cmd_container_unpause},
 	{"rm", cmd_container_rm},
+	{"logs", cmd_container_logs},
 	/* image shortcuts */
 	{"images", cmd_image_ls},
 	{"pull", cmd_image_pull},
@@ -94,45 +141,70 @@ int ocre_shell(struct ocre_context *ctx, int argc, char *argv[])
 {
 	int opt;
 	bool verbose = false;
-	while ((opt = getopt(argc, argv, "+v")) != -1) {
+	bool valid = true;
+
+	ocre_shell_getopt_begin();
+
+	while (valid && (opt = getopt(argc, argv, "+v")) != -1) {
 		switch (opt) {
 			case 'v': {
 				if (verbose) {
-					fprintf(stderr, "'-v' can be set only once\n\n");
+					fprintf(shell_err, "'-v' can be set only once\n\n");
 					print_usage(ctx, argv[0], argc, argv);
-					return -1;
+					valid = false;
+					continue;
 				}
 
 				verbose = true;
 				continue;
 			}
 			case '?': {
-				fprintf(stderr, "Invalid option: '%c'\n", optopt);
-				return -1;
+				fprintf(shell_err, "Invalid option: '%c'\n", optopt);
+				valid = false;
+				continue;
 			}
 		}
 	}
 
-	if (argc <= optind) {
+	int save_optind = optind;
+
+	ocre_shell_getopt_end();
+
+	if (!valid) {
+		return -1;
+	}
+
+	if (argc <= save_optind) {
 		return print_usage(ctx, argv[0], argc, argv);
 	}
 
 	if (verbose) {
-		fprintf(stderr, "Using context: %p\n", ctx);
+		fprintf(shell_err, "Using context: %p\n", ctx);
 	}
 
-	int save_optind = optind;
-
 	for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
 		if (argv[save_optind] && !strcmp(argv[save_optind], commands[i].name)) {
-			optind = 1;
 			return commands[i].func(ctx, argv[0], argc - save_optind, &argv[save_optind]);
 		}
 	}
 
-	fprintf(stderr, "Invalid command: '%s %s'\n\n", argv[0], argv[save_optind]);
+	fprintf(shell_err, "Invalid command: '%s %s'\n\n", argv[0], argv[save_optind]);
 
 	return print_usage(ctx, argv[0], argc, argv);
 
 	return 0;
 }
+
+int ocre_shell_run(struct ocre_context *ctx, int argc, char *argv[], FILE *out, FILE *err)
+{
+	ocre_shell_set_streams(out, err);
+
+	int ret = ocre_shell(ctx, argc, argv);
+
+	fflush(shell_out);
+	fflush(shell_err);
+
+	ocre_shell_set_streams(NULL, NULL);
+
+	return ret;
+}
@@ -0,0 +1,75 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Measures ocre_get_event(), on an empty queue and while draining messages sent to itself.
+ *
+ * Usage: bench_events ROUNDS BATCH
+ *
+ * Prints "poll CALLS NS" and "drain EVENTS NS", the total time spent in the calls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_guest.h"
+
+#define TOPIC "bench/events"
+
+int main(int argc, char **argv)
+{
+	struct bench_event event;
+	uint64_t poll_ns = 0;
+	uint64_t drain_ns = 0;
+	long polls = 0;
+	long events = 0;
+
+	if (argc < 3) {
+		return 1;
+	}
+
+	int rounds = atoi(argv[1]);
+	int batch = atoi(argv[2]);
+
+	if (ocre_subscribe_message(TOPIC)) {
+		return 1;
+	}
+
+	for (int r = 0; r < rounds; r++) {
+		uint64_t start = bench_now_ns();
+
+		for (int i = 0; i < batch; i++) {
+			bench_get_event(&event);
+		}
+
+		poll_ns += bench_now_ns() - start;
+		polls += batch;
+
+		int queued = 0;
+		for (int i = 0; i < batch; i++) {
+			if (!ocre_publish_message(TOPIC, "application/octet-stream", &i, sizeof(i))) {
+				queued++;
+			}
+		}
+
+		start = bench_now_ns();
+
+		for (int i = 0; i < queued;) {
+			if (!bench_get_event(&event) && event.type == OCRE_RESOURCE_TYPE_MESSAGING) {
+				ocre_messaging_free_module_event_data(event.port, event.state, event.extra);
+				i++;
+			}
+		}
+
+		drain_ns += bench_now_ns() - start;
+		events += queued;
+	}
+
+	printf("poll %ld %llu\n", polls, (unsigned long long)poll_ns);
+	printf("drain %ld %llu\n", events, (unsigned long long)drain_ns);
+
+	return 0;
+}
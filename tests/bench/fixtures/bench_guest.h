@@ -0,0 +1,65 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Ocre API imports used by the benchmark fixtures, so they only need the WASI SDK */
+
+#ifndef OCRE_BENCH_GUEST_H
+#define OCRE_BENCH_GUEST_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define OCRE_IMPORT(name) __attribute__((import_module("env"), import_name(#name)))
+
+#define OCRE_RESOURCE_TYPE_TIMER     0
+#define OCRE_RESOURCE_TYPE_MESSAGING 3
+
+OCRE_IMPORT(ocre_sleep) int ocre_sleep(int milliseconds);
+
+OCRE_IMPORT(ocre_get_event)
+int ocre_get_event(uint32_t *type, uint32_t *id, uint32_t *port, uint32_t *state, uint32_t *extra,
+		   uint32_t *payload_len);
+
+OCRE_IMPORT(ocre_timer_create) int ocre_timer_create(int id);
+OCRE_IMPORT(ocre_timer_start) int ocre_timer_start(int id, int interval, int is_periodic);
+OCRE_IMPORT(ocre_timer_delete) int ocre_timer_delete(int id);
+
+OCRE_IMPORT(ocre_subscribe_message) int ocre_subscribe_message(const char *topic);
+
+OCRE_IMPORT(ocre_publish_message)
+int ocre_publish_message(const char *topic, const char *content_type, const void *payload, int payload_len);
+
+OCRE_IMPORT(ocre_messaging_free_module_event_data)
+int ocre_messaging_free_module_event_data(uint32_t topic, uint32_t content_type, uint32_t payload);
+
+struct bench_event {
+	uint32_t type;
+	uint32_t id;
+	uint32_t port;
+	uint32_t state;
+	uint32_t extra;
+	uint32_t payload_len;
+};
+
+static inline int bench_get_event(struct bench_event *event)
+{
+	return ocre_get_event(&event->type, &event->id, &event->port, &event->state, &event->extra,
+			      &event->payload_len);
+}
+
+/* The host and all the containers share the same monotonic clock */
+
+static inline uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#endif /* OCRE_BENCH_GUEST_H */
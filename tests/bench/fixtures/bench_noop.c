@@ -0,0 +1,21 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Returns right away, or with an argument, sleeps for that many milliseconds. Killing it interrupts the sleep. */
+
+#include <stdlib.h>
+
+#include "bench_guest.h"
+
+int main(int argc, char **argv)
+{
+	if (argc > 1) {
+		ocre_sleep(atoi(argv[1]));
+	}
+
+	return 0;
+}
@@ -0,0 +1,40 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Publishes messages carrying their send time.
+ *
+ * Usage: bench_publisher TOPIC COUNT BURST
+ *
+ * Sends BURST messages in a row, then sleeps for a millisecond, so the subscribers can keep up.
+ */
+
+#include <stdlib.h>
+
+#include "bench_guest.h"
+
+int main(int argc, char **argv)
+{
+	if (argc < 4) {
+		return 1;
+	}
+
+	const char *topic = argv[1];
+	int count = atoi(argv[2]);
+	int burst = atoi(argv[3]);
+
+	for (int i = 0; i < count; i++) {
+		uint64_t now = bench_now_ns();
+
+		ocre_publish_message(topic, "application/octet-stream", &now, sizeof(now));
+
+		if ((i + 1) % burst == 0) {
+			ocre_sleep(1);
+		}
+	}
+
+	return 0;
+}
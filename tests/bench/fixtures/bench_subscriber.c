@@ -0,0 +1,82 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Receives messages from bench_publisher and prints, one per line, how long each took to arrive in nanoseconds.
+ * The lines are printed at the end, so writing them does not slow down the reception.
+ *
+ * Usage: bench_subscriber TOPIC COUNT IDLE_MS
+ *
+ * Prints "ready" once subscribed. Stops after COUNT messages, or after IDLE_MS without any, then prints
+ * "done RECEIVED FIRST_NS LAST_NS" with the receive times of the first and last messages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_guest.h"
+
+int main(int argc, char **argv)
+{
+	struct bench_event event;
+	uint64_t first = 0;
+	uint64_t last = 0;
+	int received = 0;
+
+	if (argc < 4) {
+		return 1;
+	}
+
+	const char *topic = argv[1];
+	int count = atoi(argv[2]);
+	uint64_t idle_ns = (uint64_t)atoi(argv[3]) * 1000000ULL;
+
+	uint64_t *latencies = calloc(count, sizeof(uint64_t));
+	if (!latencies || ocre_subscribe_message(topic)) {
+		return 1;
+	}
+
+	printf("ready\n");
+	fflush(stdout);
+
+	uint64_t idle_since = bench_now_ns();
+
+	while (received < count) {
+		uint64_t now = bench_now_ns();
+
+		if (bench_get_event(&event) || event.type != OCRE_RESOURCE_TYPE_MESSAGING) {
+			if (now - idle_since > idle_ns) {
+				break;
+			}
+
+			continue;
+		}
+
+		uint64_t sent;
+
+		memcpy(&sent, (void *)(uintptr_t)event.extra, sizeof(sent));
+		ocre_messaging_free_module_event_data(event.port, event.state, event.extra);
+
+		if (!received) {
+			first = now;
+		}
+
+		last = now;
+		idle_since = now;
+		latencies[received++] = now - sent;
+	}
+
+	for (int i = 0; i < received; i++) {
+		printf("%llu\n", (unsigned long long)latencies[i]);
+	}
+
+	printf("done %d %llu %llu\n", received, (unsigned long long)first, (unsigned long long)last);
+
+	free(latencies);
+
+	return 0;
+}
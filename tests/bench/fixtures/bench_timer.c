@@ -0,0 +1,55 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Runs a periodic timer and prints, one per line, how late each expiration was in nanoseconds.
+ *
+ * Usage: bench_timer COUNT INTERVAL_MS
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_guest.h"
+
+#define TIMER_ID 1
+
+int main(int argc, char **argv)
+{
+	struct bench_event event;
+
+	if (argc < 3) {
+		return 1;
+	}
+
+	int count = atoi(argv[1]);
+	int interval_ms = atoi(argv[2]);
+
+	if (ocre_timer_create(TIMER_ID) || ocre_timer_start(TIMER_ID, interval_ms, 1)) {
+		return 1;
+	}
+
+	uint64_t expected = bench_now_ns();
+
+	/* Busy polling, so we measure the timer and not our own wakeups */
+
+	for (int i = 0; i < count;) {
+		if (bench_get_event(&event) || event.type != OCRE_RESOURCE_TYPE_TIMER) {
+			continue;
+		}
+
+		uint64_t now = bench_now_ns();
+
+		expected += (uint64_t)interval_ms * 1000000ULL;
+
+		printf("%lld\n", (long long)(now - expected));
+		i++;
+	}
+
+	ocre_timer_delete(TIMER_ID);
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Measures the time spent by the caller of a log macro, for messages that are printed.
+ *
+ * Usage: bench_log_latency [ITERATIONS]
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <ocre/platform/log.h>
+
+LOG_MODULE_REGISTER(bench, CONFIG_OCRE_LOG_LEVEL);
+
+#define DEFAULT_ITERATIONS 10000
+#define BATCH		   100
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = DEFAULT_ITERATIONS;
+
+	if (argc > 1) {
+		iterations = atoi(argv[1]);
+		if (iterations < BATCH) {
+			fprintf(stderr, "Usage: %s [ITERATIONS]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	int batches = iterations / BATCH;
+
+	uint64_t *samples = calloc(batches, sizeof(uint64_t));
+	if (!samples) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Time batches, as a single call is close to the resolution of the clock. Flush in between, so we measure the
+	 * cost of queueing messages and not of dropping them
+	 */
+
+	for (int i = 0; i < batches; i++) {
+		uint64_t start = now_ns();
+
+		for (int j = 0; j < BATCH; j++) {
+			LOG_INF("Container '%s' timer %d expired after %u ms", "bench", j, 1000U);
+		}
+
+		samples[i] = (now_ns() - start) / BATCH;
+
+		ocre_log_flush();
+	}
+
+	qsort(samples, batches, sizeof(uint64_t), compare_u64);
+
+	uint64_t sum = 0;
+	for (int i = 0; i < batches; i++) {
+		sum += samples[i];
+	}
+
+	printf("log      n=%d min=%" PRIu64 "ns avg=%" PRIu64 "ns p50=%" PRIu64 "ns p99=%" PRIu64 "ns dropped=%lu\n",
+	       batches * BATCH, samples[0], sum / batches, samples[batches / 2], samples[(batches * 99) / 100],
+	       ocre_log_get_dropped());
+
+	free(samples);
+
+	return EXIT_SUCCESS;
+}
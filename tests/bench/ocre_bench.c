@@ -0,0 +1,852 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Microbenchmarks of the hot paths of the runtime. Results are written as JSON, so runs can be compared.
+ *
+ * Usage: ocre_bench [-n ITERATIONS] [-o FILE] [BENCHMARK...]
+ *
+ * The guest fixtures are in fixtures/. All times are in nanoseconds.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ocre/ocre.h>
+
+#define DEFAULT_ITERATIONS 100
+#define READ_TIMEOUT_MS	   10000
+
+#define TIMER_COUNT	  200
+#define TIMER_INTERVAL_MS 5
+
+#define EVENTS_ROUNDS 200
+#define EVENTS_BATCH  16 /* Must fit in the event queue */
+
+#define LATENCY_MESSAGES 1000
+
+#define FANOUT_SUBSCRIBERS 4
+#define FANOUT_MESSAGES	   2000
+#define FANOUT_BURST	   4
+
+#define MEMORY_CONTAINERS 16
+
+static const char *const api_capabilities[] = {
+	"ocre:api",
+	NULL,
+};
+
+static struct ocre_context *context;
+static int iterations = DEFAULT_ITERATIONS;
+static FILE *json;
+static bool json_first;
+
+/* A container whose output is read through a pipe */
+
+struct guest {
+	struct ocre_container *container;
+	int out[2];
+	char buf[4096];
+	size_t len;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void json_key(const char *name)
+{
+	fprintf(json, "%s\n    \"%s\": ", json_first ? "" : ",", name);
+	json_first = false;
+}
+
+static void json_stats(const char *name, uint64_t *samples, int count)
+{
+	json_key(name);
+
+	if (count <= 0) {
+		fprintf(json, "null");
+		return;
+	}
+
+	qsort(samples, count, sizeof(uint64_t), compare_u64);
+
+	uint64_t sum = 0;
+	for (int i = 0; i < count; i++) {
+		sum += samples[i];
+	}
+
+	fprintf(json,
+		"{\"n\": %d, \"min\": %" PRIu64 ", \"avg\": %" PRIu64 ", \"p50\": %" PRIu64 ", \"p99\": %" PRIu64
+		", \"max\": %" PRIu64 "}",
+		count, samples[0], sum / count, samples[count / 2], samples[(count * 99) / 100], samples[count - 1]);
+}
+
+static void json_number(const char *name, double value)
+{
+	json_key(name);
+	fprintf(json, "%.1f", value);
+}
+
+static void json_integer(const char *name, long long value)
+{
+	json_key(name);
+	fprintf(json, "%lld", value);
+}
+
+static void json_string(const char *value)
+{
+	fputc('"', json);
+
+	for (const char *p = value; p && *p; p++) {
+		if (*p == '"' || *p == '\\') {
+			fputc('\\', json);
+		}
+
+		if ((unsigned char)*p >= 0x20) {
+			fputc(*p, json);
+		}
+	}
+
+	fputc('"', json);
+}
+
+static int guest_create(struct guest *guest, const char *image, const char *id, const char **argv)
+{
+	const struct ocre_container_args args = {
+		.argv = argv,
+		.capabilities = (const char **)api_capabilities,
+	};
+
+	memset(guest, 0, sizeof(*guest));
+
+	if (pipe(guest->out)) {
+		fprintf(stderr, "Failed to create pipe: errno=%d\n", errno);
+		return -1;
+	}
+
+	guest->container = ocre_context_create_container(context, image, "wamr/wasip1", id, true, &args, STDIN_FILENO,
+							 guest->out[1], STDERR_FILENO);
+	if (!guest->container) {
+		fprintf(stderr, "Failed to create container '%s'\n", id);
+		close(guest->out[0]);
+		close(guest->out[1]);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Reads a line of output of the guest, without the newline */
+
+static int guest_read_line(struct guest *guest, char *line, size_t size)
+{
+	for (;;) {
+		char *newline = memchr(guest->buf, '\n', guest->len);
+		if (newline) {
+			size_t len = newline - guest->buf;
+			if (len >= size) {
+				len = size - 1;
+			}
+
+			memcpy(line, guest->buf, len);
+			line[len] = '\0';
+
+			guest->len -= newline + 1 - guest->buf;
+			memmove(guest->buf, newline + 1, guest->len);
+
+			return 0;
+		}
+
+		if (guest->len == sizeof(guest->buf)) {
+			fprintf(stderr, "Line too long\n");
+			return -1;
+		}
+
+		/* The container does not close its output when it exits, do not wait forever */
+
+		struct pollfd pfd = {
+			.fd = guest->out[0],
+			.events = POLLIN,
+		};
+
+		if (poll(&pfd, 1, READ_TIMEOUT_MS) <= 0) {
+			fprintf(stderr, "Timeout reading output of container '%s'\n",
+				ocre_container_get_id(guest->container));
+			return -1;
+		}
+
+		ssize_t n = read(guest->out[0], guest->buf + guest->len, sizeof(guest->buf) - guest->len);
+		if (n <= 0) {
+			return -1;
+		}
+
+		guest->len += n;
+	}
+}
+
+static void guest_destroy(struct guest *guest)
+{
+	if (!guest->container) {
+		return;
+	}
+
+	ocre_container_status_t status = ocre_container_get_status(guest->container);
+	if (status == OCRE_CONTAINER_STATUS_RUNNING || status == OCRE_CONTAINER_STATUS_PAUSED) {
+		ocre_container_kill(guest->container);
+	}
+
+	if (status != OCRE_CONTAINER_STATUS_CREATED) {
+		ocre_container_wait(guest->container, NULL);
+	}
+
+	ocre_context_remove_container(context, guest->container);
+
+	close(guest->out[0]);
+	close(guest->out[1]);
+
+	guest->container = NULL;
+}
+
+static int bench_context(void)
+{
+	int ret = -1;
+	uint64_t *create_ns = calloc(iterations, sizeof(uint64_t));
+	uint64_t *destroy_ns = calloc(iterations, sizeof(uint64_t));
+
+	if (!create_ns || !destroy_ns) {
+		goto finish;
+	}
+
+	for (int i = 0; i < iterations; i++) {
+		uint64_t start = now_ns();
+
+		struct ocre_context *other = ocre_create_context("./benchcontext");
+		if (!other) {
+			fprintf(stderr, "Failed to create context\n");
+			goto finish;
+		}
+
+		uint64_t created = now_ns();
+
+		if (ocre_destroy_context(other)) {
+			fprintf(stderr, "Failed to destroy context\n");
+			goto finish;
+		}
+
+		create_ns[i] = created - start;
+		destroy_ns[i] = now_ns() - created;
+	}
+
+	json_stats("context_create_ns", create_ns, iterations);
+	json_stats("context_destroy_ns", destroy_ns, iterations);
+
+	ret = 0;
+
+finish:
+	free(create_ns);
+	free(destroy_ns);
+
+	return ret;
+}
+
+static int bench_container(void)
+{
+	int ret = -1;
+	uint64_t *samples = calloc(4 * iterations, sizeof(uint64_t));
+	const struct ocre_container_args args = {
+		.capabilities = (const char **)api_capabilities,
+	};
+
+	if (!samples) {
+		return -1;
+	}
+
+	uint64_t *create_ns = samples;
+	uint64_t *start_ns = create_ns + iterations;
+	uint64_t *wait_ns = start_ns + iterations;
+	uint64_t *destroy_ns = wait_ns + iterations;
+
+	for (int i = 0; i < iterations; i++) {
+		uint64_t t0 = now_ns();
+
+		struct ocre_container *container = ocre_context_create_container(
+			context, "bench_noop.wasm", "wamr/wasip1", "bench", true, &args, -1, -1, -1);
+		if (!container) {
+			fprintf(stderr, "Failed to create container\n");
+			goto finish;
+		}
+
+		uint64_t t1 = now_ns();
+
+		if (ocre_container_start(container)) {
+			fprintf(stderr, "Failed to start container\n");
+			ocre_context_remove_container(context, container);
+			goto finish;
+		}
+
+		uint64_t t2 = now_ns();
+
+		ocre_container_wait(container, NULL);
+
+		uint64_t t3 = now_ns();
+
+		if (ocre_context_remove_container(context, container)) {
+			fprintf(stderr, "Failed to remove container\n");
+			goto finish;
+		}
+
+		create_ns[i] = t1 - t0;
+		start_ns[i] = t2 - t1;
+		wait_ns[i] = t3 - t2;
+		destroy_ns[i] = now_ns() - t3;
+	}
+
+	json_stats("container_create_ns", create_ns, iterations);
+	json_stats("container_start_ns", start_ns, iterations);
+	json_stats("container_wait_ns", wait_ns, iterations);
+	json_stats("container_destroy_ns", destroy_ns, iterations);
+
+	ret = 0;
+
+finish:
+	free(samples);
+
+	return ret;
+}
+
+/* Cold is with the image evicted from the page cache, warm is right after */
+
+static int bench_module_load(void)
+{
+	int ret = -1;
+	char path[PATH_MAX];
+	uint64_t *cold_ns = calloc(iterations, sizeof(uint64_t));
+	uint64_t *warm_ns = calloc(iterations, sizeof(uint64_t));
+	const struct ocre_container_args args = {
+		.capabilities = (const char **)api_capabilities,
+	};
+
+	if (!cold_ns || !warm_ns) {
+		goto finish;
+	}
+
+	snprintf(path, sizeof(path), "%s/images/bench_noop.wasm", ocre_context_get_working_directory(context));
+
+	for (int i = 0; i < iterations; i++) {
+		int fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			fprintf(stderr, "Failed to open '%s': errno=%d\n", path, errno);
+			goto finish;
+		}
+
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+
+		for (int warm = 0; warm < 2; warm++) {
+			uint64_t start = now_ns();
+
+			struct ocre_container *container = ocre_context_create_container(
+				context, "bench_noop.wasm", "wamr/wasip1", "bench", true, &args, -1, -1, -1);
+			if (!container) {
+				fprintf(stderr, "Failed to create container\n");
+				goto finish;
+			}
+
+			uint64_t elapsed = now_ns() - start;
+
+			ocre_context_remove_container(context, container);
+
+			if (warm) {
+				warm_ns[i] = elapsed;
+			} else {
+				cold_ns[i] = elapsed;
+			}
+		}
+	}
+
+	json_stats("module_load_cold_ns", cold_ns, iterations);
+	json_stats("module_load_warm_ns", warm_ns, iterations);
+
+	ret = 0;
+
+finish:
+	free(cold_ns);
+	free(warm_ns);
+
+	return ret;
+}
+
+static int bench_timer(void)
+{
+	int ret = -1;
+	char count[16];
+	char interval[16];
+	char line[64];
+	struct guest guest;
+	uint64_t late_ns[TIMER_COUNT];
+
+	snprintf(count, sizeof(count), "%d", TIMER_COUNT);
+	snprintf(interval, sizeof(interval), "%d", TIMER_INTERVAL_MS);
+
+	if (guest_create(&guest, "bench_timer.wasm", "bench-timer", (const char *[]){count, interval, NULL})) {
+		return -1;
+	}
+
+	if (ocre_container_start(guest.container)) {
+		fprintf(stderr, "Failed to start timer container\n");
+		goto finish;
+	}
+
+	/* Early expirations count as zero, the jitter is how late the timer is */
+
+	for (int i = 0; i < TIMER_COUNT; i++) {
+		if (guest_read_line(&guest, line, sizeof(line))) {
+			goto finish;
+		}
+
+		long long late = strtoll(line, NULL, 10);
+		late_ns[i] = late > 0 ? (uint64_t)late : 0;
+	}
+
+	json_stats("timer_jitter_ns", late_ns, TIMER_COUNT);
+
+	ret = 0;
+
+finish:
+	guest_destroy(&guest);
+
+	return ret;
+}
+
+static int bench_get_event(void)
+{
+	int ret = -1;
+	char rounds[16];
+	char batch[16];
+	char line[128];
+	struct guest guest;
+	unsigned long long poll_calls = 0, poll_ns = 0, events = 0, drain_ns = 0;
+
+	snprintf(rounds, sizeof(rounds), "%d", EVENTS_ROUNDS);
+	snprintf(batch, sizeof(batch), "%d", EVENTS_BATCH);
+
+	if (guest_create(&guest, "bench_events.wasm", "bench-events", (const char *[]){rounds, batch, NULL})) {
+		return -1;
+	}
+
+	if (ocre_container_start(guest.container)) {
+		fprintf(stderr, "Failed to start events container\n");
+		goto finish;
+	}
+
+	if (guest_read_line(&guest, line, sizeof(line)) || sscanf(line, "poll %llu %llu", &poll_calls, &poll_ns) != 2 ||
+	    guest_read_line(&guest, line, sizeof(line)) || sscanf(line, "drain %llu %llu", &events, &drain_ns) != 2) {
+		fprintf(stderr, "Unexpected output of events container\n");
+		goto finish;
+	}
+
+	if (!poll_calls || !events || !drain_ns) {
+		fprintf(stderr, "No events were received\n");
+		goto finish;
+	}
+
+	json_number("get_event_empty_ns", (double)poll_ns / poll_calls);
+	json_number("get_event_ns", (double)drain_ns / events);
+	json_number("get_event_per_s", events * 1e9 / drain_ns);
+
+	ret = 0;
+
+finish:
+	guest_destroy(&guest);
+
+	return ret;
+}
+
+/* Starts the subscribers, waits until they are subscribed, and runs the publisher to completion */
+
+static int run_messaging(struct guest *subscribers, int nr_subscribers, const char *topic, int messages, int burst)
+{
+	char count[16];
+	char burst_str[16];
+	char line[64];
+	struct guest publisher;
+
+	snprintf(count, sizeof(count), "%d", messages);
+	snprintf(burst_str, sizeof(burst_str), "%d", burst);
+
+	for (int i = 0; i < nr_subscribers; i++) {
+		char id[32];
+
+		snprintf(id, sizeof(id), "bench-sub%d", i);
+
+		if (guest_create(&subscribers[i], "bench_subscriber.wasm", id,
+				 (const char *[]){topic, count, "1000", NULL})) {
+			return -1;
+		}
+
+		if (ocre_container_start(subscribers[i].container) ||
+		    guest_read_line(&subscribers[i], line, sizeof(line)) || strcmp(line, "ready")) {
+			fprintf(stderr, "Subscriber %d is not ready\n", i);
+			return -1;
+		}
+	}
+
+	if (guest_create(&publisher, "bench_publisher.wasm", "bench-pub",
+			 (const char *[]){topic, count, burst_str, NULL})) {
+		return -1;
+	}
+
+	int ret = ocre_container_start(publisher.container);
+	if (!ret) {
+		ocre_container_wait(publisher.container, NULL);
+	}
+
+	guest_destroy(&publisher);
+
+	return ret;
+}
+
+/* Reads the latencies printed by a subscriber, until its summary line */
+
+static int read_subscriber(struct guest *subscriber, uint64_t *latencies, int max, int *received, uint64_t *first,
+			   uint64_t *last)
+{
+	char line[128];
+	int n = 0;
+
+	for (;;) {
+		if (guest_read_line(subscriber, line, sizeof(line))) {
+			return -1;
+		}
+
+		unsigned long long f, l;
+		if (sscanf(line, "done %d %llu %llu", received, &f, &l) == 3) {
+			*first = f;
+			*last = l;
+			return n;
+		}
+
+		if (latencies && n < max) {
+			latencies[n] = strtoull(line, NULL, 10);
+		}
+
+		n++;
+	}
+}
+
+static int bench_messaging_latency(void)
+{
+	int ret = -1;
+	int received = 0;
+	uint64_t first, last;
+	struct guest subscriber = {0};
+	uint64_t *latencies = calloc(LATENCY_MESSAGES, sizeof(uint64_t));
+
+	if (!latencies) {
+		return -1;
+	}
+
+	/* One message at a time, so we do not measure queueing */
+
+	if (run_messaging(&subscriber, 1, "bench/latency", LATENCY_MESSAGES, 1)) {
+		goto finish;
+	}
+
+	int n = read_subscriber(&subscriber, latencies, LATENCY_MESSAGES, &received, &first, &last);
+	if (n < 0) {
+		goto finish;
+	}
+
+	json_stats("messaging_latency_ns", latencies, n < LATENCY_MESSAGES ? n : LATENCY_MESSAGES);
+	json_integer("messaging_latency_lost", LATENCY_MESSAGES - received);
+
+	ret = 0;
+
+finish:
+	guest_destroy(&subscriber);
+	free(latencies);
+
+	return ret;
+}
+
+static int bench_messaging_fanout(void)
+{
+	int ret = -1;
+	int total = 0;
+	uint64_t first = UINT64_MAX;
+	uint64_t last = 0;
+	struct guest subscribers[FANOUT_SUBSCRIBERS] = {0};
+
+	if (run_messaging(subscribers, FANOUT_SUBSCRIBERS, "bench/fanout", FANOUT_MESSAGES, FANOUT_BURST)) {
+		goto finish;
+	}
+
+	for (int i = 0; i < FANOUT_SUBSCRIBERS; i++) {
+		int received = 0;
+		uint64_t f = 0, l = 0;
+
+		if (read_subscriber(&subscribers[i], NULL, 0, &received, &f, &l) < 0) {
+			goto finish;
+		}
+
+		if (received) {
+			first = f < first ? f : first;
+			last = l > last ? l : last;
+		}
+
+		total += received;
+	}
+
+	json_integer("messaging_fanout_subscribers", FANOUT_SUBSCRIBERS);
+	json_integer("messaging_fanout_delivered", total);
+	json_integer("messaging_fanout_lost", FANOUT_SUBSCRIBERS * FANOUT_MESSAGES - total);
+	json_number("messaging_fanout_per_s", last > first ? total * 1e9 / (last - first) : 0);
+
+	ret = 0;
+
+finish:
+	for (int i = 0; i < FANOUT_SUBSCRIBERS; i++) {
+		guest_destroy(&subscribers[i]);
+	}
+
+	return ret;
+}
+
+static long resident_bytes(void)
+{
+	long size, resident;
+
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (!f) {
+		return -1;
+	}
+
+	if (fscanf(f, "%ld %ld", &size, &resident) != 2) {
+		resident = -1;
+	}
+
+	fclose(f);
+
+	return resident < 0 ? -1 : resident * sysconf(_SC_PAGESIZE);
+}
+
+static int bench_memory(void)
+{
+	int ret = -1;
+	struct ocre_container *containers[MEMORY_CONTAINERS] = {0};
+	const struct ocre_container_args args = {
+		.argv = (const char *[]){"60000", NULL},
+		.capabilities = (const char **)api_capabilities,
+	};
+
+	long before = resident_bytes();
+	if (before < 0) {
+		json_key("memory_per_container_bytes");
+		fprintf(json, "null");
+		return 0;
+	}
+
+	for (int i = 0; i < MEMORY_CONTAINERS; i++) {
+		char id[32];
+
+		snprintf(id, sizeof(id), "bench-mem%d", i);
+
+		containers[i] = ocre_context_create_container(context, "bench_noop.wasm", "wamr/wasip1", id, true,
+							      &args, -1, -1, -1);
+		if (!containers[i] || ocre_container_start(containers[i])) {
+			fprintf(stderr, "Failed to run container %d\n", i);
+			goto finish;
+		}
+	}
+
+	/* Let them all reach their sleep */
+
+	usleep(100000);
+
+	json_number("memory_per_container_bytes", (double)(resident_bytes() - before) / MEMORY_CONTAINERS);
+
+	ret = 0;
+
+finish:
+	for (int i = 0; i < MEMORY_CONTAINERS && containers[i]; i++) {
+		if (ocre_container_get_status(containers[i]) == OCRE_CONTAINER_STATUS_RUNNING) {
+			ocre_container_kill(containers[i]);
+			ocre_container_wait(containers[i], NULL);
+		}
+
+		ocre_context_remove_container(context, containers[i]);
+	}
+
+	return ret;
+}
+
+/* The first one must be "context" */
+
+static const struct {
+	const char *name;
+	int (*run)(void);
+} benchmarks[] = {
+	{"context", bench_context},
+	{"container", bench_container},
+	{"module_load", bench_module_load},
+	{"timer", bench_timer},
+	{"get_event", bench_get_event},
+	{"messaging_latency", bench_messaging_latency},
+	{"messaging_fanout", bench_messaging_fanout},
+	{"memory", bench_memory},
+};
+
+#define NR_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static int usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-n ITERATIONS] [-o FILE] [BENCHMARK...]\n\nBenchmarks:", argv0);
+	for (size_t i = 0; i < NR_BENCHMARKS; i++) {
+		fprintf(stderr, " %s", benchmarks[i].name);
+	}
+	fprintf(stderr, "\n");
+
+	return EXIT_FAILURE;
+}
+
+static bool selected(const char *name, int argc, char **argv)
+{
+	if (optind >= argc) {
+		return true;
+	}
+
+	for (int i = optind; i < argc; i++) {
+		if (!strcmp(argv[i], name)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	int ret = EXIT_FAILURE;
+	const char *output = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:o:")) != -1) {
+		switch (opt) {
+			case 'n':
+				iterations = atoi(optarg);
+				if (iterations <= 0) {
+					return usage(argv[0]);
+				}
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			default:
+				return usage(argv[0]);
+		}
+	}
+
+	for (int i = optind; i < argc; i++) {
+		size_t j;
+		for (j = 0; j < NR_BENCHMARKS && strcmp(argv[i], benchmarks[j].name); j++) {
+		}
+
+		if (j == NR_BENCHMARKS) {
+			fprintf(stderr, "Unknown benchmark '%s'\n", argv[i]);
+			return usage(argv[0]);
+		}
+	}
+
+	json = output ? fopen(output, "w") : stdout;
+	if (!json) {
+		fprintf(stderr, "Failed to open '%s': errno=%d\n", output, errno);
+		return EXIT_FAILURE;
+	}
+
+	if (ocre_initialize(NULL)) {
+		fprintf(stderr, "Failed to initialize Ocre\n");
+		goto close_json;
+	}
+
+	fprintf(json, "{\n  \"version\": ");
+	json_string(ocre_build_configuration.version);
+	fprintf(json, ",\n  \"commit_id\": ");
+	json_string(ocre_build_configuration.commit_id);
+	fprintf(json, ",\n  \"iterations\": %d,\n  \"results\": {", iterations);
+
+	json_first = true;
+
+	/* Context creation is measured on a context of its own, before the one used by the other benchmarks */
+
+	if (selected(benchmarks[0].name, argc, argv)) {
+		fprintf(stderr, "Running benchmark '%s'\n", benchmarks[0].name);
+
+		if (benchmarks[0].run()) {
+			fprintf(stderr, "Benchmark '%s' failed\n", benchmarks[0].name);
+			goto deinitialize;
+		}
+	}
+
+	context = ocre_create_context(NULL);
+	if (!context) {
+		fprintf(stderr, "Failed to create context\n");
+		goto deinitialize;
+	}
+
+	for (size_t i = 1; i < NR_BENCHMARKS; i++) {
+		if (!selected(benchmarks[i].name, argc, argv)) {
+			continue;
+		}
+
+		fprintf(stderr, "Running benchmark '%s'\n", benchmarks[i].name);
+
+		if (benchmarks[i].run()) {
+			fprintf(stderr, "Benchmark '%s' failed\n", benchmarks[i].name);
+			goto destroy_context;
+		}
+	}
+
+	fprintf(json, "\n  }\n}\n");
+
+	ret = EXIT_SUCCESS;
+
+destroy_context:
+	ocre_destroy_context(context);
+
+deinitialize:
+	ocre_deinitialize();
+
+close_json:
+	if (json != stdout) {
+		fclose(json);
+	}
+
+	return ret;
+}
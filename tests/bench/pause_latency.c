@@ -0,0 +1,149 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Measures the time between a pause request and the container being suspended, and the time to resume it.
+ *
+ * Usage: bench_pause_latency [ITERATIONS]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ocre/ocre.h>
+
+#define DEFAULT_ITERATIONS 200
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void report(const char *name, uint64_t *samples, int count)
+{
+	qsort(samples, count, sizeof(uint64_t), compare_u64);
+
+	uint64_t sum = 0;
+	for (int i = 0; i < count; i++) {
+		sum += samples[i];
+	}
+
+	printf("%-8s n=%d min=%.1fus avg=%.1fus p50=%.1fus p99=%.1fus max=%.1fus\n", name, count,
+	       samples[0] / 1000.0, (double)sum / count / 1000.0, samples[count / 2] / 1000.0,
+	       samples[(count * 99) / 100] / 1000.0, samples[count - 1] / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+	int ret = EXIT_FAILURE;
+	int iterations = DEFAULT_ITERATIONS;
+
+	if (argc > 1) {
+		iterations = atoi(argv[1]);
+		if (iterations <= 0) {
+			fprintf(stderr, "Usage: %s [ITERATIONS]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	uint64_t *pause_ns = calloc(iterations, sizeof(uint64_t));
+	uint64_t *unpause_ns = calloc(iterations, sizeof(uint64_t));
+	if (!pause_ns || !unpause_ns) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		goto free_samples;
+	}
+
+	if (ocre_initialize(NULL)) {
+		fprintf(stderr, "Failed to initialize Ocre\n");
+		goto free_samples;
+	}
+
+	struct ocre_context *context = ocre_create_context(NULL);
+	if (!context) {
+		fprintf(stderr, "Failed to create context\n");
+		goto deinitialize;
+	}
+
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+	};
+
+	struct ocre_container *container = ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1", "bench",
+									 true, &args, STDIN_FILENO, STDOUT_FILENO,
+									 STDERR_FILENO);
+	if (!container) {
+		fprintf(stderr, "Failed to create container\n");
+		goto destroy_context;
+	}
+
+	if (ocre_container_start(container)) {
+		fprintf(stderr, "Failed to start container\n");
+		goto destroy_context;
+	}
+
+	for (int i = 0; i < iterations; i++) {
+		uint64_t start = now_ns();
+
+		if (ocre_container_pause(container)) {
+			fprintf(stderr, "Failed to pause container at iteration %d\n", i);
+			goto kill;
+		}
+
+		uint64_t paused = now_ns();
+
+		if (ocre_container_unpause(container)) {
+			fprintf(stderr, "Failed to unpause container at iteration %d\n", i);
+			goto kill;
+		}
+
+		pause_ns[i] = paused - start;
+		unpause_ns[i] = now_ns() - paused;
+
+		/* Let it run a bit, so we do not always catch it at the same place */
+
+		usleep(1000);
+	}
+
+	report("pause", pause_ns, iterations);
+	report("unpause", unpause_ns, iterations);
+
+	ret = EXIT_SUCCESS;
+
+kill:
+	ocre_container_kill(container);
+	ocre_container_wait(container, NULL);
+
+destroy_context:
+	ocre_destroy_context(context);
+
+deinitialize:
+	ocre_deinitialize();
+
+free_samples:
+	free(pause_ns);
+	free(unpause_ns);
+
+	return ret;
+}
@@ -0,0 +1,91 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Measures the throughput of SHA-256, with the fastest implementation the CPU supports and with the portable one.
+ *
+ * Usage: bench_sha256_throughput [MEGABYTES]
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sha256/sha256.h"
+
+#define DEFAULT_MEGABYTES 256
+#define CHUNK_SIZE	  65536
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void run(const uint8_t *chunk, int megabytes)
+{
+	char hex[65] = {0};
+	struct sha256_buff buff;
+	size_t chunks = (size_t)megabytes * 1024 * 1024 / CHUNK_SIZE;
+
+	uint64_t start = now_ns();
+
+	sha256_init(&buff);
+
+	for (size_t i = 0; i < chunks; i++) {
+		sha256_update(&buff, chunk, CHUNK_SIZE);
+	}
+
+	sha256_finalize(&buff);
+
+	uint64_t elapsed = now_ns() - start;
+
+	sha256_read_hex(&buff, hex);
+
+	printf("sha256   backend=%-10s size=%dMB time=%" PRIu64 "ms throughput=%" PRIu64 "MB/s digest=%.16s\n",
+	       sha256_backend(), megabytes, elapsed / 1000000, (uint64_t)(megabytes * 1000000000ULL / (elapsed + 1)),
+	       hex);
+}
+
+int main(int argc, char **argv)
+{
+	int megabytes = DEFAULT_MEGABYTES;
+
+	if (argc > 1) {
+		megabytes = atoi(argv[1]);
+		if (megabytes < 1) {
+			fprintf(stderr, "Usage: %s [MEGABYTES]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	uint8_t *chunk = malloc(CHUNK_SIZE);
+	if (!chunk) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < CHUNK_SIZE; i++) {
+		chunk[i] = (uint8_t)(i * 131 + 7);
+	}
+
+	/* Both runs print the same digest */
+
+	run(chunk, megabytes);
+
+	sha256_force_scalar(1);
+
+	run(chunk, megabytes);
+
+	free(chunk);
+
+	return EXIT_SUCCESS;
+}
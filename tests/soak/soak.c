@@ -0,0 +1,493 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Density and soak test.
+ *
+ * First creates thousands of containers in one context, runs them all and removes them. Then several threads cycle
+ * create/start/kill/wait/remove tens of thousands of times. Resident memory, open file descriptors, threads and
+ * lifecycle latencies are sampled over time, and the test fails if the resources grow or the latencies drift.
+ *
+ * Usage: soak [-c CONTAINERS] [-n CYCLES] [-t THREADS] [-i INTERVAL_S] [-m MAX_RSS_GROWTH_KB] [-d MAX_DRIFT]
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ocre/ocre.h>
+
+#define DEFAULT_CONTAINERS	   2000
+#define DEFAULT_CYCLES		   20000
+#define DEFAULT_THREADS		   4
+#define DEFAULT_INTERVAL_S	   2
+#define DEFAULT_MAX_RSS_GROWTH_KB  16384
+#define DEFAULT_MAX_DRIFT	   3.0
+#define MAX_SAMPLES_PER_INTERVAL   65536
+
+/* Operations of a cycle */
+
+enum op {
+	OP_CREATE,
+	OP_START,
+	OP_STOP, /* kill and wait */
+	OP_REMOVE,
+	OP_CYCLE,
+	OP_COUNT,
+};
+
+static const char *const op_names[OP_COUNT] = {"create", "start", "stop", "remove", "cycle"};
+
+struct resources {
+	long rss_kb;
+	int fds;
+	int threads;
+};
+
+static struct ocre_context *context;
+static int null_fd;
+
+static int cycles = DEFAULT_CYCLES;
+static atomic_int cycles_started;
+static atomic_int cycles_done;
+static atomic_bool failed;
+
+/* Latencies of the current interval, in microseconds */
+
+static pthread_mutex_t samples_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t samples[OP_COUNT][MAX_SAMPLES_PER_INTERVAL];
+static int nr_samples;
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int count_fds(void)
+{
+	int count = 0;
+
+	DIR *dir = opendir("/proc/self/fd");
+	if (!dir) {
+		return -1;
+	}
+
+	while (readdir(dir)) {
+		count++;
+	}
+
+	closedir(dir);
+
+	/* ".", ".." and the one of the directory itself */
+
+	return count - 3;
+}
+
+static void sample_resources(struct resources *res)
+{
+	char line[256];
+
+	res->rss_kb = -1;
+	res->threads = -1;
+	res->fds = count_fds();
+
+	FILE *f = fopen("/proc/self/status", "r");
+	if (!f) {
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		sscanf(line, "VmRSS: %ld", &res->rss_kb);
+		sscanf(line, "Threads: %d", &res->threads);
+	}
+
+	fclose(f);
+}
+
+/* Fails the test if the value is over the limit */
+
+static void check(const char *what, long value, long limit)
+{
+	if (value > limit) {
+		fprintf(stdout, "FAIL: %s is %ld (limit %ld)\n", what, value, limit);
+		atomic_store(&failed, true);
+	}
+}
+
+/* Creates all the containers, runs them all at once and removes them */
+
+static int density(int count)
+{
+	int ret = -1;
+	const struct ocre_container_args args = {0};
+
+	struct ocre_container **containers = calloc(count, sizeof(struct ocre_container *));
+	if (!containers) {
+		return -1;
+	}
+
+	uint64_t start = now_us();
+
+	for (int i = 0; i < count; i++) {
+		char id[32];
+
+		snprintf(id, sizeof(id), "density-%d", i);
+
+		containers[i] = ocre_context_create_container(context, "return0.wasm", "wamr/wasip1", id, true, &args,
+							      STDIN_FILENO, null_fd, null_fd);
+		if (!containers[i]) {
+			fprintf(stdout, "Failed to create container %d\n", i);
+			goto remove;
+		}
+	}
+
+	uint64_t created = now_us();
+
+	if (ocre_context_get_container_count(context) != count) {
+		fprintf(stdout, "Context has %d containers instead of %d\n", ocre_context_get_container_count(context),
+			count);
+		goto remove;
+	}
+
+	for (int i = 0; i < count; i++) {
+		if (ocre_container_start(containers[i])) {
+			fprintf(stdout, "Failed to start container %d\n", i);
+			goto remove;
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		int status = -1;
+
+		if (ocre_container_wait(containers[i], &status) || status) {
+			fprintf(stdout, "Container %d exited with status %d\n", i, status);
+			goto remove;
+		}
+	}
+
+	uint64_t ran = now_us();
+
+	fprintf(stdout, "density containers=%d create_ms=%llu run_ms=%llu\n", count,
+		(unsigned long long)(created - start) / 1000, (unsigned long long)(ran - created) / 1000);
+
+	ret = 0;
+
+remove:
+	for (int i = 0; i < count && containers[i]; i++) {
+		if (ocre_context_remove_container(context, containers[i])) {
+			fprintf(stdout, "Failed to remove container %d\n", i);
+			ret = -1;
+		}
+	}
+
+	free(containers);
+
+	return ret;
+}
+
+static void *churn(void *arg)
+{
+	char id[32];
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+	};
+
+	/* The same ID every time, so we also check that removing a container releases it */
+
+	snprintf(id, sizeof(id), "churn-%d", (int)(intptr_t)arg);
+
+	while (!atomic_load(&failed) && atomic_fetch_add(&cycles_started, 1) < cycles) {
+		uint32_t elapsed[OP_COUNT];
+		uint64_t t0 = now_us();
+
+		struct ocre_container *container = ocre_context_create_container(
+			context, "blinky.wasm", "wamr/wasip1", id, true, &args, STDIN_FILENO, null_fd, null_fd);
+		if (!container) {
+			fprintf(stdout, "Failed to create container '%s'\n", id);
+			atomic_store(&failed, true);
+			break;
+		}
+
+		uint64_t t1 = now_us();
+
+		if (ocre_container_start(container)) {
+			fprintf(stdout, "Failed to start container '%s'\n", id);
+			atomic_store(&failed, true);
+			ocre_context_remove_container(context, container);
+			break;
+		}
+
+		uint64_t t2 = now_us();
+
+		if (ocre_container_kill(container) || ocre_container_wait(container, NULL)) {
+			fprintf(stdout, "Failed to kill container '%s'\n", id);
+			atomic_store(&failed, true);
+			break;
+		}
+
+		uint64_t t3 = now_us();
+
+		if (ocre_context_remove_container(context, container)) {
+			fprintf(stdout, "Failed to remove container '%s'\n", id);
+			atomic_store(&failed, true);
+			break;
+		}
+
+		uint64_t t4 = now_us();
+
+		elapsed[OP_CREATE] = (uint32_t)(t1 - t0);
+		elapsed[OP_START] = (uint32_t)(t2 - t1);
+		elapsed[OP_STOP] = (uint32_t)(t3 - t2);
+		elapsed[OP_REMOVE] = (uint32_t)(t4 - t3);
+		elapsed[OP_CYCLE] = (uint32_t)(t4 - t0);
+
+		pthread_mutex_lock(&samples_mutex);
+
+		if (nr_samples < MAX_SAMPLES_PER_INTERVAL) {
+			for (int op = 0; op < OP_COUNT; op++) {
+				samples[op][nr_samples] = elapsed[op];
+			}
+
+			nr_samples++;
+		}
+
+		pthread_mutex_unlock(&samples_mutex);
+
+		atomic_fetch_add(&cycles_done, 1);
+	}
+
+	return NULL;
+}
+
+/* Prints the latencies of the interval. Returns the p99 of whole cycles, or 0 if there was none */
+
+static uint32_t report_interval(int interval, const struct resources *res)
+{
+	uint32_t p99[OP_COUNT] = {0};
+	uint32_t p50 = 0;
+
+	pthread_mutex_lock(&samples_mutex);
+
+	int n = nr_samples;
+
+	for (int op = 0; op < OP_COUNT && n; op++) {
+		qsort(samples[op], n, sizeof(uint32_t), compare_u32);
+		p99[op] = samples[op][(n * 99) / 100];
+	}
+
+	if (n) {
+		p50 = samples[OP_CYCLE][n / 2];
+	}
+
+	nr_samples = 0;
+
+	pthread_mutex_unlock(&samples_mutex);
+
+	fprintf(stdout, "interval=%d done=%d cycles=%d rss_kb=%ld fds=%d threads=%d cycle_p50_us=%u", interval,
+		atomic_load(&cycles_done), n, res->rss_kb, res->fds, res->threads, p50);
+
+	for (int op = 0; op < OP_COUNT; op++) {
+		fprintf(stdout, " %s_p99_us=%u", op_names[op], p99[op]);
+	}
+
+	fprintf(stdout, "\n");
+	fflush(stdout);
+
+	return p99[OP_CYCLE];
+}
+
+static int usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-c CONTAINERS] [-n CYCLES] [-t THREADS] [-i INTERVAL_S] [-m MAX_RSS_GROWTH_KB] "
+		"[-d MAX_DRIFT]\n",
+		argv0);
+
+	return EXIT_FAILURE;
+}
+
+int main(int argc, char **argv)
+{
+	int ret = EXIT_FAILURE;
+	int containers = DEFAULT_CONTAINERS;
+	int nr_threads = DEFAULT_THREADS;
+	int interval_s = DEFAULT_INTERVAL_S;
+	long max_rss_growth_kb = DEFAULT_MAX_RSS_GROWTH_KB;
+	double max_drift = DEFAULT_MAX_DRIFT;
+	struct resources baseline, res;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:d:i:m:n:t:")) != -1) {
+		switch (opt) {
+			case 'c':
+				containers = atoi(optarg);
+				break;
+			case 'd':
+				max_drift = atof(optarg);
+				break;
+			case 'i':
+				interval_s = atoi(optarg);
+				break;
+			case 'm':
+				max_rss_growth_kb = atol(optarg);
+				break;
+			case 'n':
+				cycles = atoi(optarg);
+				break;
+			case 't':
+				nr_threads = atoi(optarg);
+				break;
+			default:
+				return usage(argv[0]);
+		}
+	}
+
+	if (containers < 0 || cycles < 0 || nr_threads <= 0 || interval_s <= 0 || max_drift < 1.0) {
+		return usage(argv[0]);
+	}
+
+	null_fd = open("/dev/null", O_WRONLY);
+	if (null_fd < 0) {
+		fprintf(stderr, "Failed to open /dev/null: errno=%d\n", errno);
+		return EXIT_FAILURE;
+	}
+
+	pthread_t *threads = calloc(nr_threads, sizeof(pthread_t));
+	if (!threads) {
+		goto close_null;
+	}
+
+	if (ocre_initialize(NULL)) {
+		fprintf(stderr, "Failed to initialize Ocre\n");
+		goto free_threads;
+	}
+
+	context = ocre_create_context(NULL);
+	if (!context) {
+		fprintf(stderr, "Failed to create context\n");
+		goto deinitialize;
+	}
+
+	/* Warm up, so lazily allocated resources (worker pools, log rings...) are part of the baseline */
+
+	if (density(nr_threads)) {
+		goto destroy_context;
+	}
+
+	int total_cycles = cycles;
+
+	cycles = 1;
+	churn(NULL);
+	cycles = total_cycles;
+
+	if (atomic_load(&failed)) {
+		goto destroy_context;
+	}
+
+	atomic_store(&cycles_started, 0);
+	atomic_store(&cycles_done, 0);
+	nr_samples = 0;
+
+	sample_resources(&baseline);
+
+	fprintf(stdout, "baseline rss_kb=%ld fds=%d threads=%d\n", baseline.rss_kb, baseline.fds, baseline.threads);
+
+	if (density(containers)) {
+		goto destroy_context;
+	}
+
+	int started = 0;
+	for (; started < nr_threads; started++) {
+		if (pthread_create(&threads[started], NULL, churn, (void *)(intptr_t)started)) {
+			fprintf(stdout, "Failed to create thread %d\n", started);
+			atomic_store(&failed, true);
+			break;
+		}
+	}
+
+	uint32_t first_p99 = 0;
+	uint32_t last_p99 = 0;
+
+	for (int interval = 0; atomic_load(&cycles_done) < cycles && !atomic_load(&failed); interval++) {
+		sleep(interval_s);
+
+		sample_resources(&res);
+
+		uint32_t p99 = report_interval(interval, &res);
+		if (p99) {
+			last_p99 = p99;
+			if (!first_p99) {
+				first_p99 = p99;
+			}
+		}
+
+		/* Fail early on runaway growth, the final check is stricter */
+
+		check("RSS (KiB)", res.rss_kb, baseline.rss_kb + 4 * max_rss_growth_kb);
+	}
+
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	/* Leftover samples */
+
+	sample_resources(&res);
+	report_interval(-1, &res);
+
+	check("container count", ocre_context_get_container_count(context), 0);
+	check("RSS (KiB)", res.rss_kb, baseline.rss_kb + max_rss_growth_kb);
+	check("open file descriptors", res.fds, baseline.fds);
+	check("thread count", res.threads, baseline.threads);
+
+	if (first_p99) {
+		check("cycle p99 (us)", last_p99, (long)(first_p99 * max_drift));
+	}
+
+	if (!atomic_load(&failed)) {
+		fprintf(stdout, "PASS: %d containers, %d cycles\n", containers, atomic_load(&cycles_done));
+		ret = EXIT_SUCCESS;
+	}
+
+destroy_context:
+	ocre_destroy_context(context);
+
+deinitialize:
+	ocre_deinitialize();
+
+free_threads:
+	free(threads);
+
+close_null:
+	close(null_fd);
+
+	return ret;
+}
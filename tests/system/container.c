@@ -5,17 +5,62 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <semaphore.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include <unistd.h>
 
 #include <unity.h>
 #include <ocre/ocre.h>
+#include <ocre/platform/config.h>
+
+#include "shm.h"
 
 struct ocre_context *context;
 struct ocre_container *hello_world;
 struct ocre_container *blinky;
 
+/* Blocking host calls are interrupted on kill, so it should not take much longer than tearing down the instance */
+
+#define KILL_LATENCY_MAX_US 5000
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/* Reads a value from the metrics dump. The series is the metric name with its labels */
+
+static unsigned long long metric_value(const char *series)
+{
+	static char buf[16384];
+	size_t len = strlen(series);
+
+	TEST_ASSERT_LESS_THAN(sizeof(buf), ocre_metrics_dump(buf, sizeof(buf)));
+
+	for (const char *line = buf; line; line = strchr(line, '\n')) {
+		if (*line == '\n') {
+			line++;
+		}
+
+		if (!strncmp(line, series, len) && line[len] == ' ') {
+			return strtoull(line + len + 1, NULL, 10);
+		}
+	}
+
+	TEST_FAIL_MESSAGE("Metric not found");
+
+	return 0;
+}
+
 void setUp(void)
 {
 	const struct ocre_container_args args = {
@@ -112,6 +157,33 @@ void test_ocre_container_kill(void)
 	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(blinky));
 }
 
+void test_ocre_container_kill_latency_wamr(void)
+{
+	/* Blinky spends most of its time in ocre_sleep() */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
+
+	for (int i = 0; i < 3; i++) {
+		usleep(100000);
+
+		uint64_t start = now_us();
+
+		TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky));
+		TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, NULL));
+
+		uint64_t latency = now_us() - start;
+
+		TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(blinky));
+		TEST_ASSERT_LESS_THAN_UINT32(KILL_LATENCY_MAX_US, (uint32_t)latency);
+
+		/* A new run must not be affected by the previous kill */
+
+		TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
+		usleep(100000);
+		TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(blinky));
+	}
+}
+
 void test_ocre_container_destroy(void)
 {
 	/* Start blinky */
@@ -149,23 +221,33 @@ void test_ocre_container_pause_unpause_null(void)
 
 void test_ocre_container_pause_unpause_wamr(void)
 {
+#ifdef __ZEPHYR__
+	TEST_IGNORE_MESSAGE("Container suspension is not supported on Zephyr");
+#endif
+
 	/* Run blinky */
 
 	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
 	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(blinky));
 
-	/* Pause blinky. Does not work, will return -1 */
+	/* Pause blinky */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_pause(blinky));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_PAUSED, ocre_container_get_status(blinky));
+
+	/* Cannot pause twice */
 
 	TEST_ASSERT_EQUAL_INT(-1, ocre_container_pause(blinky));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_PAUSED, ocre_container_get_status(blinky));
 
-	/* Should be running because pause does not work */
+	/* Unpause blinky */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_unpause(blinky));
 	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(blinky));
 
-	/* Unpause blinky. Does not work, will return -1 */
+	/* Cannot unpause a running container */
 
 	TEST_ASSERT_EQUAL_INT(-1, ocre_container_unpause(blinky));
-
-	/* Should be running */
 	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(blinky));
 
 	/* Kill blinky */
@@ -178,6 +260,25 @@ void test_ocre_container_pause_unpause_wamr(void)
 	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, &status));
 }
 
+void test_ocre_container_kill_paused_wamr(void)
+{
+#ifdef __ZEPHYR__
+	TEST_IGNORE_MESSAGE("Container suspension is not supported on Zephyr");
+#endif
+
+	/* Run and pause blinky */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_pause(blinky));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_PAUSED, ocre_container_get_status(blinky));
+
+	/* Kill must resume it so it can exit */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, NULL));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(blinky));
+}
+
 void test_ocre_container_stop_null(void)
 {
 	TEST_ASSERT_EQUAL_INT(-1, ocre_container_stop(NULL));
@@ -185,26 +286,929 @@ void test_ocre_container_stop_null(void)
 
 void test_ocre_container_stop_wamr(void)
 {
-	/* Run blinky */
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+		.stop_timeout_ms = 200,
+	};
+
+	struct ocre_container *stoppable = ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1", "stop",
+									 true, &args, STDIN_FILENO, STDOUT_FILENO,
+									 STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(stoppable);
+
+	/* Run it */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(stoppable));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(stoppable));
+
+	/* Stop it. It either exits on the stop event or gets killed after the timeout */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_stop(stoppable));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(stoppable));
+
+	/* Cannot stop a stopped container */
+
+	TEST_ASSERT_EQUAL_INT(-1, ocre_container_stop(stoppable));
+
+#ifndef __ZEPHYR__
+	/* Stop also works on paused containers */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(stoppable));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_pause(stoppable));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_stop(stoppable));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(stoppable));
+#endif
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, stoppable));
+}
+
+void test_ocre_container_stop_no_api_wamr(void)
+{
+	/* Without the Ocre API there is no way to deliver the stop event, so it is killed right away */
+
+	const struct ocre_container_args args = {
+		.stop_timeout_ms = 60000,
+	};
+
+	struct ocre_container *sleeper = ocre_context_create_container(context, "sleep5_return0.wasm", "wamr/wasip1",
+								       "noapi", true, &args, STDIN_FILENO,
+								       STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(sleeper);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(sleeper));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_stop(sleeper));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(sleeper));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, sleeper));
+}
+
+void test_ocre_container_cpu_quota_invalid(void)
+{
+	const struct ocre_container_args args = {
+		.cpu_quota_us = 10,
+	};
+
+	/* Too small to be enforced */
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1", "quota", true, &args,
+						       STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	const struct ocre_container_args args_period = {
+		.cpu_quota_us = 20000,
+		.cpu_period_us = 10000,
+	};
+
+	/* Larger than the period */
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1", "quota", true,
+						       &args_period, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+}
+
+/* A WASI command whose _start spins forever: (loop (br 0)). It imports proc_exit, so WAMR runs it as a command */
+
+static const uint8_t busy_wasm[] = {
+	0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+	/* Types: () -> () and (i32) -> () */
+	0x01, 0x08, 0x02, 0x60, 0x00, 0x00, 0x60, 0x01, 0x7f, 0x00,
+	/* Imports: wasi_snapshot_preview1.proc_exit */
+	0x02, 0x24, 0x01, 0x16, 'w', 'a', 's', 'i', '_', 's', 'n', 'a', 'p', 's', 'h', 'o', 't', '_', 'p', 'r', 'e',
+	'v', 'i', 'e', 'w', '1', 0x09, 'p', 'r', 'o', 'c', '_', 'e', 'x', 'i', 't', 0x00, 0x01,
+	/* Functions and memory */
+	0x03, 0x02, 0x01, 0x00, 0x05, 0x03, 0x01, 0x00, 0x01,
+	/* Exports: _start and memory */
+	0x07, 0x13, 0x02, 0x06, '_', 's', 't', 'a', 'r', 't', 0x00, 0x01, 0x06, 'm', 'e', 'm', 'o', 'r', 'y', 0x02,
+	0x00,
+	/* Code */
+	0x0a, 0x09, 0x01, 0x07, 0x00, 0x03, 0x40, 0x0c, 0x00, 0x0b, 0x0b,
+};
+
+static uint64_t process_cpu_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+void test_ocre_container_cpu_quota_wamr(void)
+{
+#ifdef __ZEPHYR__
+	TEST_IGNORE_MESSAGE("Container suspension is not supported on Zephyr");
+#endif
+
+	char path[512];
+
+	snprintf(path, sizeof(path), "%s/images/busy.wasm", ocre_context_get_working_directory(context));
+
+	FILE *f = fopen(path, "wb");
+	TEST_ASSERT_NOT_NULL(f);
+	TEST_ASSERT_EQUAL_size_t(sizeof(busy_wasm), fwrite(busy_wasm, 1, sizeof(busy_wasm), f));
+	TEST_ASSERT_EQUAL_INT(0, fclose(f));
+
+	/* 10% of a CPU */
+
+	const struct ocre_container_args args = {
+		.cpu_quota_us = 5000,
+		.cpu_period_us = 50000,
+	};
+
+	struct ocre_container *limited = ocre_context_create_container(context, "busy.wasm", "wamr/wasip1", "quota",
+								       true, &args, STDIN_FILENO, STDOUT_FILENO,
+								       STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(limited);
+
+	unsigned long long throttled = metric_value("ocre_container_throttled_total");
+
+	/* Nothing else runs, so the CPU time of the process is about the one of the container. Skip the first period,
+	 * which starts with the instantiation
+	 */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(limited));
+	usleep(100000);
+
+	uint64_t wall = now_us();
+	uint64_t cpu = process_cpu_us();
+
+	usleep(1000000);
+
+	wall = now_us() - wall;
+	cpu = process_cpu_us() - cpu;
+
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(limited));
+
+	/* Unthrottled, it would use all of the wall time */
+
+	TEST_ASSERT_LESS_THAN_UINT64(wall / 5, cpu);
+	TEST_ASSERT_GREATER_THAN_UINT64(wall / 40, cpu);
+
+	/* Throttled in about every one of the 20 periods */
+
+	TEST_ASSERT_GREATER_OR_EQUAL(15, metric_value("ocre_container_throttled_total") - throttled);
+
+	/* Kill must work even if the container is throttled */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(limited));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(limited, NULL));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(limited));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, limited));
+
+	unlink(path);
+}
+
+void test_ocre_container_memory_stats_null(void)
+{
+	struct ocre_memory_stats stats;
+
+	TEST_ASSERT_NOT_EQUAL_INT(0, ocre_container_get_memory_stats(NULL, &stats));
+	TEST_ASSERT_NOT_EQUAL_INT(0, ocre_container_get_memory_stats(blinky, NULL));
+}
+
+void test_ocre_container_memory_limit_wamr(void)
+{
+#ifdef __ZEPHYR__
+	TEST_IGNORE_MESSAGE("Memory arenas are not supported on Zephyr");
+#endif
+
+	/* The module alone takes more than that */
+
+	const struct ocre_container_args args_tiny = {
+		.memory_limit = 1,
+	};
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "memory", false,
+						       &args_tiny, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	const struct ocre_container_args args = {
+		.memory_limit = 16 * 1024 * 1024,
+	};
+
+	struct ocre_container *limited = ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1",
+								       "memory", false, &args, STDIN_FILENO,
+								       STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(limited);
+
+	struct ocre_memory_stats stats;
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_get_memory_stats(limited, &stats));
+	TEST_ASSERT_TRUE(stats.used > 0);
+	TEST_ASSERT_TRUE(stats.reserved >= stats.used);
+	TEST_ASSERT_TRUE(stats.peak >= stats.reserved);
+	TEST_ASSERT_TRUE(stats.reserved <= stats.limit);
+	TEST_ASSERT_TRUE(stats.limit == args.memory_limit);
+	TEST_ASSERT_TRUE(stats.failed == 0);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(limited));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(limited, NULL));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, limited));
+}
+
+static struct ocre_container *create_with_capability(const char *id, const char *capability)
+{
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				capability,
+				NULL,
+			},
+	};
+
+	return ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", id, false, &args,
+					     STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO);
+}
+
+void test_ocre_container_shm_invalid(void)
+{
+	/* Bad names and sizes */
+
+	TEST_ASSERT_NULL(create_with_capability("shm", "ocre:shm="));
+	TEST_ASSERT_NULL(create_with_capability("shm", "ocre:shm=.frames:64k"));
+	TEST_ASSERT_NULL(create_with_capability("shm", "ocre:shm=frames:"));
+	TEST_ASSERT_NULL(create_with_capability("shm", "ocre:shm=frames:64x"));
+
+	/* The first container naming a region must give its size */
+
+	TEST_ASSERT_NULL(create_with_capability("shm", "ocre:shm=nowhere"));
+
+	/* A single shared heap per container */
+
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:shared_heap",
+				"ocre:shm=frames:64k",
+				NULL,
+			},
+	};
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "shm", false,
+						       &args, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+}
+
+void test_ocre_container_shm_wamr(void)
+{
+#ifndef CONFIG_OCRE_SHARED_HEAP
+	TEST_IGNORE_MESSAGE("Shared heaps are disabled");
+#endif
+
+	struct ocre_container *producer = create_with_capability("producer", "ocre:shm=frames:64k");
+	TEST_ASSERT_NOT_NULL(producer);
+
+	/* The next ones can leave the size out, but not give another one */
+
+	TEST_ASSERT_NULL(create_with_capability("consumer", "ocre:shm=frames:128k"));
+
+	struct ocre_container *consumer = create_with_capability("consumer", "ocre:shm=frames");
+	TEST_ASSERT_NOT_NULL(consumer);
+
+	struct ocre_container *other = create_with_capability("other", "ocre:shm=other:64k");
+	TEST_ASSERT_NOT_NULL(other);
+
+#ifdef CONFIG_OCRE_SHARED_HEAP
+	/* The same name is the same shared heap, whatever the container asking for it, and another name another one */
+
+	wasm_shared_heap_t frames = wamr_shm_get("frames");
+	TEST_ASSERT_NOT_NULL(frames);
+	TEST_ASSERT_TRUE(frames == wamr_shm_get("frames:64k"));
+
+	wasm_shared_heap_t other_heap = wamr_shm_get("other");
+	TEST_ASSERT_NOT_NULL(other_heap);
+	TEST_ASSERT_TRUE(other_heap != frames);
+#endif
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(producer));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(producer, NULL));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(consumer));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(consumer, NULL));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(other));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(other, NULL));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, producer));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, consumer));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, other));
+}
+
+void test_ocre_container_memory_limit_exceeded_wamr(void)
+{
+#ifdef __ZEPHYR__
+	TEST_IGNORE_MESSAGE("Memory arenas are not supported on Zephyr");
+#endif
+
+	struct ocre_memory_stats stats;
+
+	/* Find out what the module takes once loaded */
+
+	const struct ocre_container_args args_probe = {
+		.memory_limit = 16 * 1024 * 1024,
+	};
+
+	struct ocre_container *probe = ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1",
+								     "memory", false, &args_probe, STDIN_FILENO,
+								     STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(probe);
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_get_memory_stats(probe, &stats));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, probe));
+
+	/* No room is left for the instance, its stacks and heap, which WAMR allocates when the container starts. The
+	 * container fails to start, the process goes on
+	 */
+
+	const struct ocre_container_args args = {
+		.memory_limit = stats.reserved,
+	};
+
+	struct ocre_container *limited = ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1",
+								       "memory", false, &args, STDIN_FILENO,
+								       STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(limited);
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_start(limited));
+	TEST_ASSERT_NOT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(limited));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_get_memory_stats(limited, &stats));
+	TEST_ASSERT_TRUE(stats.failed > 0);
+	TEST_ASSERT_TRUE(stats.reserved <= stats.limit);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, limited));
+
+	/* The same module runs with the memory it needs */
+
+	struct ocre_container *unlimited = ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1",
+									 "memory", false, NULL, STDIN_FILENO,
+									 STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(unlimited);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(unlimited));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(unlimited, NULL));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, unlimited));
+}
+
+void test_ocre_container_reactor_invalid(void)
+{
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+		.cpu_quota_us = 5000,
+		.reactor = true,
+	};
+
+	/* Reactors cannot be throttled */
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1", "reactor", true, &args,
+						       STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	/* Without the Ocre API, a reactor would never get any event */
+
+	const struct ocre_container_args args_no_api = {
+		.reactor = true,
+	};
+
+	struct ocre_container *reactor = ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1",
+								       "reactor", true, &args_no_api, STDIN_FILENO,
+								       STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(reactor);
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_start(reactor));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, reactor));
+}
+
+void test_ocre_container_reactor_wamr(void)
+{
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+		.reactor = true,
+	};
+
+	struct ocre_container *reactor = ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1",
+								       "reactor", true, &args, STDIN_FILENO,
+								       STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(reactor);
+
+	/* No dispatcher is registered, so it exits as soon as its entry point returns */
+
+	for (int i = 0; i < 2; i++) {
+		int status = -1;
+
+		TEST_ASSERT_EQUAL_INT(0, ocre_container_start(reactor));
+		TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(reactor, &status));
+		TEST_ASSERT_EQUAL_INT(0, status);
+		TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(reactor));
+	}
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, reactor));
+}
+
+void test_ocre_container_reactor_kill_wamr(void)
+{
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+		.reactor = true,
+	};
+
+	struct ocre_container *reactor = ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1",
+								       "reactor", true, &args, STDIN_FILENO,
+								       STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(reactor);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(reactor));
+	usleep(100000);
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(reactor));
+
+	/* Works whether it is in the middle of its entry point or idle waiting for events */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(reactor));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(reactor, NULL));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(reactor));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, reactor));
+}
+
+void test_ocre_container_checkpoint_null(void)
+{
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_checkpoint(NULL, "checkpoint.ckpt"));
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_restore(NULL, "checkpoint.ckpt"));
+
+	struct ocre_container *container = ocre_context_create_container(
+		context, "hello-world.wasm", "wamr/wasip1", "checkpoint", true, NULL, STDIN_FILENO, STDOUT_FILENO,
+		STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_checkpoint(container, NULL));
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_restore(container, NULL));
+
+	/* Only reactors can be checkpointed */
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_restore(container, "checkpoint.ckpt"));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, container));
+}
+
+void test_ocre_container_checkpoint_wamr(void)
+{
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+		.reactor = true,
+	};
+
+	struct ocre_container *reactor = ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1",
+								       "checkpoint", true, &args, STDIN_FILENO,
+								       STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(reactor);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(reactor));
+	usleep(100000);
+
+	/* It must be paused first */
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_checkpoint(reactor, "checkpoint.ckpt"));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_pause(reactor));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_checkpoint(reactor, "checkpoint.ckpt"));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(reactor));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(reactor, NULL));
+
+	/* The restored container goes on handling its timer events */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_restore(reactor, "checkpoint.ckpt"));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(reactor));
+	usleep(100000);
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(reactor));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(reactor));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(reactor, NULL));
+
+	/* A truncated checkpoint is rejected, the container does not start */
+
+	FILE *f = fopen("checkpoint.ckpt", "w");
+	TEST_ASSERT_NOT_NULL(f);
+	fputs("OCRECKPT", f);
+	fclose(f);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_restore(reactor, "checkpoint.ckpt"));
+	ocre_container_start(reactor);
+	ocre_container_wait(reactor, NULL);
+	TEST_ASSERT_NOT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(reactor));
+
+	unlink("checkpoint.ckpt");
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, reactor));
+}
+
+void test_ocre_container_thread_attributes_invalid(void)
+{
+	const struct ocre_container_args args_nice = {
+		.sched_policy = OCRE_SCHED_OTHER,
+		.sched_priority = 20,
+	};
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "attr", true,
+						       &args_nice, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	const struct ocre_container_args args_priority = {
+		.sched_priority = 1,
+	};
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "attr", true,
+						       &args_priority, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	const struct ocre_container_args args_cpuset = {
+		.cpuset = "0-",
+	};
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "attr", true,
+						       &args_cpuset, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	const struct ocre_container_args args_reactor = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+		.reactor = true,
+		.stack_size = 65536,
+	};
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "attr", true,
+						       &args_reactor, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+}
+
+void test_ocre_container_thread_attributes_wamr(void)
+{
+#ifdef __ZEPHYR__
+	TEST_IGNORE_MESSAGE("CPU sets and nice values are not supported on Zephyr");
+#endif
+
+	const struct ocre_container_args args = {
+		.stack_size = 256 * 1024,
+		.cpuset = "0",
+		.sched_policy = OCRE_SCHED_OTHER,
+		.sched_priority = 5,
+	};
+
+	struct ocre_container *container = ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1",
+									 "attr", false, &args, STDIN_FILENO,
+									 STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(container));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(container));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, container));
+}
+
+void test_ocre_container_metrics_wamr(void)
+{
+	/* hello_world and blinky exist */
+
+	TEST_ASSERT_GREATER_OR_EQUAL(2, metric_value("ocre_containers"));
+
+	unsigned long long running = metric_value("ocre_container_transitions_total{state=\"running\"}");
+	unsigned long long stopped = metric_value("ocre_container_transitions_total{state=\"stopped\"}");
+	unsigned long long starts = metric_value("ocre_container_start_duration_seconds_count");
+	unsigned long long stops = metric_value("ocre_container_stop_duration_seconds_count");
+
+	/* Run hello_world */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(hello_world));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(hello_world, NULL));
+
+	TEST_ASSERT_EQUAL(running + 1, metric_value("ocre_container_transitions_total{state=\"running\"}"));
+	TEST_ASSERT_EQUAL(stopped + 1, metric_value("ocre_container_transitions_total{state=\"stopped\"}"));
+	TEST_ASSERT_EQUAL(starts + 1, metric_value("ocre_container_start_duration_seconds_count"));
+
+	/* Nobody asked hello_world to stop */
+
+	TEST_ASSERT_EQUAL(stops, metric_value("ocre_container_stop_duration_seconds_count"));
+
+	/* Kill blinky */
 
 	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
-	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, NULL));
+
+	TEST_ASSERT_EQUAL(stops + 1, metric_value("ocre_container_stop_duration_seconds_count"));
+
+	/* The image store holds at least hello-world.wasm and blinky.wasm */
+
+	TEST_ASSERT_GREATER_OR_EQUAL(2, metric_value("ocre_images"));
+	TEST_ASSERT_GREATER_THAN(0, metric_value("ocre_image_store_bytes"));
+}
+
+/* Reads a whole file in a static buffer */
+
+static const char *read_file(const char *path)
+{
+	static char buf[1 << 20];
+
+	FILE *f = fopen(path, "r");
+	TEST_ASSERT_NOT_NULL(f);
 
-	/* Stop blinky. Does not work, will return -1 */
+	size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+	buf[len] = '\0';
 
-	TEST_ASSERT_EQUAL_INT(-1, ocre_container_stop(blinky));
+	fclose(f);
 
-	/* Should be running because stop does not work */
+	return buf;
+}
+
+void test_ocre_container_trace_wamr(void)
+{
+#ifndef CONFIG_OCRE_TRACE
+	TEST_IGNORE_MESSAGE("Tracing is disabled");
+#else
+	/* Run hello_world and let blinky call the Ocre API for a while */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(hello_world));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(hello_world, NULL));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
+	usleep(100000);
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, NULL));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_trace_export("trace.json"));
+
+	const char *trace = read_file("trace.json");
+
+	TEST_ASSERT_NOT_NULL(strstr(trace, "\"traceEvents\""));
+	TEST_ASSERT_NOT_NULL(strstr(trace, "\"name\":\"load_file\""));
+	TEST_ASSERT_NOT_NULL(strstr(trace, "\"name\":\"wasm_runtime_load\""));
+	TEST_ASSERT_NOT_NULL(strstr(trace, "\"name\":\"instantiate\""));
+	TEST_ASSERT_NOT_NULL(strstr(trace, "\"name\":\"start_handshake\""));
+	TEST_ASSERT_NOT_NULL(strstr(trace, "\"name\":\"ocre_sleep\",\"cat\":\"api\""));
+
+	/* Container threads are named after the containers */
+
+	TEST_ASSERT_NOT_NULL(strstr(trace, "\"args\":{\"name\":\"hello\"}"));
+
+	unlink("trace.json");
+#endif
+}
+
+void test_ocre_container_native_stats_null(void)
+{
+	struct ocre_native_stats stats[1];
+
+	TEST_ASSERT_LESS_THAN_INT(0, ocre_container_get_native_stats(NULL, stats, 1));
+	TEST_ASSERT_LESS_THAN_INT(0, ocre_container_get_native_stats(blinky, NULL, 1));
+}
+
+void test_ocre_container_native_stats_wamr(void)
+{
+#ifndef CONFIG_OCRE_API_PROFILING
+	TEST_IGNORE_MESSAGE("Native profiling is disabled");
+#else
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
+	usleep(100000);
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, NULL));
+
+	int count = ocre_container_get_native_stats(blinky, NULL, 0);
+	TEST_ASSERT_GREATER_THAN_INT(0, count);
+
+	struct ocre_native_stats *stats = calloc(count, sizeof(struct ocre_native_stats));
+	TEST_ASSERT_NOT_NULL(stats);
+	TEST_ASSERT_EQUAL_INT(count, ocre_container_get_native_stats(blinky, stats, count));
+
+	/* The counters are kept after the container exited */
+
+	bool found = false;
+	for (int i = 0; i < count; i++) {
+		if (!strcmp(stats[i].name, "ocre_sleep")) {
+			TEST_ASSERT_TRUE(stats[i].calls > 0);
+			TEST_ASSERT_TRUE(stats[i].total_ns > 0);
+			found = true;
+		}
+	}
+
+	TEST_ASSERT_TRUE(found);
+
+	free(stats);
+#endif
+}
+
+#ifdef CONFIG_OCRE_WAMR_PROFILING
+static void count_stacks(void *arg, const char *stack, unsigned int count)
+{
+	unsigned int *nr_samples = arg;
+
+	TEST_ASSERT_NOT_NULL(stack);
+	TEST_ASSERT_GREATER_THAN_UINT(0, count);
+
+	*nr_samples += count;
+}
+#endif
+
+void test_ocre_container_profile_wamr(void)
+{
+#ifndef CONFIG_OCRE_WAMR_PROFILING
+	TEST_IGNORE_MESSAGE("Guest profiling is disabled");
+#else
+	unsigned int nr_samples = 0;
+	char buf[4096];
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
+
+	int samples = ocre_container_sample(blinky, 200, 10, count_stacks, &nr_samples);
+	TEST_ASSERT_GREATER_THAN_INT(0, samples);
+	TEST_ASSERT_EQUAL_UINT(samples, nr_samples);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, NULL));
+
+	/* The profile of the last run is kept after the container exited */
+
+	int len = ocre_container_get_profile(blinky, buf, sizeof(buf));
+	TEST_ASSERT_GREATER_THAN_INT(0, len);
+	TEST_ASSERT_NOT_NULL(strstr(buf, "FUNCTION\tCALLS"));
+	TEST_ASSERT_NOT_NULL(strstr(buf, "Memory consumption"));
+
+	/* Exited containers cannot be sampled */
+
+	TEST_ASSERT_LESS_THAN_INT(0, ocre_container_sample(blinky, 100, 10, count_stacks, &nr_samples));
+#endif
+}
+
+struct completion {
+	sem_t sem;
+	struct ocre_container *container;
+	int result;
+};
+
+static void complete(struct ocre_container *container, int result, void *arg)
+{
+	struct completion *completion = arg;
+
+	completion->container = container;
+	completion->result = result;
+
+	sem_post(&completion->sem);
+}
+
+void test_ocre_container_async_null(void)
+{
+	struct completion completion;
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_start_async(NULL, complete, &completion));
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_start_async(blinky, NULL, NULL));
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_wait_async(NULL, complete, &completion));
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_wait_async(blinky, NULL, NULL));
+
+	/* Created containers cannot be waited for */
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_container_wait_async(blinky, complete, &completion));
+}
+
+void test_ocre_container_start_wait_async(void)
+{
+	struct completion started;
+	struct completion exited;
+
+	sem_init(&started.sem, 0, 0);
+	sem_init(&exited.sem, 0, 0);
+
+	/* hello_world is attached, the asynchronous start does not wait for it to exit */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start_async(hello_world, complete, &started));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait_async(hello_world, complete, &exited));
+
+	TEST_ASSERT_EQUAL_INT(0, sem_wait(&started.sem));
+	TEST_ASSERT_EQUAL_PTR(hello_world, started.container);
+	TEST_ASSERT_EQUAL_INT(0, started.result);
+
+	TEST_ASSERT_EQUAL_INT(0, sem_wait(&exited.sem));
+	TEST_ASSERT_EQUAL_PTR(hello_world, exited.container);
+	TEST_ASSERT_EQUAL_INT(0, exited.result);
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(hello_world));
+
+	/* Already stopped, the callback is called before returning */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait_async(hello_world, complete, &exited));
+	TEST_ASSERT_EQUAL_INT(0, sem_trywait(&exited.sem));
+
+	/* Several waiters of a running container are all notified */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start_async(blinky, complete, &started));
+	TEST_ASSERT_EQUAL_INT(0, sem_wait(&started.sem));
+	TEST_ASSERT_EQUAL_INT(0, started.result);
 	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_RUNNING, ocre_container_get_status(blinky));
 
-	/* Kill blinky */
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait_async(blinky, complete, &exited));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait_async(blinky, complete, &exited));
+	TEST_ASSERT_NOT_EQUAL(0, sem_trywait(&exited.sem));
 
 	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky));
 
-	/* Wait for blinky to stop */
+	TEST_ASSERT_EQUAL_INT(0, sem_wait(&exited.sem));
+	TEST_ASSERT_EQUAL_INT(0, sem_wait(&exited.sem));
+	TEST_ASSERT_EQUAL_PTR(blinky, exited.container);
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(blinky));
 
-	int status;
-	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, &status));
+	sem_destroy(&started.sem);
+	sem_destroy(&exited.sem);
+}
+
+void test_ocre_container_restart_policy(void)
+{
+	TEST_ASSERT_EQUAL_INT(-1, ocre_container_get_restart_count(NULL));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_get_restart_count(hello_world));
+
+	const struct ocre_container_args invalid = {
+		.restart_policy = OCRE_RESTART_ALWAYS + 1,
+	};
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "invalid", false,
+						       &invalid, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	/* hello-world exits with 0, it is not restarted on failure only */
+
+	const struct ocre_container_args on_failure = {
+		.restart_policy = OCRE_RESTART_ON_FAILURE,
+		.restart_backoff_ms = 1,
+	};
+
+	struct ocre_container *container = ocre_context_create_container(
+		context, "hello-world.wasm", "wamr/wasip1", "on-failure", false, &on_failure, STDIN_FILENO,
+		STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	int status = -1;
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(container, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_get_restart_count(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, container));
+
+	/* Always restarted, until the retries run out */
+
+	const struct ocre_container_args always = {
+		.restart_policy = OCRE_RESTART_ALWAYS,
+		.restart_max_retries = 3,
+		.restart_backoff_ms = 1,
+		.restart_backoff_max_ms = 4,
+	};
+
+	container = ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "always", false, &always,
+						  STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(container, &status));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(container));
+	TEST_ASSERT_EQUAL_INT(3, ocre_container_get_restart_count(container));
+
+	/* Starting again gives it its retries back */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(container, &status));
+	TEST_ASSERT_EQUAL_INT(6, ocre_container_get_restart_count(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, container));
+
+	/* Killed containers are not restarted */
+
+	const struct ocre_container_args blinky_always = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+		.restart_policy = OCRE_RESTART_ALWAYS,
+	};
+
+	container = ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1", "blinky-always", true,
+						  &blinky_always, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(container, NULL));
+	TEST_ASSERT_EQUAL(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_get_restart_count(container));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, container));
 }
 
 int main(void)
@@ -214,6 +1218,7 @@ int main(void)
 	RUN_TEST(test_ocre_container_status);
 	RUN_TEST(test_ocre_container_restart);
 	RUN_TEST(test_ocre_container_kill);
+	RUN_TEST(test_ocre_container_kill_latency_wamr);
 	RUN_TEST(test_ocre_container_destroy);
 	RUN_TEST(test_ocre_container_get_image_null);
 	RUN_TEST(test_ocre_container_get_image_blinky);
@@ -221,7 +1226,31 @@ int main(void)
 	RUN_TEST(test_ocre_container_get_id_hello);
 	RUN_TEST(test_ocre_container_pause_unpause_null);
 	RUN_TEST(test_ocre_container_pause_unpause_wamr);
+	RUN_TEST(test_ocre_container_kill_paused_wamr);
 	RUN_TEST(test_ocre_container_stop_null);
 	RUN_TEST(test_ocre_container_stop_wamr);
+	RUN_TEST(test_ocre_container_stop_no_api_wamr);
+	RUN_TEST(test_ocre_container_cpu_quota_invalid);
+	RUN_TEST(test_ocre_container_cpu_quota_wamr);
+	RUN_TEST(test_ocre_container_memory_stats_null);
+	RUN_TEST(test_ocre_container_memory_limit_wamr);
+	RUN_TEST(test_ocre_container_memory_limit_exceeded_wamr);
+	RUN_TEST(test_ocre_container_shm_invalid);
+	RUN_TEST(test_ocre_container_shm_wamr);
+	RUN_TEST(test_ocre_container_reactor_invalid);
+	RUN_TEST(test_ocre_container_reactor_wamr);
+	RUN_TEST(test_ocre_container_reactor_kill_wamr);
+	RUN_TEST(test_ocre_container_checkpoint_null);
+	RUN_TEST(test_ocre_container_checkpoint_wamr);
+	RUN_TEST(test_ocre_container_thread_attributes_invalid);
+	RUN_TEST(test_ocre_container_thread_attributes_wamr);
+	RUN_TEST(test_ocre_container_metrics_wamr);
+	RUN_TEST(test_ocre_container_trace_wamr);
+	RUN_TEST(test_ocre_container_native_stats_null);
+	RUN_TEST(test_ocre_container_native_stats_wamr);
+	RUN_TEST(test_ocre_container_profile_wamr);
+	RUN_TEST(test_ocre_container_async_null);
+	RUN_TEST(test_ocre_container_start_wait_async);
+	RUN_TEST(test_ocre_container_restart_policy);
 	return UNITY_END();
 }
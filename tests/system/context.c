@@ -5,6 +5,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <unistd.h>
 
@@ -566,6 +568,282 @@ void test_ocre_context_create_container_detached_mode(void)
 	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, non_detached_container));
 }
 
+void test_ocre_context_wait_any_null(void)
+{
+	TEST_ASSERT_NULL(ocre_context_wait_any(NULL, NULL, 0, 0));
+	TEST_ASSERT_NULL(ocre_context_wait_any(context, NULL, 1, 0));
+
+	/* Nothing exited */
+
+	TEST_ASSERT_NULL(ocre_context_wait_any(context, NULL, 0, 0));
+	TEST_ASSERT_NULL(ocre_context_wait_any(context, NULL, 0, 100));
+}
+
+void test_ocre_context_wait_any(void)
+{
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+	};
+
+	struct ocre_container *blinky[2];
+
+	for (int i = 0; i < 2; i++) {
+		blinky[i] = ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1", NULL, true, &args,
+							  STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO);
+		TEST_ASSERT_NOT_NULL(blinky[i]);
+		TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky[i]));
+	}
+
+	/* Both run */
+
+	TEST_ASSERT_NULL(ocre_context_wait_any(context, blinky, 2, 100));
+	TEST_ASSERT_EQUAL_INT(-ETIMEDOUT, ocre_container_wait_timeout(blinky[0], NULL, 100));
+
+	/* The second one exits, waiting for the first one only does not report it */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky[1]));
+
+	TEST_ASSERT_NULL(ocre_context_wait_any(context, blinky, 1, 100));
+	TEST_ASSERT_EQUAL_PTR(blinky[1], ocre_context_wait_any(context, blinky, 2, -1));
+
+	int status;
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait_timeout(blinky[1], &status, 0));
+	TEST_ASSERT_EQUAL_INT(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(blinky[1]));
+
+	/* Each exit is reported once */
+
+	TEST_ASSERT_NULL(ocre_context_wait_any(context, NULL, 0, 0));
+
+	/* Any container of the context */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky[0]));
+	TEST_ASSERT_EQUAL_PTR(blinky[0], ocre_context_wait_any(context, NULL, 0, 1000));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait_timeout(blinky[0], NULL, 1000));
+
+	/* Removed containers are not reported */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky[0]));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky[0]));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky[0], NULL));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, blinky[0]));
+
+	TEST_ASSERT_NULL(ocre_context_wait_any(context, NULL, 0, 0));
+}
+
+void test_ocre_context_watch_null(void)
+{
+	struct ocre_container_event event;
+
+	TEST_ASSERT_NULL(ocre_context_watch(NULL, 16, NULL, NULL));
+	TEST_ASSERT_NULL(ocre_context_watch(context, 0, NULL, NULL));
+	TEST_ASSERT_EQUAL_INT(-EINVAL, ocre_watch_read(NULL, &event, 1, 0));
+	TEST_ASSERT_EQUAL_INT(-EINVAL, ocre_watch_get_fd(NULL));
+
+	ocre_context_unwatch(context, NULL);
+	ocre_context_unwatch(NULL, NULL);
+}
+
+static void count_events(const struct ocre_container_event *event, void *arg)
+{
+	(void)event;
+
+	(*(int *)arg)++;
+}
+
+void test_ocre_context_watch(void)
+{
+	const struct ocre_container_args args = {
+		.capabilities =
+			(const char *[]){
+				"ocre:api",
+				NULL,
+			},
+	};
+
+	static const ocre_container_status_t expected[][2] = {
+		{OCRE_CONTAINER_STATUS_UNKNOWN, OCRE_CONTAINER_STATUS_CREATED},
+		{OCRE_CONTAINER_STATUS_CREATED, OCRE_CONTAINER_STATUS_RUNNING},
+		{OCRE_CONTAINER_STATUS_RUNNING, OCRE_CONTAINER_STATUS_EXITED},
+		{OCRE_CONTAINER_STATUS_EXITED, OCRE_CONTAINER_STATUS_STOPPED},
+		{OCRE_CONTAINER_STATUS_STOPPED, OCRE_CONTAINER_STATUS_UNKNOWN},
+	};
+
+	struct ocre_container_event events[8];
+	int calls = 0;
+
+	struct ocre_watch *watch = ocre_context_watch(context, 8, count_events, &calls);
+	TEST_ASSERT_NOT_NULL(watch);
+
+	/* A small ring only keeps the latest events */
+
+	struct ocre_watch *small = ocre_context_watch(context, 2, NULL, NULL);
+	TEST_ASSERT_NOT_NULL(small);
+
+#ifdef __linux__
+	TEST_ASSERT_GREATER_OR_EQUAL(0, ocre_watch_get_fd(watch));
+#endif
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_watch_read(watch, events, 8, 0));
+	TEST_ASSERT_EQUAL_INT(0, ocre_watch_read(watch, events, 8, 100));
+
+	struct ocre_container *blinky = ocre_context_create_container(context, "blinky.wasm", "wamr/wasip1", "watched",
+								      true, &args, STDIN_FILENO, STDOUT_FILENO,
+								      STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(blinky);
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_kill(blinky));
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_wait(blinky, NULL));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, blinky));
+
+	TEST_ASSERT_EQUAL_INT(5, calls);
+	TEST_ASSERT_EQUAL_INT(5, ocre_watch_read(watch, events, 8, 1000));
+
+	for (int i = 0; i < 5; i++) {
+		TEST_ASSERT_EQUAL_STRING("watched", events[i].id);
+		TEST_ASSERT_EQUAL_INT(expected[i][0], events[i].old_status);
+		TEST_ASSERT_EQUAL_INT(expected[i][1], events[i].new_status);
+
+		if (i) {
+			TEST_ASSERT_TRUE(events[i - 1].sequence + 1 == events[i].sequence);
+			TEST_ASSERT_TRUE(events[i - 1].timestamp_ns <= events[i].timestamp_ns);
+		}
+	}
+
+	uint64_t last = events[4].sequence;
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_watch_read(watch, events, 8, 0));
+
+	TEST_ASSERT_EQUAL_INT(2, ocre_watch_read(small, events, 8, 0));
+	TEST_ASSERT_TRUE(last - 1 == events[0].sequence);
+	TEST_ASSERT_TRUE(last == events[1].sequence);
+
+	ocre_context_unwatch(context, small);
+	ocre_context_unwatch(context, watch);
+}
+
+void test_ocre_context_memory_budget_null(void)
+{
+	struct ocre_budget_stats stats;
+
+	TEST_ASSERT_NOT_EQUAL_INT(0, ocre_context_set_memory_budget(NULL, 0));
+	TEST_ASSERT_NOT_EQUAL_INT(0, ocre_context_get_memory_budget(NULL, &stats));
+	TEST_ASSERT_NOT_EQUAL_INT(0, ocre_context_get_memory_budget(context, NULL));
+}
+
+void test_ocre_context_memory_budget(void)
+{
+	struct ocre_budget_stats stats;
+
+	/* Too small for the module alone */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_set_memory_budget(context, 1024));
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "budget", false,
+						       NULL, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	/* A declared memory limit is checked before loading the module */
+
+	const struct ocre_container_args args = {
+		.memory_limit = 4096,
+	};
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "budget", false,
+						       &args, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_get_memory_budget(context, &stats));
+	TEST_ASSERT_TRUE(stats.budget == 1024);
+	TEST_ASSERT_TRUE(stats.reserved == 0);
+	TEST_ASSERT_TRUE(stats.rejected == 2);
+
+	/* Unlimited */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_set_memory_budget(context, 0));
+
+	struct ocre_container *container = ocre_context_create_container(
+		context, "hello-world.wasm", "wamr/wasip1", "budget", false, NULL, STDIN_FILENO, STDOUT_FILENO,
+		STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_get_memory_budget(context, &stats));
+	TEST_ASSERT_TRUE(stats.reserved > 0);
+
+	/* The budget cannot go below what is reserved, but can be exactly that */
+
+	TEST_ASSERT_NOT_EQUAL_INT(0, ocre_context_set_memory_budget(context, stats.reserved - 1));
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_set_memory_budget(context, stats.reserved));
+
+	/* Nothing is left for a second container */
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-world.wasm", "wamr/wasip1", "budget2", false,
+						       NULL, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	/* Removing the container gives its memory back */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, container));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_get_memory_budget(context, &stats));
+	TEST_ASSERT_TRUE(stats.reserved == 0);
+	TEST_ASSERT_TRUE(stats.rejected == 3);
+}
+
+void test_ocre_context_create_container_image_ref(void)
+{
+	static const char digest[] = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+	const char *workdir = ocre_context_get_working_directory(context);
+	char image[PATH_MAX], blob[PATH_MAX], ref[PATH_MAX];
+	char buf[1024];
+	size_t n;
+
+	snprintf(image, sizeof(image), "%s/images/hello-world.wasm", workdir);
+	snprintf(blob, sizeof(blob), "%s/blobs/sha256/%s", workdir, digest);
+	snprintf(ref, sizeof(ref), "%s/images/hello-ref", workdir);
+
+	/* A reference to a blob which is not stored cannot be loaded */
+
+	FILE *f = fopen(ref, "w");
+	TEST_ASSERT_NOT_NULL(f);
+	fprintf(f, "sha256:%s\n", digest);
+	fclose(f);
+
+	char read_digest[OCRE_IMAGE_DIGEST_SIZE];
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_image_ref_read(ref, read_digest));
+	TEST_ASSERT_EQUAL_STRING(digest, read_digest);
+	TEST_ASSERT_EQUAL_INT(1, ocre_image_ref_read(image, read_digest));
+	TEST_ASSERT_LESS_THAN_INT(0, ocre_image_ref_read(blob, read_digest));
+
+	TEST_ASSERT_NULL(ocre_context_create_container(context, "hello-ref", "wamr/wasip1", NULL, false, NULL,
+						       STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO));
+
+	/* Store the blob the reference names */
+
+	FILE *in = fopen(image, "r");
+	TEST_ASSERT_NOT_NULL(in);
+	FILE *out = fopen(blob, "w");
+	TEST_ASSERT_NOT_NULL(out);
+
+	while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+		TEST_ASSERT_EQUAL_INT(n, fwrite(buf, 1, n, out));
+	}
+
+	fclose(in);
+	fclose(out);
+
+	struct ocre_container *container =
+		ocre_context_create_container(context, "hello-ref", "wamr/wasip1", NULL, false, NULL, STDIN_FILENO,
+					      STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_context_remove_container(context, container));
+
+	unlink(ref);
+	unlink(blob);
+}
+
 int main(void)
 {
 	UNITY_BEGIN();
@@ -581,6 +859,7 @@ int main(void)
 	RUN_TEST(test_ocre_context_create_container_ok);
 	RUN_TEST(test_ocre_context_create_container_null_runtime_ok);
 	RUN_TEST(test_ocre_context_create_container_with_id_ok);
+	RUN_TEST(test_ocre_context_create_container_image_ref);
 	RUN_TEST(test_ocre_context_create_container_detached_mode);
 	RUN_TEST(test_ocre_context_create_container_with_id_twice);
 	RUN_TEST(test_ocre_context_create_container_and_forget);
@@ -595,5 +874,11 @@ int main(void)
 	RUN_TEST(test_ocre_context_get_containers_err);
 	RUN_TEST(test_ocre_context_get_containers_zero);
 	RUN_TEST(test_ocre_context_get_containers_ok);
+	RUN_TEST(test_ocre_context_wait_any_null);
+	RUN_TEST(test_ocre_context_wait_any);
+	RUN_TEST(test_ocre_context_watch_null);
+	RUN_TEST(test_ocre_context_watch);
+	RUN_TEST(test_ocre_context_memory_budget_null);
+	RUN_TEST(test_ocre_context_memory_budget);
 	return UNITY_END();
 }
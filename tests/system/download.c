@@ -0,0 +1,458 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Tests of the POSIX image downloader, against a small HTTP server running in the test */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <unity.h>
+
+#include "sha256/sha256.h"
+
+#define TEST_FILE	 "download.tmp"
+#define TEST_RESUME_FILE TEST_FILE ".resume"
+
+extern int ocre_download_file(const char *url, const char *filepath, char *digest);
+
+/* Server */
+
+static struct {
+	pthread_mutex_t mutex;
+	int sock;
+	int port;
+	uint8_t *body;
+	size_t size;
+	uint8_t *retired[16]; /* Previous bodies, which connections being dropped may still send */
+	int retired_count;
+	char etag[32];
+	size_t drop_after;	/* Close the next response after this many bytes of the body, if not zero */
+	int requests;		/* Requests of the image */
+	int64_t last_range; /* Start of the last range requested, -1 if none */
+} server = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void send_all(int sock, const void *data, size_t len)
+{
+	while (len) {
+		ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+		if (n <= 0) {
+			return;
+		}
+
+		data = (const uint8_t *)data + n;
+		len -= n;
+	}
+}
+
+static void *serve_connection(void *arg)
+{
+	int sock = (int)(intptr_t)arg;
+	char req[4096];
+	char header[512];
+	size_t len = 0;
+
+	/* Read the whole request, which has no body */
+
+	while (len < sizeof(req) - 1) {
+		ssize_t n = recv(sock, req + len, sizeof(req) - 1 - len, 0);
+		if (n <= 0) {
+			goto finish;
+		}
+
+		len += n;
+		req[len] = '\0';
+
+		if (strstr(req, "\r\n\r\n")) {
+			break;
+		}
+	}
+
+	if (!strncmp(req, "GET /redirect ", strlen("GET /redirect "))) {
+		snprintf(header, sizeof(header), "HTTP/1.1 302 Found\r\nLocation: /image\r\nContent-Length: 0\r\n\r\n");
+		send_all(sock, header, strlen(header));
+		goto finish;
+	}
+
+	bool chunked = !strncmp(req, "GET /chunked ", strlen("GET /chunked "));
+
+	if (!chunked && strncmp(req, "GET /image ", strlen("GET /image "))) {
+		snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+		send_all(sock, header, strlen(header));
+		goto finish;
+	}
+
+	pthread_mutex_lock(&server.mutex);
+
+	const uint8_t *body = server.body;
+	size_t start = 0;
+	size_t end = server.size;
+	size_t drop_after = server.drop_after;
+	bool ranged = false;
+
+	server.drop_after = 0;
+	server.requests++;
+	server.last_range = -1;
+
+	const char *range = chunked ? NULL : strcasestr(req, "\r\nRange: bytes=");
+	const char *if_range = strcasestr(req, "\r\nIf-Range: ");
+
+	if (range && (!if_range || !strncmp(if_range + strlen("\r\nIf-Range: "), server.etag, strlen(server.etag)))) {
+		char *p;
+
+		start = strtoul(range + strlen("\r\nRange: bytes="), &p, 10);
+		if (*++p != '\r') {
+			end = strtoul(p, NULL, 10) + 1;
+		}
+
+		ranged = true;
+		server.last_range = start;
+	}
+
+	if (ranged && start >= server.size) {
+		snprintf(header, sizeof(header),
+			 "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%zu\r\n\r\n", server.size);
+	} else if (chunked) {
+		snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+	} else if (ranged) {
+		snprintf(header, sizeof(header),
+			 "HTTP/1.1 206 Partial Content\r\nETag: %s\r\nContent-Range: bytes %zu-%zu/%zu\r\n"
+			 "Content-Length: %zu\r\n\r\n",
+			 server.etag, start, end - 1, server.size, end - start);
+	} else {
+		snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nETag: %s\r\nContent-Length: %zu\r\n\r\n",
+			 server.etag, server.size);
+	}
+
+	pthread_mutex_unlock(&server.mutex);
+
+	send_all(sock, header, strlen(header));
+
+	/* Chunks of all sizes, one of them with an extension, and a trailer */
+
+	if (chunked) {
+		static const size_t sizes[] = {1, 2, 13, 4095, 4096, 4097, 65536};
+
+		for (int i = 0; start < end; i++) {
+			size_t n = sizes[i % (sizeof(sizes) / sizeof(sizes[0]))];
+
+			if (n > end - start) {
+				n = end - start;
+			}
+
+			snprintf(header, sizeof(header), i == 3 ? "%zx;name=value\r\n" : "%zX\r\n", n);
+			send_all(sock, header, strlen(header));
+			send_all(sock, body + start, n);
+			send_all(sock, "\r\n", 2);
+
+			start += n;
+		}
+
+		snprintf(header, sizeof(header), "0\r\nX-Trailer: done\r\n\r\n");
+		send_all(sock, header, strlen(header));
+		goto finish;
+	}
+
+	if (start < end) {
+		send_all(sock, body + start, drop_after && drop_after < end - start ? drop_after : end - start);
+	}
+
+finish:
+	close(sock);
+
+	return NULL;
+}
+
+static void *serve(void *arg)
+{
+	(void)arg;
+
+	for (;;) {
+		pthread_t thread;
+
+		int sock = accept(server.sock, NULL, NULL);
+		if (sock < 0) {
+			return NULL;
+		}
+
+		if (pthread_create(&thread, NULL, serve_connection, (void *)(intptr_t)sock)) {
+			close(sock);
+			continue;
+		}
+
+		pthread_detach(thread);
+	}
+}
+
+static void set_body(size_t size, const char *etag)
+{
+	pthread_mutex_lock(&server.mutex);
+
+	if (server.body) {
+		TEST_ASSERT_LESS_THAN(16, server.retired_count);
+		server.retired[server.retired_count++] = server.body;
+	}
+
+	server.body = malloc(size);
+	TEST_ASSERT_NOT_NULL(server.body);
+
+	for (size_t i = 0; i < size; i++) {
+		server.body[i] = (uint8_t)(i * 131 + etag[1]);
+	}
+
+	server.size = size;
+	snprintf(server.etag, sizeof(server.etag), "%s", etag);
+	server.requests = 0;
+
+	pthread_mutex_unlock(&server.mutex);
+}
+
+static void url(char *buf, size_t size, const char *path)
+{
+	snprintf(buf, size, "http://127.0.0.1:%d%s", server.port, path);
+}
+
+/* Checks the file and its digest against the body of the server */
+
+static void check_download(const char *digest)
+{
+	char expected[65] = {0};
+	struct sha256_buff buff;
+	struct stat st;
+
+	sha256_init(&buff);
+	sha256_update(&buff, server.body, server.size);
+	sha256_finalize(&buff);
+	sha256_read_hex(&buff, expected);
+
+	TEST_ASSERT_EQUAL_STRING(expected, digest);
+
+	TEST_ASSERT_EQUAL_INT(0, stat(TEST_FILE, &st));
+	TEST_ASSERT_EQUAL_INT(server.size, st.st_size);
+
+	FILE *f = fopen(TEST_FILE, "r");
+	TEST_ASSERT_NOT_NULL(f);
+
+	uint8_t *data = malloc(server.size);
+	TEST_ASSERT_NOT_NULL(data);
+	TEST_ASSERT_EQUAL_INT(server.size, fread(data, 1, server.size, f));
+	TEST_ASSERT_EQUAL_MEMORY(server.body, data, server.size);
+
+	free(data);
+	fclose(f);
+
+	/* Nothing is left to resume */
+
+	TEST_ASSERT_NOT_EQUAL(0, access(TEST_RESUME_FILE, F_OK));
+}
+
+void setUp(void)
+{
+	unlink(TEST_FILE);
+	unlink(TEST_RESUME_FILE);
+}
+
+void tearDown(void)
+{
+	unlink(TEST_FILE);
+	unlink(TEST_RESUME_FILE);
+}
+
+void test_download_ok(void)
+{
+	char buf[128];
+	char digest[65] = {0};
+
+	set_body(100000, "\"a\"");
+	url(buf, sizeof(buf), "/image");
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_download_file(buf, TEST_FILE, digest));
+	TEST_ASSERT_EQUAL_INT(1, server.requests);
+
+	check_download(digest);
+}
+
+void test_download_redirect(void)
+{
+	char buf[128];
+	char digest[65] = {0};
+
+	set_body(1000, "\"b\"");
+	url(buf, sizeof(buf), "/redirect");
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_download_file(buf, TEST_FILE, digest));
+
+	check_download(digest);
+}
+
+void test_download_parallel(void)
+{
+	char buf[128];
+	char digest[65] = {0};
+
+	/* Large enough to be fetched over several connections */
+
+	set_body(9 * 1024 * 1024 + 3, "\"c\"");
+	url(buf, sizeof(buf), "/image");
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_download_file(buf, TEST_FILE, digest));
+	TEST_ASSERT_GREATER_THAN(1, server.requests);
+
+	check_download(digest);
+}
+
+void test_download_chunked(void)
+{
+	char buf[128];
+	char digest[65] = {0};
+
+	/* No Content-Length, so it is not split in ranges */
+
+	set_body(300000, "\"h\"");
+	url(buf, sizeof(buf), "/chunked");
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_download_file(buf, TEST_FILE, digest));
+	TEST_ASSERT_EQUAL_INT(1, server.requests);
+
+	check_download(digest);
+}
+
+void test_download_resume(void)
+{
+	char buf[128];
+	char digest[65] = {0};
+
+	set_body(100000, "\"d\"");
+	url(buf, sizeof(buf), "/image");
+
+	/* The connection is lost, what was received is kept */
+
+	server.drop_after = 40000;
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_download_file(buf, TEST_FILE, digest));
+	TEST_ASSERT_EQUAL_INT(0, access(TEST_RESUME_FILE, F_OK));
+
+	/* Only the rest is asked for */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_download_file(buf, TEST_FILE, digest));
+	TEST_ASSERT_EQUAL_INT(40000, server.last_range);
+
+	check_download(digest);
+}
+
+void test_download_parallel_resume(void)
+{
+	char buf[128];
+	char digest[65] = {0};
+
+	set_body(9 * 1024 * 1024 + 3, "\"g\"");
+	url(buf, sizeof(buf), "/image");
+
+	/* The first range is cut short, the other ranges are dropped with it */
+
+	server.drop_after = 40000;
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_download_file(buf, TEST_FILE, digest));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_download_file(buf, TEST_FILE, digest));
+
+	check_download(digest);
+}
+
+void test_download_resume_changed(void)
+{
+	char buf[128];
+	char digest[65] = {0};
+
+	set_body(100000, "\"e\"");
+	url(buf, sizeof(buf), "/image");
+
+	server.drop_after = 40000;
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_download_file(buf, TEST_FILE, digest));
+
+	/* The image changed on the server, so it is downloaded again from the start */
+
+	set_body(70000, "\"f\"");
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_download_file(buf, TEST_FILE, digest));
+	TEST_ASSERT_EQUAL_INT(-1, server.last_range);
+
+	check_download(digest);
+}
+
+void test_download_not_found(void)
+{
+	char buf[128];
+	char digest[65] = {0};
+
+	url(buf, sizeof(buf), "/missing");
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_download_file(buf, TEST_FILE, digest));
+	TEST_ASSERT_NOT_EQUAL(0, access(TEST_FILE, F_OK));
+}
+
+void test_download_bad_urls(void)
+{
+	char digest[65] = {0};
+
+	TEST_ASSERT_NOT_EQUAL(0, ocre_download_file("https://127.0.0.1/image", TEST_FILE, digest));
+	TEST_ASSERT_NOT_EQUAL(0, ocre_download_file("ftp://127.0.0.1/image", TEST_FILE, digest));
+	TEST_ASSERT_NOT_EQUAL(0, ocre_download_file("http:///image", TEST_FILE, digest));
+	TEST_ASSERT_NOT_EQUAL(0, ocre_download_file("http://127.0.0.1:123456/image", TEST_FILE, digest));
+}
+
+int main(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t addr_len = sizeof(addr);
+	pthread_t thread;
+
+	server.sock = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (server.sock < 0 || bind(server.sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    getsockname(server.sock, (struct sockaddr *)&addr, &addr_len) || listen(server.sock, 16) ||
+	    pthread_create(&thread, NULL, serve, NULL)) {
+		fprintf(stderr, "Failed to start the HTTP server: errno=%d\n", errno);
+		return EXIT_FAILURE;
+	}
+
+	server.port = ntohs(addr.sin_port);
+
+	UNITY_BEGIN();
+	RUN_TEST(test_download_ok);
+	RUN_TEST(test_download_redirect);
+	RUN_TEST(test_download_parallel);
+	RUN_TEST(test_download_chunked);
+	RUN_TEST(test_download_resume);
+	RUN_TEST(test_download_parallel_resume);
+	RUN_TEST(test_download_resume_changed);
+	RUN_TEST(test_download_not_found);
+	RUN_TEST(test_download_bad_urls);
+	return UNITY_END();
+}
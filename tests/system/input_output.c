@@ -5,6 +5,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -136,11 +137,80 @@ void test_ocre_container_input_stdin_output_stderr(void)
 	ocre_context_remove_container(context, container);
 }
 
+void test_ocre_container_output_captured(void)
+{
+	const struct ocre_container_args args = {
+		.argv =
+			(const char *[]){
+				ARG_TEST_STRING,
+				NULL,
+			},
+		.capture_logs = true,
+	};
+
+	struct ocre_container *container =
+		ocre_context_create_container(context, "print_args.wasm", "wamr/wasip1", NULL, true, &args,
+					      STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	char buf[1000];
+	uint64_t cursor = 0;
+
+	/* Nothing written yet */
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_read_logs(container, &cursor, buf, sizeof(buf), 0));
+
+	TEST_ASSERT_EQUAL_INT(0, ocre_container_start(container));
+
+	ocre_container_wait(container, NULL);
+
+	/* The output may still be on its way to the ring buffer */
+
+	memset(buf, 0, sizeof(buf));
+
+	size_t len = 0;
+	while (!strstr(buf, "argv[1]=" ARG_TEST_STRING "\n")) {
+		int n = ocre_container_read_logs(container, &cursor, buf + len, sizeof(buf) - 1 - len, 1000);
+		TEST_ASSERT_GREATER_THAN_INT(0, n);
+		len += n;
+	}
+
+	TEST_ASSERT_EQUAL_UINT64(len, cursor);
+
+	/* Reading again from the start gives the same output */
+
+	char again[1000];
+	cursor = 0;
+
+	TEST_ASSERT_EQUAL_INT(len, ocre_container_read_logs(container, &cursor, again, sizeof(again), 0));
+	TEST_ASSERT_EQUAL_MEMORY(buf, again, len);
+
+	ocre_context_remove_container(context, container);
+}
+
+void test_ocre_container_output_not_captured(void)
+{
+	char buf[16];
+	uint64_t cursor = 0;
+
+	struct ocre_container *container =
+		ocre_context_create_container(context, "print_args.wasm", "wamr/wasip1", NULL, true, NULL, STDIN_FILENO,
+					      STDOUT_FILENO, STDERR_FILENO);
+	TEST_ASSERT_NOT_NULL(container);
+
+	TEST_ASSERT_LESS_THAN_INT(0, ocre_container_read_logs(container, &cursor, buf, sizeof(buf), 0));
+	TEST_ASSERT_LESS_THAN_INT(0, ocre_container_read_logs(NULL, &cursor, buf, sizeof(buf), 0));
+
+	ocre_context_remove_container(context, container);
+}
+
 int main(void)
 {
 	UNITY_BEGIN();
 	RUN_TEST(test_ocre_container_output_stdout);
 	RUN_TEST(test_ocre_container_input_stdin_output_stdout);
 	RUN_TEST(test_ocre_container_input_stdin_output_stderr);
+	RUN_TEST(test_ocre_container_output_captured);
+	RUN_TEST(test_ocre_container_output_not_captured);
 	return UNITY_END();
 }
@@ -6,6 +6,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include <unity.h>
 #include <ocre/ocre.h>
@@ -44,6 +45,30 @@ void test_ocre_initialize_arr_null(void)
 	ocre_deinitialize();
 }
 
+void test_ocre_metrics_dump(void)
+{
+	char small[16];
+	char buf[16384];
+
+	/* Works like snprintf */
+
+	size_t len = ocre_metrics_dump(NULL, 0);
+	TEST_ASSERT_GREATER_THAN(0, len);
+	TEST_ASSERT_LESS_THAN(sizeof(buf), len);
+
+	TEST_ASSERT_EQUAL(len, ocre_metrics_dump(small, sizeof(small)));
+	TEST_ASSERT_EQUAL(sizeof(small) - 1, strlen(small));
+
+	TEST_ASSERT_EQUAL(len, ocre_metrics_dump(buf, sizeof(buf)));
+	TEST_ASSERT_EQUAL(len, strlen(buf));
+
+	/* Prometheus text format */
+
+	TEST_ASSERT_NOT_NULL(strstr(buf, "# TYPE ocre_containers gauge\n"));
+	TEST_ASSERT_NOT_NULL(strstr(buf, "# TYPE ocre_container_transitions_total counter\n"));
+	TEST_ASSERT_NOT_NULL(strstr(buf, "ocre_container_start_duration_seconds_bucket{le=\"+Inf\"} "));
+}
+
 static int dummy_runtime_init_ok(void)
 {
 	return 0;
@@ -136,6 +161,7 @@ int main(void)
 	RUN_TEST(test_ocre_initialize_vtable_init_ok);
 	RUN_TEST(test_ocre_initialize_vtable_init_err);
 	RUN_TEST(test_ocre_initialize_duplicate);
+	RUN_TEST(test_ocre_metrics_dump);
 	RUN_TEST(test_ocre_initialize_init_called);
 	return UNITY_END();
 }
@@ -0,0 +1,354 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Tests of the shell daemon, with the remote client of the shell against a server on a socket of the test */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <unity.h>
+#include <ocre/ocre.h>
+#include <ocre/shell/shell.h>
+
+#include "protocol.h"
+
+static struct ocre_context *context;
+static struct ocre_shell_server *server;
+static char socket_path[64];
+
+/* Output of the last remote command */
+
+static char out[4096];
+static char err[4096];
+
+/* Reads what was written to a redirected stream and restores it */
+
+static void restore_stream(FILE *stream, int fd, int saved, FILE *capture, char *buf, size_t size)
+{
+	fflush(stream);
+	dup2(saved, fd);
+	close(saved);
+
+	rewind(capture);
+	size_t n = fread(buf, 1, size - 1, capture);
+	buf[n] = '\0';
+
+	fclose(capture);
+}
+
+/* Runs a command in the daemon, with the output written to out and err */
+
+static int remote(int argc, char *argv[], int *status)
+{
+	FILE *out_capture = tmpfile();
+	FILE *err_capture = tmpfile();
+	TEST_ASSERT_NOT_NULL(out_capture);
+	TEST_ASSERT_NOT_NULL(err_capture);
+
+	fflush(stdout);
+	fflush(stderr);
+
+	int saved_out = dup(STDOUT_FILENO);
+	int saved_err = dup(STDERR_FILENO);
+	TEST_ASSERT_GREATER_OR_EQUAL(0, saved_out);
+	TEST_ASSERT_GREATER_OR_EQUAL(0, saved_err);
+
+	dup2(fileno(out_capture), STDOUT_FILENO);
+	dup2(fileno(err_capture), STDERR_FILENO);
+
+	int rc = ocre_shell_remote(socket_path, argc, argv, status);
+
+	restore_stream(stdout, STDOUT_FILENO, saved_out, out_capture, out, sizeof(out));
+	restore_stream(stderr, STDERR_FILENO, saved_err, err_capture, err, sizeof(err));
+
+	return rc;
+}
+
+static int connect_raw(void)
+{
+	struct sockaddr_un addr = {
+		.sun_family = AF_UNIX,
+	};
+
+	strcpy(addr.sun_path, socket_path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+	TEST_ASSERT_EQUAL_INT(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+	return fd;
+}
+
+/* Sends a command without waiting for its result */
+
+static void send_raw(int fd, int argc, char *argv[])
+{
+	unsigned char message[256];
+	size_t len = OCRE_SHELL_HEADER_SIZE;
+
+	message[0] = OCRE_SHELL_MESSAGE_COMMAND;
+	message[len++] = OCRE_SHELL_PROTOCOL_VERSION;
+
+	for (int i = 0; i < argc; i++) {
+		size_t size = strlen(argv[i]) + 1;
+		TEST_ASSERT_TRUE(len + size <= sizeof(message));
+
+		memcpy(message + len, argv[i], size);
+		len += size;
+	}
+
+	uint32_t payload = (uint32_t)(len - OCRE_SHELL_HEADER_SIZE);
+
+	message[1] = (unsigned char)(payload >> 24);
+	message[2] = (unsigned char)(payload >> 16);
+	message[3] = (unsigned char)(payload >> 8);
+	message[4] = (unsigned char)payload;
+
+	TEST_ASSERT_EQUAL_INT(len, send(fd, message, len, MSG_NOSIGNAL));
+}
+
+void setUp(void)
+{
+	snprintf(socket_path, sizeof(socket_path), "/tmp/ocre-test-remote-%d.sock", (int)getpid());
+
+	ocre_initialize(NULL);
+	context = ocre_create_context(NULL);
+	TEST_ASSERT_NOT_NULL(context);
+
+	server = ocre_shell_server_start(context, socket_path);
+	TEST_ASSERT_NOT_NULL(server);
+}
+
+void tearDown(void)
+{
+	ocre_shell_server_stop(server);
+	server = NULL;
+
+	ocre_destroy_context(context);
+	ocre_deinitialize();
+}
+
+void test_remote_ps_empty(void)
+{
+	int status = -1;
+
+	TEST_ASSERT_EQUAL_INT(0, remote(2, (char *[]){"ocre", "ps", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+	TEST_ASSERT_EQUAL_STRING("", out);
+	TEST_ASSERT_EQUAL_STRING("", err);
+}
+
+void test_remote_socket_private(void)
+{
+	struct stat st;
+
+	/* Only the user of the daemon may connect */
+
+	TEST_ASSERT_EQUAL_INT(0, stat(socket_path, &st));
+	TEST_ASSERT_TRUE(S_ISSOCK(st.st_mode));
+	TEST_ASSERT_EQUAL_INT(0600, st.st_mode & 0777);
+}
+
+void test_remote_create_start_wait(void)
+{
+	int status = -1;
+
+	TEST_ASSERT_EQUAL_INT(0,
+			      remote(5, (char *[]){"ocre", "create", "-n", "remote1", "return1.wasm", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+	TEST_ASSERT_EQUAL_STRING("remote1\n", out);
+
+	TEST_ASSERT_EQUAL_INT(0, remote(2, (char *[]){"ocre", "ps", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+	TEST_ASSERT_NOT_NULL(strstr(out, "ID\tSTATUS\tIMAGE\tMEMORY\n"));
+	TEST_ASSERT_NOT_NULL(strstr(out, "remote1\tCREATED\treturn1.wasm\t"));
+
+	TEST_ASSERT_EQUAL_INT(0, remote(3, (char *[]){"ocre", "start", "remote1", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+	TEST_ASSERT_EQUAL_STRING("remote1\n", out);
+
+	/* The exit code of the container is the output of wait, not its result */
+
+	TEST_ASSERT_EQUAL_INT(0, remote(3, (char *[]){"ocre", "wait", "remote1", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+	TEST_ASSERT_EQUAL_STRING("1\n", out);
+
+	TEST_ASSERT_EQUAL_INT(0, remote(3, (char *[]){"ocre", "rm", "remote1", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+}
+
+void test_remote_bad_command(void)
+{
+	int status = 0;
+
+	TEST_ASSERT_EQUAL_INT(0, remote(2, (char *[]){"ocre", "nope", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(-1, status);
+	TEST_ASSERT_EQUAL_STRING("", out);
+	TEST_ASSERT_NOT_NULL(strstr(err, "Invalid command: 'ocre nope'"));
+	TEST_ASSERT_NOT_NULL(strstr(err, "Usage: ocre"));
+
+	/* The command failed, not the daemon */
+
+	status = 0;
+
+	TEST_ASSERT_EQUAL_INT(0, remote(3, (char *[]){"ocre", "wait", "missing", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(-1, status);
+	TEST_ASSERT_NOT_NULL(strstr(err, "Failed to get container 'missing'"));
+}
+
+void test_remote_no_daemon(void)
+{
+	int status;
+
+	ocre_shell_server_stop(server);
+	server = NULL;
+
+	TEST_ASSERT_EQUAL_INT(-ENOENT, remote(2, (char *[]){"ocre", "ps", NULL}, &status));
+
+	server = ocre_shell_server_start(context, socket_path);
+	TEST_ASSERT_NOT_NULL(server);
+
+	/* Only one daemon per socket */
+
+	TEST_ASSERT_NULL(ocre_shell_server_start(context, socket_path));
+}
+
+void test_remote_oversize_command(void)
+{
+	int status;
+
+	/* Rejected by the client */
+
+	char *big = malloc(OCRE_SHELL_MAX_COMMAND_SIZE);
+	TEST_ASSERT_NOT_NULL(big);
+
+	memset(big, 'a', OCRE_SHELL_MAX_COMMAND_SIZE - 1);
+	big[OCRE_SHELL_MAX_COMMAND_SIZE - 1] = '\0';
+
+	TEST_ASSERT_EQUAL_INT(-E2BIG, remote(3, (char *[]){"ocre", "ps", big, NULL}, &status));
+
+	free(big);
+
+	/* Rejected by the server, which closes the connection without reading the payload */
+
+	int fd = connect_raw();
+
+	unsigned char header[OCRE_SHELL_HEADER_SIZE] = {OCRE_SHELL_MESSAGE_COMMAND};
+	uint32_t len = OCRE_SHELL_MAX_COMMAND_SIZE + 1;
+
+	header[1] = (unsigned char)(len >> 24);
+	header[2] = (unsigned char)(len >> 16);
+	header[3] = (unsigned char)(len >> 8);
+	header[4] = (unsigned char)len;
+
+	TEST_ASSERT_EQUAL_INT(sizeof(header), send(fd, header, sizeof(header), MSG_NOSIGNAL));
+
+	char reply;
+	TEST_ASSERT_EQUAL_INT(0, recv(fd, &reply, 1, 0));
+
+	close(fd);
+
+	/* The daemon still serves other clients */
+
+	TEST_ASSERT_EQUAL_INT(0, remote(2, (char *[]){"ocre", "ps", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+}
+
+void test_remote_stop_connected(void)
+{
+	int status;
+
+	/* A client which connected but did not send its command yet. Connections are accepted in order, so it is served
+	 * once the next command ran
+	 */
+
+	int fd = connect_raw();
+
+	TEST_ASSERT_EQUAL_INT(0, remote(2, (char *[]){"ocre", "ps", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+
+	/* Returns once the client is disconnected */
+
+	ocre_shell_server_stop(server);
+	server = NULL;
+
+	char reply;
+	TEST_ASSERT_EQUAL_INT(0, recv(fd, &reply, 1, 0));
+
+	close(fd);
+
+	TEST_ASSERT_NOT_EQUAL(0, access(socket_path, F_OK));
+
+	server = ocre_shell_server_start(context, socket_path);
+	TEST_ASSERT_NOT_NULL(server);
+}
+
+void test_remote_stop_waiting(void)
+{
+	int status;
+
+	TEST_ASSERT_EQUAL_INT(
+		0, remote(5, (char *[]){"ocre", "create", "-n", "sleeper", "sleep5_return0.wasm", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+
+	TEST_ASSERT_EQUAL_INT(0, remote(3, (char *[]){"ocre", "start", "sleeper", NULL}, &status));
+	TEST_ASSERT_EQUAL_INT(0, status);
+
+	struct ocre_container *sleeper = ocre_context_get_container_by_id(context, "sleeper");
+	TEST_ASSERT_NOT_NULL(sleeper);
+
+	/* A command which does not write anything until the container exits */
+
+	int fd = connect_raw();
+
+	send_raw(fd, 3, (char *[]){"ocre", "wait", "sleeper"});
+
+	struct timespec ts = {0, 200000000L};
+	nanosleep(&ts, NULL);
+
+	/* Returns once the container is killed, before it would have exited */
+
+	ocre_shell_server_stop(server);
+	server = NULL;
+
+	TEST_ASSERT_EQUAL_INT(OCRE_CONTAINER_STATUS_STOPPED, ocre_container_get_status(sleeper));
+
+	char reply;
+	TEST_ASSERT_EQUAL_INT(0, recv(fd, &reply, 1, 0));
+
+	close(fd);
+
+	server = ocre_shell_server_start(context, socket_path);
+	TEST_ASSERT_NOT_NULL(server);
+}
+
+int main(void)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_remote_ps_empty);
+	RUN_TEST(test_remote_socket_private);
+	RUN_TEST(test_remote_create_start_wait);
+	RUN_TEST(test_remote_bad_command);
+	RUN_TEST(test_remote_no_daemon);
+	RUN_TEST(test_remote_oversize_command);
+	RUN_TEST(test_remote_stop_connected);
+	RUN_TEST(test_remote_stop_waiting);
+	return UNITY_END();
+}
@@ -0,0 +1,127 @@
+/**
+ * @copyright Copyright (c) contributors to Project Ocre,
+ * which has been established as Project Ocre a Series of LF Projects, LLC
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unity.h>
+
+#include "sha256/sha256.h"
+
+/* Known answers from FIPS 180-4 examples, run through every implementation the CPU supports */
+
+static const struct {
+	const char *message;
+	const char *digest;
+} vectors[] = {
+	{"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+	{"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+	{"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+	{"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrst"
+	 "nopqrstu",
+	 "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+};
+
+#define MILLION_A_DIGEST "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+	sha256_force_scalar(0);
+}
+
+static void check_vectors(void)
+{
+	char hex[65] = {0};
+	struct sha256_buff buff;
+
+	for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+		sha256_init(&buff);
+		sha256_update(&buff, vectors[i].message, strlen(vectors[i].message));
+		sha256_finalize(&buff);
+		sha256_read_hex(&buff, hex);
+
+		TEST_ASSERT_EQUAL_STRING(vectors[i].digest, hex);
+	}
+}
+
+/* One million 'a', fed in uneven pieces so that blocks straddle the calls */
+
+static void check_million_a(void)
+{
+	static uint8_t data[1000000];
+	char hex[65] = {0};
+	struct sha256_buff buff;
+	size_t offset = 0;
+	size_t piece = 1;
+
+	memset(data, 'a', sizeof(data));
+
+	sha256_init(&buff);
+
+	while (offset < sizeof(data)) {
+		size_t len = piece < sizeof(data) - offset ? piece : sizeof(data) - offset;
+
+		sha256_update(&buff, data + offset, len);
+
+		offset += len;
+		piece = (piece * 7 + 3) % 4099;
+	}
+
+	sha256_finalize(&buff);
+	sha256_read_hex(&buff, hex);
+
+	TEST_ASSERT_EQUAL_STRING(MILLION_A_DIGEST, hex);
+}
+
+void test_sha256_backend(void)
+{
+	TEST_ASSERT_NOT_NULL(sha256_backend());
+
+	sha256_force_scalar(1);
+
+	TEST_ASSERT_EQUAL_STRING("scalar", sha256_backend());
+}
+
+void test_sha256_vectors(void)
+{
+	check_vectors();
+}
+
+void test_sha256_vectors_scalar(void)
+{
+	sha256_force_scalar(1);
+
+	check_vectors();
+}
+
+void test_sha256_million_a(void)
+{
+	check_million_a();
+}
+
+void test_sha256_million_a_scalar(void)
+{
+	sha256_force_scalar(1);
+
+	check_million_a();
+}
+
+int main(void)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_sha256_backend);
+	RUN_TEST(test_sha256_vectors);
+	RUN_TEST(test_sha256_vectors_scalar);
+	RUN_TEST(test_sha256_million_a);
+	RUN_TEST(test_sha256_million_a_scalar);
+	return UNITY_END();
+}
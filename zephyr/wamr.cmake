@@ -70,6 +70,13 @@ set(WAMR_BUILD_LIB_PTHREAD 0)
 set(WAMR_BUILD_REF_TYPES 1)
 set(WAMR_BUILD_SHARED_HEAP 1)
 set(WASM_ENABLE_LOG 1)
+if (CONFIG_OCRE_WAMR_PROFILING)
+    set(WAMR_BUILD_PERF_PROFILING 1)
+    set(WAMR_BUILD_MEMORY_PROFILING 1)
+    set(WAMR_BUILD_CUSTOM_NAME_SECTION 1)
+    set(WAMR_BUILD_COPY_CALL_STACK 1)
+    set(WAMR_BH_VPRINTF wamr_profile_vprintf)
+endif()
 
 enable_language (ASM)
 